@@ -0,0 +1,587 @@
+"""Benchmarks of the conversion and dispatch hot paths of blpapi.
+
+The events are built with 'blpapi.test', from the schemas below, so that
+no connection is needed. Each benchmark processes every message of an
+event and reports its throughput in messages per second, together with the
+peak memory allocated per message while processing the event.
+
+The results can be saved as JSON and compared to a baseline, the script
+exiting with a non-zero status if a benchmark is slower than the baseline
+by more than the given tolerance.
+"""
+
+from argparse import ArgumentParser, RawTextHelpFormatter
+import datetime
+import gc
+import json
+import platform
+import sys
+import time
+import tracemalloc
+
+import blpapi
+from blpapi import internals
+
+# pylint: disable=line-too-long
+MKTDATA_SCHEMA = """<?xml version="1.0" encoding="UTF-8" ?>
+<ServiceDefinition name="blp.mktdata" version="1.0.1.0">
+   <service name="//blp/mktdata" version="1.0.0.0">
+      <event name="MarketDataEvents" eventType="MarketDataUpdate">
+         <eventId>0</eventId>
+         <eventId>9999</eventId>
+      </event>
+      <defaultServiceId>134217729</defaultServiceId>
+      <publisherSupportsRecap>true</publisherSupportsRecap>
+      <recapEventId>9999</recapEventId>
+   </service>
+   <schema>
+      <sequenceType name="MarketDataUpdate">
+         <element name="LAST_PRICE" type="Float64" minOccurs="0" maxOccurs="1"/>
+         <element name="BID" type="Float64" minOccurs="0" maxOccurs="1"/>
+         <element name="ASK" type="Float64" minOccurs="0" maxOccurs="1"/>
+         <element name="HIGH" type="Float64" minOccurs="0" maxOccurs="1"/>
+         <element name="LOW" type="Float64" minOccurs="0" maxOccurs="1"/>
+         <element name="OPEN" type="Float64" minOccurs="0" maxOccurs="1"/>
+         <element name="VWAP" type="Float64" minOccurs="0" maxOccurs="1"/>
+         <element name="BID_SIZE" type="Int64" minOccurs="0" maxOccurs="1"/>
+         <element name="ASK_SIZE" type="Int64" minOccurs="0" maxOccurs="1"/>
+         <element name="VOLUME" type="Int64" minOccurs="0" maxOccurs="1"/>
+         <element name="NUM_TRADES" type="Int64" minOccurs="0" maxOccurs="1"/>
+         <element name="SIZE_LAST_TRADE" type="Int64" minOccurs="0" maxOccurs="1"/>
+         <element name="TRADING_DT" type="Date" minOccurs="0" maxOccurs="1"/>
+         <element name="TRADE_UPDATE_STAMP" type="Time" minOccurs="0" maxOccurs="1"/>
+         <element name="EVT_TRADE_TIME" type="Datetime" minOccurs="0" maxOccurs="1"/>
+         <element name="MKTDATA_EVENT_TYPE" type="String" minOccurs="0" maxOccurs="1"/>
+         <element name="MKTDATA_EVENT_SUBTYPE" type="String" minOccurs="0" maxOccurs="1"/>
+         <element name="TICKER" type="String" minOccurs="0" maxOccurs="1"/>
+         <element name="EXCH_CODE" type="String" minOccurs="0" maxOccurs="1"/>
+         <element name="IS_DELAYED_STREAM" type="Bool" minOccurs="0" maxOccurs="1"/>
+      </sequenceType>
+   </schema>
+</ServiceDefinition>
+"""
+
+REFDATA_SCHEMA = """<?xml version="1.0" encoding="UTF-8" ?>
+<ServiceDefinition name="blp.refdata" version="1.0.1.0">
+   <service name="//blp/refdata" version="1.0.0.0">
+      <operation name="ReferenceDataRequest" serviceId="84">
+         <request>ReferenceDataRequest</request>
+         <response>Response</response>
+         <responseSelection>ReferenceDataResponse</responseSelection>
+      </operation>
+      <operation name="HistoricalDataRequest" serviceId="84">
+         <request>HistoricalDataRequest</request>
+         <response>Response</response>
+         <responseSelection>HistoricalDataResponse</responseSelection>
+      </operation>
+   </service>
+   <schema>
+      <sequenceType name="ReferenceDataRequest">
+         <element name="securities" type="String" maxOccurs="unbounded"/>
+         <element name="fields" type="String" maxOccurs="unbounded"/>
+      </sequenceType>
+      <sequenceType name="HistoricalDataRequest">
+         <element name="securities" type="String" maxOccurs="unbounded"/>
+         <element name="fields" type="String" maxOccurs="unbounded"/>
+         <element name="startDate" type="String"/>
+         <element name="endDate" type="String"/>
+      </sequenceType>
+      <choiceType name="Response">
+         <element name="ReferenceDataResponse" type="ReferenceDataResponseType"/>
+         <element name="HistoricalDataResponse" type="HistoricalDataResponseType"/>
+      </choiceType>
+      <sequenceType name="ReferenceDataResponseType">
+         <element name="securityData" type="ReferenceSecurityData" minOccurs="1" maxOccurs="unbounded"/>
+      </sequenceType>
+      <sequenceType name="ReferenceSecurityData">
+         <element name="security" type="String"/>
+         <element name="sequenceNumber" type="Int64" minOccurs="0" maxOccurs="1"/>
+         <element name="fieldData" type="ReferenceFieldData"/>
+      </sequenceType>
+      <sequenceType name="ReferenceFieldData">
+         <element name="PX_LAST" type="Float64" minOccurs="0" maxOccurs="1"/>
+         <element name="PX_BID" type="Float64" minOccurs="0" maxOccurs="1"/>
+         <element name="PX_ASK" type="Float64" minOccurs="0" maxOccurs="1"/>
+         <element name="CUR_MKT_CAP" type="Float64" minOccurs="0" maxOccurs="1"/>
+         <element name="VOLUME_AVG_30D" type="Float64" minOccurs="0" maxOccurs="1"/>
+         <element name="EQY_SH_OUT" type="Float64" minOccurs="0" maxOccurs="1"/>
+         <element name="NAME" type="String" minOccurs="0" maxOccurs="1"/>
+         <element name="CRNCY" type="String" minOccurs="0" maxOccurs="1"/>
+         <element name="GICS_SECTOR_NAME" type="String" minOccurs="0" maxOccurs="1"/>
+         <element name="LAST_UPDATE_DT" type="Date" minOccurs="0" maxOccurs="1"/>
+      </sequenceType>
+      <sequenceType name="HistoricalDataResponseType">
+         <element name="securityData" type="HistoricalSecurityData"/>
+      </sequenceType>
+      <sequenceType name="HistoricalSecurityData">
+         <element name="security" type="String"/>
+         <element name="sequenceNumber" type="Int64" minOccurs="0" maxOccurs="1"/>
+         <element name="fieldData" type="HistoricalFieldData" minOccurs="0" maxOccurs="unbounded"/>
+      </sequenceType>
+      <sequenceType name="HistoricalFieldData">
+         <element name="date" type="Date"/>
+         <element name="PX_OPEN" type="Float64" minOccurs="0" maxOccurs="1"/>
+         <element name="PX_HIGH" type="Float64" minOccurs="0" maxOccurs="1"/>
+         <element name="PX_LOW" type="Float64" minOccurs="0" maxOccurs="1"/>
+         <element name="PX_LAST" type="Float64" minOccurs="0" maxOccurs="1"/>
+         <element name="VOLUME" type="Int64" minOccurs="0" maxOccurs="1"/>
+      </sequenceType>
+   </schema>
+</ServiceDefinition>
+"""
+# pylint: enable=line-too-long
+
+MARKET_DATA_EVENTS = blpapi.Name("MarketDataEvents")
+REFERENCE_DATA_REQUEST = blpapi.Name("ReferenceDataRequest")
+HISTORICAL_DATA_REQUEST = blpapi.Name("HistoricalDataRequest")
+
+FLOAT_FIELDS = [
+    blpapi.Name(name)
+    for name in ("LAST_PRICE", "BID", "ASK", "HIGH", "LOW", "OPEN", "VWAP")
+]
+INT_FIELDS = [
+    blpapi.Name(name)
+    for name in (
+        "BID_SIZE",
+        "ASK_SIZE",
+        "VOLUME",
+        "NUM_TRADES",
+        "SIZE_LAST_TRADE",
+    )
+]
+STRING_FIELDS = [
+    blpapi.Name(name)
+    for name in (
+        "MKTDATA_EVENT_TYPE",
+        "MKTDATA_EVENT_SUBTYPE",
+        "TICKER",
+        "EXCH_CODE",
+    )
+]
+ALL_FIELDS = FLOAT_FIELDS + INT_FIELDS + STRING_FIELDS
+
+
+def marketDataTick(index):
+    """Return the content of the 'index'th synthetic market data tick."""
+    price = 100.0 + (index % 100) * 0.01
+    return {
+        "LAST_PRICE": price,
+        "BID": price - 0.01,
+        "ASK": price + 0.01,
+        "HIGH": price + 1.0,
+        "LOW": price - 1.0,
+        "OPEN": 100.0,
+        "VWAP": price + 0.005,
+        "BID_SIZE": 100 + index % 7,
+        "ASK_SIZE": 200 + index % 11,
+        "VOLUME": 1000000 + index,
+        "NUM_TRADES": 5000 + index,
+        "SIZE_LAST_TRADE": 100,
+        "TRADING_DT": datetime.date(2024, 6, 3),
+        "TRADE_UPDATE_STAMP": datetime.time(14, 30, index % 60),
+        "EVT_TRADE_TIME": datetime.datetime(
+            2024, 6, 3, 14, 30, index % 60, 125000
+        ),
+        "MKTDATA_EVENT_TYPE": "TRADE",
+        "MKTDATA_EVENT_SUBTYPE": "NEW",
+        "TICKER": "IBM",
+        "EXCH_CODE": "US",
+        "IS_DELAYED_STREAM": False,
+    }
+
+
+def referenceDataResponse(numSecurities):
+    """Return the content of a synthetic 'ReferenceDataResponse'."""
+    return {
+        "securityData": [
+            {
+                "security": f"SEC{i} US Equity",
+                "sequenceNumber": i,
+                "fieldData": {
+                    "PX_LAST": 100.0 + i,
+                    "PX_BID": 99.9 + i,
+                    "PX_ASK": 100.1 + i,
+                    "CUR_MKT_CAP": 1.5e11 + i,
+                    "VOLUME_AVG_30D": 4.2e6,
+                    "EQY_SH_OUT": 9.1e8,
+                    "NAME": f"SECURITY {i} CORP",
+                    "CRNCY": "USD",
+                    "GICS_SECTOR_NAME": "Information Technology",
+                    "LAST_UPDATE_DT": datetime.date(2024, 6, 3),
+                },
+            }
+            for i in range(numSecurities)
+        ]
+    }
+
+
+def historicalDataResponse(numDays):
+    """Return the content of a synthetic 'HistoricalDataResponse'."""
+    start = datetime.date(2023, 1, 2)
+    return {
+        "securityData": {
+            "security": "IBM US Equity",
+            "sequenceNumber": 0,
+            "fieldData": [
+                {
+                    "date": start + datetime.timedelta(days=i),
+                    "PX_OPEN": 140.0 + i * 0.1,
+                    "PX_HIGH": 141.0 + i * 0.1,
+                    "PX_LOW": 139.0 + i * 0.1,
+                    "PX_LAST": 140.5 + i * 0.1,
+                    "VOLUME": 3000000 + i,
+                }
+                for i in range(numDays)
+            ],
+        }
+    }
+
+
+class Fixtures:
+    """The synthetic events the benchmarks process."""
+
+    def __init__(self, options):
+        self.mktdataService = blpapi.test.deserializeService(MKTDATA_SCHEMA)
+        self.refdataService = blpapi.test.deserializeService(REFDATA_SCHEMA)
+        self.topic = blpapi.test.createTopic(self.mktdataService)
+
+        marketDataDef = self.mktdataService.getEventDefinition(
+            MARKET_DATA_EVENTS
+        )
+        self.ticks = [marketDataTick(i) for i in range(options.messages)]
+        self.marketData = blpapi.test.createEvent(
+            blpapi.Event.SUBSCRIPTION_DATA
+        )
+        for tick in self.ticks:
+            formatter = blpapi.test.appendMessage(
+                self.marketData, marketDataDef
+            )
+            formatter.formatMessageDict(tick)
+
+        self.referenceData = self.__response(
+            REFERENCE_DATA_REQUEST, referenceDataResponse(options.securities)
+        )
+        self.historicalData = self.__response(
+            HISTORICAL_DATA_REQUEST, historicalDataResponse(options.days)
+        )
+
+    def __response(self, operation, content):
+        event = blpapi.test.createEvent(blpapi.Event.RESPONSE)
+        definition = self.refdataService.getOperation(
+            operation
+        ).getResponseDefinitionAt(0)
+        formatter = blpapi.test.appendMessage(event, definition)
+        # JSON, to cover the other formatting path of the test utilities
+        formatter.formatMessageJson(json.dumps(content, default=str))
+        return event
+
+
+BENCHMARKS = []
+
+
+def benchmark(name):
+    """Register the decorated function as the benchmark 'name'. The function
+    takes the 'Fixtures' and returns '(run, numMessages)', where 'run()'
+    processes 'numMessages' messages."""
+
+    def register(func):
+        BENCHMARKS.append((name, func))
+        return func
+
+    return register
+
+
+@benchmark("event_iteration")
+def eventIteration(fixtures):
+    event = fixtures.marketData
+
+    def run():
+        for message in event:
+            message.messageType()
+
+    return run, len(fixtures.ticks)
+
+
+@benchmark("event_toPy")
+def eventToPy(fixtures):
+    event = fixtures.marketData
+    return (lambda: event.toPy()), len(fixtures.ticks)
+
+
+@benchmark("message_toPy_mktdata")
+def messageToPyMarketData(fixtures):
+    event = fixtures.marketData
+
+    def run():
+        for message in event:
+            message.toPy()
+
+    return run, len(fixtures.ticks)
+
+
+@benchmark("message_toPy_refdata")
+def messageToPyReferenceData(fixtures):
+    event = fixtures.referenceData
+
+    def run():
+        for message in event:
+            message.toPy()
+
+    return run, 1
+
+
+@benchmark("message_toPy_histdata")
+def messageToPyHistoricalData(fixtures):
+    event = fixtures.historicalData
+
+    def run():
+        for message in event:
+            message.toPy()
+
+    return run, 1
+
+
+@benchmark("element_getitem")
+def elementGetItem(fixtures):
+    event = fixtures.marketData
+
+    def run():
+        for message in event:
+            for name in ALL_FIELDS:
+                message[name]  # pylint: disable=pointless-statement
+
+    return run, len(fixtures.ticks)
+
+
+@benchmark("message_getElementAs")
+def messageGetElementAs(fixtures):
+    event = fixtures.marketData
+
+    def run():
+        for message in event:
+            for name in FLOAT_FIELDS:
+                message.getElementAsFloat(name)
+            for name in INT_FIELDS:
+                message.getElementAsInteger(name)
+            for name in STRING_FIELDS:
+                message.getElementAsString(name)
+
+    return run, len(fixtures.ticks)
+
+
+@benchmark("element_toString")
+def elementToString(fixtures):
+    event = fixtures.marketData
+
+    def run():
+        for message in event:
+            message.asElement().toString()
+
+    return run, len(fixtures.ticks)
+
+
+@benchmark("eventformatter_fromPy")
+def eventFormatterFromPy(fixtures):
+    service = fixtures.mktdataService
+    topic = fixtures.topic
+    ticks = fixtures.ticks
+
+    def run():
+        formatter = blpapi.EventFormatter(service.createPublishEvent())
+        for tick in ticks:
+            formatter.appendMessage(MARKET_DATA_EVENTS, topic)
+            formatter.fromPy(tick)
+
+    return run, len(ticks)
+
+
+def measure(run, numMessages, options):
+    """Return the best messages per second of 'options.repeat' timings of
+    'run', and the peak memory allocated per message by one more call."""
+    run()  # warm up the caches
+    numCalls = 1
+    # calibrate the number of calls of a timing to 'options.minTime'
+    while True:
+        start = time.perf_counter()
+        for _ in range(numCalls):
+            run()
+        elapsed = time.perf_counter() - start
+        if elapsed >= options.minTime:
+            break
+        numCalls *= 2
+
+    best = elapsed
+    for _ in range(options.repeat - 1):
+        start = time.perf_counter()
+        for _ in range(numCalls):
+            run()
+        best = min(best, time.perf_counter() - start)
+
+    gc.collect()
+    tracemalloc.start()
+    run()
+    _, peak = tracemalloc.get_traced_memory()
+    tracemalloc.stop()
+    return numCalls * numMessages / best, peak / numMessages
+
+
+def compare(results, baseline, tolerance):
+    """Print the change of each benchmark from 'baseline', and return the
+    names of those slower than it by more than 'tolerance'."""
+    regressions = []
+    for name, result in results.items():
+        previous = baseline.get(name)
+        if previous is None:
+            continue
+        ratio = result["messagesPerSecond"] / previous["messagesPerSecond"]
+        print(f"{name:<26} {100 * (ratio - 1):+8.1f}%")
+        if ratio < 1 - tolerance:
+            regressions.append(name)
+    return regressions
+
+
+def parseCmdLine():
+    """Parse command line arguments"""
+
+    parser = ArgumentParser(
+        formatter_class=RawTextHelpFormatter,
+        description="Benchmarks of the conversion and dispatch hot paths",
+    )
+    parser.add_argument(
+        "-b",
+        "--benchmark",
+        dest="benchmarks",
+        help="benchmark to run, can be specified multiple times"
+        " (default: all)",
+        metavar="name",
+        action="append",
+        choices=[name for name, _ in BENCHMARKS],
+        default=[],
+    )
+    parser.add_argument(
+        "--messages",
+        help="number of messages of the market data event"
+        " (default: %(default)s)",
+        type=int,
+        default=1000,
+    )
+    parser.add_argument(
+        "--securities",
+        help="number of securities of the reference data response"
+        " (default: %(default)s)",
+        type=int,
+        default=50,
+    )
+    parser.add_argument(
+        "--days",
+        help="number of days of the historical data response"
+        " (default: %(default)s)",
+        type=int,
+        default=250,
+    )
+    parser.add_argument(
+        "--repeat",
+        help="number of timings of each benchmark, the best being kept"
+        " (default: %(default)s)",
+        type=int,
+        default=5,
+    )
+    parser.add_argument(
+        "--min-time",
+        dest="minTime",
+        help="minimum duration in seconds of a timing (default: %(default)s)",
+        type=float,
+        default=0.2,
+    )
+    parser.add_argument(
+        "--save",
+        help="save the results as JSON to the specified file",
+        metavar="file",
+    )
+    parser.add_argument(
+        "--compare",
+        help="compare the results to those saved in the specified file",
+        metavar="file",
+    )
+    parser.add_argument(
+        "--tolerance",
+        help="relative slowdown from the compared results above which the"
+        "\nscript fails (default: %(default)s)",
+        type=float,
+        default=0.1,
+    )
+
+    return parser.parse_args()
+
+
+def main():
+    options = parseCmdLine()
+    fixtures = Fixtures(options)
+    selected = set(options.benchmarks)
+
+    extension = internals._ffiutils  # pylint: disable=protected-access
+    print(
+        f"blpapi {blpapi.__version__}, Python {platform.python_version()},"
+        f" extension module {'off' if extension is None else 'on'}"
+    )
+    print(f"{'benchmark':<26} {'messages/s':>14} {'peak bytes/msg':>15}")
+    results = {}
+    for name, func in BENCHMARKS:
+        if selected and name not in selected:
+            continue
+        run, numMessages = func(fixtures)
+        rate, peak = measure(run, numMessages, options)
+        results[name] = {
+            "messagesPerSecond": rate,
+            "peakBytesPerMessage": peak,
+        }
+        print(f"{name:<26} {rate:>14,.0f} {peak:>15,.0f}")
+
+    if options.save:
+        with open(options.save, "w", encoding="utf-8") as output:
+            json.dump(
+                {
+                    "blpapiVersion": blpapi.__version__,
+                    "pythonVersion": platform.python_version(),
+                    "results": results,
+                },
+                output,
+                indent=2,
+            )
+
+    if options.compare:
+        with open(options.compare, encoding="utf-8") as baselineFile:
+            baseline = json.load(baselineFile)["results"]
+        print(
+            f"\nChange from {options.compare}, tolerance"
+            f" {100 * options.tolerance:.0f}%:"
+        )
+        regressions = compare(results, baseline, options.tolerance)
+        if regressions:
+            print("Slower than the baseline: " + ", ".join(regressions))
+            sys.exit(1)
+
+
+if __name__ == "__main__":
+    main()
+
+__copyright__ = """
+Copyright 2024, Bloomberg Finance L.P.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to
+deal in the Software without restriction, including without limitation the
+rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+sell copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:  The above
+copyright notice and this permission notice shall be included in all copies
+or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+IN THE SOFTWARE.
+"""
@@ -8,6 +8,7 @@ import os
 import platform as plat
 import re
 import codecs
+import sysconfig
 from sys import argv
 from shutil import copyfile
 from setuptools import setup, Extension
@@ -116,12 +117,21 @@ if is64bit:
 else:
     blpapiLibraryName = "blpapi3_32"
 extraLinkArgs = ["/MANIFEST"] if platform == "windows" else []
+# the limited API is not available on free-threaded builds
+defineMacros = (
+    [("FFIUTILS_NO_LIMITED_API", "1")]
+    if sysconfig.get_config_var("Py_GIL_DISABLED")
+    else []
+)
 blpapi_wrap = Extension(
     "blpapi.ffiutils",
     sources=["src/blpapi/ffi_utils.c"],
     include_dirs=[blpapiIncludes],
     library_dirs=[blpapiLibraryPath],
-    libraries=[blpapiLibraryName],
+    # the event pipes of 'AsyncSession' signal their sockets natively
+    libraries=[blpapiLibraryName]
+    + (["ws2_32"] if platform == "windows" else []),
+    define_macros=defineMacros,
     extra_compile_args=[],
     extra_link_args=extraLinkArgs,
 )
@@ -16,25 +16,34 @@ except ImportError as error:
 
 from .abstractsession import AbstractSession
 from .auth import AuthOptions, AuthUser
+from .columnar import Column, ColumnarBatch, ColumnarExtractor
 from .constant import Constant, ConstantList
 from .correlationid import CorrelationId
+from .correlationidrouter import CorrelationIdRouter
 from .datatype import DataType
 from .datetime import FixedOffset
-from .element import Element
-from .event import Event, EventQueue
+from .element import Element, ElementArrayView, ElementView
+from .event import DecodedEvent, Event, EventQueue
+from .eventcapture import EventRecorder, EventReplayer
 from .eventdispatcher import EventDispatcher
 from .eventformatter import EventFormatter
 from .exception import *
+from .fieldselector import FieldSelector
 from .identity import Identity
+from .lastvaluecache import LastValueCache
+from .latencymonitor import LatencyMonitor
 from .logging import Logger
 from .message import Message
 from .name import Name
 from .names import Names
+from .preparedrequest import PreparedRequest
 from .providersession import ProviderSession, ServiceRegistrationOptions
 from .request import Request
 from .requesttemplate import RequestTemplate
 from .resolutionlist import ResolutionList
+from .responsecollector import ResponseCollector
 from .schema import SchemaElementDefinition, SchemaStatus, SchemaTypeDefinition
+from .schemaplan import FieldPlan, SchemaPlan
 from .service import Service, Operation
 from .session import (
     Session,
@@ -42,6 +51,7 @@ from .session import (
     SubscriptionPreprocessMode,
 )
 from .sessionoptions import SessionOptions, TlsOptions, Socks5Config
+from .sessionpool import SessionPool
 from .subscriptionlist import SubscriptionList
 from .topic import Topic
 from .topiclist import TopicList
@@ -78,6 +88,22 @@ except ImportError as error:
 # blpapi.test module
 from .test import *
 
+
+def __getattr__(name):
+    # 'AsyncSession' is imported on first use, to spare the processes not
+    # using it the import of 'asyncio'
+    if name == "AsyncSession":
+        from .asyncsession import AsyncSession
+
+        globals()[name] = AsyncSession
+        return AsyncSession
+    raise AttributeError(f"module {__name__!r} has no attribute {name!r}")
+
+
+def __dir__():
+    return sorted(set(globals()) | {"AsyncSession"})
+
+
 __copyright__ = """
 Copyright 2012. Bloomberg Finance L.P.
 
@@ -17,7 +17,8 @@ identifiers without upper-case characters.  Note that the <namespace> and
 """
 
 # pylint: disable=protected-access
-from typing import Callable, Union, Sequence, Optional
+from typing import Callable, Union, Sequence, Optional, Set, cast
+from weakref import ref, ReferenceType
 from . import typehints  # pylint: disable=unused-import
 from .typehints import (
     BlpapiAbstractSessionHandle,
@@ -89,6 +90,9 @@ class AbstractSession(CHandle):
     ``nextEvent()``.
     """
 
+    # weak reference to the set returned by '_sessionSet'
+    __sessionSet: Optional[ReferenceType] = None
+
     def __init__(
         self,
         sessionHandle: Union[BlpapiSessionHandle, BlpapiProviderSessionHandle],
@@ -354,7 +358,7 @@ class AbstractSession(CHandle):
             self.__handle, serviceName
         )
         _ExceptionUtil.raiseOnError(errorCode)
-        return Service(service, {self})
+        return Service(service, self._sessionSet())
 
     def createIdentity(self) -> Identity:
         """Create an :class:`Identity` which is valid but has not been
@@ -447,6 +451,22 @@ class AbstractSession(CHandle):
         _ExceptionUtil.raiseOnError(result)
         return sessionName
 
+    def _sessionSet(self) -> Set["typehints.AbstractSession"]:
+        """Return the immutable set of this session held by its events,
+        messages and services. For internal use.
+
+        The set is shared by all of them for as long as one of them holds
+        it, instead of each event allocating its own. It is only weakly
+        referenced by the session, so that it does not make a reference
+        cycle of the session.
+        """
+        sessions = None if self.__sessionSet is None else self.__sessionSet()
+        if sessions is None:
+            sessions = frozenset((self,))
+            self.__sessionSet = ref(sessions)
+        # never modified by its holders
+        return cast(Set["typehints.AbstractSession"], sessions)
+
 
 __copyright__ = """
 Copyright 2019. Bloomberg Finance L.P.
@@ -0,0 +1,549 @@
+# asyncsession.py
+
+"""Provide a consumer session integrated with an asyncio event loop.
+
+This component defines a class, 'AsyncSession', which delivers the events
+of a 'Session' to the asyncio event loop running it, without a thread
+blocking in 'Session.nextEvent' for each session. The event handler of the
+session appends the events to a pipe, and sends a byte to a socket pair
+when the pipe becomes non-empty. The loop, waiting for the socket to be
+readable with the other sockets it serves, then takes all the pending events
+at once. When the extension module is available, the events are appended to
+the pipe natively on the threads of the dispatcher of the session, without
+acquiring the GIL.
+
+The responses of the requests sent by 'AsyncSession.sendRequest' are
+awaited, and the partial responses of 'AsyncSession.requestStream' are
+iterated asynchronously. The other events are returned by
+'AsyncSession.nextEvent', or by iterating over the 'AsyncSession'.
+
+Usage
+-----
+The following sends a request and processes the subscription data in the
+same event loop.
+
+    async def main():
+        session = AsyncSession(sessionOptions)
+        if not await session.start():
+            return
+        if not await session.openService("//blp/refdata"):
+            return
+        service = session.session().getService("//blp/refdata")
+        request = service.createRequest("ReferenceDataRequest")
+        ...
+        for event in await session.sendRequest(request):
+            ...
+        session.session().subscribe(subscriptions)
+        async for event in session:
+            ...
+
+    asyncio.run(main())
+"""
+
+import asyncio
+import socket
+import threading
+from typing import Any, AsyncIterator, Dict, List, Optional
+from .correlationid import CorrelationId
+from .event import Event
+from .names import Names
+from .session import Session
+from .sessionoptions import SessionOptions
+from . import exception
+from . import internals
+from . import typehints  # pylint: disable=unused-import
+
+# the events completing the request of their correlation ids
+_FINAL_EVENT_TYPES = (
+    Event.RESPONSE,
+    Event.REQUEST_STATUS,
+    Event.SERVICE_STATUS,
+)
+
+
+class _EventPipe:
+    """The pipe of an :class:`AsyncSession` when the extension module is
+    not available, with the same behavior as the native one. It is the
+    event handler of the session."""
+
+    def __init__(self, writer: socket.socket) -> None:
+        self.__writer = writer
+        self.__lock = threading.Lock()
+        self.__events: List[Event] = []
+        self.__signalled = False
+        self.__closed = False
+
+    def __call__(
+        self,
+        event: Event,
+        session: Session,  # pylint: disable=unused-argument
+    ) -> None:
+        with self.__lock:
+            if self.__closed:
+                return
+            self.__events.append(event)
+            if not self.__signalled:
+                self.__signalled = True
+                self.__writer.send(b"\0")
+
+    def drain(self) -> List[Event]:
+        with self.__lock:
+            events = self.__events
+            self.__events = []
+            self.__signalled = False
+            return events
+
+    def close(self) -> None:
+        with self.__lock:
+            self.__closed = True
+            self.__events = []
+
+
+class _PendingRequest:
+    """The events received for a request, delivered to the future of
+    :meth:`AsyncSession.sendRequest` once complete, or to the queue of
+    :meth:`AsyncSession.requestStream` as they arrive."""
+
+    def __init__(self, loop: asyncio.AbstractEventLoop, stream: bool) -> None:
+        self.events: List[Event] = []
+        self.future = loop.create_future()
+        self.queue: Optional[asyncio.Queue] = (
+            asyncio.Queue() if stream else None
+        )
+
+    def deliver(self, event: Event, final: bool) -> None:
+        if self.queue is not None:
+            self.queue.put_nowait(event)
+            if final:
+                self.queue.put_nowait(None)
+            return
+        self.events.append(event)
+        if final and not self.future.done():
+            self.future.set_result(self.events)
+
+    def fail(self, error: BaseException) -> None:
+        if self.queue is not None:
+            self.queue.put_nowait(error)
+        elif not self.future.done():
+            self.future.set_exception(error)
+
+
+class AsyncSession:
+    """A consumer :class:`Session` whose events are delivered to an asyncio
+    event loop.
+
+    The events are received by the loop running the first coroutine of the
+    :class:`AsyncSession` awaited, which must then be used from that loop
+    only. The events received before are kept until then.
+
+    The :attr:`~Event.RESPONSE`, :attr:`~Event.PARTIAL_RESPONSE`,
+    :attr:`~Event.REQUEST_STATUS` and :attr:`~Event.SERVICE_STATUS` events of
+    the requests of :meth:`sendRequest`, :meth:`requestStream` and
+    :meth:`openService` are delivered to them. The other events, including
+    those of the requests sent directly with the :meth:`session`, are queued
+    to be returned by :meth:`nextEvent` and :meth:`tryNextEvent`, or by
+    iterating over the :class:`AsyncSession`. This queue is not bounded: an
+    application subscribing to data must consume it.
+
+    The other operations, such as subscribing, are done with the
+    :meth:`session`, the methods of :class:`Session` returning immediately
+    being safe to call from the loop.
+    """
+
+    def __init__(
+        self,
+        options: Optional[SessionOptions] = None,
+        eventDispatcher: Optional["typehints.EventDispatcher"] = None,
+    ) -> None:
+        """Create an :class:`AsyncSession` with the specified ``options``.
+
+        Args:
+            options: Options to construct the session with
+            eventDispatcher: An optional dispatcher for the events, as for
+                :class:`Session`
+        """
+        self.__reader, self.__writer = socket.socketpair()
+        self.__reader.setblocking(False)
+        self.__writer.setblocking(False)
+        self.__pipe: Any
+        if internals.EventPipe_create is not None:
+            self.__pipe = internals.EventPipe_create(self.__writer.fileno())
+        else:
+            self.__pipe = _EventPipe(self.__writer)
+        self.__session = Session(options, self.__pipe, eventDispatcher)
+        self.__sessions = self.__session._sessionSet()
+        self.__loop: Optional[asyncio.AbstractEventLoop] = None
+        self.__readerTask: Optional[asyncio.Task] = None
+        self.__events: Optional[asyncio.Queue] = None
+        self.__requests: Dict[CorrelationId, _PendingRequest] = {}
+        self.__started: Optional[asyncio.Future] = None
+        self.__terminated: Optional[asyncio.Future] = None
+        self.__closed = False
+
+    def session(self) -> Session:
+        """
+        Returns:
+            The :class:`Session` of this :class:`AsyncSession`.
+        """
+        return self.__session
+
+    async def start(self) -> bool:
+        """Start the session, and wait for it to be started.
+
+        Returns:
+            ``True`` if the session started, ``False`` if it failed to.
+
+        The :attr:`~Event.SESSION_STATUS` events are also returned by
+        :meth:`nextEvent`.
+        """
+        loop = self.__attach()
+        self.__started = loop.create_future()
+        if not self.__session.startAsync():
+            return False
+        return await self.__started
+
+    async def stop(self) -> None:
+        """Stop the session, wait for it to be terminated, and close this
+        :class:`AsyncSession`.
+
+        The requests still pending fail with an
+        :class:`InvalidStateException`.
+        """
+        loop = self.__attach()
+        if self.__started is not None and self.__terminated is None:
+            self.__terminated = loop.create_future()
+            if self.__session.stopAsync():
+                await self.__terminated
+        self.close()
+
+    def close(self) -> None:
+        """Stop delivering the events to the loop, and release the sockets
+        of this :class:`AsyncSession`. The session must be stopped, or not
+        started."""
+        if self.__closed:
+            return
+        self.__closed = True
+        if self.__loop is not None:
+            if self.__readerTask is not None:
+                self.__readerTask.cancel()
+            else:
+                self.__loop.remove_reader(self.__reader.fileno())
+        if internals.EventPipe_close is not None:
+            internals.EventPipe_close(self.__pipe)
+        else:
+            self.__pipe.close()
+        self.__reader.close()
+        self.__writer.close()
+        self.__failRequests()
+        if self.__events is not None:
+            # wakes up the tasks waiting for an event
+            self.__events.put_nowait(None)
+
+    async def openService(
+        self, serviceName: str, correlationId: Optional[CorrelationId] = None
+    ) -> bool:
+        """Open the service ``serviceName``, and wait for it to be opened.
+
+        Args:
+            serviceName: Name of the service
+            correlationId: Correlation id to associate with the
+                :attr:`~Event.SERVICE_STATUS` event of the service
+
+        Returns:
+            ``True`` if the service is opened, ``False`` if it failed to.
+        """
+        self.__attach()
+        correlationId = self.__session.openServiceAsync(
+            serviceName, correlationId
+        )
+        events = await self.__await(correlationId)
+        return any(
+            message.messageType() == Names.SERVICE_OPENED
+            for message in events[-1]
+        )
+
+    async def sendRequest(
+        self,
+        request: "typehints.Request",
+        identity: Optional["typehints.Identity"] = None,
+        correlationId: Optional[CorrelationId] = None,
+        requestLabel: Optional[str] = None,
+    ) -> List[Event]:
+        """Send ``request``, and wait for its response.
+
+        Args:
+            request: Request to send
+            identity: Identity used for authorization
+            correlationId: Correlation id to associate with the request
+            requestLabel: Optional debugging information
+
+        Returns:
+            The :attr:`~Event.PARTIAL_RESPONSE` events of the request, in
+            order, followed by its :attr:`~Event.RESPONSE` event, or by the
+            :attr:`~Event.REQUEST_STATUS` event reporting its failure.
+
+        Raises:
+            InvalidStateException: If the session is stopped before the
+                response is received
+
+        If the awaiting task is cancelled, the request is cancelled.
+        """
+        self.__attach()
+        correlationId = self.__session.sendRequest(
+            request,
+            identity=identity,
+            correlationId=correlationId,
+            requestLabel=requestLabel,
+        )
+        return await self.__await(correlationId)
+
+    async def requestStream(
+        self,
+        request: "typehints.Request",
+        identity: Optional["typehints.Identity"] = None,
+        correlationId: Optional[CorrelationId] = None,
+        requestLabel: Optional[str] = None,
+    ) -> AsyncIterator[Event]:
+        """Send ``request``, and iterate over its responses as they arrive.
+
+        Args:
+            request: Request to send
+            identity: Identity used for authorization
+            correlationId: Correlation id to associate with the request
+            requestLabel: Optional debugging information
+
+        Yields:
+            The :attr:`~Event.PARTIAL_RESPONSE` events of the request, in
+            order, followed by its :attr:`~Event.RESPONSE` event, or by the
+            :attr:`~Event.REQUEST_STATUS` event reporting its failure.
+
+        Raises:
+            InvalidStateException: If the session is stopped before the
+                response is received
+
+        If the iterator is closed before the response, for instance by
+        :func:`contextlib.aclosing` when the iteration is stopped early, the
+        request is cancelled.
+        """
+        loop = self.__attach()
+        correlationId = self.__session.sendRequest(
+            request,
+            identity=identity,
+            correlationId=correlationId,
+            requestLabel=requestLabel,
+        )
+        pending = self.__register(loop, correlationId, stream=True)
+        assert pending.queue is not None
+        try:
+            while True:
+                event = await pending.queue.get()
+                if event is None:
+                    return
+                if isinstance(event, BaseException):
+                    raise event
+                yield event
+        finally:
+            self.__abandon(correlationId, pending)
+
+    async def nextEvent(self, timeout: Optional[float] = None) -> Event:
+        """
+        Args:
+            timeout: The number of seconds to wait for an event, ``None``
+                to wait until one arrives
+
+        Returns:
+            The next event that is not delivered to a request.
+
+        Raises:
+            asyncio.TimeoutError: If no event arrives within ``timeout``
+            InvalidStateException: If this :class:`AsyncSession` is closed
+                and all its events are returned
+        """
+        self.__attach()
+        assert self.__events is not None
+        if timeout is None:
+            event = await self.__events.get()
+        else:
+            event = await asyncio.wait_for(self.__events.get(), timeout)
+        if event is None:
+            self.__events.put_nowait(None)
+            raise exception.InvalidStateException("AsyncSession is closed", 0)
+        return event
+
+    def tryNextEvent(self) -> Optional[Event]:
+        """
+        Returns:
+            The next event that is not delivered to a request, if one was
+            received by the loop, ``None`` otherwise.
+        """
+        if self.__events is None or self.__events.empty():
+            return None
+        event = self.__events.get_nowait()
+        if event is None:
+            self.__events.put_nowait(None)
+        return event
+
+    def __aiter__(self) -> AsyncIterator[Event]:
+        """
+        Returns:
+            An asynchronous iterator over the events returned by
+            :meth:`nextEvent`, which stops after the ``SessionTerminated``
+            event, or once this :class:`AsyncSession` is closed.
+        """
+        return self.__iterate()
+
+    async def __iterate(self) -> AsyncIterator[Event]:
+        while True:
+            try:
+                event = await self.nextEvent()
+            except exception.InvalidStateException:
+                return
+            yield event
+            if event.eventType() == Event.SESSION_STATUS and any(
+                message.messageType() == Names.SESSION_TERMINATED
+                for message in event
+            ):
+                return
+
+    def __attach(self) -> asyncio.AbstractEventLoop:
+        """Deliver the events to the running loop, on the first call."""
+        loop = asyncio.get_running_loop()
+        if self.__loop is loop:
+            return loop
+        if self.__loop is not None or self.__closed:
+            raise exception.InvalidStateException(
+                "AsyncSession is closed or used from another event loop", 0
+            )
+        self.__loop = loop
+        self.__events = asyncio.Queue()
+        try:
+            loop.add_reader(self.__reader.fileno(), self.__onReadable)
+        except NotImplementedError:
+            # the proactor event loop of Windows
+            self.__readerTask = loop.create_task(self.__readLoop())
+        # the events received before are signalled already
+        return loop
+
+    def __onReadable(self) -> None:
+        try:
+            self.__reader.recv(4096)
+        except (BlockingIOError, InterruptedError):
+            pass
+        self.__deliver()
+
+    async def __readLoop(self) -> None:
+        assert self.__loop is not None
+        while await self.__loop.sock_recv(self.__reader, 4096):
+            self.__deliver()
+
+    def __deliver(self) -> None:
+        if internals.EventPipe_drain is not None:
+            events = [
+                Event(handle, self.__sessions)
+                for handle in internals.EventPipe_drain(self.__pipe)
+            ]
+        else:
+            events = self.__pipe.drain()
+        for event in events:
+            self.__dispatch(event)
+
+    def __dispatch(self, event: Event) -> None:
+        eventType = event.eventType()
+        if self.__requests and (
+            eventType in _FINAL_EVENT_TYPES
+            or eventType == Event.PARTIAL_RESPONSE
+        ):
+            final = eventType in _FINAL_EVENT_TYPES
+            delivered = False
+            for message in event:
+                for correlationId in message.correlationIds():
+                    pending = self.__requests.get(correlationId)
+                    if pending is None:
+                        continue
+                    if final:
+                        del self.__requests[correlationId]
+                    pending.deliver(event, final)
+                    delivered = True
+            if delivered:
+                return
+        if eventType == Event.SESSION_STATUS:
+            self.__onSessionStatus(event)
+        assert self.__events is not None
+        self.__events.put_nowait(event)
+
+    def __onSessionStatus(self, event: Event) -> None:
+        for message in event:
+            messageType = message.messageType()
+            if messageType == Names.SESSION_STARTED:
+                self.__resolve(self.__started, True)
+            elif messageType == Names.SESSION_STARTUP_FAILURE:
+                self.__resolve(self.__started, False)
+            elif messageType == Names.SESSION_TERMINATED:
+                self.__resolve(self.__started, False)
+                self.__resolve(self.__terminated, None)
+                self.__failRequests()
+
+    @staticmethod
+    def __resolve(future: Optional[asyncio.Future], result: Any) -> None:
+        if future is not None and not future.done():
+            future.set_result(result)
+
+    def __register(
+        self,
+        loop: asyncio.AbstractEventLoop,
+        correlationId: CorrelationId,
+        stream: bool,
+    ) -> _PendingRequest:
+        pending = _PendingRequest(loop, stream)
+        self.__requests[correlationId] = pending
+        return pending
+
+    async def __await(self, correlationId: CorrelationId) -> List[Event]:
+        assert self.__loop is not None
+        pending = self.__register(self.__loop, correlationId, stream=False)
+        try:
+            return await pending.future
+        finally:
+            self.__abandon(correlationId, pending)
+
+    def __abandon(
+        self, correlationId: CorrelationId, pending: _PendingRequest
+    ) -> None:
+        """Cancel the request of ``correlationId`` if it is still pending."""
+        if self.__requests.get(correlationId) is not pending:
+            return
+        del self.__requests[correlationId]
+        if not self.__closed:
+            self.__session.cancel(correlationId)
+
+    def __failRequests(self) -> None:
+        requests = self.__requests
+        self.__requests = {}
+        for pending in requests.values():
+            pending.fail(
+                exception.InvalidStateException(
+                    "The session is terminated", 0
+                )
+            )
+
+
+__copyright__ = """
+Copyright 2024. Bloomberg Finance L.P.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to
+deal in the Software without restriction, including without limitation the
+rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+sell copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:  The above
+copyright notice and this permission notice shall be included in all copies
+or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+IN THE SOFTWARE.
+"""
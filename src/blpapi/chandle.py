@@ -13,6 +13,10 @@ from typing import Callable, Any
 class CHandle:
     """A base class for objects that rely on C handles"""
 
+    # wrappers like 'Message' and 'Element' are created for every message
+    # and field read, '__slots__' keep them small and free of a '__dict__'
+    __slots__ = ("__handle", "_dtor", "__weakref__")
+
     def __init__(self, handle: Any, dtor: Callable) -> None:
         """Set the handle and the dtor"""
         # None case is for tests
@@ -0,0 +1,497 @@
+# columnar.py
+
+"""Provide extraction of message fields into typed columns.
+
+This file defines a 'ColumnarExtractor' which converts the messages of one or
+more 'Event's into a 'ColumnarBatch': one column per requested field, with one
+row per message. The values of 'int64', 'float64', 'bool' and 'timestamp'
+columns are written directly into contiguous buffers, together with a null
+bitmap, without creating a Python object per value. The columns can then be
+exposed as NumPy arrays or as an Arrow 'RecordBatch' without copying.
+
+Usage
+-----
+The following snippet collects the quotes of a subscription data event into
+a pandas 'DataFrame'.
+
+    extractor = ColumnarExtractor([
+        ("BID", ColumnarExtractor.FLOAT64),
+        ("ASK", ColumnarExtractor.FLOAT64),
+        ("BID_SIZE", ColumnarExtractor.INT64),
+        ("LAST_UPDATE_BID_RT", ColumnarExtractor.TIMESTAMP),
+    ])
+    batch = extractor.extract(event)
+    frame = batch.toArrow().to_pandas()
+"""
+
+from __future__ import annotations
+from ctypes import addressof
+from typing import (
+    Any,
+    Dict,
+    Iterable,
+    List,
+    Optional,
+    Sequence,
+    Tuple,
+    Union,
+)
+from . import internals
+from . import utils
+from .event import DecodedEvent, Event
+from .fieldselector import FieldSelector
+from .name import Name
+from .utils import get_handle
+
+_VALUE_SIZES = {
+    internals.COLUMNKIND_INT64: 8,
+    internals.COLUMNKIND_FLOAT64: 8,
+    internals.COLUMNKIND_BOOL: 1,
+    internals.COLUMNKIND_TIMESTAMP: 8,
+}
+
+# the '(kind, values, validity)' triples filled by the conversion functions
+ColumnarColumns = Tuple[
+    Tuple[int, Union[bytearray, List[Any]], bytearray], ...
+]
+
+
+class Column:
+    """A single column of a :class:`ColumnarBatch`.
+
+    The values of a column of kind :attr:`ColumnarExtractor.INT64`,
+    :attr:`~ColumnarExtractor.FLOAT64`, :attr:`~ColumnarExtractor.BOOL` or
+    :attr:`~ColumnarExtractor.TIMESTAMP` are stored in a contiguous native
+    endian buffer of 64 bit integers, 64 bit floats, bytes or 64 bit integer
+    nanoseconds since the epoch respectively, and are exposed as a typed
+    :py:class:`memoryview`. The values of a column of kind
+    :attr:`~ColumnarExtractor.OBJECT` are the :py:class:`list` of the
+    :meth:`Element.toPy` conversions of the field.
+
+    Whether each row holds a value is recorded in a validity bitmap, in the
+    layout used by Arrow: bit ``i % 8`` of byte ``i // 8`` is set if row
+    ``i`` holds a value. The value stored in a row without a value is
+    unspecified (``0`` or ``None``).
+    """
+
+    def __init__(
+        self,
+        name: str,
+        kind: int,
+        values: Union[bytearray, List[Any]],
+        validity: bytearray,
+        numRows: int,
+    ) -> None:
+        self.__name = name
+        self.__kind = kind
+        self.__values = values
+        self.__validity = validity
+        self.__numRows = numRows
+        self.__nullCount = numRows - bin(
+            int.from_bytes(validity, "little")
+        ).count("1")
+
+    def name(self) -> str:
+        """
+        Returns:
+            The name of the field stored in this column.
+        """
+        return self.__name
+
+    def kind(self) -> int:
+        """
+        Returns:
+            The kind of this column, one of the ``ColumnarExtractor``
+            constants.
+        """
+        return self.__kind
+
+    def values(self) -> Union[memoryview, List[Any]]:
+        """
+        Returns:
+            A :py:class:`memoryview` of the values of this column, formatted
+            as ``"q"``, ``"d"`` or ``"?"``, or the :py:class:`list` of values
+            of an :attr:`~ColumnarExtractor.OBJECT` column.
+        """
+        if isinstance(self.__values, list):
+            return self.__values
+        fmt = {
+            internals.COLUMNKIND_INT64: "q",
+            internals.COLUMNKIND_FLOAT64: "d",
+            internals.COLUMNKIND_BOOL: "?",
+            internals.COLUMNKIND_TIMESTAMP: "q",
+        }[self.__kind]
+        return memoryview(self.__values).cast(fmt)
+
+    def validity(self) -> bytes:
+        """
+        Returns:
+            The validity bitmap of this column.
+        """
+        return bytes(self.__validity)
+
+    def nullCount(self) -> int:
+        """
+        Returns:
+            The number of rows of this column without a value.
+        """
+        return self.__nullCount
+
+    def __len__(self) -> int:
+        return self.__numRows
+
+    def toNumpy(self) -> Any:
+        """
+        Returns:
+            ``numpy.ndarray``: The values of this column, sharing the memory
+            of the column, or a ``numpy.ma.MaskedArray`` masking the rows
+            without a value if there are any. Timestamps have the
+            ``datetime64[ns]`` type.
+
+        Raises:
+            ImportError: If ``numpy`` is not installed.
+        """
+        import numpy  # pylint: disable=import-outside-toplevel
+
+        if isinstance(self.__values, list):
+            array = numpy.empty(self.__numRows, dtype=object)
+            array[:] = self.__values
+        else:
+            dtype = {
+                internals.COLUMNKIND_INT64: numpy.int64,
+                internals.COLUMNKIND_FLOAT64: numpy.float64,
+                internals.COLUMNKIND_BOOL: numpy.bool_,
+                internals.COLUMNKIND_TIMESTAMP: "datetime64[ns]",
+            }[self.__kind]
+            array = numpy.frombuffer(self.__values, dtype=dtype)
+        if not self.__nullCount:
+            return array
+        valid = numpy.unpackbits(
+            numpy.frombuffer(self.__validity, dtype=numpy.uint8),
+            count=self.__numRows,
+            bitorder="little",
+        )
+        return numpy.ma.MaskedArray(array, mask=valid == 0)
+
+    def toArrow(self) -> Any:
+        """
+        Returns:
+            ``pyarrow.Array``: The values of this column. Except for
+            :attr:`~ColumnarExtractor.BOOL` and
+            :attr:`~ColumnarExtractor.OBJECT` columns, the array shares the
+            memory of the column. Timestamps have the ``timestamp("ns",
+            "UTC")`` type.
+
+        Raises:
+            ImportError: If ``pyarrow`` is not installed.
+        """
+        import pyarrow  # pylint: disable=import-outside-toplevel
+
+        if isinstance(self.__values, list):
+            return pyarrow.array(self.__values)
+        arrowType = {
+            internals.COLUMNKIND_INT64: pyarrow.int64(),
+            internals.COLUMNKIND_FLOAT64: pyarrow.float64(),
+            # Arrow booleans are bit packed, they are converted below
+            internals.COLUMNKIND_BOOL: pyarrow.uint8(),
+            internals.COLUMNKIND_TIMESTAMP: pyarrow.timestamp("ns", "UTC"),
+        }[self.__kind]
+        array = pyarrow.Array.from_buffers(
+            arrowType,
+            self.__numRows,
+            [
+                pyarrow.py_buffer(self.__validity)
+                if self.__nullCount
+                else None,
+                pyarrow.py_buffer(self.__values),
+            ],
+            null_count=self.__nullCount,
+        )
+        if self.__kind == internals.COLUMNKIND_BOOL:
+            return array.cast(pyarrow.bool_())
+        return array
+
+
+class ColumnarBatch:
+    """The columns produced by :meth:`ColumnarExtractor.extract`, one per
+    field, in the order in which the fields were given to the
+    :class:`ColumnarExtractor`, each with one row per converted
+    :class:`Message`, or per element of its ``rows``.
+    """
+
+    def __init__(self, columns: List[Column], numRows: int) -> None:
+        self.__columns = columns
+        self.__numRows = numRows
+
+    def numRows(self) -> int:
+        """
+        Returns:
+            The number of rows of each column of this batch.
+        """
+        return self.__numRows
+
+    def columns(self) -> List[Column]:
+        """
+        Returns:
+            The columns of this batch.
+        """
+        return list(self.__columns)
+
+    def column(self, name: Union[Name, str]) -> Column:
+        """
+        Args:
+            name: Name of the field stored in the column
+
+        Returns:
+            The column of this batch holding the field ``name``.
+
+        Raises:
+            KeyError: If there is no such column.
+        """
+        for column in self.__columns:
+            if column.name() == str(name):
+                return column
+        raise KeyError(f"ColumnarBatch does not contain column {name}")
+
+    def toNumpy(self) -> Dict[str, Any]:
+        """
+        Returns:
+            A :py:class:`dict` mapping the name of each column to its
+            :meth:`Column.toNumpy` conversion.
+
+        Raises:
+            ImportError: If ``numpy`` is not installed.
+        """
+        return {column.name(): column.toNumpy() for column in self.__columns}
+
+    def toArrow(self) -> Any:
+        """
+        Returns:
+            ``pyarrow.RecordBatch``: The columns of this batch, converted by
+            :meth:`Column.toArrow`.
+
+        Raises:
+            ImportError: If ``pyarrow`` is not installed.
+        """
+        import pyarrow  # pylint: disable=import-outside-toplevel
+
+        return pyarrow.RecordBatch.from_arrays(
+            [column.toArrow() for column in self.__columns],
+            names=[column.name() for column in self.__columns],
+        )
+
+
+class ColumnarExtractor(metaclass=utils.MetaClassForClassesWithEnums):
+    """Converts the messages of :class:`Event`\\ s into typed columns.
+
+    A :class:`ColumnarExtractor` is created once with the list of fields to
+    extract, each with the kind of column to store it in, and reused for
+    every extraction. Each column holds one top-level field of the
+    messages, and each :class:`Message` produces one row. Rows for messages
+    where the field is missing or null have no value.
+
+    The class attributes represent the possible kinds of column.
+    """
+
+    INT64 = internals.COLUMNKIND_INT64
+    """64 bit integers, for any integer field"""
+    FLOAT64 = internals.COLUMNKIND_FLOAT64
+    """64 bit floating point numbers, for any numeric field"""
+    BOOL = internals.COLUMNKIND_BOOL
+    """Booleans"""
+    TIMESTAMP = internals.COLUMNKIND_TIMESTAMP
+    """64 bit integer nanoseconds since the epoch, for date and time fields,
+    converted as described in :meth:`Element.toPy` with
+    ``datetimeAsEpochNanos=True``"""
+    OBJECT = internals.COLUMNKIND_OBJECT
+    """Python objects, as returned by :meth:`Element.toPy`, for any field"""
+
+    def __init__(
+        self,
+        fields: Sequence[Tuple[Union[Name, str], int]],
+        rows: Optional[Sequence[Union[Name, str]]] = None,
+    ) -> None:
+        """
+        Args:
+            fields: Pairs of field name and column kind
+            rows: Path of names leading from the messages to the elements
+                which form the rows, if any
+
+        Raises:
+            ValueError: If a column kind is not one of the class attributes
+
+        If ``rows`` is given, each :class:`Message` produces one row per
+        element reached by following the names of ``rows`` from it, each
+        array of complex values on the way producing one row per value, and
+        a message without such an element produces no row. The fields are
+        then looked up in the element of each row or, if it does not
+        contain them, in the elements enclosing it. For instance
+        ``rows=["securityData", "fieldData"]`` produces one row per date of
+        a ``HistoricalDataResponse``, in which the ``"security"`` field is
+        found in the enclosing ``securityData`` element.
+        """
+        kinds = []
+        for _, kind in fields:
+            if kind not in (
+                ColumnarExtractor.INT64,
+                ColumnarExtractor.FLOAT64,
+                ColumnarExtractor.BOOL,
+                ColumnarExtractor.TIMESTAMP,
+                ColumnarExtractor.OBJECT,
+            ):
+                raise ValueError(f"Invalid column kind: {kind!r}")
+            kinds.append(kind)
+        self.__selector = FieldSelector(name for name, _ in fields)
+        self.__kinds = tuple(kinds)
+        self.__rows = FieldSelector(rows) if rows is not None else None
+
+    def extract(
+        self,
+        events: Union[
+            Event, DecodedEvent, Iterable[Union[Event, DecodedEvent]]
+        ],
+    ) -> ColumnarBatch:
+        """
+        Args:
+            events: The :class:`Event` or :class:`Event`\\ s to convert,
+                which may have been decoded with :meth:`Event.decode`
+
+        Returns:
+            A batch with one column per field and one row per
+            :class:`Message` of ``events``, or per element reached by the
+            ``rows`` given to this extractor, in delivery order.
+
+        Raises:
+            Exception: If the value of a field cannot be stored in its
+                column, e.g. a string field extracted as
+                :attr:`FLOAT64`, or if an element of the ``rows`` path is
+                not complex.
+
+        A :class:`DecodedEvent` is converted from its decoded values, which
+        only hold the fields selected when decoding it, if any. Its integer
+        values can be stored in :attr:`FLOAT64` columns and its boolean
+        values in :attr:`INT64` columns, but no other conversion is done
+        between the types of its values and the kinds of the columns. If
+        ``rows`` was given to this extractor, the :class:`Event` of a
+        :class:`DecodedEvent` is converted instead.
+        """
+        if isinstance(events, (Event, DecodedEvent)):
+            events = [events]
+        columns = self._newColumns()
+        numRows = 0
+        for event in events:
+            numRows = self._append(columns, event, numRows)
+        return self._finish(columns, numRows)
+
+    def _newColumns(self) -> ColumnarColumns:
+        """Return empty columns, to be filled by '_append'."""
+        return tuple(
+            (
+                kind,
+                [] if kind == ColumnarExtractor.OBJECT else bytearray(),
+                bytearray(),
+            )
+            for kind in self.__kinds
+        )
+
+    def _append(
+        self,
+        columns: ColumnarColumns,
+        event: Union[Event, DecodedEvent],
+        numRows: int,
+    ) -> int:
+        """Append the rows of 'event' to 'columns', which hold 'numRows'
+        rows, and return the number of rows they hold afterwards. If
+        converting 'event' fails, 'columns' are truncated back to 'numRows'
+        rows before raising."""
+        try:
+            return self.__convert(columns, event, numRows)
+        except BaseException:
+            _truncate(columns, numRows)
+            raise
+
+    def __convert(
+        self,
+        columns: ColumnarColumns,
+        event: Union[Event, DecodedEvent],
+        numRows: int,
+    ) -> int:
+        # pylint: disable=protected-access
+        handles = self.__selector._handles()
+        if self.__rows is not None:
+            if isinstance(event, DecodedEvent):
+                event = event.event()
+            return internals.blpapi_Event_toRows(
+                get_handle(event),
+                self.__rows._handles(),
+                len(self.__rows.names()),
+                handles,
+                len(self.__kinds),
+                columns,
+                numRows,
+            )
+        decoded = event._decoded() if isinstance(event, DecodedEvent) else None
+        if decoded is not None:
+            return internals.blpapi_DecodedEvent_toColumns(
+                decoded,
+                addressof(handles),
+                len(self.__kinds),
+                columns,
+                numRows,
+            )
+        if isinstance(event, DecodedEvent):
+            event = event.event()
+        return internals.blpapi_Event_toColumns(
+            get_handle(event),
+            handles,
+            len(self.__kinds),
+            columns,
+            numRows,
+        )
+
+    def _finish(self, columns: ColumnarColumns, numRows: int) -> ColumnarBatch:
+        """Return the batch of the 'numRows' rows of 'columns'."""
+        _truncate(columns, numRows)
+        return ColumnarBatch(
+            [
+                Column(str(name), kind, values, validity, numRows)
+                for name, (kind, values, validity) in zip(
+                    self.__selector.names(), columns
+                )
+            ],
+            numRows,
+        )
+
+
+def _truncate(columns: ColumnarColumns, numRows: int) -> None:
+    """Drop the values of 'columns' past their first 'numRows' rows: the
+    unused tail of the buffers, which are grown geometrically, and the
+    values of the rows of a failed conversion."""
+    for kind, values, validity in columns:
+        if isinstance(values, bytearray):
+            del values[numRows * _VALUE_SIZES[kind] :]
+        else:
+            del values[numRows:]
+        del validity[(numRows + 7) // 8 :]
+
+
+__copyright__ = """
+Copyright 2024. Bloomberg Finance L.P.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to
+deal in the Software without restriction, including without limitation the
+rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+sell copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:  The above
+copyright notice and this permission notice shall be included in all copies
+or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+IN THE SOFTWARE.
+"""
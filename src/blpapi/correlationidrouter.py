@@ -0,0 +1,219 @@
+# correlationidrouter.py
+
+"""Route the messages of events to handlers by integer correlation id.
+
+This component defines a class, 'CorrelationIdRouter', which holds a handler
+per integer correlation id and gives each message of an event to the
+handlers of its correlation ids. When the extension module is available, the
+handlers are kept in a native table that is looked up from the correlation
+ids of the messages as returned by the C library, so that no
+'CorrelationId', and no 'Message' for the messages without a handler, is
+created to route an event.
+
+A 'CorrelationIdRouter' is also an event handler, which can be given to a
+'Session' or a 'SessionPool'.
+
+Usage
+-----
+The following routes the ticks of each subscription to its own handler.
+
+    router = CorrelationIdRouter(default=processOtherMessage)
+    subscriptions = SubscriptionList()
+    for index, (topic, handler) in enumerate(handlers.items()):
+        router.register(index, handler)
+        subscriptions.add(topic, "LAST_PRICE", correlationId=index)
+
+    session = Session(sessionOptions, router)
+"""
+
+from typing import Any, Callable, Dict, Optional, Union
+from .correlationid import CorrelationId
+from .event import Event
+from .message import Message
+from .utils import get_handle
+from . import internals
+from . import typehints  # pylint: disable=unused-import
+
+
+def _intOfCorrelationId(correlationId: Union[int, CorrelationId]) -> int:
+    if isinstance(correlationId, CorrelationId):
+        # the values of the generated correlation ids may be those of
+        # integer ones, which they would then be confused with
+        if correlationId.type() != CorrelationId.INT_TYPE:
+            raise TypeError(
+                "Only integer correlation ids can be routed, got"
+                f" {correlationId}"
+            )
+        return correlationId.value()
+    if isinstance(correlationId, bool) or not isinstance(correlationId, int):
+        raise TypeError(
+            "`correlationId` must be an `int` or a `CorrelationId`, got"
+            f" `{type(correlationId).__name__}`"
+        )
+    # the values of the correlation ids are unsigned 64 bits integers
+    return correlationId & 0xFFFFFFFFFFFFFFFF
+
+
+class CorrelationIdRouter:
+    """Handlers of the messages of events, by integer correlation id.
+
+    :meth:`route` calls, for each message of an event, the handler
+    registered for each of its correlation ids of type
+    :attr:`CorrelationId.INT_TYPE`, with the message, in the order of
+    :meth:`Message.correlationIds`. The messages without any registered
+    correlation id are given to the ``default`` handler, if any, and are
+    skipped otherwise.
+
+    Note:
+        The correlation ids of type :attr:`CorrelationId.AUTOGEN_TYPE`,
+        generated by the library for the requests and subscriptions sent
+        without one, are never routed and cannot be registered, as their
+        values may be those of integer correlation ids of the application.
+
+    A :class:`CorrelationIdRouter` can be used as the ``eventHandler`` of a
+    :class:`Session`, in which case the events are routed as by
+    :meth:`route`, the session being ignored.
+
+    Handlers can be registered and unregistered from any thread, including
+    from a handler.
+    """
+
+    def __init__(
+        self, default: Optional[Callable[[Message], Any]] = None
+    ) -> None:
+        """Create a router without any handler, giving the messages that
+        are not routed to ``default``, if any.
+
+        Args:
+            default: Handler of the messages without a registered
+                correlation id
+        """
+        self.__default = default
+        self.__table: Any = None
+        self.__handlers: Dict[int, Callable[[Message], Any]] = {}
+        if internals.CorrelationIdTable_create is not None:
+            self.__table = internals.CorrelationIdTable_create()
+
+    def register(
+        self,
+        correlationId: Union[int, CorrelationId],
+        handler: Callable[[Message], Any],
+    ) -> None:
+        """Call ``handler`` with the messages of ``correlationId``,
+        replacing any handler registered for it.
+
+        Args:
+            correlationId: An integer correlation id, or its value
+            handler: Handler of the messages of ``correlationId``
+
+        Raises:
+            TypeError: If ``correlationId`` is not an integer correlation id
+        """
+        value = _intOfCorrelationId(correlationId)
+        if self.__table is not None:
+            internals.CorrelationIdTable_set(self.__table, value, handler)
+        else:
+            self.__handlers[value] = handler
+
+    def unregister(self, correlationId: Union[int, CorrelationId]) -> bool:
+        """Remove the handler of ``correlationId``.
+
+        Args:
+            correlationId: An integer correlation id, or its value
+
+        Returns:
+            ``True`` if a handler was registered for ``correlationId``,
+            ``False`` otherwise.
+        """
+        value = _intOfCorrelationId(correlationId)
+        if self.__table is not None:
+            return internals.CorrelationIdTable_remove(self.__table, value)
+        return self.__handlers.pop(value, None) is not None
+
+    def handler(
+        self, correlationId: Union[int, CorrelationId]
+    ) -> Optional[Callable[[Message], Any]]:
+        """
+        Args:
+            correlationId: An integer correlation id, or its value
+
+        Returns:
+            The handler registered for ``correlationId``, or ``None``.
+        """
+        value = _intOfCorrelationId(correlationId)
+        if self.__table is not None:
+            return internals.CorrelationIdTable_get(self.__table, value)
+        return self.__handlers.get(value)
+
+    def __len__(self) -> int:
+        """
+        Returns:
+            The number of correlation ids with a handler.
+        """
+        if self.__table is not None:
+            return internals.CorrelationIdTable_size(self.__table)
+        return len(self.__handlers)
+
+    def route(self, event: Event) -> None:
+        """Give each message of ``event`` to the handlers of its integer
+        correlation ids, or to the ``default`` handler.
+
+        Args:
+            event: The event to route
+
+        An exception raised by a handler stops the routing of ``event`` and
+        is propagated.
+        """
+        if internals.blpapi_Event_route is not None:
+            internals.blpapi_Event_route(
+                self.__table,
+                get_handle(event),
+                Message,
+                event,
+                self.__default,
+            )
+            return
+
+        for message in event:
+            routed = False
+            for value in internals.blpapi_Message_intCorrelationIds(
+                get_handle(message)
+            ):
+                handler = (
+                    None if value is None else self.__handlers.get(value)
+                )
+                if handler is not None:
+                    routed = True
+                    handler(message)
+            if not routed and self.__default is not None:
+                self.__default(message)
+
+    def __call__(
+        self,
+        event: Event,
+        session: "typehints.AbstractSession",  # pylint: disable=unused-argument
+    ) -> None:
+        """Route ``event``, as :meth:`route`."""
+        self.route(event)
+
+
+__copyright__ = """
+Copyright 2024. Bloomberg Finance L.P.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to
+deal in the Software without restriction, including without limitation the
+rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+sell copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:  The above
+copyright notice and this permission notice shall be included in all copies
+or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+IN THE SOFTWARE.
+"""
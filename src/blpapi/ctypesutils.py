@@ -112,6 +112,23 @@ def getSizedBytesFromBuffer(outp: Any, outsz: int) -> bytes:
     return bytes(cast(outp, POINTER(c_char * outsz)).contents)
 
 
+def getMemoryViewFromOutput(
+    outp: Any, outsz: Any, retCode: int, owner: Any
+) -> Optional[memoryview]:
+    """Return a read-only view of the output buffer, without copying it.
+
+    The view keeps 'owner', which must keep the buffer valid, alive."""
+    if retCode != 0:
+        return None
+    # the data may start with a null byte, check the address itself
+    if not cast(outp.contents, c_void_p).value or not outsz.contents.value:
+        return memoryview(b"")
+    array = cast(outp.contents, POINTER(c_char * outsz.contents.value)).contents
+    # the view references 'array', which references 'owner'
+    array._owner = owner  # pylint: disable=protected-access
+    return memoryview(array).cast("B").toreadonly()
+
+
 def getPODFromOutput(outp: Any, retCode: int) -> Any:
     return outp.contents.value if retCode == 0 else None
 
@@ -4,6 +4,8 @@
 
 This file defines these classes:
     'Element' - represents an item in a message.
+    'ElementView' - lazy, read-only mapping over a complex element.
+    'ElementArrayView' - lazy, read-only sequence over an array element.
 
 """
 
@@ -12,6 +14,7 @@ from .exception import _ExceptionUtil
 from .exception import UnsupportedOperationException
 from .datetime import _DatetimeUtil
 from .datatype import DataType
+from .fieldselector import FieldSelector, toFieldSelector
 from .name import Name, getNamePair
 from .schema import SchemaElementDefinition
 from .utils import Iterator, isNonScalarSequence
@@ -23,11 +26,16 @@ from .typehints import (
     SupportedElementTypes,
 )
 from . import typehints  # pylint: disable=unused-import
-from collections.abc import Iterator as IteratorABC, Mapping
+from collections.abc import (
+    Iterator as IteratorABC,
+    Mapping,
+    Sequence as SequenceABC,
+)
 from typing import (
     Any,
     Callable,
     Dict,
+    Iterable,
     Iterator as IteratorType,
     List,
     Optional,
@@ -47,6 +55,8 @@ class ElementIterator(IteratorABC):
     value(s).
     """
 
+    __slots__ = ("_element", "_index")
+
     def __init__(self, element: Element) -> None:
         self._element = element
         self._index = 0
@@ -65,6 +75,223 @@ class ElementIterator(IteratorABC):
         raise StopIteration()
 
 
+def _noop(*args: Any) -> None:
+    """Destructor of the handles of elements, which are owned by the message,
+    request or element holding their data."""
+
+
+def _viewOf(element: Element, flags: int) -> Any:
+    """Return a view of ``element`` if it is complex or an array, and its
+    converted value otherwise."""
+    handle = element._handle()
+    if internals.blpapi_Element_isComplexType(handle):
+        return ElementView(element, flags)
+    if internals.blpapi_Element_isArray(handle):
+        return ElementArrayView(element, flags)
+    return internals.blpapi_Element_toPy(handle, flags)
+
+
+class ElementView(Mapping):
+    r"""A read-only :py:class:`~collections.abc.Mapping` over the
+    sub-:class:`Element`\s of a complex :class:`Element`.
+
+    :class:`ElementView` objects are obtained from :meth:`Element.view()` or
+    :meth:`Message.asMapping()`. A view reads the underlying
+    :class:`Element` when accessed instead of copying it: a sub-:class:`Element`
+    is looked up and converted only when its key is accessed, and the result
+    is cached, so reading a few keys of a large :class:`Message` costs only
+    those conversions. The view keeps the :class:`Message` it was created from
+    alive.
+
+    The keys are the :py:class:`str` names of the sub-:class:`Element`\s, and
+    the values are the same as in the result of :meth:`Element.toPy()`, except
+    that complex and array sub-:class:`Element`\s are themselves returned as
+    :class:`ElementView` and :class:`ElementArrayView`. A view compares equal
+    to the :py:class:`dict` that :meth:`toPy()` returns.
+    """
+
+    def __init__(self, element: Element, flags: int) -> None:
+        """
+        Args:
+            element: Complex element to view
+            flags: Conversion flags of the values
+        """
+        self.__element = element
+        self.__flags = flags
+        self.__keys: Optional[List[str]] = None
+        self.__values: Dict[str, Any] = {}
+
+    def __getitem__(self, name: Union[Name, str]) -> Any:
+        key = name if isinstance(name, str) else str(name)
+        try:
+            return self.__values[key]
+        except KeyError:
+            pass
+        nameString, nameHandle = getNamePair(name)
+        if nameHandle is None:
+            # no element has a name missing from the name table
+            raise KeyError(
+                f"Element {self.__element.name()} "
+                f"does not contain element {key}"
+            )
+        if internals.blpapi_Element_getItem is not None:
+            # lookup and conversion of scalars in a single call
+            kind, value = internals.blpapi_Element_getItem(
+                self.__element._handle(), nameString, nameHandle, self.__flags
+            )
+            if kind == internals.ITEMKIND_ELEMENT:
+                element = Element(value, self.__element._getDataHolder())
+                if internals.blpapi_Element_isComplexType(value):
+                    value = ElementView(element, self.__flags)
+                else:
+                    value = ElementArrayView(element, self.__flags)
+        else:
+            retCode, handle = internals.blpapi_Element_getElement(
+                self.__element._handle(), nameString, nameHandle
+            )
+            if retCode:
+                raise KeyError(
+                    f"Element {self.__element.name()} "
+                    f"does not contain element {key}"
+                )
+            value = _viewOf(
+                Element(handle, self.__element._getDataHolder()), self.__flags
+            )
+        self.__values[key] = value
+        return value
+
+    def __iter__(self) -> IteratorType:
+        if self.__keys is None:
+            self.__keys = internals.blpapi_Element_keysToPy(
+                self.__element._handle()
+            )
+        return iter(self.__keys)  # type: ignore
+
+    def __len__(self) -> int:
+        return internals.blpapi_Element_numElements(self.__element._handle())
+
+    def __contains__(self, name: Any) -> bool:
+        if not isinstance(name, (Name, str)):
+            return False
+        # the values are cached by 'str', as in '__getitem__'
+        if (name if isinstance(name, str) else str(name)) in self.__values:
+            return True
+        nameString, nameHandle = getNamePair(name)
+        if nameHandle is None:
+            return False
+        retCode, _ = internals.blpapi_Element_getElement(
+            self.__element._handle(), nameString, nameHandle
+        )
+        return retCode == 0
+
+    def __repr__(self) -> str:
+        return f"ElementView({dict(self.items())!r})"
+
+    def element(self) -> Element:
+        """
+        Returns:
+            The :class:`Element` this view reads.
+        """
+        return self.__element
+
+    def toPy(self) -> Dict:
+        """
+        Returns:
+            The full conversion of the viewed :class:`Element`, as returned
+            by :meth:`Element.toPy()` with the options of this view.
+        """
+        return internals.blpapi_Element_toPy(  # type: ignore
+            self.__element._handle(), self.__flags
+        )
+
+
+class ElementArrayView(SequenceABC):
+    """A read-only :py:class:`~collections.abc.Sequence` over the values of an
+    array :class:`Element`.
+
+    Like :class:`ElementView`, the values are converted only when accessed,
+    and cached. Complex values are returned as :class:`ElementView`. Slicing
+    returns a :py:class:`list`. A view compares equal to the
+    :py:class:`list` that :meth:`toPy()` returns.
+    """
+
+    def __init__(self, element: Element, flags: int) -> None:
+        """
+        Args:
+            element: Array element to view
+            flags: Conversion flags of the values
+        """
+        self.__element = element
+        self.__flags = flags
+        self.__isComplex = element.datatype() in (
+            DataType.SEQUENCE,
+            DataType.CHOICE,
+        )
+        self.__values: Dict[int, Any] = {}
+
+    def __getitem__(self, index: Union[int, slice]) -> Any:  # type: ignore
+        if isinstance(index, slice):
+            return [self[i] for i in range(*index.indices(len(self)))]
+        numValues = len(self)
+        position = index + numValues if index < 0 else index
+        if position < 0 or position >= numValues:
+            raise IndexError("ElementArrayView index out of range")
+        try:
+            return self.__values[position]
+        except KeyError:
+            pass
+        handle = self.__element._handle()
+        if self.__isComplex:
+            retCode, valueHandle = internals.blpapi_Element_getValueAsElement(
+                handle, position
+            )
+            _ExceptionUtil.raiseOnError(retCode)
+            value: Any = ElementView(
+                Element(valueHandle, self.__element._getDataHolder()),
+                self.__flags,
+            )
+        else:
+            value = internals.blpapi_Element_valueToPy(
+                handle, position, self.__flags
+            )
+        self.__values[position] = value
+        return value
+
+    def __len__(self) -> int:
+        return internals.blpapi_Element_numValues(self.__element._handle())
+
+    def __eq__(self, other: Any) -> bool:
+        if isinstance(other, (str, bytes)) or not isinstance(
+            other, SequenceABC
+        ):
+            return NotImplemented
+        return len(self) == len(other) and all(
+            mine == theirs for mine, theirs in zip(self, other)
+        )
+
+    __hash__ = None  # type: ignore
+
+    def __repr__(self) -> str:
+        return f"ElementArrayView({list(self)!r})"
+
+    def element(self) -> Element:
+        """
+        Returns:
+            The :class:`Element` this view reads.
+        """
+        return self.__element
+
+    def toPy(self) -> List:
+        """
+        Returns:
+            The full conversion of the viewed :class:`Element`, as returned
+            by :meth:`Element.toPy()` with the options of this view.
+        """
+        return internals.blpapi_Element_toPy(  # type: ignore
+            self.__element._handle(), self.__flags
+        )
+
+
 class Element(CHandle):
     """Represents an item in a message.
 
@@ -227,6 +454,8 @@ class Element(CHandle):
             return Element.__nameTraits
         return Element.__defaultTraits
 
+    __slots__ = ("__dataHolder",)
+
     def __assertIsValid(self) -> None:
         if not self.isValid():
             raise RuntimeError("Element is not valid")
@@ -249,8 +478,7 @@ class Element(CHandle):
         uninitialized :class:`Element` are assignment, :meth:`isValid()`, and
         destruction.
         """
-        noop = lambda *args: None
-        super(Element, self).__init__(handle, noop)
+        super(Element, self).__init__(handle, _noop)
         self.__dataHolder = dataHolder
 
     def _getDataHolder(
@@ -312,6 +540,19 @@ class Element(CHandle):
             return self.getValue(nameOrIndex)
 
         # is name
+        if internals.blpapi_Element_getItem is not None:
+            # lookup and conversion in a single call
+            self.__assertIsValid()
+            name = getNamePair(nameOrIndex)
+            kind, value = internals.blpapi_Element_getItem(
+                self._handle(), name[0], name[1]
+            )
+            if kind == internals.ITEMKIND_ELEMENT:
+                return Element(value, self._getDataHolder())
+            if kind == internals.ITEMKIND_NAME:
+                return Name._createInternally(value)
+            return value
+
         if not self.hasElement(nameOrIndex):
             raise KeyError(
                 f"Element {self.name()} "
@@ -545,8 +786,25 @@ class Element(CHandle):
         _ExceptionUtil.raiseOnError(res)
         return False  # unreachable
 
-    def toPy(self) -> Union[Dict, List, SupportedElementTypes]:
+    def toPy(
+        self,
+        datetimeAsEpochNanos: bool = False,
+        fields: Optional[
+            Union[FieldSelector, Iterable[Union[Name, str]]]
+        ] = None,
+    ) -> Union[Dict, List, SupportedElementTypes]:
         r"""
+        Args:
+            datetimeAsEpochNanos: If ``True``, date and time values are
+                converted to :py:class:`int` nanoseconds instead of
+                :py:mod:`datetime` objects (see below).
+            fields: If specified, only these top-level sub-elements of this
+                complex :class:`Element` are converted (see below).
+
+        Raises:
+            UnsupportedOperationException: If ``fields`` is specified and
+                this :class:`Element` is not a complex type.
+
         Returns:
             A :py:class:`dict`, :py:class:`list`, or value representation of
             this :class:`Element`. This is a deep copy containing only native
@@ -565,6 +823,21 @@ class Element(CHandle):
         If that value was a :class:`Name`, it will be converted to a
         :py:class:`str`.
 
+        If ``datetimeAsEpochNanos`` is ``True``, a value that has both date
+        and time parts is converted to the number of nanoseconds since the
+        1970-01-01 00:00 UTC epoch, a value with only a date part to the
+        nanoseconds since the epoch at midnight UTC of that date, and a value
+        with only a time part to the nanoseconds since midnight, in the
+        value's own offset. This avoids building :py:mod:`datetime` objects
+        for applications that only need timestamps.
+
+        If ``fields`` is specified, the result is a :py:class:`dict` holding
+        only the listed sub-elements, in the listed order; sub-elements that
+        are not part of this :class:`Element` are skipped. Each of them is
+        converted in full. ``fields`` should be a :class:`FieldSelector`
+        created once and reused, as a list of names has to be resolved on
+        every call.
+
         For example, the following ``exampleElement`` has the following BLPAPI
         representation:
 
@@ -612,7 +885,110 @@ class Element(CHandle):
             }
 
         """
-        return internals.blpapi_Element_toPy(self._handle())
+        flags = (
+            internals.TOPY_DATETIME_AS_EPOCH_NANOS
+            if datetimeAsEpochNanos
+            else 0
+        )
+        if fields is None:
+            return internals.blpapi_Element_toPy(self._handle(), flags)
+
+        if not self.isComplexType():
+            raise UnsupportedOperationException(
+                description="Only complex elements support field selection",
+                errorCode=None,
+            )
+        selector = toFieldSelector(fields)
+        return internals.blpapi_Element_toPyFields(
+            self._handle(), selector._handles(), len(selector), flags
+        )
+
+    def toJson(
+        self,
+        datetimeAsEpochNanos: bool = False,
+        fields: Optional[
+            Union[FieldSelector, Iterable[Union[Name, str]]]
+        ] = None,
+    ) -> bytes:
+        """
+        Args:
+            datetimeAsEpochNanos: If ``True``, date and time values are
+                written as nanoseconds, as for :meth:`toPy()`.
+            fields: If specified, only these top-level sub-elements of this
+                complex :class:`Element` are written, as for :meth:`toPy()`.
+
+        Raises:
+            UnsupportedOperationException: If ``fields`` is specified and
+                this :class:`Element` is not a complex type.
+
+        Returns:
+            The UTF-8 encoded JSON of this :class:`Element`.
+
+        The JSON is that of the value :meth:`toPy()` returns, as written by
+        ``json.dumps(value, ensure_ascii=False, separators=(",", ":"))``,
+        except that date and time values are written as the strings their
+        ``isoformat()`` returns and bytes as base64 strings. It is written
+        directly from this :class:`Element`, without converting it to
+        python objects first, which makes it the cheapest way to forward
+        messages to JSON consumers.
+
+        Non-finite floats are written as ``NaN``, ``Infinity`` and
+        ``-Infinity``, as :py:func:`json.dumps` does.
+        """
+        flags = (
+            internals.TOPY_DATETIME_AS_EPOCH_NANOS
+            if datetimeAsEpochNanos
+            else 0
+        )
+        if fields is None:
+            return internals.blpapi_Element_toJson(
+                self._handle(), flags, None, 0
+            )
+
+        if not self.isComplexType():
+            raise UnsupportedOperationException(
+                description="Only complex elements support field selection",
+                errorCode=None,
+            )
+        selector = toFieldSelector(fields)
+        return internals.blpapi_Element_toJson(
+            self._handle(), flags, selector._handles(), len(selector)
+        )
+
+    def view(
+        self, datetimeAsEpochNanos: bool = False
+    ) -> Union[ElementView, ElementArrayView, SupportedElementTypes]:
+        r"""
+        Args:
+            datetimeAsEpochNanos: If ``True``, date and time values are
+                converted to :py:class:`int` nanoseconds, as for
+                :meth:`toPy()`.
+
+        Returns:
+            An :class:`ElementView` if this :class:`Element` is a complex
+            type, an :class:`ElementArrayView` if it is an array, and the
+            value that :meth:`toPy()` returns otherwise.
+
+        Unlike :meth:`toPy()`, which copies this whole :class:`Element` at
+        once, a view converts sub-:class:`Element`\s and values only when
+        they are accessed. Prefer a view when only part of the
+        :class:`Element` is read, for example when filtering messages on a
+        few fields; prefer :meth:`toPy()` when all of it is.
+
+        A view reads this :class:`Element`, so it is only valid as long as
+        this :class:`Element` is, and it keeps the :class:`Message` this
+        :class:`Element` belongs to alive. :class:`Element`\s that are
+        modified after the view is created, like those of a :class:`Request`,
+        should be converted with :meth:`toPy()` instead, since the values
+        already read are cached.
+        """
+        self.__assertIsValid()
+        flags = (
+            internals.TOPY_DATETIME_AS_EPOCH_NANOS
+            if datetimeAsEpochNanos
+            else 0
+        )
+        return _viewOf(self, flags)
 
     def toString(self, level: int = 0, spacesPerLevel: int = 4) -> str:
         """Format this :class:`Element` to the string at the specified
@@ -716,6 +1092,9 @@ class Element(CHandle):
 
         self.__assertIsValid()
         namepair = getNamePair(name)
+        if namepair[1] is None:
+            # no element has a name missing from the name table
+            return False
         res = internals.blpapi_Element_hasElementEx(
             self._handle(),
             namepair[0],
@@ -796,6 +1175,34 @@ class Element(CHandle):
         _ExceptionUtil.raiseOnError(res[0])
         return res[1]
 
+    def getValueAsBytesView(self, index: int = 0) -> memoryview:
+        r"""
+        Args:
+            index: Index of the value in the element
+
+        Returns:
+            ``index``\th entry in the :class:`Element` as a read-only
+            :py:class:`memoryview` of unsigned bytes.
+
+        Raises:
+            InvalidConversionException: If the data type of this
+                :class:`Element` cannot be converted to bytes.
+            IndexOutOfRangeException: If ``index >= numValues()``.
+
+        Unlike :meth:`getValueAsBytes`, the value is not copied: the view
+        refers directly to the data of the :class:`Message` or
+        :class:`Request` this :class:`Element` belongs to, and keeps it alive
+        until the view is released. Use :meth:`memoryview.release` or a
+        ``with`` block to release large payloads promptly.
+        """
+
+        self.__assertIsValid()
+        res = internals.blpapi_Element_getValueAsBytesView(
+            self._handle(), index, self
+        )
+        _ExceptionUtil.raiseOnError(res[0])
+        return res[1]
+
     def getValueAsDatetime(self, index: int = 0) -> AnyPythonDatetime:
         r"""
         Args:
@@ -1010,6 +1417,24 @@ class Element(CHandle):
 
         return self.getElement(name).getValueAsBytes()
 
+    def getElementAsBytesView(self, name: Name) -> memoryview:
+        """
+        Args:
+            name: Sub-element identifier
+
+        Returns:
+            This element's sub-element with ``name`` as a read-only
+            :py:class:`memoryview`, see :meth:`getValueAsBytesView`.
+
+        Raises:
+            Exception: If ``name`` is neither a :class:`Name` nor a string, or
+                if this :class:`Element` is neither a sequence nor a choice, or
+                in case it has no sub-element with the specified ``name``, or
+                in case the element's value can't be returned as bytes.
+        """
+
+        return self.getElement(name).getValueAsBytesView()
+
     def getElementAsDatetime(self, name: Name) -> AnyPythonDatetime:
         """
         Args:
@@ -1235,6 +1660,39 @@ class Element(CHandle):
 
         self.setValue(value, internals.ELEMENT_INDEX_END)
 
+    def appendValues(self, values: Iterable[SupportedElementTypes]) -> None:
+        r"""Append each of the specified ``values`` to this
+        :class:`Element`\s entries at the end, as :meth:`appendValue` does.
+
+        Args:
+            values: Values to append. An object with a ``tolist`` method,
+                such as a NumPy array, an :py:class:`array.array` or a
+                :py:class:`memoryview`, is converted with it first.
+
+        Raises:
+            Exception: As :meth:`appendValue`, for the first value that
+                cannot be appended. The values before it remain appended.
+
+        The values of the types handled by :meth:`appendValue` without
+        conversion, except datetypes and :class:`Name`, are appended in a
+        single call into the ``blpapi`` extension module when it is
+        available, which is much faster than appending them one at a time.
+        """
+
+        self.__assertIsValid()
+        tolist = getattr(values, "tolist", None)
+        if tolist is not None:
+            values = tolist()
+        if internals.blpapi_Element_appendValues is None:
+            for value in values:
+                self.appendValue(value)
+            return
+        _ExceptionUtil.raiseOnError(
+            internals.blpapi_Element_appendValues(
+                self._handle(), values, _setValueOfHandle
+            )
+        )
+
     def appendElement(self) -> Element:
         r"""Append a new element to this array :class:`Element`.
 
@@ -1414,7 +1872,16 @@ class Element(CHandle):
             print(exampleElementAsDict == exampleElement.toPy()) # True
 
         """
-        self._fromPyHelper(value)
+        if internals.blpapi_Element_fromPy is None:
+            self._fromPyHelper(value)
+            return
+
+        self.__assertIsValid()
+        failure = internals.blpapi_Element_fromPy(
+            self._handle(), value, getNamePair, _setValueOfHandle
+        )
+        if failure is not None:
+            _raiseFromPyFailure(failure)
 
     def _fromPyHelper(
         self,
@@ -1439,17 +1906,7 @@ class Element(CHandle):
         activeElement = self
 
         def getActivePathMessage(isArrayEntry: bool = False) -> str:
-            elementType = "scalar"
-            if activeElement.isArray():
-                elementType = "array"
-            elif activeElement.isComplexType():
-                elementType = "complex"
-
-            arrayEntryText = "an entry in " if isArrayEntry else ""
-            return (
-                f"While operating on {arrayEntryText}{elementType} "
-                f" Element `{path}`, "
-            )
+            return _fromPyPathMessage(activeElement, path, isArrayEntry)
 
         if path is None:
             path = str(activeElement.name())
@@ -1554,6 +2011,88 @@ class Element(CHandle):
                 raise Exception(getActivePathMessage() + errorMsg)
 
 
+def _fromPyPathMessage(
+    element: Element, path: Optional[str], isArrayEntry: bool = False
+) -> str:
+    """Return the prefix of the errors of `fromPy` for ``element``, whose
+    path from the formatted `Element` is ``path``."""
+    elementType = "scalar"
+    if element.isArray():
+        elementType = "array"
+    elif element.isComplexType():
+        elementType = "complex"
+
+    arrayEntryText = "an entry in " if isArrayEntry else ""
+    return (
+        f"While operating on {arrayEntryText}{elementType} "
+        f" Element `{path}`, "
+    )
+
+
+def _setValueOfHandle(
+    handle: "typehints.BlpapiElementHandle",
+    value: SupportedElementTypes,
+    index: int,
+) -> None:
+    """Set the value at ``index`` of the `Element` ``handle``, for the values
+    that `blpapi_Element_fromPy` does not set itself."""
+    Element(handle, None).setValue(value, index)
+
+
+_FROMPY_FAILURE_MESSAGES = {
+    internals.FROMPY_ALREADY_FORMATTED: (
+        "this Element has already been formatted"
+    ),
+    internals.FROMPY_NOT_COMPLEX: (
+        "encountered a `Mapping` instance while"
+        " formatting a non-complex Element"
+    ),
+    internals.FROMPY_NOT_ARRAY: (
+        "encountered a `Sequence` while formatting a non-array Element"
+    ),
+    internals.FROMPY_MAPPING_ENTRY: (
+        "encountered a `Mapping` where a scalar value was expected."
+    ),
+    internals.FROMPY_SCALAR_ENTRY: (
+        "encountered a scalar value where a `Mapping` was expected."
+    ),
+}
+
+
+def _raiseFromPyFailure(failure: Tuple) -> None:
+    """Raise the exception that `Element._fromPyHelper` raises for the
+    ``failure`` returned by `blpapi_Element_fromPy`."""
+    kind, handle, path, isArrayEntry, detail = failure
+    if kind in (internals.FROMPY_ERROR, internals.FROMPY_RAISE) and (
+        isinstance(detail, tuple)
+    ):
+        detail = _ExceptionUtil.createException(*detail)
+    if kind == internals.FROMPY_RAISE:
+        raise detail
+
+    element = Element(handle, None)
+    errorMsg = _fromPyPathMessage(element, path, isArrayEntry)
+    if kind == internals.FROMPY_ERROR:
+        errorMsg += f"encountered error: {detail}"
+    elif kind == internals.FROMPY_NOT_SCALAR:
+        errorMsg += (
+            f"encountered an incompatible type, {type(detail)},"
+            " for a non-scalar Element"
+        )
+    elif kind == internals.FROMPY_NESTED_SEQUENCE:
+        typeDef = element.elementDefinition().typeDefinition()
+        expectedObject = (
+            "`Mapping`" if typeDef.isComplexType() else "scalar value"
+        )
+        errorMsg += (
+            f"encountered a nested `Sequence` where a "
+            f"{expectedObject} was expected."
+        )
+    else:
+        errorMsg += _FROMPY_FAILURE_MESSAGES[kind]
+    raise Exception(errorMsg)
+
+
 _ELEMENT_VALUE_GETTER = {
     DataType.BOOL: Element.getValueAsBool,
     DataType.CHAR: Element.getValueAsString,
@@ -33,9 +33,21 @@ Synchronously read the response 'event' and parse over messages using 'token'
 
 """
 from __future__ import annotations
-from typing import Iterator as IteratorType, Optional, Set
+from typing import (
+    Any,
+    Dict,
+    Iterable,
+    Iterator as IteratorType,
+    List,
+    Optional,
+    Set,
+    Union,
+)
 from collections.abc import Iterator as IteratorABC
+from ctypes import addressof
+from .fieldselector import FieldSelector, toFieldSelector
 from .message import Message
+from .name import Name
 from . import internals
 from . import utils
 from .utils import get_handle
@@ -52,6 +64,8 @@ class MessageIterator(CHandle, IteratorABC):
     :class:`Event` and :class:`Message` objects.
     """
 
+    __slots__ = ("__handle", "__event")
+
     def __init__(self, event: Event) -> None:
         selfhandle = internals.blpapi_MessageIterator_create(get_handle(event))
         super(MessageIterator, self).__init__(
@@ -124,6 +138,8 @@ class Event(CHandle, metaclass=utils.MetaClassForClassesWithEnums):
     UNKNOWN = -1
     """Unknown event"""
 
+    __slots__ = ("__handle", "__sessions")
+
     def __init__(
         self,
         handle: BlpapiEventHandle,
@@ -147,6 +163,111 @@ class Event(CHandle, metaclass=utils.MetaClassForClassesWithEnums):
         """
         return MessageIterator(self)
 
+    def toPy(
+        self,
+        datetimeAsEpochNanos: bool = False,
+        fields: Optional[
+            Union[FieldSelector, Iterable[Union[Name, str]]]
+        ] = None,
+    ) -> List[Dict[str, Any]]:
+        r"""
+        Args:
+            datetimeAsEpochNanos: If ``True``, date and time values are
+                converted to :py:class:`int` nanoseconds, as described in
+                :meth:`Element.toPy`.
+            fields: If specified, only these top-level fields of each
+                :class:`Message` are converted, as described in
+                :meth:`Element.toPy`.
+
+        Returns:
+            A :py:class:`list` with one :py:class:`dict` per :class:`Message`
+            in this :class:`Event`, in delivery order.
+
+        Each :py:class:`dict` has the following keys:
+
+        * ``"messageType"``: the :py:class:`str` form of
+          :meth:`Message.messageType`.
+        * ``"topicName"``: the topic string of the :class:`Message`, or an
+          empty :py:class:`str` if there is none (see
+          :meth:`Message.topicName`).
+        * ``"correlationIds"``: a :py:class:`list` of the values of the
+          :class:`Message`'s :class:`CorrelationId`\s, as returned by
+          :meth:`CorrelationId.value`.
+        * ``"elements"``: the content of the :class:`Message`, as returned
+          by :meth:`Message.toPy` with the same ``datetimeAsEpochNanos``
+          and ``fields``.
+
+        The whole :class:`Event` is converted in a single call, without
+        creating a :class:`Message` for each of its messages, which makes
+        this considerably cheaper than ``[m.toPy() for m in event]`` for
+        events carrying many messages.
+        """
+        flags = (
+            internals.TOPY_DATETIME_AS_EPOCH_NANOS
+            if datetimeAsEpochNanos
+            else 0
+        )
+        if fields is None:
+            return internals.blpapi_Event_toPy(self.__handle, flags, None, 0)
+        selector = toFieldSelector(fields)
+        # pylint: disable=protected-access
+        return internals.blpapi_Event_toPy(
+            self.__handle, flags, selector._handles(), len(selector)
+        )
+
+    def decode(
+        self,
+        datetimeAsEpochNanos: bool = False,
+        fields: Optional[
+            Union[FieldSelector, Iterable[Union[Name, str]]]
+        ] = None,
+    ) -> DecodedEvent:
+        r"""
+        Args:
+            datetimeAsEpochNanos: If ``True``, date and time values are
+                converted to :py:class:`int` nanoseconds, as described in
+                :meth:`Element.toPy`.
+            fields: If specified, only these top-level fields of each
+                :class:`Message` are decoded, as described in
+                :meth:`Element.toPy`.
+
+        Returns:
+            The messages of this :class:`Event`, decoded into a native
+            representation.
+
+        Decoding is the first half of :meth:`toPy`: it walks all the
+        messages of this :class:`Event` without holding the GIL, so that
+        events decoded on several threads are decoded in parallel. The
+        python objects are then created by :meth:`DecodedEvent.toPy`, which
+        returns the same result as :meth:`toPy`, or the values are stored
+        in columns by :meth:`ColumnarExtractor.extract`. For example, with
+        a pool of worker threads::
+
+            with ThreadPoolExecutor(8) as pool:
+                decode = functools.partial(Event.decode, fields=selector)
+                for decoded in pool.map(decode, events):
+                    process(decoded.toPy())
+
+        On free-threaded builds of python, the conversions of different
+        :class:`DecodedEvent`\s also run in parallel.
+        """
+        flags = (
+            internals.TOPY_DATETIME_AS_EPOCH_NANOS
+            if datetimeAsEpochNanos
+            else 0
+        )
+        selector = None if fields is None else toFieldSelector(fields)
+        decoded = None
+        if internals.blpapi_Event_decode is not None:
+            # pylint: disable=protected-access
+            decoded = internals.blpapi_Event_decode(
+                self.__handle,
+                flags,
+                None if selector is None else addressof(selector._handles()),
+                0 if selector is None else len(selector),
+            )
+        return DecodedEvent(self, decoded, datetimeAsEpochNanos, selector)
+
     def _sessions(self) -> Set["typehints.AbstractSession"]:
         """Return session(s) that this 'Event' is related to.
 
@@ -157,6 +278,64 @@ class Event(CHandle, metaclass=utils.MetaClassForClassesWithEnums):
     # derived from this class from changes:
 
 
+class DecodedEvent:
+    """The messages of an :class:`Event` decoded by :meth:`Event.decode`.
+
+    A :class:`DecodedEvent` keeps its :class:`Event` alive, and can be
+    converted any number of times, from any thread.
+    """
+
+    def __init__(
+        self,
+        event: Event,
+        decoded: Any,
+        datetimeAsEpochNanos: bool,
+        selector: Optional[FieldSelector],
+    ) -> None:
+        """For internal use only."""
+        # the decoded values refer to the memory of 'event'
+        self.__event = event
+        self.__decoded = decoded
+        self.__datetimeAsEpochNanos = datetimeAsEpochNanos
+        self.__selector = selector
+
+    def event(self) -> Event:
+        """
+        Returns:
+            The decoded :class:`Event`.
+        """
+        return self.__event
+
+    def numMessages(self) -> int:
+        """
+        Returns:
+            The number of messages of the decoded :class:`Event`.
+        """
+        if self.__decoded is None:
+            return sum(1 for _ in self.__event)
+        return internals.blpapi_DecodedEvent_numMessages(self.__decoded)
+
+    def toPy(self) -> List[Dict[str, Any]]:
+        """
+        Returns:
+            The same :py:class:`list` as :meth:`Event.toPy` returns with the
+            arguments given to :meth:`Event.decode`.
+        """
+        if self.__decoded is None:
+            return self.__event.toPy(
+                datetimeAsEpochNanos=self.__datetimeAsEpochNanos,
+                fields=self.__selector,
+            )
+        return internals.blpapi_DecodedEvent_toPy(self.__decoded)
+
+    def _decoded(self) -> Any:
+        """Return the decoded values, 'None' if the 'ffiutils' module is not
+        available.
+
+        For internal use."""
+        return self.__decoded
+
+
 class EventQueue(CHandle):
     """A construct used to handle replies to request synchronously.
 
@@ -208,6 +387,32 @@ class EventQueue(CHandle):
             return None
         return Event(res[1], self._getSessions())
 
+    def drainEvents(self, maxEvents: int, timeout: int = 0) -> List[Event]:
+        r"""
+        Args:
+            maxEvents: Maximum number of events to return.
+            timeout: Timeout threshold in milliseconds.
+
+        Returns:
+            List of up to ``maxEvents`` next available events from the
+            :class:`EventQueue`.
+
+        Raises:
+            ValueError: If ``maxEvents`` is not positive.
+
+        Wait for the next :class:`Event` as :meth:`nextEvent()` does, then
+        add the :class:`Event`\s already available from the
+        :class:`EventQueue` without blocking again, in a single call. If no
+        :class:`Event` is available within the specified ``timeout``, an
+        empty list is returned instead of an :class:`Event` of type
+        :attr:`~Event.TIMEOUT`.
+        """
+        events = internals.blpapi_EventQueue_drainEvents(
+            self.__handle, maxEvents, timeout
+        )
+        sessions = self._getSessions()
+        return [Event(event, sessions) for event in events]
+
     def purge(self) -> None:
         """Purge any :class:`Event` objects in this :class:`EventQueue`.
 
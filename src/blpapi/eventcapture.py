@@ -0,0 +1,805 @@
+# eventcapture.py
+
+"""Record events to a capture file, and replay them.
+
+This component defines two classes: 'EventRecorder', which appends the
+events it is given to an append-only, memory-mapped capture file, and
+'EventReplayer', which reads a capture file and rebuilds its events with the
+'blpapi.test' utilities, at the pace at which they were recorded, or faster.
+
+A capture file starts with a 16 bytes header, followed by a record per
+event. Each record holds the time at which the event was recorded, its event
+type and, for each of its messages, the message type, topic name, service
+name, recap and fragment types, 'timeReceived', correlation ids and the
+values of the elements. When the extension module is available, the records
+are encoded and decoded natively, the events being encoded without holding
+the GIL.
+
+An 'EventRecorder' is also an event handler, which records the events it is
+given before handing them to another event handler, if any.
+
+Usage
+-----
+The following records the events of a session.
+
+    with EventRecorder("open.capture", processEvent) as recorder:
+        session = Session(sessionOptions, recorder)
+        ...
+
+The following replays them twice as fast against a new event handler, the
+schemas of the messages being those of the services of a session.
+
+    with EventReplayer("open.capture", [mktdataService]) as replayer:
+        replayer.replay(newProcessEvent, speed=2.0)
+"""
+
+import datetime
+import mmap
+import os
+import struct
+import threading
+import time
+from typing import Any, Callable, Dict, Iterable, Iterator, Optional, Tuple
+from .correlationid import CorrelationId
+from .datetime import _DatetimeUtil, UTC
+from .event import Event
+from .exception import NotFoundException
+from .name import Name
+from .utils import get_handle
+from . import internals
+from . import typehints  # pylint: disable=unused-import
+
+_MAGIC = b"BLPAPICF"
+_VERSION = 1
+_FILE_HEADER = struct.Struct("<8sII")  # magic, version, reserved
+_SIZE = struct.Struct("<I")
+_RECORD_HEADER = struct.Struct("<qiI")  # recordedAt, eventType, numMessages
+_MESSAGE_HEADER = struct.Struct("<iiqI")
+_CORRELATION_ID = struct.Struct("<BQ")
+_DATETIME = struct.Struct("<BBBBHBBHhI")
+_VALUE_HEADER = struct.Struct("<BI")  # kind, length of the name
+
+# kinds of the values of the records, must match ffi_utils.c
+_NULL = 0
+_BOOL = 1
+_INT64 = 2
+_FLOAT64 = 3
+_STRING = 4
+_BYTES = 5
+_DATETIME_KIND = 6
+_COMPLEX = 7
+_ARRAY = 8
+
+_NO_TIME = -(2**63)  # 'timeReceived' of the messages without one
+_EPOCH_ORDINAL = datetime.date(1970, 1, 1).toordinal()
+
+_INT_DATATYPES = (
+    internals.DATATYPE_BYTE,
+    internals.DATATYPE_INT32,
+    internals.DATATYPE_INT64,
+)
+_FLOAT_DATATYPES = (internals.DATATYPE_FLOAT32, internals.DATATYPE_FLOAT64)
+_STRING_DATATYPES = (
+    internals.DATATYPE_CHAR,
+    internals.DATATYPE_STRING,
+    internals.DATATYPE_ENUMERATION,
+)
+_DATETIME_DATATYPES = (
+    internals.DATATYPE_DATE,
+    internals.DATATYPE_TIME,
+    internals.DATATYPE_DATETIME,
+)
+
+
+def _datetimeToNanos(value: Any) -> Optional[int]:
+    """The nanoseconds since the epoch of the 'HighPrecisionDatetime'
+    ``value``, as computed by 'datetimeToNanos' in ffi_utils.c."""
+    dt = value.datetime
+    hasDate = (
+        dt.parts & internals.DATETIME_DATE_PART == internals.DATETIME_DATE_PART
+    )
+    hasTime = dt.parts & internals.DATETIME_TIMEFRACSECONDS_PART != 0
+    nanos = 0
+    if hasTime:
+        nanos = (
+            ((dt.hours * 60 + dt.minutes) * 60 + dt.seconds) * 1_000_000_000
+            + dt.milliSeconds * 1_000_000
+            + value.picoseconds // 1000
+        )
+    if hasDate:
+        days = datetime.date(dt.year, dt.month, dt.day).toordinal()
+        nanos += (days - _EPOCH_ORDINAL) * 86_400_000_000_000
+        if hasTime and dt.parts & internals.DATETIME_OFFSET_PART:
+            nanos -= dt.offset * 60_000_000_000
+    elif not hasTime:
+        return None
+    return nanos
+
+
+def _putString(out: bytearray, value: str) -> None:
+    data = value.encode()
+    out += _SIZE.pack(len(data))
+    out += data
+
+
+def _encodeScalar(out: bytearray, element: Any, index: int) -> None:
+    datatype = element.datatype()
+    if datatype == internals.DATATYPE_BOOL:
+        out += struct.pack("<B", element.getValueAsBool(index))
+    elif datatype in _INT_DATATYPES:
+        out += struct.pack("<q", element.getValueAsInteger(index))
+    elif datatype in _FLOAT_DATATYPES:
+        out += struct.pack("<d", element.getValueAsFloat(index))
+    elif datatype in _STRING_DATATYPES:
+        _putString(out, element.getValueAsString(index))
+    elif datatype == internals.DATATYPE_BYTEARRAY:
+        data = element.getValueAsBytes(index)
+        out += _SIZE.pack(len(data))
+        out += data
+    else:
+        _, value = internals.blpapi_Element_getValueAsHighPrecisionDatetime(
+            get_handle(element), index
+        )
+        dt = value.datetime
+        out += _DATETIME.pack(
+            dt.parts,
+            dt.hours,
+            dt.minutes,
+            dt.seconds,
+            dt.milliSeconds,
+            dt.month,
+            dt.day,
+            dt.year,
+            dt.offset,
+            value.picoseconds,
+        )
+
+
+def _scalarKind(datatype: int) -> int:
+    if datatype == internals.DATATYPE_BOOL:
+        return _BOOL
+    if datatype in _INT_DATATYPES:
+        return _INT64
+    if datatype in _FLOAT_DATATYPES:
+        return _FLOAT64
+    if datatype in _STRING_DATATYPES:
+        return _STRING
+    if datatype == internals.DATATYPE_BYTEARRAY:
+        return _BYTES
+    if datatype in _DATETIME_DATATYPES:
+        return _DATETIME_KIND
+    raise TypeError(f"Cannot record an element of datatype {datatype}")
+
+
+def _encodeValueHeader(out: bytearray, kind: int, name: str) -> None:
+    data = name.encode()
+    out += _VALUE_HEADER.pack(kind, len(data))
+    out += data
+
+
+def _encodeElement(out: bytearray, element: Any, name: str) -> None:
+    if element.isComplexType():
+        _encodeValueHeader(out, _COMPLEX, name)
+        out += _SIZE.pack(element.numElements())
+        for subElement in element.elements():
+            _encodeElement(out, subElement, str(subElement.name()))
+    elif element.isArray():
+        isComplex = (
+            element.elementDefinition().typeDefinition().isComplexType()
+        )
+        _encodeValueHeader(out, _ARRAY, name)
+        out += _SIZE.pack(element.numValues())
+        for index in range(element.numValues()):
+            if isComplex:
+                _encodeElement(out, element.getValueAsElement(index), "")
+            else:
+                _encodeValueHeader(out, _scalarKind(element.datatype()), "")
+                _encodeScalar(out, element, index)
+    elif element.isNull():
+        _encodeValueHeader(out, _NULL, name)
+    else:
+        _encodeValueHeader(out, _scalarKind(element.datatype()), name)
+        _encodeScalar(out, element, 0)
+
+
+def _encodeEvent(event: Event, recordedAt: int) -> bytes:
+    """The record of ``event``, as encoded by 'blpapi_Event_encode' in
+    ffi_utils.c."""
+    messages = list(event)
+    out = bytearray(_SIZE.size)
+    out += _RECORD_HEADER.pack(recordedAt, event.eventType(), len(messages))
+    for message in messages:
+        handle = get_handle(message)
+        _putString(out, str(message.messageType()))
+        _putString(out, internals.blpapi_Message_topicName(handle) or "")
+        serviceHandle = internals.blpapi_Message_service(handle)
+        _putString(
+            out,
+            ""
+            if serviceHandle is None
+            else internals.blpapi_Service_name(serviceHandle),
+        )
+        rc, timePoint = internals.blpapi_Message_timeReceived(handle)
+        nanos = None
+        if rc == 0:
+            nanos = _datetimeToNanos(
+                internals.blpapi_HighPrecisionDatetime_fromTimePoint_wrapper(
+                    timePoint
+                )
+            )
+        correlationIds = message.correlationIds()
+        out += _MESSAGE_HEADER.pack(
+            message.recapType(),
+            message.fragmentType(),
+            _NO_TIME if nanos is None else nanos,
+            len(correlationIds),
+        )
+        for correlationId in correlationIds:
+            isInt = correlationId.type() in (
+                CorrelationId.INT_TYPE,
+                CorrelationId.AUTOGEN_TYPE,
+            )
+            out += _CORRELATION_ID.pack(
+                correlationId.type(), correlationId.value() if isInt else 0
+            )
+        _encodeElement(out, message.asElement(), "")
+    _SIZE.pack_into(out, 0, len(out) - _SIZE.size)
+    return bytes(out)
+
+
+class _RecordReader:
+    """Decoder of a record without the extension module, with the same
+    result as 'CaptureRecord_toPy' in ffi_utils.c."""
+
+    def __init__(self, record: bytes, datetimeAsEpochNanos: bool) -> None:
+        self.__record = record
+        self.__offset = 0
+        self.__datetimeAsEpochNanos = datetimeAsEpochNanos
+
+    def __unpack(self, layout: struct.Struct) -> Tuple:
+        result = layout.unpack_from(self.__record, self.__offset)
+        self.__offset += layout.size
+        return result
+
+    def __bytes(self, length: int) -> bytes:
+        end = self.__offset + length
+        if end > len(self.__record):
+            raise ValueError("Malformed capture record")
+        result = self.__record[self.__offset : end]
+        self.__offset = end
+        return result
+
+    def __string(self) -> str:
+        (length,) = self.__unpack(_SIZE)
+        return self.__bytes(length).decode()
+
+    def __datetime(self) -> Any:
+        fields = self.__unpack(_DATETIME)
+        value = internals.HighPrecisionDatetime()
+        dt = value.datetime
+        (
+            dt.parts,
+            dt.hours,
+            dt.minutes,
+            dt.seconds,
+            dt.milliSeconds,
+            dt.month,
+            dt.day,
+            dt.year,
+            dt.offset,
+            value.picoseconds,
+        ) = fields
+        if not dt.parts:
+            return None
+        if self.__datetimeAsEpochNanos:
+            return _datetimeToNanos(value)
+        return _DatetimeUtil.convertToNative(value)
+
+    def __value(self) -> Tuple[str, Any]:
+        kind, length = self.__unpack(_VALUE_HEADER)
+        name = self.__bytes(length).decode()
+        if kind == _NULL:
+            return name, None
+        if kind == _BOOL:
+            return name, bool(self.__unpack(struct.Struct("<B"))[0])
+        if kind == _INT64:
+            return name, self.__unpack(struct.Struct("<q"))[0]
+        if kind == _FLOAT64:
+            return name, self.__unpack(struct.Struct("<d"))[0]
+        if kind == _STRING:
+            return name, self.__string()
+        if kind == _BYTES:
+            (length,) = self.__unpack(_SIZE)
+            return name, self.__bytes(length)
+        if kind == _DATETIME_KIND:
+            return name, self.__datetime()
+        if kind == _COMPLEX:
+            (numValues,) = self.__unpack(_SIZE)
+            return name, dict(self.__value() for _ in range(numValues))
+        if kind == _ARRAY:
+            (numValues,) = self.__unpack(_SIZE)
+            return name, [self.__value()[1] for _ in range(numValues)]
+        raise ValueError("Malformed capture record")
+
+    def __message(self) -> Dict[str, Any]:
+        messageType = self.__string()
+        topicName = self.__string()
+        service = self.__string()
+        recapType, fragmentType, nanos, numCorrelationIds = self.__unpack(
+            _MESSAGE_HEADER
+        )
+        correlationIds = []
+        for _ in range(numCorrelationIds):
+            valueType, value = self.__unpack(_CORRELATION_ID)
+            isInt = valueType in (
+                internals.CORRELATION_TYPE_INT,
+                internals.CORRELATION_TYPE_AUTOGEN,
+            )
+            correlationIds.append(value if isInt else None)
+        return {
+            "messageType": messageType,
+            "topicName": topicName,
+            "service": service,
+            "recapType": recapType,
+            "fragmentType": fragmentType,
+            "timeReceived": None if nanos == _NO_TIME else nanos,
+            "correlationIds": correlationIds,
+            "elements": self.__value()[1],
+        }
+
+    def read(self) -> Dict[str, Any]:
+        try:
+            recordedAt, eventType, numMessages = self.__unpack(
+                _RECORD_HEADER
+            )
+            result = {
+                "recordedAt": recordedAt,
+                "eventType": eventType,
+                "messages": [self.__message() for _ in range(numMessages)],
+            }
+        except (struct.error, UnicodeDecodeError) as error:
+            raise ValueError("Malformed capture record") from error
+        if self.__offset != len(self.__record):
+            raise ValueError("Malformed capture record")
+        return result
+
+
+def _readHeader(path: str, data: Any) -> None:
+    if len(data) < _FILE_HEADER.size:
+        raise ValueError(f"'{path}' is not a capture file")
+    magic, version, _ = _FILE_HEADER.unpack_from(data, 0)
+    if magic != _MAGIC:
+        raise ValueError(f"'{path}' is not a capture file")
+    if version != _VERSION:
+        raise ValueError(
+            f"'{path}' has version {version}, only version {_VERSION} is"
+            " supported"
+        )
+
+
+def _records(data: Any, end: int) -> Iterator[Tuple[int, int]]:
+    """The offsets and sizes of the records of the capture file mapped by
+    ``data``, up to ``end``. The records stop at the first zero size, which
+    follows the last record of a file being recorded, or at a record which
+    was not entirely written."""
+    offset = _FILE_HEADER.size
+    while offset + _SIZE.size <= end:
+        (size,) = _SIZE.unpack_from(data, offset)
+        if size == 0 or offset + _SIZE.size + size > end:
+            return
+        yield offset + _SIZE.size, size
+        offset += _SIZE.size + size
+
+
+class EventRecorder:
+    """Recorder of events to a capture file.
+
+    :meth:`record` appends a record of an event to the capture file, which
+    is memory-mapped and grown by ``chunkSize`` bytes, or more, whenever a
+    record does not fit in it. An existing capture file is appended to.
+    The file is truncated to its records when the recorder is closed, and
+    the records written so far can be replayed from another process while
+    it is open.
+
+    An :class:`EventRecorder` can be used as the ``eventHandler`` of a
+    :class:`Session`, in which case each event is recorded, then given to
+    the ``handler`` of the recorder, if any.
+
+    An :class:`EventRecorder` can be used from any thread.
+    """
+
+    def __init__(
+        self,
+        path: str,
+        handler: Optional[
+            Callable[[Event, "typehints.AbstractSession"], None]
+        ] = None,
+        chunkSize: int = 16 * 1024 * 1024,
+    ) -> None:
+        """Open the capture file at ``path``, creating it if needed.
+
+        Args:
+            path: Path of the capture file
+            handler: Event handler of the events, once recorded
+            chunkSize: Minimum number of bytes by which the capture file is
+                grown
+
+        Raises:
+            ValueError: If ``path`` is neither empty nor a capture file
+        """
+        if chunkSize <= 0:
+            raise ValueError("`chunkSize` must be positive")
+        self.__handler = handler
+        self.__chunkSize = chunkSize
+        self.__lock = threading.Lock()
+        self.__numRecords = 0
+        self.__mmap: Optional[mmap.mmap] = None
+        self.__file = open(  # pylint: disable=consider-using-with
+            os.open(path, os.O_RDWR | os.O_CREAT), "r+b"
+        )
+        try:
+            size = os.fstat(self.__file.fileno()).st_size
+            if size == 0:
+                self.__capacity = 0
+                self.__end = _FILE_HEADER.size
+                self.__reserve(0)
+                assert self.__mmap is not None
+                self.__mmap[: _FILE_HEADER.size] = _FILE_HEADER.pack(
+                    _MAGIC, _VERSION, 0
+                )
+            else:
+                self.__capacity = size
+                self.__mmap = mmap.mmap(self.__file.fileno(), size)
+                _readHeader(path, self.__mmap)
+                self.__end = _FILE_HEADER.size
+                for offset, recordSize in _records(self.__mmap, size):
+                    self.__end = offset + recordSize
+                    self.__numRecords += 1
+        except BaseException:
+            # not truncated, 'path' may not be a capture file
+            if self.__mmap is not None:
+                self.__mmap.close()
+            self.__file.close()
+            raise
+
+    def __reserve(self, size: int) -> None:
+        needed = self.__end + size + _SIZE.size  # room for the zero size
+        if needed <= self.__capacity:
+            return
+        capacity = max(needed, 2 * self.__capacity)
+        capacity = -(-capacity // self.__chunkSize) * self.__chunkSize
+        if self.__mmap is not None:
+            self.__mmap.close()
+            self.__mmap = None
+        # the new bytes are zeros, which end the records
+        self.__file.truncate(capacity)
+        self.__mmap = mmap.mmap(self.__file.fileno(), capacity)
+        self.__capacity = capacity
+
+    def record(self, event: Event) -> None:
+        """Append a record of ``event`` to the capture file.
+
+        Args:
+            event: The event to record
+
+        Raises:
+            ValueError: If this recorder is closed
+        """
+        recordedAt = time.time_ns()
+        if internals.blpapi_Event_encode is not None:
+            data = internals.blpapi_Event_encode(get_handle(event), recordedAt)
+        else:
+            data = _encodeEvent(event, recordedAt)
+        with self.__lock:
+            if self.__file.closed:
+                raise ValueError("The recorder is closed")
+            self.__reserve(len(data))
+            assert self.__mmap is not None
+            start = self.__end
+            # the size is written last, so that a reader never sees a
+            # record that is not entirely written
+            self.__mmap[start + _SIZE.size : start + len(data)] = data[
+                _SIZE.size :
+            ]
+            self.__mmap[start : start + _SIZE.size] = data[: _SIZE.size]
+            self.__end += len(data)
+            self.__numRecords += 1
+
+    def __call__(
+        self, event: Event, session: "typehints.AbstractSession"
+    ) -> None:
+        """Record ``event``, then give it to the ``handler`` of this
+        recorder, if any."""
+        self.record(event)
+        if self.__handler is not None:
+            self.__handler(event, session)
+
+    def numRecords(self) -> int:
+        """
+        Returns:
+            The number of records of the capture file.
+        """
+        with self.__lock:
+            return self.__numRecords
+
+    def flush(self) -> None:
+        """Write the records to the capture file on disk."""
+        with self.__lock:
+            if self.__mmap is not None:
+                self.__mmap.flush()
+
+    def close(self) -> None:
+        """Flush and close the capture file, truncated to its records. Does
+        nothing if this recorder is already closed."""
+        with self.__lock:
+            if self.__file.closed:
+                return
+            if self.__mmap is not None:
+                self.__mmap.flush()
+                self.__mmap.close()
+                self.__mmap = None
+                self.__file.truncate(self.__end)
+            self.__file.close()
+
+    def __enter__(self) -> "EventRecorder":
+        return self
+
+    def __exit__(self, *args: Any) -> None:
+        self.close()
+
+
+class EventReplayer:
+    """Replayer of the events of a capture file.
+
+    The events of the records of the capture file are rebuilt with
+    :func:`blpapi.test.createEvent` and :func:`blpapi.test.appendMessage`,
+    the messages having the recorded recap and fragment types,
+    ``timeReceived``, integer correlation ids and service, and elements. The
+    correlation ids of the other types are not replayed, nor are the topic
+    names, which are only available from :meth:`records`.
+
+    The definition of each message is found by its message type in the
+    event definitions, then in the response definitions of the operations,
+    of the service of the message, which must be one of the ``services`` of
+    the replayer. The messages without a service, or whose service does not
+    define their type, are replayed as the admin messages of
+    :func:`blpapi.test.getAdminMessageDefinition`.
+    """
+
+    def __init__(
+        self, path: str, services: Iterable["typehints.Service"] = ()
+    ) -> None:
+        """Open the capture file at ``path``.
+
+        Args:
+            path: Path of the capture file
+            services: Services of the recorded messages, for instance
+                opened by a :class:`Session` or created by
+                :func:`blpapi.test.deserializeService`
+
+        Raises:
+            ValueError: If ``path`` is not a capture file
+        """
+        self.__services = {service.name(): service for service in services}
+        self.__definitions: Dict[Tuple[str, str], Any] = {}
+        self.__names: Dict[str, Name] = {}
+        with open(path, "rb") as file:
+            size = os.fstat(file.fileno()).st_size
+            if size < _FILE_HEADER.size:
+                raise ValueError(f"'{path}' is not a capture file")
+            self.__mmap = mmap.mmap(
+                file.fileno(), size, access=mmap.ACCESS_READ
+            )
+        try:
+            _readHeader(path, self.__mmap)
+        except ValueError:
+            self.close()
+            raise
+
+    def records(
+        self, datetimeAsEpochNanos: bool = False
+    ) -> Iterator[Dict[str, Any]]:
+        r"""
+        Args:
+            datetimeAsEpochNanos: Whether the datetime values are returned
+                as ``int`` nanoseconds since the epoch, as by
+                :meth:`Element.toPy`
+
+        Returns:
+            An iterator over the records of the capture file, as ``dict``\s
+            of their ``recordedAt`` time in ``int`` nanoseconds since the
+            epoch, ``eventType`` and ``messages``. The messages are the
+            ``dict``\s of :meth:`Message.toPy`, the correlation ids being
+            those of :meth:`Message.correlationIdInts`, with their
+            ``service`` name, ``recapType``, ``fragmentType`` and
+            ``timeReceived``, in ``int`` nanoseconds since the epoch or
+            ``None``.
+
+        Raises:
+            ValueError: If a record is malformed
+        """
+        flags = (
+            internals.TOPY_DATETIME_AS_EPOCH_NANOS
+            if datetimeAsEpochNanos
+            else 0
+        )
+        for offset, size in _records(self.__mmap, len(self.__mmap)):
+            record = self.__mmap[offset : offset + size]
+            if internals.CaptureRecord_toPy is not None:
+                yield internals.CaptureRecord_toPy(record, flags)
+            else:
+                yield _RecordReader(record, datetimeAsEpochNanos).read()
+
+    def events(self) -> Iterator[Tuple[int, Event]]:
+        """
+        Returns:
+            An iterator over the ``recordedAt`` times, in ``int``
+            nanoseconds since the epoch, and rebuilt events of the records
+            of the capture file.
+
+        Raises:
+            NotFoundException: If the definition of a message is not found
+        """
+        for record in self.records():
+            yield record["recordedAt"], self.__event(record)
+
+    def replay(
+        self,
+        handler: Callable[[Event, Any], None],
+        speed: Optional[float] = 1.0,
+        session: Optional["typehints.AbstractSession"] = None,
+    ) -> int:
+        """Call ``handler`` with each rebuilt event and ``session``, at the
+        pace of their records.
+
+        Args:
+            handler: The event handler of the rebuilt events
+            speed: How many times faster than recorded the events are
+                replayed, or ``None`` to replay them as fast as possible
+            session: The session given to ``handler``
+
+        Returns:
+            The number of events replayed.
+
+        The time taken by ``handler`` is not added to the intervals
+        between the events: a late event is replayed immediately.
+        """
+        if speed is not None and speed <= 0:
+            raise ValueError("`speed` must be positive or `None`")
+        numEvents = 0
+        start: Optional[Tuple[int, int]] = None
+        for recordedAt, event in self.events():
+            if speed is not None:
+                now = time.perf_counter_ns()
+                if start is None:
+                    start = (recordedAt, now)
+                delay = (
+                    start[1] + (recordedAt - start[0]) / speed - now
+                ) / 1e9
+                if delay > 0:
+                    time.sleep(delay)
+            handler(event, session)
+            numEvents += 1
+        return numEvents
+
+    def close(self) -> None:
+        """Close the capture file."""
+        self.__mmap.close()
+
+    def __enter__(self) -> "EventReplayer":
+        return self
+
+    def __exit__(self, *args: Any) -> None:
+        self.close()
+
+    def __name(self, key: str) -> Name:
+        name = self.__names.get(key)
+        if name is None:
+            name = self.__names[key] = Name(key)
+        return name
+
+    def __definition(self, serviceName: str, messageType: str) -> Any:
+        key = (serviceName, messageType)
+        definition = self.__definitions.get(key)
+        if definition is not None:
+            return definition
+        service = self.__services.get(serviceName)
+        if service is not None and service.hasEventDefinition(messageType):
+            definition = service.getEventDefinition(messageType)
+        elif service is not None:
+            for operation in service.operations():
+                for response in operation.responseDefinitions():
+                    if str(response.name()) == messageType:
+                        definition = response
+        if definition is None:
+            # imported here, 'blpapi.test' needing the 'blpapi' package
+            from .test import getAdminMessageDefinition
+
+            try:
+                definition = getAdminMessageDefinition(
+                    self.__name(messageType)
+                )
+            except Exception as error:  # pylint: disable=broad-except
+                raise NotFoundException(
+                    f"No definition of '{messageType}' found in the"
+                    f" services {sorted(self.__services)}",
+                    0,
+                ) from error
+        self.__definitions[key] = definition
+        return definition
+
+    def __format(self, formatter: Any, values: Dict[str, Any]) -> None:
+        for key, value in values.items():
+            name = self.__name(key)
+            if isinstance(value, dict):
+                formatter.pushElement(name)
+                self.__format(formatter, value)
+                formatter.popElement()
+            elif isinstance(value, list):
+                formatter.pushElement(name)
+                for entry in value:
+                    if isinstance(entry, dict):
+                        formatter.appendElement()
+                        self.__format(formatter, entry)
+                        formatter.popElement()
+                    else:
+                        formatter.appendValue(entry)
+                formatter.popElement()
+            else:
+                formatter.setElement(name, value)
+
+    def __event(self, record: Dict[str, Any]) -> Event:
+        # imported here, 'blpapi.test' needing the 'blpapi' package
+        from .test import appendMessage, createEvent, MessageProperties
+
+        event = createEvent(record["eventType"])
+        for message in record["messages"]:
+            properties = MessageProperties()
+            properties.setCorrelationIds(
+                [
+                    CorrelationId(value)
+                    for value in message["correlationIds"]
+                    if value is not None
+                ]
+            )
+            properties.setRecapType(
+                message["recapType"], message["fragmentType"]
+            )
+            if message["timeReceived"] is not None:
+                seconds, nanos = divmod(message["timeReceived"], 1_000_000_000)
+                properties.setTimeReceived(
+                    datetime.datetime.fromtimestamp(seconds, UTC)
+                    + datetime.timedelta(microseconds=nanos // 1000)
+                )
+            service = self.__services.get(message["service"])
+            if service is not None:
+                properties.setService(service)
+            formatter = appendMessage(
+                event,
+                self.__definition(message["service"], message["messageType"]),
+                properties,
+            )
+            self.__format(formatter, message["elements"])
+        return event
+
+
+__copyright__ = """
+Copyright 2024. Bloomberg Finance L.P.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to
+deal in the Software without restriction, including without limitation the
+rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+sell copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:  The above
+copyright notice and this permission notice shall be included in all copies
+or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+IN THE SOFTWARE.
+"""
@@ -22,7 +22,17 @@ from . import typehints  # pylint: disable=unused-import
 
 from collections import deque
 from collections.abc import Mapping
-from typing import Any, Callable, Deque, Optional, Tuple, Union
+from typing import (
+    Any,
+    Callable,
+    Deque,
+    Iterable,
+    List,
+    Optional,
+    Sequence,
+    Tuple,
+    Union,
+)
 from typing import Mapping as MappingType
 
 
@@ -437,6 +447,36 @@ class EventFormatter(CHandle):
         value = invoke_if_valid(traits[2], value)
         _ExceptionUtil.raiseOnError(traits[1](self.__handle, value))
 
+    def appendValues(self, values: Iterable[Any]) -> None:
+        """Append each of the specified ``values`` to the array element at
+        the current level, as :meth:`appendValue` does.
+
+        Args:
+            values: Values to append. An object with a ``tolist`` method,
+                such as a NumPy array, an :py:class:`array.array` or a
+                :py:class:`memoryview`, is converted with it first.
+
+        Raises:
+            Exception: As :meth:`appendValue`, for the first value that
+                cannot be appended. The values before it remain appended.
+
+        The :py:class:`bool`, :py:class:`str`, :py:class:`int` and
+        :py:class:`float` values are appended in a single call into the
+        ``blpapi`` extension module when it is available.
+        """
+        tolist = getattr(values, "tolist", None)
+        if tolist is not None:
+            values = tolist()
+        if internals.blpapi_EventFormatter_appendValues is None:
+            for value in values:
+                self.appendValue(value)
+            return
+        _ExceptionUtil.raiseOnError(
+            internals.blpapi_EventFormatter_appendValues(
+                self.__handle, values, self.appendValue
+            )
+        )
+
     def appendElement(self) -> None:
         _ExceptionUtil.raiseOnError(
             internals.blpapi_EventFormatter_appendElement(self.__handle)
@@ -580,7 +620,181 @@ class EventFormatter(CHandle):
 
         if not isinstance(value, Mapping):
             raise Exception("`value` must be a `Mapping` instance")
-        self._fromPyHelper(value)
+        if internals.blpapi_EventFormatter_fromPy is None:
+            self._fromPyHelper(value)
+            return
+
+        failure = internals.blpapi_EventFormatter_fromPy(
+            self.__handle,
+            value,
+            getNamePair,
+            self.setElement,
+            self.appendValue,
+        )
+        if failure is not None:
+            self.__raiseFromPyFailure(failure)
+
+    def appendMessages(
+        self,
+        messageType: Union[Name, str],
+        messages: Sequence[Tuple["typehints.Topic", MappingType]],
+    ) -> None:
+        r"""Append a message of type ``messageType`` per ``(topic, value)``
+        pair of ``messages``, published under ``topic`` and formatted from
+        ``value`` as :meth:`fromPy` does.
+
+        Args:
+            messageType: Type of the messages
+            messages: The topics and values of the messages
+
+        Raises:
+            Exception: if a ``value`` cannot properly format its message
+
+        The messages are encoded in the ``blpapi`` extension module when it
+        is available, without a Python call per element. If a message cannot
+        be formatted, the exception raised is the one :meth:`fromPy` raises,
+        and the messages before it remain appended.
+        """
+        topics = []
+        values = []
+        for topic, value in messages:
+            if not isinstance(value, Mapping):
+                raise Exception("`value` must be a `Mapping` instance")
+            topics.append(get_handle(topic))
+            values.append(value)
+        self._appendMessagesFromPy(
+            messageType, topics, values, None, 0, len(topics)
+        )
+
+    def appendColumns(
+        self,
+        messageType: Union[Name, str],
+        topics: Sequence["typehints.Topic"],
+        columns: MappingType[Union[Name, str], Sequence[Any]],
+    ) -> None:
+        r"""Append a message of type ``messageType`` per topic of
+        ``topics``, whose element ``name`` is set from the value of the
+        column ``columns[name]`` in the row of the topic.
+
+        Args:
+            messageType: Type of the messages
+            topics: The topic of each message
+            columns: The columns of the values of the elements, each with a
+                value per topic
+
+        Raises:
+            ValueError: if a column does not have a value per topic
+            Exception: if a value cannot properly format its element
+
+        The values are those accepted by :meth:`fromPy`. ``None`` values are
+        skipped, so that sparse updates can be published from the same
+        columns. Columns with a ``tolist`` method, such as NumPy arrays and
+        :py:class:`memoryview`\s, are converted with it first.
+
+        Example:
+            The following publishes the quotes of two topics::
+
+                ef.appendColumns("MarketData", [ibmTopic, msftTopic], {
+                    "BID": [181.5, 402.1],
+                    "ASK": [181.6, None],
+                })
+        """
+        topicHandles = [get_handle(topic) for topic in topics]
+        fields, values = _columnsFromPy(columns, len(topicHandles))
+        self._appendMessagesFromPy(
+            messageType, topicHandles, values, fields, 0, len(topicHandles)
+        )
+
+    def _appendMessagesFromPy(
+        self,
+        messageType: Union[Name, str],
+        topics: Sequence[Any],
+        values: Sequence[Any],
+        fields: Optional[Sequence[Union[Name, str]]],
+        start: int,
+        stop: int,
+    ) -> None:
+        """Append the messages ``start`` to ``stop`` of a batch whose topic
+        handles are ``topics``. If ``fields`` is ``None``, ``values`` are the
+        values of the messages, otherwise the columns of the ``fields``."""
+        name = getNamePair(messageType)
+        if internals.blpapi_EventFormatter_appendMessagesFromPy is None:
+            for row in range(start, stop):
+                _ExceptionUtil.raiseOnError(
+                    internals.blpapi_EventFormatter_appendMessage(
+                        self.__handle, name[0], name[1], topics[row]
+                    )
+                )
+                self.latestMessageName = messageType
+                if fields is None:
+                    self.fromPy(values[row])
+                    continue
+                self.fromPy(
+                    {
+                        field: column[row]
+                        for field, column in zip(fields, values)
+                        if column[row] is not None
+                    }
+                )
+            return
+
+        failure = internals.blpapi_EventFormatter_appendMessagesFromPy(
+            self.__handle,
+            name[0],
+            name[1],
+            topics,
+            values,
+            fields,
+            start,
+            stop,
+            getNamePair,
+            self.setElement,
+            self.appendValue,
+        )
+        self.latestMessageName = messageType
+        if failure is not None:
+            self.__raiseFromPyFailure(failure[1])
+
+    def __raiseFromPyFailure(self, failure: Tuple) -> None:
+        """Raise the exception that `_fromPyHelper` raises for the
+        ``failure`` returned by `blpapi_EventFormatter_fromPy`."""
+        kind, path, detail, name = failure
+        if isinstance(detail, tuple):
+            detail = _ExceptionUtil.createException(*detail)
+        if kind == internals.FROMPY_RAISE:
+            raise detail
+
+        if kind == internals.FROMPY_NESTED_SEQUENCE:
+            errorMsg = (
+                "encountered nested `Sequences`s. An array of"
+                " array Elements should be represented as"
+                " `Sequence`s of `Mappings`s with `Sequence`"
+                " values."
+            )
+        elif kind == internals.FROMPY_MAPPING_ENTRY:
+            errorMsg = (
+                "encountered a `Mapping` where a scalar "
+                f"value was expected. Error: {detail}"
+            )
+        elif name is not None and isinstance(
+            detail, IndexOutOfRangeException
+        ):
+            path.append(str(name))
+            errorMsg = (
+                "attempted to format an array Element using a"
+                " scalar value. Array Elements are formatted with"
+                " `Sequence`s."
+            )
+        else:
+            if name is not None and isinstance(
+                detail, (InvalidConversionException, InvalidArgumentException)
+            ):
+                path.append(str(name))
+            errorMsg = _fromPyErrorTemplate.format(detail)
+
+        path.insert(0, str(self.latestMessageName))
+        pathStr = "/".join(path)
+        raise Exception(f"While operating on Element `{pathStr}`, " + errorMsg)
 
     def _fromPyHelper(
         self,
@@ -713,6 +927,29 @@ class EventFormatter(CHandle):
 _fromPyErrorTemplate = "encountered Error: {}"
 
 
+def _columnsFromPy(
+    columns: MappingType[Union[Name, str], Sequence[Any]],
+    numRows: int,
+) -> Tuple[List[Union[Name, str]], List[Sequence[Any]]]:
+    """Return the fields and the values of ``columns``, the columns with a
+    ``tolist`` method being converted with it. Raise ValueError unless each
+    column has ``numRows`` values."""
+    fields = []
+    values = []
+    for field, column in columns.items():
+        tolist = getattr(column, "tolist", None)
+        if tolist is not None:
+            column = tolist()
+        if len(column) != numRows:
+            raise ValueError(
+                f"column `{field}` has {len(column)} values, expected"
+                f" {numRows}"
+            )
+        fields.append(field)
+        values.append(column)
+    return fields, values
+
+
 __copyright__ = """
 Copyright 2012. Bloomberg Finance L.P.
 
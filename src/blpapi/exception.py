@@ -129,16 +129,23 @@ class _ExceptionUtil:
         )
 
     @staticmethod
-    def raiseException(
+    def createException(
         errorCode: int, description: Optional[str] = None
-    ) -> None:
-        """Throw the appropriate exception for the specified 'errorCode'."""
+    ) -> Exception:
+        """Return the appropriate exception for the specified 'errorCode'."""
         if description is None:
             description = internals.blpapi_getLastErrorDescription(errorCode)
             if not description:
                 description = "Unknown"
         errorClass = _ExceptionUtil.__getErrorClass(errorCode)
-        raise errorClass(description, errorCode)
+        return errorClass(description, errorCode)
+
+    @staticmethod
+    def raiseException(
+        errorCode: int, description: Optional[str] = None
+    ) -> None:
+        """Throw the appropriate exception for the specified 'errorCode'."""
+        raise _ExceptionUtil.createException(errorCode, description)
 
     @staticmethod
     def raiseOnError(
@@ -1,8 +1,38 @@
+/* The limited API is not available on free-threaded builds of python,
+   for which setup.py defines 'FFIUTILS_NO_LIMITED_API'. */
+#ifndef FFIUTILS_NO_LIMITED_API
 #define Py_LIMITED_API 0x03080000
+#endif
 #include <Python.h>
 
+#include <float.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_WIN32)
+#include <winsock2.h>
+#define FFIUTILS_SOCKET SOCKET
+#else
+#include <sys/socket.h>
+#define FFIUTILS_SOCKET int
+#endif
+
 #include "blpapi_element.h"
+#include "blpapi_constant.h"
 #include "blpapi_correlationid.h"
+#include "blpapi_datetime.h"
+#include "blpapi_error.h"
+#include "blpapi_event.h"
+#include "blpapi_eventformatter.h"
+#include "blpapi_highresolutionclock.h"
+#include "blpapi_logging.h"
+#include "blpapi_message.h"
+#include "blpapi_schema.h"
+#include "blpapi_service.h"
+#include "blpapi_session.h"
+#include "blpapi_subscriptionlist.h"
+#include "blpapi_timepoint.h"
 
 #if defined(WIN32) || defined(_WIN32) || defined(__WIN32) && !defined(__CYGWIN__)
 #define PEXPRT __declspec(dllexport)
@@ -10,13 +40,348 @@
 #define PEXPRT
 #endif
 
-PEXPRT PyObject* blpapi_Element_toPy(blpapi_Element_t *element);
+/* Free-threaded builds have no GIL to serialize the accesses to the
+   caches and to the shared state of the event handlers, which are guarded
+   by mutexes there instead. */
+#ifdef Py_GIL_DISABLED
+#define FFIUTILS_LOCK(mutex) PyMutex_Lock(&(mutex))
+#define FFIUTILS_UNLOCK(mutex) PyMutex_Unlock(&(mutex))
+static PyMutex cacheMutex = { 0 };
+#else
+#define FFIUTILS_LOCK(mutex)
+#define FFIUTILS_UNLOCK(mutex)
+#endif
+
+/* Flags controlling the conversions done by the 'toPy' functions */
+#define TOPY_DATETIME_AS_EPOCH_NANOS 0x1
+
+PEXPRT PyObject* blpapi_Element_toPy(blpapi_Element_t *element, int flags);
+PEXPRT PyObject* blpapi_Element_toPyFields(
+        blpapi_Element_t *element,
+        const blpapi_Name_t *const *fields,
+        size_t numFields,
+        int flags);
+PEXPRT PyObject* blpapi_Element_keysToPy(blpapi_Element_t *element);
+PEXPRT PyObject* blpapi_Element_toJson(blpapi_Element_t *element,
+                                       int flags,
+                                       const blpapi_Name_t *const *fields,
+                                       size_t numFields);
+PEXPRT PyObject* blpapi_Element_valueToPy(blpapi_Element_t *element,
+                                          size_t index,
+                                          int flags);
+PEXPRT PyObject* blpapi_Event_toPy(blpapi_Event_t *event,
+                                   int flags,
+                                   const blpapi_Name_t *const *fields,
+                                   size_t numFields);
+PEXPRT PyObject* blpapi_Event_toColumns(blpapi_Event_t *event,
+                                        const blpapi_Name_t *const *fields,
+                                        size_t numFields,
+                                        PyObject *columns,
+                                        size_t numRows);
+PEXPRT PyObject* blpapi_Event_toRows(blpapi_Event_t *event,
+                                     const blpapi_Name_t *const *path,
+                                     size_t pathLength,
+                                     const blpapi_Name_t *const *fields,
+                                     size_t numFields,
+                                     PyObject *columns,
+                                     size_t numRows);
+PEXPRT int managerFunc(void * mptr, void * sptr, int operation);
+
+
+/* Cache of interned python strings keyed by 'blpapi_Name_t*'.
+   'blpapi_Name_t' objects live in a global table of the C library and are
+   never deallocated, so their address is a stable key for the lifetime of
+   the process. Using the cached keys saves a UTF-8 decode and an allocation
+   for every field of every converted element, and the interned strings make
+   the lookups done by the application on the resulting dicts cheaper.
+   The cache is only accessed with the GIL held, or 'cacheMutex' locked on
+   free-threaded builds.
+*/
+typedef struct {
+    const blpapi_Name_t* name;
+    PyObject* key;
+} NameKeyEntry;
+
+static NameKeyEntry* nameKeyCache = NULL;
+static size_t nameKeyCacheCapacity = 0; // always a power of 2
+static size_t nameKeyCacheSize = 0;
+
+static size_t nameKeyHash(const blpapi_Name_t* name) {
+    size_t h = (size_t) name;
+    // the low bits of heap addresses carry little information
+    h ^= h >> 17;
+    h *= (size_t) 0x9E3779B97F4A7C15ULL;
+    return h ^ (h >> 31);
+}
+
+static int nameKeyCacheGrow(void) {
+    const size_t newCapacity =
+        nameKeyCacheCapacity ? 2 * nameKeyCacheCapacity : 256;
+    NameKeyEntry* newCache =
+        (NameKeyEntry*) PyMem_Calloc(newCapacity, sizeof(NameKeyEntry));
+    size_t i;
+    if (newCache == NULL) {
+        PyErr_NoMemory();
+        return -1;
+    }
+    for (i = 0; i < nameKeyCacheCapacity; ++i) {
+        if (nameKeyCache[i].name != NULL) {
+            size_t j = nameKeyHash(nameKeyCache[i].name) & (newCapacity - 1);
+            while (newCache[j].name != NULL) {
+                j = (j + 1) & (newCapacity - 1);
+            }
+            newCache[j] = nameKeyCache[i];
+        }
+    }
+    PyMem_Free(nameKeyCache);
+    nameKeyCache = newCache;
+    nameKeyCacheCapacity = newCapacity;
+    return 0;
+}
+
+static PyObject* lockedNameToPyKey(const blpapi_Name_t* name) {
+    size_t i;
+    PyObject* key;
+    if (nameKeyCacheCapacity) {
+        i = nameKeyHash(name) & (nameKeyCacheCapacity - 1);
+        while (nameKeyCache[i].name != NULL) {
+            if (nameKeyCache[i].name == name) {
+                return nameKeyCache[i].key;
+            }
+            i = (i + 1) & (nameKeyCacheCapacity - 1);
+        }
+    }
+
+    // keep the load factor below 1/2
+    if (2 * (nameKeyCacheSize + 1) > nameKeyCacheCapacity
+            && nameKeyCacheGrow()) {
+        return NULL;
+    }
+    key = PyUnicode_InternFromString(blpapi_Name_string(name));
+    if (key == NULL) {
+        return NULL;
+    }
+    i = nameKeyHash(name) & (nameKeyCacheCapacity - 1);
+    while (nameKeyCache[i].name != NULL) {
+        i = (i + 1) & (nameKeyCacheCapacity - 1);
+    }
+    // the cache owns the reference
+    nameKeyCache[i].name = name;
+    nameKeyCache[i].key = key;
+    ++nameKeyCacheSize;
+    return key;
+}
+
+/* Returns a borrowed reference to the interned python string for 'name',
+   or NULL with an error set. */
+PyObject* nameToPyKey(const blpapi_Name_t* name) {
+    PyObject* key;
+    if (name == NULL) {
+        PyErr_SetString(PyExc_Exception, "Internal error getting Name");
+        return NULL;
+    }
+    FFIUTILS_LOCK(cacheMutex);
+    key = lockedNameToPyKey(name);
+    FFIUTILS_UNLOCK(cacheMutex);
+    return key;
+}
+
+/* Returns a borrowed reference to an interned python string for the
+   constant 'str', created on first use and stored in '*cached'. */
+static PyObject* constantKey(PyObject** cached, const char* str) {
+    if (*cached == NULL) {
+        FFIUTILS_LOCK(cacheMutex);
+        if (*cached == NULL) {
+            *cached = PyUnicode_InternFromString(str);
+        }
+        FFIUTILS_UNLOCK(cacheMutex);
+    }
+    return *cached;
+}
+
+/* Python types used to convert datetimes, looked up once. */
+static PyObject* pyDatetimeType = NULL;
+static PyObject* pyDateType = NULL;
+static PyObject* pyTimeType = NULL;
+static PyObject* fixedOffsetType = NULL;
+// 'FixedOffset' instances, keyed by offset in minutes
+static PyObject* fixedOffsets = NULL;
+
+static int initDatetimeTypes(void) {
+    PyObject* datetimeModule;
+    PyObject* blpapiDatetimeModule;
+    /*
+       Py_LIMITED_API blocks the use of macros from datetime.h,
+       we call the constructors of the python types instead...
+    */
+    datetimeModule = PyImport_ImportModule("datetime");
+    if (datetimeModule == NULL) {
+        return -1;
+    }
+    pyDatetimeType = PyObject_GetAttrString(datetimeModule, "datetime");
+    pyDateType = PyObject_GetAttrString(datetimeModule, "date");
+    pyTimeType = PyObject_GetAttrString(datetimeModule, "time");
+    Py_DECREF(datetimeModule);
+
+    blpapiDatetimeModule = PyImport_ImportModule("blpapi.datetime");
+    if (blpapiDatetimeModule == NULL) {
+        return -1;
+    }
+    fixedOffsetType =
+        PyObject_GetAttrString(blpapiDatetimeModule, "FixedOffset");
+    Py_DECREF(blpapiDatetimeModule);
+
+    fixedOffsets = PyDict_New();
+    if (pyDatetimeType == NULL || pyDateType == NULL || pyTimeType == NULL
+            || fixedOffsetType == NULL || fixedOffsets == NULL) {
+        Py_CLEAR(pyDatetimeType);
+        Py_CLEAR(pyDateType);
+        Py_CLEAR(pyTimeType);
+        Py_CLEAR(fixedOffsetType);
+        Py_CLEAR(fixedOffsets);
+        PyErr_SetString(
+                PyExc_Exception,
+                "Internal error getting datetime types");
+        return -1;
+    }
+    return 0;
+}
+
+/* Returns a borrowed reference to the shared 'FixedOffset' for 'offset'. */
+static PyObject* getFixedOffset(int offset) {
+    PyObject* key = PyLong_FromLong(offset);
+    PyObject* tzinfo;
+    if (key == NULL) {
+        return NULL;
+    }
+    tzinfo = PyDict_GetItem(fixedOffsets, key);
+    if (tzinfo == NULL) {
+        tzinfo = PyObject_CallFunction(fixedOffsetType, "i", offset);
+        if (tzinfo == NULL || PyDict_SetItem(fixedOffsets, key, tzinfo)) {
+            Py_XDECREF(tzinfo);
+            Py_DECREF(key);
+            return NULL;
+        }
+        // the dict keeps 'tzinfo' alive
+        Py_DECREF(tzinfo);
+    }
+    Py_DECREF(key);
+    return tzinfo;
+}
+
+/* Returns the number of days between 1970-01-01 and the specified date of
+   the proleptic Gregorian calendar. */
+static long long daysFromCivil(int year, unsigned month, unsigned day) {
+    const int y = year - (month <= 2);
+    const int era = (y >= 0 ? y : y - 399) / 400;
+    const unsigned yoe = (unsigned) (y - era * 400);
+    const unsigned doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5
+                         + day - 1;
+    const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return (long long) era * 146097 + (long long) doe - 719468;
+}
+
+/* Loads into '*nanos' the number of nanoseconds since the epoch of 'value'
+   and returns 0, or returns non-zero if 'value' has neither a date nor a
+   time part. Values having both date and time parts are returned as UTC,
+   values having only a date part as midnight UTC of that date and values
+   having only a time part as nanoseconds since midnight, in their own
+   offset. */
+static int datetimeToNanos(const blpapi_HighPrecisionDatetime_t* value,
+                           long long* nanos) {
+    const blpapi_Datetime_t* dt = &value->datetime;
+    const int hasDate = (dt->parts & BLPAPI_DATETIME_DATE_PART)
+                        == BLPAPI_DATETIME_DATE_PART;
+    const int hasTime = (dt->parts & BLPAPI_DATETIME_TIMEFRACSECONDS_PART)
+                        != 0;
+    *nanos = 0;
+    if (hasTime) {
+        *nanos = ((dt->hours * 60LL + dt->minutes) * 60LL + dt->seconds)
+                     * 1000000000LL
+                 + dt->milliSeconds * 1000000LL
+                 + value->picoseconds / 1000;
+    }
+    if (hasDate) {
+        *nanos += daysFromCivil(dt->year, dt->month, dt->day)
+                  * 86400000000000LL;
+        if (hasTime && (dt->parts & BLPAPI_DATETIME_OFFSET_PART)) {
+            *nanos -= dt->offset * 60000000000LL;
+        }
+    }
+    else if (!hasTime) {
+        return -1;
+    }
+    return 0;
+}
+
+PyObject* datetimeToPy(const blpapi_HighPrecisionDatetime_t* value,
+                       const int flags) {
+    const blpapi_Datetime_t* dt = &value->datetime;
+    int hasDate;
+    int hasTime;
+    int microseconds;
+    PyObject* tzinfo = Py_None;
+
+    // Return `None` when the `datetime` has no parts
+    if (!dt->parts) {
+        Py_RETURN_NONE; // inc ref and return
+    }
+    if (flags & TOPY_DATETIME_AS_EPOCH_NANOS) {
+        long long nanos;
+        if (datetimeToNanos(value, &nanos)) {
+            Py_RETURN_NONE; // inc ref and return
+        }
+        return PyLong_FromLongLong(nanos);
+    }
+    if (fixedOffsets == NULL) {
+        int rc = 0;
+        FFIUTILS_LOCK(cacheMutex);
+        if (fixedOffsets == NULL) {
+            rc = initDatetimeTypes();
+        }
+        FFIUTILS_UNLOCK(cacheMutex);
+        if (rc) {
+            return NULL;
+        }
+    }
+
+    hasDate = (dt->parts & BLPAPI_DATETIME_DATE_PART)
+              == BLPAPI_DATETIME_DATE_PART;
+    hasTime = (dt->parts & BLPAPI_DATETIME_TIMEFRACSECONDS_PART) != 0;
+    microseconds = dt->milliSeconds * 1000 + value->picoseconds / 1000000;
+    if (dt->parts & BLPAPI_DATETIME_OFFSET_PART) {
+        tzinfo = getFixedOffset(dt->offset);
+        if (tzinfo == NULL) {
+            return NULL;
+        }
+    }
 
-// this is only needed for windows as the linker will add an /EXPORT
-void PyInit_ffiutils(void) {
+    if (hasDate && hasTime) {
+        return PyObject_CallFunction(
+            pyDatetimeType, "iiiiiiiO",
+            dt->year, dt->month, dt->day,
+            dt->hours, dt->minutes, dt->seconds, microseconds,
+            tzinfo);
+    }
+    else if (hasDate) {
+        // Skip an offset, because it's not informative if there is a
+        // date without time
+        return PyObject_CallFunction(
+            pyDateType, "iii", dt->year, dt->month, dt->day);
+    }
+    else if (hasTime) {
+        return PyObject_CallFunction(
+            pyTimeType, "iiiiO",
+            dt->hours, dt->minutes, dt->seconds, microseconds,
+            tzinfo);
+    }
+    // only an offset, nothing to convert
+    Py_RETURN_NONE; // inc ref and return
 }
 
-PyObject* getScalarValue(const blpapi_Element_t* element, const int index) {
+PyObject* getScalarValue(const blpapi_Element_t* element,
+                         const int index,
+                         const int flags) {
     const int datatype = blpapi_Element_datatype(element);
 
     switch (datatype) {
@@ -90,47 +455,7 @@ PyObject* getScalarValue(const blpapi_Element_t* element, const int index) {
         case BLPAPI_DATATYPE_DATE:
         case BLPAPI_DATATYPE_TIME:
         case BLPAPI_DATATYPE_DATETIME: {
-            static PyObject* blpapiDatetimeModule = NULL;
-            static PyObject* datetimeUtil = NULL;
-            static PyObject* convertToPyTime = NULL;
             blpapi_HighPrecisionDatetime_t highPrecisionDatetimeBuffer;
-
-            /*
-               Py_LIMITED_API blocks the use of macros from datetime.h
-               we need to call conversion code from python...
-            */
-            // initialize static variables once
-            if (convertToPyTime == NULL) {
-                blpapiDatetimeModule =
-                    PyImport_ImportModule("blpapi.datetime");
-                if (blpapiDatetimeModule == NULL) {
-                    PyErr_SetString(
-                            PyExc_Exception,
-                            "Internal error getting blpapi.datetime");
-                    return NULL;
-                }
-                datetimeUtil =
-                    PyObject_GetAttr(blpapiDatetimeModule,
-                                     PyUnicode_FromString("_DatetimeUtil"));
-                if (datetimeUtil == NULL) {
-                    Py_DECREF(blpapiDatetimeModule);
-                    PyErr_SetString(
-                            PyExc_Exception,
-                            "Internal error getting _DatetimeUtil");
-                    return NULL;
-                }
-                convertToPyTime = PyObject_GetAttr(
-                    datetimeUtil, PyUnicode_FromString("toPyTimeFromInts"));
-                if (convertToPyTime == NULL) {
-                    Py_DECREF(blpapiDatetimeModule);
-                    Py_DECREF(datetimeUtil);
-                    PyErr_SetString(
-                            PyExc_Exception,
-                            "Internal error getting 'toPyTimeFromInts'");
-                    return NULL;
-                }
-            }
-
             if (blpapi_Element_getValueAsHighPrecisionDatetime(
                         element,
                         &highPrecisionDatetimeBuffer,
@@ -140,25 +465,7 @@ PyObject* getScalarValue(const blpapi_Element_t* element, const int index) {
                         "Internal error getting datetime");
                 return NULL;
             }
-
-            // Return `None` when the `datetime` has no parts because our
-            if (!highPrecisionDatetimeBuffer.datetime.parts) {
-                Py_RETURN_NONE; // inc ref and return
-            }
-
-            return PyObject_CallFunction(
-                convertToPyTime, "iiiiiiiii",
-                    highPrecisionDatetimeBuffer.datetime.parts,
-                    highPrecisionDatetimeBuffer.datetime.offset,
-                    highPrecisionDatetimeBuffer.datetime.year,
-                    highPrecisionDatetimeBuffer.datetime.month,
-                    highPrecisionDatetimeBuffer.datetime.day,
-                    highPrecisionDatetimeBuffer.datetime.hours,
-                    highPrecisionDatetimeBuffer.datetime.minutes,
-                    highPrecisionDatetimeBuffer.datetime.seconds,
-                    (highPrecisionDatetimeBuffer.datetime.milliSeconds * 1000)
-                    + (highPrecisionDatetimeBuffer.picoseconds / 1000000)
-                    );
+            return datetimeToPy(&highPrecisionDatetimeBuffer, flags);
         }
         case BLPAPI_DATATYPE_SEQUENCE:
         case BLPAPI_DATATYPE_CHOICE:
@@ -169,7 +476,7 @@ PyObject* getScalarValue(const blpapi_Element_t* element, const int index) {
     }
 }
 
-PyObject* complexElementToPy(blpapi_Element_t *element) {
+PyObject* complexElementToPy(blpapi_Element_t *element, const int flags) {
         PyObject* pyDict = PyDict_New();
         PyObject* subElementPy = NULL;
         unsigned int i;
@@ -179,22 +486,26 @@ PyObject* complexElementToPy(blpapi_Element_t *element) {
 
         for (i = 0; i < blpapi_Element_numElements(element); ++i) {
             blpapi_Element_t* subElement;
-            const char* name;
+            PyObject* key;
             if (0 != blpapi_Element_getElementAt(element, &subElement, i)) {
                 PyErr_SetString(PyExc_Exception,
                                 "Internal error in `Element.toPy`");
                 goto ERROR;
             }
-            name = blpapi_Element_nameString(subElement);
-            subElementPy = blpapi_Element_toPy(subElement);
+            // borrowed reference owned by the cache
+            key = nameToPyKey(blpapi_Element_name(subElement));
+            if (key == NULL) {
+                goto ERROR;
+            }
+            subElementPy = blpapi_Element_toPy(subElement, flags);
             if (subElementPy == NULL) {
                 goto ERROR;
             }
-            // does not steal ref to value
-            if (PyDict_SetItemString(pyDict, name, subElementPy)) {
+            // does not steal refs to key and value
+            if (PyDict_SetItem(pyDict, key, subElementPy)) {
                 goto ERROR;
             }
-            Py_DECREF(subElementPy);
+            Py_CLEAR(subElementPy);
         }
         return pyDict;
 ERROR:
@@ -209,7 +520,7 @@ ERROR:
     return NULL;
 }
 
-PyObject* arrayElementToPy(blpapi_Element_t *element) {
+PyObject* arrayElementToPy(blpapi_Element_t *element, const int flags) {
     const unsigned int numValues = blpapi_Element_numValues(element);
     PyObject* pyList = PyList_New(numValues);
     PyObject* pyValue = NULL;
@@ -234,7 +545,7 @@ PyObject* arrayElementToPy(blpapi_Element_t *element) {
                     "Internal error in blpapi_Element_getValueAsElement");
                 goto ERROR;
             }
-            pyValue = blpapi_Element_toPy(result);
+            pyValue = blpapi_Element_toPy(result, flags);
             if (pyValue == NULL) {
                 goto ERROR;
             }
@@ -245,7 +556,7 @@ PyObject* arrayElementToPy(blpapi_Element_t *element) {
     else {
         // non complex values
         for (i = 0; i < numValues; ++i) {
-            pyValue = getScalarValue(element, i);
+            pyValue = getScalarValue(element, i, flags);
             if (pyValue == NULL) {
                 goto ERROR;
             }
@@ -266,72 +577,6364 @@ ERROR:
     return NULL;
 }
 
-PyObject* blpapi_Element_toPy(blpapi_Element_t *element) {
+PyObject* blpapi_Element_toPy(blpapi_Element_t *element, int flags) {
     if (blpapi_Element_isComplexType(element)) {
-        return complexElementToPy(element);
+        return complexElementToPy(element, flags);
     }
     else if (blpapi_Element_isArray(element)) {
-        return arrayElementToPy(element);
+        return arrayElementToPy(element, flags);
     }
     else if (blpapi_Element_isNull(element)) {
         Py_RETURN_NONE; // inc ref and return
     }
     else {
-        return getScalarValue(element, 0);
+        return getScalarValue(element, 0, flags);
     }
 }
 
-/* decrefs allow python code to decrement ref. count of objects,
-   even if they are not yet pointed to by blpapi_ManagedPtr_t struct.
+/* Converts only the sub-elements of the complex 'element' named by the
+   'numFields' names in 'fields', looking each of them up by name.
+   Fields that are not part of 'element' are skipped.
 */
-PEXPRT void incref(PyObject *obj);
-void incref(PyObject *obj)
-{
-    PyGILState_STATE s = PyGILState_Ensure();
-    Py_XINCREF(obj);
-    PyGILState_Release(s);
+PyObject* blpapi_Element_toPyFields(blpapi_Element_t *element,
+                                    const blpapi_Name_t *const *fields,
+                                    size_t numFields,
+                                    int flags) {
+    PyObject* pyDict = PyDict_New();
+    PyObject* subElementPy = NULL;
+    size_t i;
+    if (pyDict == NULL) {
+        goto ERROR;
+    }
+
+    for (i = 0; i < numFields; ++i) {
+        blpapi_Element_t* subElement;
+        PyObject* key;
+        if (0 != blpapi_Element_getElement(element,
+                                           &subElement,
+                                           NULL,
+                                           fields[i])) {
+            continue;
+        }
+        // borrowed reference owned by the cache
+        key = nameToPyKey(fields[i]);
+        if (key == NULL) {
+            goto ERROR;
+        }
+        subElementPy = blpapi_Element_toPy(subElement, flags);
+        if (subElementPy == NULL) {
+            goto ERROR;
+        }
+        // does not steal refs to key and value
+        if (PyDict_SetItem(pyDict, key, subElementPy)) {
+            goto ERROR;
+        }
+        Py_CLEAR(subElementPy);
+    }
+    return pyDict;
+
+ERROR:
+    Py_XDECREF(pyDict);
+    Py_XDECREF(subElementPy);
+    // Ensure that we set an error before returning NULL
+    if (PyErr_Occurred() == NULL) {
+        PyErr_SetString(
+                PyExc_Exception,
+                "Internal error converting the fields of an Element");
+    }
+    return NULL;
 }
 
-/* This function implements the interface for managing objects from C.
-   We are ensuring GIL in this implementation, but those calls
-   can be nested and will not cause a deadlock if a call to managerFunc
-   is interrupted by GC that needs to decref.
-   Note: INCREF/DECREF are not atomic in the C-sense, but will not be
-   interrupted by Python interpreted thread.
- */
-PEXPRT int managerFunc(void * mptr, void * sptr, int operation)
-{
-    PyGILState_STATE s = PyGILState_Ensure();
+/* Returns the list of the names of the sub-elements of the complex
+   'element', as the same 'str' keys used by 'blpapi_Element_toPy'.
+*/
+PyObject* blpapi_Element_keysToPy(blpapi_Element_t *element) {
+    const size_t numElements = blpapi_Element_numElements(element);
+    PyObject* pyList = PyList_New((Py_ssize_t) numElements);
+    size_t i;
+    if (pyList == NULL) {
+        return NULL;
+    }
 
-    blpapi_ManagedPtr_t * managedPtr = (blpapi_ManagedPtr_t *) mptr;
-    blpapi_ManagedPtr_t * srcPtr = (blpapi_ManagedPtr_t *) sptr;
+    for (i = 0; i < numElements; ++i) {
+        blpapi_Element_t* subElement;
+        PyObject* key;
+        if (0 != blpapi_Element_getElementAt(element, &subElement, i)) {
+            PyErr_SetString(PyExc_Exception,
+                            "Internal error getting the keys of an Element");
+            Py_DECREF(pyList);
+            return NULL;
+        }
+        // borrowed reference owned by the cache
+        key = nameToPyKey(blpapi_Element_name(subElement));
+        if (key == NULL) {
+            Py_DECREF(pyList);
+            return NULL;
+        }
+        Py_INCREF(key);
+        // steals the reference to key
+        PyList_SetItem(pyList, (Py_ssize_t) i, key);
+    }
+    return pyList;
+}
 
-    if (operation == BLPAPI_MANAGEDPTR_COPY) {
-        managedPtr->pointer = srcPtr->pointer;
-        managedPtr->manager = srcPtr->manager;
-        Py_XINCREF((PyObject *) (managedPtr->pointer));
+/* Converts the value at 'index' of the scalar or array 'element' the same
+   way 'blpapi_Element_toPy' converts it as part of the whole element.
+*/
+PyObject* blpapi_Element_valueToPy(blpapi_Element_t *element,
+                                   size_t index,
+                                   int flags) {
+    if (index >= blpapi_Element_numValues(element)) {
+        PyErr_SetString(PyExc_IndexError, "Element index out of range");
+        return NULL;
     }
-    else if (operation == BLPAPI_MANAGEDPTR_DESTROY) {
-        Py_XDECREF((PyObject *) (managedPtr->pointer));
+    return getScalarValue(element, (int) index, flags);
+}
+
+/* JSON serialization. 'blpapi_Element_toJson' writes the element tree
+   straight into a growable UTF-8 buffer, giving the same text as
+   'json.dumps(element.toPy(), ensure_ascii=False, separators=(",", ":"))'
+   without building the intermediate python objects. Datetimes are written
+   as their 'isoformat()' strings, or as 'int' nanoseconds with
+   'TOPY_DATETIME_AS_EPOCH_NANOS', and bytes as base64 strings, since JSON
+   has neither. Only called with the GIL held.
+*/
+typedef struct {
+    char* data;
+    size_t size;
+    size_t capacity;
+} JsonBuffer;
+
+/* Returns a pointer to 'size' more bytes at the end of 'buffer', or NULL
+   with a python error set if it cannot grow. */
+static char* jsonReserve(JsonBuffer* buffer, size_t size) {
+    char* result;
+    if (buffer->size + size > buffer->capacity) {
+        size_t newCapacity = buffer->capacity ? 2 * buffer->capacity : 1024;
+        char* newData;
+        while (newCapacity < buffer->size + size) {
+            newCapacity *= 2;
+        }
+        newData = (char*) PyMem_Realloc(buffer->data, newCapacity);
+        if (newData == NULL) {
+            PyErr_NoMemory();
+            return NULL;
+        }
+        buffer->data = newData;
+        buffer->capacity = newCapacity;
     }
+    result = buffer->data + buffer->size;
+    buffer->size += size;
+    return result;
+}
 
-    PyGILState_Release(s);
+static int jsonPut(JsonBuffer* buffer, const char* data, size_t length) {
+    char* out = jsonReserve(buffer, length);
+    if (out == NULL) {
+        return -1;
+    }
+    memcpy(out, data, length);
     return 0;
 }
 
-/* Used to set the function pointer to our manager inside cid structure */
-PEXPRT void setmptr(void *s);
-void setmptr(void *s) {
-    blpapi_ManagedPtr_t *p = (blpapi_ManagedPtr_t *) s;
-    p->manager = (blpapi_ManagedPtr_ManagerFunction_t ) &managerFunc;
+static int jsonPutChar(JsonBuffer* buffer, char c) {
+    return jsonPut(buffer, &c, 1);
 }
 
-/* Used to check if the manager used by a cid is the one we set.
-If it is not the same, it must be a C++ cb set for recaps.
-This function will be removed when recap cids are fixed.
-*/
-PEXPRT int is_known_obj(void *s);
-int is_known_obj(void *s) {
-    blpapi_ManagedPtr_t *p = (blpapi_ManagedPtr_t *) s;
-    return p->manager == (blpapi_ManagedPtr_ManagerFunction_t ) &managerFunc;
+/* Writes the quoted string of the UTF-8 'data', escaping the characters
+   that 'json.dumps' escapes when 'ensure_ascii' is false. */
+static int jsonPutString(JsonBuffer* buffer,
+                         const char* data,
+                         size_t length) {
+    static const char hexDigits[] = "0123456789abcdef";
+    size_t start = 0;
+    size_t i;
+    if (jsonPutChar(buffer, '"')) {
+        return -1;
+    }
+    for (i = 0; i < length; ++i) {
+        const unsigned char c = (unsigned char) data[i];
+        char escape[6];
+        size_t escapeLength = 2;
+        if (c >= 0x20 && c != '"' && c != '\\') {
+            continue;
+        }
+        escape[0] = '\\';
+        switch (c) {
+            case '"': escape[1] = '"'; break;
+            case '\\': escape[1] = '\\'; break;
+            case '\b': escape[1] = 'b'; break;
+            case '\f': escape[1] = 'f'; break;
+            case '\n': escape[1] = 'n'; break;
+            case '\r': escape[1] = 'r'; break;
+            case '\t': escape[1] = 't'; break;
+            default: {
+                escape[1] = 'u';
+                escape[2] = '0';
+                escape[3] = '0';
+                escape[4] = hexDigits[c >> 4];
+                escape[5] = hexDigits[c & 0xf];
+                escapeLength = 6;
+            }
+        }
+        if (jsonPut(buffer, data + start, i - start)
+                || jsonPut(buffer, escape, escapeLength)) {
+            return -1;
+        }
+        start = i + 1;
+    }
+    if (jsonPut(buffer, data + start, length - start)) {
+        return -1;
+    }
+    return jsonPutChar(buffer, '"');
+}
+
+static int jsonPutName(JsonBuffer* buffer, const blpapi_Name_t* name) {
+    return jsonPutString(
+            buffer, blpapi_Name_string(name), blpapi_Name_length(name));
+}
+
+static int jsonPutBase64(JsonBuffer* buffer,
+                         const unsigned char* data,
+                         size_t length) {
+    static const char alphabet[] =
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    char* out = jsonReserve(buffer, (length + 2) / 3 * 4 + 2);
+    size_t i;
+    if (out == NULL) {
+        return -1;
+    }
+    *out++ = '"';
+    for (i = 0; i + 2 < length; i += 3) {
+        const unsigned long bits =
+            ((unsigned long) data[i] << 16) | (data[i + 1] << 8) | data[i + 2];
+        *out++ = alphabet[(bits >> 18) & 0x3f];
+        *out++ = alphabet[(bits >> 12) & 0x3f];
+        *out++ = alphabet[(bits >> 6) & 0x3f];
+        *out++ = alphabet[bits & 0x3f];
+    }
+    if (i < length) {
+        const unsigned long bits =
+            ((unsigned long) data[i] << 16)
+            | (i + 1 < length ? data[i + 1] << 8 : 0);
+        *out++ = alphabet[(bits >> 18) & 0x3f];
+        *out++ = alphabet[(bits >> 12) & 0x3f];
+        *out++ = i + 1 < length ? alphabet[(bits >> 6) & 0x3f] : '=';
+        *out++ = '=';
+    }
+    *out = '"';
+    return 0;
+}
+
+/* Writes 'value' as 'repr' does, which is what 'json.dumps' writes for
+   finite values. */
+static int jsonPutFloat(JsonBuffer* buffer, double value) {
+    char* text;
+    int rc;
+    if (value != value) {
+        return jsonPut(buffer, "NaN", 3);
+    }
+    if (value > DBL_MAX) {
+        return jsonPut(buffer, "Infinity", 8);
+    }
+    if (value < -DBL_MAX) {
+        return jsonPut(buffer, "-Infinity", 9);
+    }
+    text = PyOS_double_to_string(value, 'r', 0, Py_DTSF_ADD_DOT_0, NULL);
+    if (text == NULL) {
+        return -1;
+    }
+    rc = jsonPut(buffer, text, strlen(text));
+    PyMem_Free(text);
+    return rc;
+}
+
+/* Writes the 'isoformat()' of what 'datetimeToPy' returns for 'value', or
+   'null' where it returns 'None'. */
+static int jsonPutDatetime(JsonBuffer* buffer,
+                           const blpapi_HighPrecisionDatetime_t* value,
+                           const int flags) {
+    const blpapi_Datetime_t* dt = &value->datetime;
+    const int hasDate = (dt->parts & BLPAPI_DATETIME_DATE_PART)
+                        == BLPAPI_DATETIME_DATE_PART;
+    const int hasTime = (dt->parts & BLPAPI_DATETIME_TIMEFRACSECONDS_PART)
+                        != 0;
+    const int microseconds =
+        dt->milliSeconds * 1000 + (int) (value->picoseconds / 1000000);
+    char text[64];
+    int length = 0;
+
+    if (flags & TOPY_DATETIME_AS_EPOCH_NANOS) {
+        long long nanos;
+        if (!dt->parts || datetimeToNanos(value, &nanos)) {
+            return jsonPut(buffer, "null", 4);
+        }
+        length = snprintf(text, sizeof(text), "%lld", nanos);
+        return jsonPut(buffer, text, (size_t) length);
+    }
+    if (!hasDate && !hasTime) {
+        return jsonPut(buffer, "null", 4);
+    }
+    text[length++] = '"';
+    if (hasDate) {
+        length += snprintf(text + length, sizeof(text) - length,
+                           "%04d-%02d-%02d",
+                           dt->year, dt->month, dt->day);
+    }
+    if (hasTime) {
+        if (hasDate) {
+            text[length++] = 'T';
+        }
+        length += snprintf(text + length, sizeof(text) - length,
+                           "%02d:%02d:%02d",
+                           dt->hours, dt->minutes, dt->seconds);
+        if (microseconds) {
+            length += snprintf(text + length, sizeof(text) - length,
+                               ".%06d", microseconds);
+        }
+        // an offset is only kept with a time, as by 'datetimeToPy'
+        if (dt->parts & BLPAPI_DATETIME_OFFSET_PART) {
+            const int offset = dt->offset < 0 ? -dt->offset : dt->offset;
+            length += snprintf(text + length, sizeof(text) - length,
+                               "%c%02d:%02d",
+                               dt->offset < 0 ? '-' : '+',
+                               offset / 60, offset % 60);
+        }
+    }
+    text[length++] = '"';
+    return jsonPut(buffer, text, (size_t) length);
+}
+
+static int jsonPutScalar(JsonBuffer* buffer,
+                         const blpapi_Element_t* element,
+                         const int index,
+                         const int flags) {
+    switch (blpapi_Element_datatype(element)) {
+        case BLPAPI_DATATYPE_BOOL: {
+            blpapi_Bool_t boolBuffer;
+            if (0 != blpapi_Element_getValueAsBool(element,
+                                                   &boolBuffer,
+                                                   index)) {
+                PyErr_SetString(PyExc_Exception,
+                                "Internal error getting bool");
+                return -1;
+            }
+            return boolBuffer ? jsonPut(buffer, "true", 4)
+                              : jsonPut(buffer, "false", 5);
+        }
+        case BLPAPI_DATATYPE_BYTE:
+        case BLPAPI_DATATYPE_INT32:
+        case BLPAPI_DATATYPE_INT64: {
+            blpapi_Int64_t int64Buffer;
+            char text[24];
+            if (0 != blpapi_Element_getValueAsInt64(element,
+                                                    &int64Buffer,
+                                                    index)) {
+                PyErr_SetString(PyExc_Exception,
+                                "Internal error getting int");
+                return -1;
+            }
+            return jsonPut(buffer,
+                           text,
+                           (size_t) snprintf(text, sizeof(text), "%lld",
+                                             (long long) int64Buffer));
+        }
+        case BLPAPI_DATATYPE_FLOAT32:
+        case BLPAPI_DATATYPE_FLOAT64: {
+            blpapi_Float64_t floatBuffer;
+            if (0 != blpapi_Element_getValueAsFloat64(element,
+                                                      &floatBuffer,
+                                                      index)) {
+                PyErr_SetString(PyExc_Exception,
+                                "Internal error getting float");
+                return -1;
+            }
+            return jsonPutFloat(buffer, floatBuffer);
+        }
+        case BLPAPI_DATATYPE_CHAR:
+        case BLPAPI_DATATYPE_STRING:
+        case BLPAPI_DATATYPE_ENUMERATION: {
+            const char* strValue;
+            if (0 != blpapi_Element_getValueAsString(element,
+                                                     &strValue,
+                                                     index)) {
+                PyErr_SetString(PyExc_Exception,
+                                "Internal error getting string");
+                return -1;
+            }
+            return jsonPutString(buffer, strValue, strlen(strValue));
+        }
+        case BLPAPI_DATATYPE_BYTEARRAY: {
+            const char* bytesValue = 0;
+            size_t bytesLength = 0;
+            if (0 != blpapi_Element_getValueAsBytes(element,
+                                                    &bytesValue,
+                                                    &bytesLength,
+                                                    index)) {
+                PyErr_SetString(PyExc_Exception,
+                                "Internal error getting bytes");
+                return -1;
+            }
+            return jsonPutBase64(buffer,
+                                 (const unsigned char*) bytesValue,
+                                 bytesLength);
+        }
+        case BLPAPI_DATATYPE_DATE:
+        case BLPAPI_DATATYPE_TIME:
+        case BLPAPI_DATATYPE_DATETIME: {
+            blpapi_HighPrecisionDatetime_t highPrecisionDatetimeBuffer;
+            if (blpapi_Element_getValueAsHighPrecisionDatetime(
+                        element,
+                        &highPrecisionDatetimeBuffer,
+                        index) != 0) {
+                PyErr_SetString(PyExc_Exception,
+                                "Internal error getting datetime");
+                return -1;
+            }
+            return jsonPutDatetime(
+                    buffer, &highPrecisionDatetimeBuffer, flags);
+        }
+        default: {
+            PyErr_SetString(PyExc_Exception, "Internal datatype error");
+            return -1;
+        }
+    }
+}
+
+/* Writes 'element' as 'blpapi_Element_toPy' converts it. */
+static int jsonPutElement(JsonBuffer* buffer,
+                          blpapi_Element_t* element,
+                          const int flags) {
+    size_t i;
+    if (blpapi_Element_isComplexType(element)) {
+        const size_t numElements = blpapi_Element_numElements(element);
+        if (jsonPutChar(buffer, '{')) {
+            return -1;
+        }
+        for (i = 0; i < numElements; ++i) {
+            blpapi_Element_t* subElement;
+            if (0 != blpapi_Element_getElementAt(element, &subElement, i)) {
+                PyErr_SetString(PyExc_Exception,
+                                "Internal error in `Element.toJson`");
+                return -1;
+            }
+            if ((i && jsonPutChar(buffer, ','))
+                    || jsonPutName(buffer, blpapi_Element_name(subElement))
+                    || jsonPutChar(buffer, ':')
+                    || jsonPutElement(buffer, subElement, flags)) {
+                return -1;
+            }
+        }
+        return jsonPutChar(buffer, '}');
+    }
+    if (blpapi_Element_isArray(element)) {
+        const size_t numValues = blpapi_Element_numValues(element);
+        const int isComplex = blpapi_SchemaTypeDefinition_isComplexType(
+                blpapi_SchemaElementDefinition_type(
+                        blpapi_Element_definition(element)));
+        if (jsonPutChar(buffer, '[')) {
+            return -1;
+        }
+        for (i = 0; i < numValues; ++i) {
+            if (i && jsonPutChar(buffer, ',')) {
+                return -1;
+            }
+            if (isComplex) {
+                blpapi_Element_t* value;
+                if (0 != blpapi_Element_getValueAsElement(
+                            element, &value, i)) {
+                    PyErr_SetString(
+                        PyExc_Exception,
+                        "Internal error in blpapi_Element_getValueAsElement");
+                    return -1;
+                }
+                if (jsonPutElement(buffer, value, flags)) {
+                    return -1;
+                }
+            }
+            else if (jsonPutScalar(buffer, element, (int) i, flags)) {
+                return -1;
+            }
+        }
+        return jsonPutChar(buffer, ']');
+    }
+    if (blpapi_Element_isNull(element)) {
+        return jsonPut(buffer, "null", 4);
+    }
+    return jsonPutScalar(buffer, element, 0, flags);
+}
+
+/* Returns the 'bytes' of the JSON of 'element', or, if 'fields' is not
+   NULL, of only the sub-elements of the complex 'element' named by the
+   'numFields' names in 'fields', as 'blpapi_Element_toPyFields' selects
+   them.
+*/
+PyObject* blpapi_Element_toJson(blpapi_Element_t *element,
+                                int flags,
+                                const blpapi_Name_t *const *fields,
+                                size_t numFields) {
+    JsonBuffer buffer = { NULL, 0, 0 };
+    PyObject* result = NULL;
+    int rc = 0;
+    if (fields == NULL) {
+        rc = jsonPutElement(&buffer, element, flags);
+    }
+    else {
+        size_t i;
+        int first = 1;
+        rc = jsonPutChar(&buffer, '{');
+        for (i = 0; rc == 0 && i < numFields; ++i) {
+            blpapi_Element_t* subElement;
+            if (0 != blpapi_Element_getElement(element,
+                                               &subElement,
+                                               NULL,
+                                               fields[i])) {
+                continue;
+            }
+            rc = (!first && jsonPutChar(&buffer, ','))
+                 || jsonPutName(&buffer, fields[i])
+                 || jsonPutChar(&buffer, ':')
+                 || jsonPutElement(&buffer, subElement, flags);
+            first = 0;
+        }
+        rc = rc || jsonPutChar(&buffer, '}');
+    }
+    if (rc == 0) {
+        result = PyBytes_FromStringAndSize(buffer.data,
+                                           (Py_ssize_t) buffer.size);
+    }
+    PyMem_Free(buffer.data);
+    return result;
+}
+
+PyObject* correlationIdToPy(const blpapi_CorrelationId_t *correlationId) {
+    switch (correlationId->valueType) {
+        case BLPAPI_CORRELATION_TYPE_INT:
+        case BLPAPI_CORRELATION_TYPE_AUTOGEN: {
+            return PyLong_FromUnsignedLongLong(correlationId->value.intValue);
+        }
+        case BLPAPI_CORRELATION_TYPE_POINTER: {
+            const blpapi_ManagedPtr_t *ptr = &correlationId->value.ptrValue;
+            // only objects managed by 'managerFunc' are python objects,
+            // others are set by the C++ layer for recaps
+            if (ptr->manager == (blpapi_ManagedPtr_ManagerFunction_t)
+                                                               &managerFunc
+                && ptr->pointer != NULL) {
+                Py_INCREF((PyObject *) ptr->pointer);
+                return (PyObject *) ptr->pointer;
+            }
+            Py_RETURN_NONE; // inc ref and return
+        }
+        default: {
+            Py_RETURN_NONE; // inc ref and return
+        }
+    }
+}
+
+/* Keys of the dicts of converted messages */
+static PyObject* messageTypeKey = NULL;
+static PyObject* topicNameKey = NULL;
+static PyObject* correlationIdsKey = NULL;
+static PyObject* elementsKey = NULL;
+
+/* Returns a new dict holding the 'messageType', 'topicName' and
+   'correlationIds' of 'message', or NULL with an error set. */
+static PyObject* messageHeaderToPy(blpapi_Message_t *message) {
+    PyObject* pyDict = PyDict_New();
+    PyObject* key;
+    PyObject* pyValue = NULL;
+    PyObject* pyCorrelationIds = NULL;
+    const char* topicName;
+    int numCorrelationIds;
+    int i;
+    if (pyDict == NULL) {
+        goto ERROR;
+    }
+
+    // borrowed reference owned by the cache
+    pyValue = nameToPyKey(blpapi_Message_messageType(message));
+    key = constantKey(&messageTypeKey, "messageType");
+    if (pyValue == NULL || key == NULL
+            || PyDict_SetItem(pyDict, key, pyValue)) {
+        pyValue = NULL;
+        goto ERROR;
+    }
+
+    topicName = blpapi_Message_topicName(message);
+    pyValue = PyUnicode_FromString(topicName ? topicName : "");
+    key = constantKey(&topicNameKey, "topicName");
+    if (pyValue == NULL || key == NULL
+            || PyDict_SetItem(pyDict, key, pyValue)) {
+        goto ERROR;
+    }
+    Py_CLEAR(pyValue);
+
+    numCorrelationIds = blpapi_Message_numCorrelationIds(message);
+    pyCorrelationIds = PyList_New(numCorrelationIds);
+    if (pyCorrelationIds == NULL) {
+        goto ERROR;
+    }
+    for (i = 0; i < numCorrelationIds; ++i) {
+        // the returned struct is a shallow copy, we do not own a reference
+        const blpapi_CorrelationId_t correlationId
+            = blpapi_Message_correlationId(message, i);
+        pyValue = correlationIdToPy(&correlationId);
+        if (pyValue == NULL) {
+            goto ERROR;
+        }
+        // steals ref to value
+        PyList_SetItem(pyCorrelationIds, i, pyValue);
+    }
+    pyValue = NULL;
+    key = constantKey(&correlationIdsKey, "correlationIds");
+    if (key == NULL || PyDict_SetItem(pyDict, key, pyCorrelationIds)) {
+        goto ERROR;
+    }
+    Py_CLEAR(pyCorrelationIds);
+    return pyDict;
+
+ERROR:
+    Py_XDECREF(pyDict);
+    Py_XDECREF(pyValue);
+    Py_XDECREF(pyCorrelationIds);
+    return NULL;
+}
+
+PyObject* messageToPy(blpapi_Message_t *message,
+                      const int flags,
+                      const blpapi_Name_t *const *fields,
+                      size_t numFields) {
+    PyObject* pyDict = messageHeaderToPy(message);
+    PyObject* key;
+    PyObject* pyValue = NULL;
+    if (pyDict == NULL) {
+        goto ERROR;
+    }
+
+    pyValue = fields == NULL
+        ? blpapi_Element_toPy(blpapi_Message_elements(message), flags)
+        : blpapi_Element_toPyFields(
+                blpapi_Message_elements(message), fields, numFields, flags);
+    key = constantKey(&elementsKey, "elements");
+    if (pyValue == NULL || key == NULL
+            || PyDict_SetItem(pyDict, key, pyValue)) {
+        goto ERROR;
+    }
+    Py_CLEAR(pyValue);
+    return pyDict;
+
+ERROR:
+    Py_XDECREF(pyDict);
+    Py_XDECREF(pyValue);
+    // Ensure that we set an error before returning NULL
+    if (PyErr_Occurred() == NULL) {
+        PyErr_SetString(
+                PyExc_Exception,
+                "Internal error converting a Message");
+    }
+    return NULL;
+}
+
+/* Converts all the messages of 'event' in a single call, avoiding the
+   creation of a python 'Message' wrapper for each of them.
+   If 'fields' is not NULL, only the 'numFields' fields it names are
+   converted from the content of each message.
+*/
+PyObject* blpapi_Event_toPy(blpapi_Event_t *event,
+                            int flags,
+                            const blpapi_Name_t *const *fields,
+                            size_t numFields) {
+    blpapi_MessageIterator_t* iterator = NULL;
+    blpapi_Message_t* message = NULL;
+    PyObject* pyList = PyList_New(0);
+    PyObject* pyValue = NULL;
+    if (pyList == NULL) {
+        goto ERROR;
+    }
+
+    iterator = blpapi_MessageIterator_create(event);
+    if (iterator == NULL) {
+        PyErr_SetString(PyExc_Exception,
+                        "Internal error in blpapi_MessageIterator_create");
+        goto ERROR;
+    }
+
+    while (0 == blpapi_MessageIterator_next(iterator, &message)) {
+        pyValue = messageToPy(message, flags, fields, numFields);
+        if (pyValue == NULL) {
+            goto ERROR;
+        }
+        // does not steal ref to value
+        if (PyList_Append(pyList, pyValue)) {
+            goto ERROR;
+        }
+        Py_CLEAR(pyValue);
+    }
+    blpapi_MessageIterator_destroy(iterator);
+    return pyList;
+
+ERROR:
+    if (iterator != NULL) {
+        blpapi_MessageIterator_destroy(iterator);
+    }
+    Py_XDECREF(pyList);
+    Py_XDECREF(pyValue);
+    // Ensure that we set an error before returning NULL
+    if (PyErr_Occurred() == NULL) {
+        PyErr_SetString(
+                PyExc_Exception,
+                "Internal error converting an Event");
+    }
+    return NULL;
+}
+
+/* Kinds of the columns filled by 'blpapi_Event_toColumns' */
+#define COLUMN_KIND_INT64 0
+#define COLUMN_KIND_FLOAT64 1
+#define COLUMN_KIND_BOOL 2
+#define COLUMN_KIND_TIMESTAMP 3
+#define COLUMN_KIND_OBJECT 4
+
+static const char* const columnKindNames[] = {
+    "int64", "float64", "bool", "timestamp", "object"
+};
+static const Py_ssize_t columnValueSizes[] = { 8, 8, 1, 8, 0 };
+
+/* Ensures that the bytearray 'buffer' holds at least 'size' bytes, growing
+   it geometrically and zeroing the added bytes. */
+static int reserveBytes(PyObject* buffer, Py_ssize_t size) {
+    const Py_ssize_t currentSize = PyByteArray_Size(buffer);
+    Py_ssize_t newSize;
+    if (currentSize >= size) {
+        return 0;
+    }
+    newSize = currentSize < 64 ? 64 : currentSize;
+    while (newSize < size) {
+        newSize *= 2;
+    }
+    if (PyByteArray_Resize(buffer, newSize)) {
+        return -1;
+    }
+    memset(PyByteArray_AsString(buffer) + currentSize,
+           0,
+           (size_t) (newSize - currentSize));
+    return 0;
+}
+
+/* Sets the bit of row 'row' of the LSB-first 'validity' bitmap to
+   'isValid'. */
+static int setValidity(PyObject* validity, const size_t row, int isValid) {
+    unsigned char* bits;
+    if (reserveBytes(validity, (Py_ssize_t) row / 8 + 1)) {
+        return -1;
+    }
+    bits = (unsigned char*) PyByteArray_AsString(validity);
+    if (isValid) {
+        bits[row / 8] |= (unsigned char) (1u << (row % 8));
+    }
+    else {
+        bits[row / 8] &= (unsigned char) ~(1u << (row % 8));
+    }
+    return 0;
+}
+
+/* Writes the value of 'element', the field 'field' of a row, in row 'row'
+   of the column described by 'kind', 'values' and 'validity'. Missing
+   fields, for which 'element' is NULL, and null fields are marked as not
+   valid in the LSB-first 'validity' bitmap. */
+static int storeColumn(blpapi_Element_t* element,
+                       const blpapi_Name_t* field,
+                       const int kind,
+                       PyObject* values,
+                       PyObject* validity,
+                       const size_t row) {
+    int isValid = element != NULL && !blpapi_Element_isNull(element);
+    int rc = 0;
+
+    if (kind == COLUMN_KIND_OBJECT) {
+        PyObject* value = NULL;
+        if (isValid) {
+            value = blpapi_Element_toPy(element, 0);
+            if (value == NULL) {
+                return -1;
+            }
+        }
+        else {
+            value = Py_None;
+            Py_INCREF(value);
+        }
+        rc = PyList_Append(values, value);
+        Py_DECREF(value);
+        if (rc) {
+            return -1;
+        }
+    }
+    else {
+        const Py_ssize_t size = columnValueSizes[kind];
+        char* dest;
+        if (reserveBytes(values, ((Py_ssize_t) row + 1) * size)) {
+            return -1;
+        }
+        dest = PyByteArray_AsString(values) + (Py_ssize_t) row * size;
+        if (isValid) {
+            switch (kind) {
+                case COLUMN_KIND_INT64: {
+                    blpapi_Int64_t value;
+                    rc = blpapi_Element_getValueAsInt64(element, &value, 0);
+                    memcpy(dest, &value, sizeof(value));
+                } break;
+                case COLUMN_KIND_FLOAT64: {
+                    blpapi_Float64_t value;
+                    rc = blpapi_Element_getValueAsFloat64(element, &value, 0);
+                    memcpy(dest, &value, sizeof(value));
+                } break;
+                case COLUMN_KIND_BOOL: {
+                    blpapi_Bool_t value;
+                    rc = blpapi_Element_getValueAsBool(element, &value, 0);
+                    *dest = value ? 1 : 0;
+                } break;
+                case COLUMN_KIND_TIMESTAMP: {
+                    blpapi_HighPrecisionDatetime_t value;
+                    long long nanos = 0;
+                    rc = blpapi_Element_getValueAsHighPrecisionDatetime(
+                            element, &value, 0);
+                    if (rc == 0 && datetimeToNanos(&value, &nanos)) {
+                        isValid = 0;
+                    }
+                    memcpy(dest, &nanos, sizeof(nanos));
+                } break;
+            }
+            if (rc != 0) {
+                PyErr_Format(PyExc_Exception,
+                             "Element '%s' cannot be stored in a %s column",
+                             blpapi_Name_string(field),
+                             columnKindNames[kind]);
+                return -1;
+            }
+        }
+    }
+
+    return setValidity(validity, row, isValid);
+}
+
+/* Same as 'storeColumn' for the field 'field' of 'elements'. */
+static int fillColumn(blpapi_Element_t* elements,
+                      const blpapi_Name_t* field,
+                      const int kind,
+                      PyObject* values,
+                      PyObject* validity,
+                      const size_t row) {
+    blpapi_Element_t* element = NULL;
+    if (0 != blpapi_Element_getElement(elements, &element, NULL, field)) {
+        element = NULL;
+    }
+    return storeColumn(element, field, kind, values, validity, row);
+}
+
+/* Loads into '*kinds', '*values' and '*validities' new arrays of the
+   kinds and borrowed buffers of the 'numFields' columns described by
+   'columns', to be released with 'PyMem_Free' even on error. */
+static int parseColumns(PyObject* columns,
+                        size_t numFields,
+                        int** kinds,
+                        PyObject*** values,
+                        PyObject*** validities) {
+    size_t i;
+    *kinds = NULL;
+    *values = NULL;
+    *validities = NULL;
+    if (!PyTuple_Check(columns)
+            || (size_t) PyTuple_Size(columns) != numFields) {
+        PyErr_SetString(PyExc_Exception,
+                        "Internal error: invalid column descriptions");
+        return -1;
+    }
+    *kinds = (int*) PyMem_Malloc((numFields + 1) * sizeof(int));
+    *values = (PyObject**) PyMem_Malloc((numFields + 1) * sizeof(PyObject*));
+    *validities =
+        (PyObject**) PyMem_Malloc((numFields + 1) * sizeof(PyObject*));
+    if (*kinds == NULL || *values == NULL || *validities == NULL) {
+        PyErr_NoMemory();
+        return -1;
+    }
+    for (i = 0; i < numFields; ++i) {
+        // borrowed references, kept alive by 'columns'
+        PyObject* column = PyTuple_GetItem(columns, (Py_ssize_t) i);
+        int kind;
+        if (column == NULL || !PyTuple_Check(column)
+                || PyTuple_Size(column) != 3) {
+            PyErr_SetString(PyExc_Exception,
+                            "Internal error: invalid column description");
+            return -1;
+        }
+        kind = (int) PyLong_AsLong(PyTuple_GetItem(column, 0));
+        (*kinds)[i] = kind;
+        (*values)[i] = PyTuple_GetItem(column, 1);
+        (*validities)[i] = PyTuple_GetItem(column, 2);
+        if (kind < COLUMN_KIND_INT64 || kind > COLUMN_KIND_OBJECT
+                || !PyByteArray_Check((*validities)[i])
+                || (kind == COLUMN_KIND_OBJECT
+                    ? !PyList_Check((*values)[i])
+                    : !PyByteArray_Check((*values)[i]))) {
+            PyErr_Clear();
+            PyErr_SetString(PyExc_Exception,
+                            "Internal error: invalid column description");
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/* Appends one row per message of 'event' to the 'numFields' columns
+   described by 'columns', a tuple of '(kind, values, validity)' tuples
+   where 'values' is a bytearray, or a list for 'COLUMN_KIND_OBJECT', and
+   'validity' is a bytearray. Column 'i' holds the values of the field
+   'fields[i]' of the messages. The columns already hold 'numRows' rows and
+   the buffers are grown as needed, so they may end up larger than the
+   data. Returns the new number of rows.
+*/
+PyObject* blpapi_Event_toColumns(blpapi_Event_t *event,
+                                 const blpapi_Name_t *const *fields,
+                                 size_t numFields,
+                                 PyObject *columns,
+                                 size_t numRows) {
+    blpapi_MessageIterator_t* iterator = NULL;
+    blpapi_Message_t* message = NULL;
+    int* kinds = NULL;
+    PyObject** values = NULL;
+    PyObject** validities = NULL;
+    size_t i;
+
+    if (parseColumns(columns, numFields, &kinds, &values, &validities)) {
+        goto ERROR;
+    }
+
+    iterator = blpapi_MessageIterator_create(event);
+    if (iterator == NULL) {
+        PyErr_SetString(PyExc_Exception,
+                        "Internal error in blpapi_MessageIterator_create");
+        goto ERROR;
+    }
+    while (0 == blpapi_MessageIterator_next(iterator, &message)) {
+        blpapi_Element_t* elements = blpapi_Message_elements(message);
+        for (i = 0; i < numFields; ++i) {
+            if (fillColumn(elements,
+                           fields[i],
+                           kinds[i],
+                           values[i],
+                           validities[i],
+                           numRows)) {
+                goto ERROR;
+            }
+        }
+        ++numRows;
+    }
+    blpapi_MessageIterator_destroy(iterator);
+    PyMem_Free(kinds);
+    PyMem_Free(values);
+    PyMem_Free(validities);
+    return PyLong_FromSize_t(numRows);
+
+ERROR:
+    if (iterator != NULL) {
+        blpapi_MessageIterator_destroy(iterator);
+    }
+    PyMem_Free(kinds);
+    PyMem_Free(values);
+    PyMem_Free(validities);
+    // Ensure that we set an error before returning NULL
+    if (PyErr_Occurred() == NULL) {
+        PyErr_SetString(
+                PyExc_Exception,
+                "Internal error converting an Event to columns");
+    }
+    return NULL;
+}
+
+/* State of the walk of the rows of a message by 'blpapi_Event_toRows'. */
+typedef struct {
+    const blpapi_Name_t* const* path;
+    size_t pathLength;
+    const blpapi_Name_t* const* fields;
+    size_t numFields;
+    const int* kinds;
+    PyObject** values;
+    PyObject** validities;
+    // the elements of the path leading to the current row, the elements
+    // of the message first
+    blpapi_Element_t** scopes;
+    size_t numRows;
+} RowWalk;
+
+/* Appends the rows under 'walk->scopes[depth]', reached by the first
+   'depth' names of the path. */
+static int walkRows(RowWalk* walk, size_t depth) {
+    blpapi_Element_t* element;
+    size_t i;
+    if (depth == walk->pathLength) {
+        for (i = 0; i < walk->numFields; ++i) {
+            // looked up in the row, then in the elements enclosing it
+            blpapi_Element_t* field = NULL;
+            size_t scope = depth + 1;
+            while (scope-- > 0
+                       && 0 != blpapi_Element_getElement(walk->scopes[scope],
+                                                         &field,
+                                                         NULL,
+                                                         walk->fields[i])) {
+                field = NULL;
+            }
+            if (storeColumn(field,
+                            walk->fields[i],
+                            walk->kinds[i],
+                            walk->values[i],
+                            walk->validities[i],
+                            walk->numRows)) {
+                return -1;
+            }
+        }
+        ++walk->numRows;
+        return 0;
+    }
+
+    if (0 != blpapi_Element_getElement(walk->scopes[depth],
+                                       &element,
+                                       NULL,
+                                       walk->path[depth])) {
+        // no rows under a missing element
+        return 0;
+    }
+    if (blpapi_Element_isComplexType(element)) {
+        walk->scopes[depth + 1] = element;
+        return walkRows(walk, depth + 1);
+    }
+    if (blpapi_Element_isArray(element)
+            && blpapi_SchemaTypeDefinition_isComplexType(
+                    blpapi_SchemaElementDefinition_type(
+                            blpapi_Element_definition(element)))) {
+        const size_t numValues = blpapi_Element_numValues(element);
+        for (i = 0; i < numValues; ++i) {
+            if (0 != blpapi_Element_getValueAsElement(
+                        element, &walk->scopes[depth + 1], i)) {
+                PyErr_SetString(
+                    PyExc_Exception,
+                    "Internal error in blpapi_Element_getValueAsElement");
+                return -1;
+            }
+            if (walkRows(walk, depth + 1)) {
+                return -1;
+            }
+        }
+        return 0;
+    }
+    PyErr_Format(PyExc_Exception,
+                 "Element '%s' of the rows is not complex",
+                 blpapi_Name_string(walk->path[depth]));
+    return -1;
+}
+
+/* Same as 'blpapi_Event_toColumns', except that a message produces one row
+   per element reached from it by the 'pathLength' names of 'path', each
+   array on the way being expanded into its values. Column 'i' holds the
+   values of the field 'fields[i]' of the rows or, for the rows without
+   such a field, of the nearest element enclosing them that has one, e.g.
+   the security of the 'fieldData' rows of a 'securityData' element.
+*/
+PyObject* blpapi_Event_toRows(blpapi_Event_t *event,
+                              const blpapi_Name_t *const *path,
+                              size_t pathLength,
+                              const blpapi_Name_t *const *fields,
+                              size_t numFields,
+                              PyObject *columns,
+                              size_t numRows) {
+    blpapi_MessageIterator_t* iterator = NULL;
+    blpapi_Message_t* message = NULL;
+    int* kinds = NULL;
+    PyObject** values = NULL;
+    PyObject** validities = NULL;
+    RowWalk walk;
+
+    walk.scopes = (blpapi_Element_t**) PyMem_Malloc(
+            (pathLength + 1) * sizeof(blpapi_Element_t*));
+    if (walk.scopes == NULL) {
+        PyErr_NoMemory();
+        goto ERROR;
+    }
+    if (parseColumns(columns, numFields, &kinds, &values, &validities)) {
+        goto ERROR;
+    }
+    walk.path = path;
+    walk.pathLength = pathLength;
+    walk.fields = fields;
+    walk.numFields = numFields;
+    walk.kinds = kinds;
+    walk.values = values;
+    walk.validities = validities;
+    walk.numRows = numRows;
+
+    iterator = blpapi_MessageIterator_create(event);
+    if (iterator == NULL) {
+        PyErr_SetString(PyExc_Exception,
+                        "Internal error in blpapi_MessageIterator_create");
+        goto ERROR;
+    }
+    while (0 == blpapi_MessageIterator_next(iterator, &message)) {
+        walk.scopes[0] = blpapi_Message_elements(message);
+        if (walkRows(&walk, 0)) {
+            goto ERROR;
+        }
+    }
+    blpapi_MessageIterator_destroy(iterator);
+    PyMem_Free(walk.scopes);
+    PyMem_Free(kinds);
+    PyMem_Free(values);
+    PyMem_Free(validities);
+    return PyLong_FromSize_t(walk.numRows);
+
+ERROR:
+    if (iterator != NULL) {
+        blpapi_MessageIterator_destroy(iterator);
+    }
+    PyMem_Free(walk.scopes);
+    PyMem_Free(kinds);
+    PyMem_Free(values);
+    PyMem_Free(validities);
+    // Ensure that we set an error before returning NULL
+    if (PyErr_Occurred() == NULL) {
+        PyErr_SetString(
+                PyExc_Exception,
+                "Internal error converting the rows of an Event to columns");
+    }
+    return NULL;
+}
+
+/* Two phase conversion of events. 'decodeEvent' walks the messages of an
+   event into a 'DecodedEvent', a flat array of tagged values, without
+   calling into python, so that it runs without the GIL and decodes in
+   parallel on as many threads as call it. The values are then converted to
+   python objects, or stored in columns, with the GIL held.
+
+   The values of the array are in pre-order: a complex, array or message
+   value is followed by the values of its children, the 'size' of a value
+   being the number of values of its subtree, itself included. Strings and
+   bytes point into the event, which must outlive the 'DecodedEvent'.
+*/
+#define DECODED_NULL 0
+#define DECODED_BOOL 1
+#define DECODED_INT64 2
+#define DECODED_FLOAT64 3
+#define DECODED_STRING 4
+#define DECODED_BYTES 5
+#define DECODED_DATETIME 6
+#define DECODED_COMPLEX 7
+#define DECODED_ARRAY 8
+#define DECODED_MESSAGE 9
+
+typedef struct DecodedValue {
+    int kind;
+    size_t size;
+    // name of the field of a complex value, NULL otherwise
+    const blpapi_Name_t* name;
+    union {
+        blpapi_Bool_t boolValue;
+        blpapi_Int64_t intValue;
+        blpapi_Float64_t floatValue;
+        struct {
+            const char* data;
+            size_t length;
+        } bytesValue; // DECODED_STRING and DECODED_BYTES
+        blpapi_HighPrecisionDatetime_t datetimeValue;
+        size_t numValues; // DECODED_COMPLEX and DECODED_ARRAY
+        blpapi_Message_t* message;
+    } value;
+} DecodedValue;
+
+typedef struct DecodedEvent {
+    DecodedValue* values;
+    size_t numValues;
+    size_t capacity;
+    size_t numMessages;
+    int flags;
+    const char* error; // set if decoding failed
+} DecodedEvent;
+
+static void destroyDecodedEvent(DecodedEvent* decoded) {
+    free(decoded->values);
+    free(decoded);
+}
+
+/* Returns the index of a new value of 'kind' appended to 'decoded', or
+   '(size_t) -1' if it cannot be allocated. Does not need the GIL. */
+static size_t appendDecodedValue(DecodedEvent* decoded,
+                                 int kind,
+                                 const blpapi_Name_t* name) {
+    DecodedValue* value;
+    if (decoded->numValues == decoded->capacity) {
+        const size_t newCapacity =
+            decoded->capacity ? 2 * decoded->capacity : 64;
+        DecodedValue* newValues = (DecodedValue*) realloc(
+                decoded->values, newCapacity * sizeof(DecodedValue));
+        if (newValues == NULL) {
+            decoded->error = "Out of memory decoding an Event";
+            return (size_t) -1;
+        }
+        decoded->values = newValues;
+        decoded->capacity = newCapacity;
+    }
+    value = &decoded->values[decoded->numValues];
+    value->kind = kind;
+    value->size = 1;
+    value->name = name;
+    return decoded->numValues++;
+}
+
+static int decodeScalar(DecodedEvent* decoded,
+                        const blpapi_Element_t* element,
+                        const int index,
+                        const blpapi_Name_t* name) {
+    DecodedValue* value;
+    size_t i;
+    int rc = 0;
+    switch (blpapi_Element_datatype(element)) {
+        case BLPAPI_DATATYPE_BOOL: {
+            if ((i = appendDecodedValue(decoded, DECODED_BOOL, name))
+                    == (size_t) -1) {
+                return -1;
+            }
+            value = &decoded->values[i];
+            rc = blpapi_Element_getValueAsBool(
+                    element, &value->value.boolValue, index);
+            decoded->error = rc ? "Internal error getting bool" : NULL;
+        } break;
+        case BLPAPI_DATATYPE_BYTE:
+        case BLPAPI_DATATYPE_INT32:
+        case BLPAPI_DATATYPE_INT64: {
+            if ((i = appendDecodedValue(decoded, DECODED_INT64, name))
+                    == (size_t) -1) {
+                return -1;
+            }
+            value = &decoded->values[i];
+            rc = blpapi_Element_getValueAsInt64(
+                    element, &value->value.intValue, index);
+            decoded->error = rc ? "Internal error getting int" : NULL;
+        } break;
+        case BLPAPI_DATATYPE_FLOAT32:
+        case BLPAPI_DATATYPE_FLOAT64: {
+            if ((i = appendDecodedValue(decoded, DECODED_FLOAT64, name))
+                    == (size_t) -1) {
+                return -1;
+            }
+            value = &decoded->values[i];
+            rc = blpapi_Element_getValueAsFloat64(
+                    element, &value->value.floatValue, index);
+            decoded->error = rc ? "Internal error getting float" : NULL;
+        } break;
+        case BLPAPI_DATATYPE_CHAR:
+        case BLPAPI_DATATYPE_STRING:
+        case BLPAPI_DATATYPE_ENUMERATION: {
+            const char* strValue = NULL;
+            if ((i = appendDecodedValue(decoded, DECODED_STRING, name))
+                    == (size_t) -1) {
+                return -1;
+            }
+            value = &decoded->values[i];
+            rc = blpapi_Element_getValueAsString(element, &strValue, index);
+            value->value.bytesValue.data = strValue;
+            value->value.bytesValue.length = rc ? 0 : strlen(strValue);
+            decoded->error = rc ? "Internal error getting string" : NULL;
+        } break;
+        case BLPAPI_DATATYPE_BYTEARRAY: {
+            if ((i = appendDecodedValue(decoded, DECODED_BYTES, name))
+                    == (size_t) -1) {
+                return -1;
+            }
+            value = &decoded->values[i];
+            rc = blpapi_Element_getValueAsBytes(
+                    element,
+                    &value->value.bytesValue.data,
+                    &value->value.bytesValue.length,
+                    index);
+            decoded->error = rc ? "Internal error getting bytes" : NULL;
+        } break;
+        case BLPAPI_DATATYPE_DATE:
+        case BLPAPI_DATATYPE_TIME:
+        case BLPAPI_DATATYPE_DATETIME: {
+            if ((i = appendDecodedValue(decoded, DECODED_DATETIME, name))
+                    == (size_t) -1) {
+                return -1;
+            }
+            value = &decoded->values[i];
+            rc = blpapi_Element_getValueAsHighPrecisionDatetime(
+                    element, &value->value.datetimeValue, index);
+            decoded->error = rc ? "Internal error getting datetime" : NULL;
+        } break;
+        default: {
+            decoded->error = "Internal datatype error";
+            rc = -1;
+        }
+    }
+    return rc ? -1 : 0;
+}
+
+static int decodeElement(DecodedEvent* decoded,
+                         blpapi_Element_t* element,
+                         const blpapi_Name_t* name) {
+    size_t index;
+    unsigned int i;
+    if (blpapi_Element_isComplexType(element)) {
+        const unsigned int numElements = blpapi_Element_numElements(element);
+        index = appendDecodedValue(decoded, DECODED_COMPLEX, name);
+        if (index == (size_t) -1) {
+            return -1;
+        }
+        for (i = 0; i < numElements; ++i) {
+            blpapi_Element_t* subElement;
+            if (0 != blpapi_Element_getElementAt(element, &subElement, i)) {
+                decoded->error = "Internal error in `Element.toPy`";
+                return -1;
+            }
+            if (decodeElement(decoded,
+                              subElement,
+                              blpapi_Element_name(subElement))) {
+                return -1;
+            }
+        }
+        decoded->values[index].value.numValues = numElements;
+    }
+    else if (blpapi_Element_isArray(element)) {
+        const unsigned int numValues = blpapi_Element_numValues(element);
+        const int isComplex = blpapi_SchemaTypeDefinition_isComplexType(
+                blpapi_SchemaElementDefinition_type(
+                        blpapi_Element_definition(element)));
+        index = appendDecodedValue(decoded, DECODED_ARRAY, name);
+        if (index == (size_t) -1) {
+            return -1;
+        }
+        for (i = 0; i < numValues; ++i) {
+            if (isComplex) {
+                blpapi_Element_t* result;
+                if (0 != blpapi_Element_getValueAsElement(
+                            element, &result, i)) {
+                    decoded->error =
+                        "Internal error in blpapi_Element_getValueAsElement";
+                    return -1;
+                }
+                if (decodeElement(decoded, result, NULL)) {
+                    return -1;
+                }
+            }
+            else if (decodeScalar(decoded, element, (int) i, NULL)) {
+                return -1;
+            }
+        }
+        decoded->values[index].value.numValues = numValues;
+    }
+    else if (blpapi_Element_isNull(element)) {
+        return appendDecodedValue(decoded, DECODED_NULL, name) == (size_t) -1
+            ? -1 : 0;
+    }
+    else {
+        return decodeScalar(decoded, element, 0, name);
+    }
+    decoded->values[index].size = decoded->numValues - index;
+    return 0;
+}
+
+static int decodeMessage(DecodedEvent* decoded,
+                         blpapi_Message_t* message,
+                         const blpapi_Name_t *const *fields,
+                         size_t numFields) {
+    blpapi_Element_t* elements = blpapi_Message_elements(message);
+    size_t index = appendDecodedValue(decoded, DECODED_MESSAGE, NULL);
+    size_t elementsIndex;
+    size_t i, numPresent = 0;
+    if (index == (size_t) -1) {
+        return -1;
+    }
+    decoded->values[index].value.message = message;
+    if (fields == NULL) {
+        if (decodeElement(decoded, elements, NULL)) {
+            return -1;
+        }
+    }
+    else {
+        // same as 'blpapi_Element_toPyFields'
+        elementsIndex = appendDecodedValue(decoded, DECODED_COMPLEX, NULL);
+        if (elementsIndex == (size_t) -1) {
+            return -1;
+        }
+        for (i = 0; i < numFields; ++i) {
+            blpapi_Element_t* subElement;
+            if (0 != blpapi_Element_getElement(elements,
+                                               &subElement,
+                                               NULL,
+                                               fields[i])) {
+                continue;
+            }
+            if (decodeElement(decoded, subElement, fields[i])) {
+                return -1;
+            }
+            ++numPresent;
+        }
+        decoded->values[elementsIndex].value.numValues = numPresent;
+        decoded->values[elementsIndex].size =
+            decoded->numValues - elementsIndex;
+    }
+    decoded->values[index].size = decoded->numValues - index;
+    ++decoded->numMessages;
+    return 0;
+}
+
+/* Returns a new 'DecodedEvent' of the messages of 'event', or NULL if it
+   cannot be allocated. Decoding failed if its 'error' is set. Does not
+   call into python and must be called without holding the GIL, or with
+   it held and then released around the call. */
+static DecodedEvent* decodeEvent(blpapi_Event_t *event,
+                                 int flags,
+                                 const blpapi_Name_t *const *fields,
+                                 size_t numFields) {
+    blpapi_MessageIterator_t* iterator;
+    blpapi_Message_t* message = NULL;
+    DecodedEvent* decoded =
+        (DecodedEvent*) calloc(1, sizeof(DecodedEvent));
+    if (decoded == NULL) {
+        return NULL;
+    }
+    decoded->flags = flags;
+    iterator = blpapi_MessageIterator_create(event);
+    if (iterator == NULL) {
+        decoded->error = "Internal error in blpapi_MessageIterator_create";
+        return decoded;
+    }
+    while (0 == blpapi_MessageIterator_next(iterator, &message)) {
+        if (decodeMessage(decoded, message, fields, numFields)) {
+            break;
+        }
+    }
+    blpapi_MessageIterator_destroy(iterator);
+    return decoded;
+}
+
+/* Returns a new reference to the python object for 'value', converted
+   with 'flags' as 'blpapi_Element_toPy' would. Needs the GIL. */
+static PyObject* decodedValueToPy(const DecodedValue* value, const int flags) {
+    const DecodedValue* child;
+    const DecodedValue* const end = value + value->size;
+    PyObject* pyResult = NULL;
+    PyObject* pyValue = NULL;
+    PyObject* key;
+    switch (value->kind) {
+        case DECODED_NULL: {
+            Py_RETURN_NONE; // inc ref and return
+        }
+        case DECODED_BOOL: {
+            return PyBool_FromLong(value->value.boolValue);
+        }
+        case DECODED_INT64: {
+            return PyLong_FromLongLong(value->value.intValue);
+        }
+        case DECODED_FLOAT64: {
+            return PyFloat_FromDouble(value->value.floatValue);
+        }
+        case DECODED_STRING: {
+            return PyUnicode_FromStringAndSize(
+                    value->value.bytesValue.data,
+                    (Py_ssize_t) value->value.bytesValue.length);
+        }
+        case DECODED_BYTES: {
+            return PyBytes_FromStringAndSize(
+                    value->value.bytesValue.data,
+                    (Py_ssize_t) value->value.bytesValue.length);
+        }
+        case DECODED_DATETIME: {
+            return datetimeToPy(&value->value.datetimeValue, flags);
+        }
+        case DECODED_COMPLEX: {
+            pyResult = PyDict_New();
+            for (child = value + 1;
+                    pyResult != NULL && child < end;
+                    child += child->size) {
+                // borrowed reference owned by the cache
+                key = nameToPyKey(child->name);
+                pyValue = key ? decodedValueToPy(child, flags) : NULL;
+                // does not steal refs to key and value
+                if (pyValue == NULL
+                        || PyDict_SetItem(pyResult, key, pyValue)) {
+                    goto ERROR;
+                }
+                Py_CLEAR(pyValue);
+            }
+            return pyResult;
+        }
+        case DECODED_ARRAY: {
+            Py_ssize_t i = 0;
+            pyResult = PyList_New((Py_ssize_t) value->value.numValues);
+            for (child = value + 1;
+                    pyResult != NULL && child < end;
+                    child += child->size) {
+                pyValue = decodedValueToPy(child, flags);
+                // steals ref to value
+                if (pyValue == NULL
+                        || PyList_SetItem(pyResult, i++, pyValue)) {
+                    pyValue = NULL;
+                    goto ERROR;
+                }
+            }
+            return pyResult;
+        }
+        case DECODED_MESSAGE: {
+            pyResult = messageHeaderToPy(value->value.message);
+            if (pyResult == NULL) {
+                goto ERROR;
+            }
+            pyValue = decodedValueToPy(value + 1, flags);
+            key = constantKey(&elementsKey, "elements");
+            if (pyValue == NULL || key == NULL
+                    || PyDict_SetItem(pyResult, key, pyValue)) {
+                goto ERROR;
+            }
+            Py_CLEAR(pyValue);
+            return pyResult;
+        }
+    }
+    PyErr_SetString(PyExc_Exception, "Internal datatype error");
+ERROR:
+    Py_XDECREF(pyResult);
+    Py_XDECREF(pyValue);
+    if (PyErr_Occurred() == NULL) {
+        PyErr_SetString(
+                PyExc_Exception,
+                "Internal error converting a decoded Event");
+    }
+    return NULL;
+}
+
+/* Returns a new list of the dicts of the messages of 'decoded', the same
+   as 'blpapi_Event_toPy' returns for the decoded event. */
+static PyObject* decodedEventToPy(const DecodedEvent* decoded) {
+    const DecodedValue* value = decoded->values;
+    const DecodedValue* const end = decoded->values + decoded->numValues;
+    Py_ssize_t i = 0;
+    PyObject* pyValue;
+    PyObject* pyList = PyList_New((Py_ssize_t) decoded->numMessages);
+    for (; pyList != NULL && value < end; value += value->size) {
+        pyValue = decodedValueToPy(value, decoded->flags);
+        // steals ref to value
+        if (pyValue == NULL || PyList_SetItem(pyList, i++, pyValue)) {
+            Py_CLEAR(pyList);
+        }
+    }
+    return pyList;
+}
+
+/* Same as 'fillColumn' for the decoded 'value' of 'field', NULL if the
+   field is missing. */
+static int fillDecodedColumn(const DecodedValue* value,
+                             const blpapi_Name_t* field,
+                             const int kind,
+                             PyObject* values,
+                             PyObject* validity,
+                             const size_t row) {
+    int isValid = value != NULL && value->kind != DECODED_NULL;
+    int rc = 0;
+
+    if (kind == COLUMN_KIND_OBJECT) {
+        PyObject* pyValue = isValid ? decodedValueToPy(value, 0) : Py_None;
+        if (pyValue == NULL) {
+            return -1;
+        }
+        if (!isValid) {
+            Py_INCREF(pyValue);
+        }
+        rc = PyList_Append(values, pyValue);
+        Py_DECREF(pyValue);
+        if (rc) {
+            return -1;
+        }
+    }
+    else {
+        const Py_ssize_t size = columnValueSizes[kind];
+        char* dest;
+        if (reserveBytes(values, ((Py_ssize_t) row + 1) * size)) {
+            return -1;
+        }
+        dest = PyByteArray_AsString(values) + (Py_ssize_t) row * size;
+        if (isValid) {
+            // the conversions accepted by the 'getValueAs' functions
+            switch (kind) {
+                case COLUMN_KIND_INT64: {
+                    blpapi_Int64_t intValue = value->value.intValue;
+                    if (value->kind == DECODED_BOOL) {
+                        intValue = value->value.boolValue ? 1 : 0;
+                    }
+                    else if (value->kind != DECODED_INT64) {
+                        rc = -1;
+                    }
+                    memcpy(dest, &intValue, sizeof(intValue));
+                } break;
+                case COLUMN_KIND_FLOAT64: {
+                    blpapi_Float64_t floatValue = value->value.floatValue;
+                    if (value->kind == DECODED_INT64) {
+                        floatValue = (blpapi_Float64_t) value->value.intValue;
+                    }
+                    else if (value->kind != DECODED_FLOAT64) {
+                        rc = -1;
+                    }
+                    memcpy(dest, &floatValue, sizeof(floatValue));
+                } break;
+                case COLUMN_KIND_BOOL: {
+                    rc = value->kind == DECODED_BOOL ? 0 : -1;
+                    *dest = rc == 0 && value->value.boolValue ? 1 : 0;
+                } break;
+                case COLUMN_KIND_TIMESTAMP: {
+                    long long nanos = 0;
+                    rc = value->kind == DECODED_DATETIME ? 0 : -1;
+                    if (rc == 0 && datetimeToNanos(
+                                &value->value.datetimeValue, &nanos)) {
+                        isValid = 0;
+                    }
+                    memcpy(dest, &nanos, sizeof(nanos));
+                } break;
+            }
+            if (rc != 0) {
+                PyErr_Format(PyExc_Exception,
+                             "Element '%s' cannot be stored in a %s column",
+                             blpapi_Name_string(field),
+                             columnKindNames[kind]);
+                return -1;
+            }
+        }
+    }
+    return setValidity(validity, row, isValid);
+}
+
+/* Same as 'blpapi_Event_toColumns' for the decoded event 'decoded'. */
+static PyObject* decodedEventToColumns(const DecodedEvent* decoded,
+                                       const blpapi_Name_t *const *fields,
+                                       size_t numFields,
+                                       PyObject *columns,
+                                       size_t numRows) {
+    const DecodedValue* message = decoded->values;
+    const DecodedValue* const end = decoded->values + decoded->numValues;
+    const DecodedValue** found = NULL;
+    int* kinds = NULL;
+    PyObject** values = NULL;
+    PyObject** validities = NULL;
+    PyObject* result = NULL;
+    size_t i;
+
+    if (parseColumns(columns, numFields, &kinds, &values, &validities)) {
+        goto DONE;
+    }
+    found = (const DecodedValue**)
+        PyMem_Malloc((numFields + 1) * sizeof(DecodedValue*));
+    if (found == NULL) {
+        PyErr_NoMemory();
+        goto DONE;
+    }
+    for (; message < end; message += message->size) {
+        // the elements of the message follow it
+        const DecodedValue* const elements = message + 1;
+        const DecodedValue* child;
+        for (i = 0; i < numFields; ++i) {
+            found[i] = NULL;
+        }
+        for (child = elements + 1;
+                child < elements + elements->size;
+                child += child->size) {
+            for (i = 0; i < numFields; ++i) {
+                if (child->name == fields[i]) {
+                    found[i] = child;
+                }
+            }
+        }
+        for (i = 0; i < numFields; ++i) {
+            if (fillDecodedColumn(found[i],
+                                  fields[i],
+                                  kinds[i],
+                                  values[i],
+                                  validities[i],
+                                  numRows)) {
+                goto DONE;
+            }
+        }
+        ++numRows;
+    }
+    result = PyLong_FromSize_t(numRows);
+
+DONE:
+    PyMem_Free(found);
+    PyMem_Free(kinds);
+    PyMem_Free(values);
+    PyMem_Free(validities);
+    return result;
+}
+
+/* decrefs allow python code to decrement ref. count of objects,
+   even if they are not yet pointed to by blpapi_ManagedPtr_t struct.
+*/
+PEXPRT void incref(PyObject *obj);
+void incref(PyObject *obj)
+{
+    PyGILState_STATE s = PyGILState_Ensure();
+    Py_XINCREF(obj);
+    PyGILState_Release(s);
+}
+
+/* This function implements the interface for managing objects from C.
+   We are ensuring GIL in this implementation, but those calls
+   can be nested and will not cause a deadlock if a call to managerFunc
+   is interrupted by GC that needs to decref.
+   Note: INCREF/DECREF are not atomic in the C-sense, but will not be
+   interrupted by Python interpreted thread.
+ */
+int managerFunc(void * mptr, void * sptr, int operation)
+{
+    PyGILState_STATE s = PyGILState_Ensure();
+
+    blpapi_ManagedPtr_t * managedPtr = (blpapi_ManagedPtr_t *) mptr;
+    blpapi_ManagedPtr_t * srcPtr = (blpapi_ManagedPtr_t *) sptr;
+
+    if (operation == BLPAPI_MANAGEDPTR_COPY) {
+        managedPtr->pointer = srcPtr->pointer;
+        managedPtr->manager = srcPtr->manager;
+        Py_XINCREF((PyObject *) (managedPtr->pointer));
+    }
+    else if (operation == BLPAPI_MANAGEDPTR_DESTROY) {
+        Py_XDECREF((PyObject *) (managedPtr->pointer));
+    }
+
+    PyGILState_Release(s);
+    return 0;
+}
+
+/* Used to set the function pointer to our manager inside cid structure */
+PEXPRT void setmptr(void *s);
+void setmptr(void *s) {
+    blpapi_ManagedPtr_t *p = (blpapi_ManagedPtr_t *) s;
+    p->manager = (blpapi_ManagedPtr_ManagerFunction_t ) &managerFunc;
+}
+
+/* Used to check if the manager used by a cid is the one we set.
+If it is not the same, it must be a C++ cb set for recaps.
+This function will be removed when recap cids are fixed.
+*/
+PEXPRT int is_known_obj(void *s);
+int is_known_obj(void *s) {
+    blpapi_ManagedPtr_t *p = (blpapi_ManagedPtr_t *) s;
+    return p->manager == (blpapi_ManagedPtr_ManagerFunction_t ) &managerFunc;
+}
+
+/* Compiled versions of the hottest accessors of 'internals.py'.
+   They take and return the same values as the ctypes wrappers they
+   replace: handles are 'ctypes.c_void_p' objects, or 'None' for NULL, and
+   accessors with an output parameter return a '(retCode, value)' tuple
+   where 'value' is 'None' if 'retCode' is not 0. The caller raises on a
+   non-zero 'retCode', so nothing is built on the error path here.
+*/
+static PyObject* voidPtrType = NULL; // ctypes.c_void_p
+static PyObject* valueAttr = NULL;   // "value"
+
+/* Loads into '*ptr' the address held by the handle 'obj'. */
+static int handleFromPy(PyObject* obj, void** ptr) {
+    PyObject* value;
+    if (obj == Py_None) {
+        *ptr = NULL;
+        return 0;
+    }
+    if (PyLong_Check(obj)) {
+        *ptr = PyLong_AsVoidPtr(obj);
+        return PyErr_Occurred() ? -1 : 0;
+    }
+    value = PyObject_GetAttr(obj, valueAttr);
+    if (value == NULL) {
+        return -1;
+    }
+    *ptr = value == Py_None ? NULL : PyLong_AsVoidPtr(value);
+    Py_DECREF(value);
+    return PyErr_Occurred() ? -1 : 0;
+}
+
+/* Returns a new 'c_void_p' handle for 'ptr', or 'None' if it is NULL. */
+static PyObject* handleToPy(void* ptr) {
+    if (ptr == NULL) {
+        Py_RETURN_NONE; // inc ref and return
+    }
+    return PyObject_CallFunction(voidPtrType, "N", PyLong_FromVoidPtr(ptr));
+}
+
+/* Loads into '*str' the UTF-8 form of the 'str' or 'None' object 'obj',
+   keeping the encoded bytes in '*holder', which the caller releases. */
+static int stringFromPy(PyObject* obj, const char** str, PyObject** holder) {
+    *holder = NULL;
+    *str = NULL;
+    if (obj == Py_None) {
+        return 0;
+    }
+    if (PyBytes_Check(obj)) {
+        *str = PyBytes_AsString(obj);
+        return 0;
+    }
+    *holder = PyUnicode_AsUTF8String(obj);
+    if (*holder == NULL) {
+        return -1;
+    }
+    *str = PyBytes_AsString(*holder);
+    return 0;
+}
+
+static PyObject* resultToPy(int retCode, PyObject* value) {
+    if (value == NULL) {
+        return NULL;
+    }
+    return Py_BuildValue("(iN)", retCode, value);
+}
+
+#define ELEMENT_INT_PROPERTY(FUNC)                                           \
+static PyObject* fast_##FUNC(PyObject* self, PyObject* args) {               \
+    PyObject* elementObj;                                                    \
+    void* element;                                                           \
+    if (!PyArg_ParseTuple(args, "O", &elementObj)                            \
+            || handleFromPy(elementObj, &element)) {                         \
+        return NULL;                                                         \
+    }                                                                        \
+    return PyLong_FromLong(                                                  \
+            (long) FUNC((const blpapi_Element_t*) element));                 \
+}
+
+ELEMENT_INT_PROPERTY(blpapi_Element_datatype)
+ELEMENT_INT_PROPERTY(blpapi_Element_isArray)
+ELEMENT_INT_PROPERTY(blpapi_Element_isComplexType)
+ELEMENT_INT_PROPERTY(blpapi_Element_isNull)
+
+static PyObject* fast_blpapi_Element_numElements(PyObject* self,
+                                                 PyObject* args) {
+    PyObject* elementObj;
+    void* element;
+    if (!PyArg_ParseTuple(args, "O", &elementObj)
+            || handleFromPy(elementObj, &element)) {
+        return NULL;
+    }
+    return PyLong_FromSize_t(
+            blpapi_Element_numElements((const blpapi_Element_t*) element));
+}
+
+static PyObject* fast_blpapi_Element_numValues(PyObject* self,
+                                               PyObject* args) {
+    PyObject* elementObj;
+    void* element;
+    if (!PyArg_ParseTuple(args, "O", &elementObj)
+            || handleFromPy(elementObj, &element)) {
+        return NULL;
+    }
+    return PyLong_FromSize_t(
+            blpapi_Element_numValues((const blpapi_Element_t*) element));
+}
+
+static PyObject* fast_blpapi_Element_hasElementEx(PyObject* self,
+                                                  PyObject* args) {
+    PyObject *elementObj, *nameStringObj, *nameObj, *holder;
+    void *element, *name;
+    const char* nameString;
+    int excludeNullElements, reserved, result;
+    if (!PyArg_ParseTuple(args, "OOOii", &elementObj, &nameStringObj,
+                          &nameObj, &excludeNullElements, &reserved)
+            || handleFromPy(elementObj, &element)
+            || handleFromPy(nameObj, &name)
+            || stringFromPy(nameStringObj, &nameString, &holder)) {
+        return NULL;
+    }
+    result = blpapi_Element_hasElementEx((const blpapi_Element_t*) element,
+                                         nameString,
+                                         (const blpapi_Name_t*) name,
+                                         excludeNullElements,
+                                         reserved);
+    Py_XDECREF(holder);
+    return PyLong_FromLong(result);
+}
+
+static PyObject* fast_blpapi_Element_getElement(PyObject* self,
+                                                PyObject* args) {
+    PyObject *elementObj, *nameStringObj, *nameObj, *holder;
+    void *element, *name;
+    const char* nameString;
+    blpapi_Element_t* result = NULL;
+    int retCode;
+    if (!PyArg_ParseTuple(args, "OOO", &elementObj, &nameStringObj,
+                          &nameObj)
+            || handleFromPy(elementObj, &element)
+            || handleFromPy(nameObj, &name)
+            || stringFromPy(nameStringObj, &nameString, &holder)) {
+        return NULL;
+    }
+    retCode = blpapi_Element_getElement((const blpapi_Element_t*) element,
+                                        &result,
+                                        nameString,
+                                        (const blpapi_Name_t*) name);
+    Py_XDECREF(holder);
+    return resultToPy(retCode, handleToPy(retCode ? NULL : result));
+}
+
+static PyObject* fast_blpapi_Element_getElementAt(PyObject* self,
+                                                  PyObject* args) {
+    PyObject* elementObj;
+    void* element;
+    Py_ssize_t position;
+    blpapi_Element_t* result = NULL;
+    int retCode;
+    if (!PyArg_ParseTuple(args, "On", &elementObj, &position)
+            || handleFromPy(elementObj, &element)) {
+        return NULL;
+    }
+    retCode = blpapi_Element_getElementAt((const blpapi_Element_t*) element,
+                                          &result,
+                                          (size_t) position);
+    return resultToPy(retCode, handleToPy(retCode ? NULL : result));
+}
+
+static PyObject* fast_blpapi_Element_getValueAsBool(PyObject* self,
+                                                    PyObject* args) {
+    PyObject* elementObj;
+    void* element;
+    Py_ssize_t index;
+    blpapi_Bool_t value;
+    int retCode;
+    if (!PyArg_ParseTuple(args, "On", &elementObj, &index)
+            || handleFromPy(elementObj, &element)) {
+        return NULL;
+    }
+    retCode = blpapi_Element_getValueAsBool(
+            (const blpapi_Element_t*) element, &value, (size_t) index);
+    if (retCode) {
+        return resultToPy(retCode, Py_BuildValue(""));
+    }
+    return resultToPy(retCode, PyLong_FromLong(value));
+}
+
+static PyObject* fast_blpapi_Element_getValueAsInt64(PyObject* self,
+                                                     PyObject* args) {
+    PyObject* elementObj;
+    void* element;
+    Py_ssize_t index;
+    blpapi_Int64_t value;
+    int retCode;
+    if (!PyArg_ParseTuple(args, "On", &elementObj, &index)
+            || handleFromPy(elementObj, &element)) {
+        return NULL;
+    }
+    retCode = blpapi_Element_getValueAsInt64(
+            (const blpapi_Element_t*) element, &value, (size_t) index);
+    if (retCode) {
+        return resultToPy(retCode, Py_BuildValue(""));
+    }
+    return resultToPy(retCode, PyLong_FromLongLong(value));
+}
+
+static PyObject* fast_blpapi_Element_getValueAsFloat64(PyObject* self,
+                                                       PyObject* args) {
+    PyObject* elementObj;
+    void* element;
+    Py_ssize_t index;
+    blpapi_Float64_t value;
+    int retCode;
+    if (!PyArg_ParseTuple(args, "On", &elementObj, &index)
+            || handleFromPy(elementObj, &element)) {
+        return NULL;
+    }
+    retCode = blpapi_Element_getValueAsFloat64(
+            (const blpapi_Element_t*) element, &value, (size_t) index);
+    if (retCode) {
+        return resultToPy(retCode, Py_BuildValue(""));
+    }
+    return resultToPy(retCode, PyFloat_FromDouble(value));
+}
+
+static PyObject* fast_blpapi_Element_getValueAsString(PyObject* self,
+                                                      PyObject* args) {
+    PyObject* elementObj;
+    void* element;
+    Py_ssize_t index;
+    const char* value = NULL;
+    int retCode;
+    if (!PyArg_ParseTuple(args, "On", &elementObj, &index)
+            || handleFromPy(elementObj, &element)) {
+        return NULL;
+    }
+    retCode = blpapi_Element_getValueAsString(
+            (const blpapi_Element_t*) element, &value, (size_t) index);
+    if (retCode || value == NULL) {
+        return resultToPy(retCode, Py_BuildValue(""));
+    }
+    return resultToPy(retCode, PyUnicode_FromString(value));
+}
+
+static PyObject* fast_blpapi_MessageIterator_next(PyObject* self,
+                                                  PyObject* args) {
+    PyObject* iteratorObj;
+    void* iterator;
+    blpapi_Message_t* result = NULL;
+    int retCode;
+    if (!PyArg_ParseTuple(args, "O", &iteratorObj)
+            || handleFromPy(iteratorObj, &iterator)) {
+        return NULL;
+    }
+    retCode = blpapi_MessageIterator_next(
+            (blpapi_MessageIterator_t*) iterator, &result);
+    return resultToPy(retCode, handleToPy(retCode ? NULL : result));
+}
+
+/* Kinds of the results of 'blpapi_Element_getItem' */
+#define ITEM_KIND_VALUE 0
+#define ITEM_KIND_ELEMENT 1
+#define ITEM_KIND_NAME 2
+
+/* Implements 'Element.__getitem__' for names in a single call: returns
+   '(ITEM_KIND_ELEMENT, handle)' for a complex or array sub-element,
+   '(ITEM_KIND_VALUE, None)' for a null one, '(ITEM_KIND_NAME, handle)' for
+   an enumeration and '(ITEM_KIND_VALUE, value)' otherwise; raises KeyError
+   if there is no such sub-element. If the optional 'flags' are given, the
+   values are converted as by 'blpapi_Element_toPy' with these flags, and
+   enumerations are returned as '(ITEM_KIND_VALUE, str)' instead.
+*/
+static PyObject* fast_blpapi_Element_getItem(PyObject* self,
+                                             PyObject* args) {
+    PyObject *elementObj, *nameStringObj, *nameObj, *holder;
+    void *element, *name;
+    const char* nameString;
+    blpapi_Element_t* result = NULL;
+    int retCode;
+    int flags = -1;
+    if (!PyArg_ParseTuple(args, "OOO|i", &elementObj, &nameStringObj,
+                          &nameObj, &flags)
+            || handleFromPy(elementObj, &element)
+            || handleFromPy(nameObj, &name)
+            || stringFromPy(nameStringObj, &nameString, &holder)) {
+        return NULL;
+    }
+    retCode = blpapi_Element_getElement((const blpapi_Element_t*) element,
+                                        &result,
+                                        nameString,
+                                        (const blpapi_Name_t*) name);
+    if (retCode) {
+        PyErr_Format(PyExc_KeyError,
+                     "Element %s does not contain element %s",
+                     blpapi_Element_nameString(
+                         (const blpapi_Element_t*) element),
+                     nameString ? nameString
+                                : blpapi_Name_string(
+                                      (const blpapi_Name_t*) name));
+        Py_XDECREF(holder);
+        return NULL;
+    }
+    Py_XDECREF(holder);
+
+    if (blpapi_Element_isComplexType(result)
+            || blpapi_Element_isArray(result)) {
+        return resultToPy(ITEM_KIND_ELEMENT, handleToPy(result));
+    }
+    if (blpapi_Element_isNull(result)) {
+        // Scalar element with a null value
+        return resultToPy(ITEM_KIND_VALUE, Py_BuildValue(""));
+    }
+    if (flags >= 0) {
+        return resultToPy(ITEM_KIND_VALUE,
+                          getScalarValue(result, 0, flags));
+    }
+    if (blpapi_Element_datatype(result) == BLPAPI_DATATYPE_ENUMERATION) {
+        blpapi_Name_t* value = NULL;
+        if (blpapi_Element_getValueAsName(result, &value, 0)) {
+            PyErr_SetString(PyExc_Exception, "Internal error getting Name");
+            return NULL;
+        }
+        return resultToPy(ITEM_KIND_NAME, handleToPy(value));
+    }
+    return resultToPy(ITEM_KIND_VALUE, getScalarValue(result, 0, 0));
+}
+
+/* Formats elements and events from python values, the reverse of
+   'blpapi_Element_toPy', for 'Element.fromPy' and 'EventFormatter.fromPy'.
+   The walk is native and calls back into python only for the names given as
+   keys and for values other than 'None', 'bool', 'int', 'float', 'str' and
+   'bytes'. A failure stops the walk and is returned as a tuple describing
+   it, the path of the failing element being built only then, from which the
+   python callers raise the same exceptions as their python implementations.
+*/
+
+/* Kinds of the failures of the 'fromPy' functions */
+#define FROMPY_ERROR 0              // an operation failed
+#define FROMPY_RAISE 1              // as FROMPY_ERROR, raised unchanged
+#define FROMPY_ALREADY_FORMATTED 2
+#define FROMPY_NOT_COMPLEX 3        // a mapping for a non-complex element
+#define FROMPY_NOT_ARRAY 4          // a sequence for a non-array element
+#define FROMPY_MAPPING_ENTRY 5      // a mapping for a scalar array entry
+#define FROMPY_NESTED_SEQUENCE 6    // a sequence for an array entry
+#define FROMPY_SCALAR_ENTRY 7       // a scalar for a complex array entry
+#define FROMPY_NOT_SCALAR 8         // a scalar for a complex or array element
+
+/* Kinds of python values, as told apart by the 'fromPy' implementations */
+#define VALUE_KIND_MAPPING 0
+#define VALUE_KIND_SEQUENCE 1
+#define VALUE_KIND_SCALAR 2
+
+/* Returned by the scalar setters for values left to the python callback */
+#define FROMPY_NOT_HANDLED -2
+
+static PyObject* mappingType = NULL;  // collections.abc.Mapping
+static PyObject* sequenceType = NULL; // collections.abc.Sequence
+
+static int initAbstractTypes(void) {
+    PyObject* abcModule;
+    if (sequenceType != NULL) {
+        return 0;
+    }
+    FFIUTILS_LOCK(cacheMutex);
+    if (sequenceType == NULL) {
+        abcModule = PyImport_ImportModule("collections.abc");
+        if (abcModule != NULL) {
+            mappingType = PyObject_GetAttrString(abcModule, "Mapping");
+            if (mappingType != NULL) {
+                sequenceType = PyObject_GetAttrString(abcModule, "Sequence");
+            }
+            Py_DECREF(abcModule);
+        }
+    }
+    FFIUTILS_UNLOCK(cacheMutex);
+    return sequenceType == NULL ? -1 : 0;
+}
+
+/* Returns the 'VALUE_KIND_*' of 'value' or -1 on error. As for
+   'isNonScalarSequence', strings and buffers are scalars. */
+static int classifyValue(PyObject* value) {
+    int isInstance;
+    if (PyDict_Check(value)) {
+        return VALUE_KIND_MAPPING;
+    }
+    if (PyList_Check(value) || PyTuple_Check(value)) {
+        return VALUE_KIND_SEQUENCE;
+    }
+    if (value == Py_None || PyUnicode_Check(value) || PyBytes_Check(value)
+            || PyLong_Check(value) || PyFloat_Check(value)
+            || PyByteArray_Check(value) || PyMemoryView_Check(value)) {
+        return VALUE_KIND_SCALAR;
+    }
+    if (initAbstractTypes()) {
+        return -1;
+    }
+    isInstance = PyObject_IsInstance(value, mappingType);
+    if (isInstance) {
+        return isInstance < 0 ? -1 : VALUE_KIND_MAPPING;
+    }
+    isInstance = PyObject_IsInstance(value, sequenceType);
+    if (isInstance) {
+        return isInstance < 0 ? -1 : VALUE_KIND_SEQUENCE;
+    }
+    return VALUE_KIND_SCALAR;
+}
+
+/* Returns '(retCode, description)' describing the failed 'retCode'. */
+static PyObject* errorDetail(int retCode) {
+    return Py_BuildValue("(is)",
+                         retCode,
+                         blpapi_getLastErrorDescription(retCode));
+}
+
+/* Returns the pending python exception, or NULL leaving it pending if it
+   is not an 'Exception', as the python implementations only catch those. */
+static PyObject* exceptionDetail(void) {
+    PyObject *type, *value, *traceback;
+    if (!PyErr_ExceptionMatches(PyExc_Exception)) {
+        return NULL;
+    }
+    PyErr_Fetch(&type, &value, &traceback);
+    PyErr_NormalizeException(&type, &value, &traceback);
+    Py_XDECREF(type);
+    Py_XDECREF(traceback);
+    return value;
+}
+
+/* Appends the 'str' 'part' (stolen) to '*path'. */
+static int appendPathPart(PyObject** path, PyObject* part) {
+    PyObject* joined;
+    if (part == NULL) {
+        return -1;
+    }
+    joined = PyUnicode_Concat(*path, part);
+    Py_DECREF(part);
+    Py_DECREF(*path);
+    *path = joined;
+    return joined == NULL ? -1 : 0;
+}
+
+/* A level of the walk, kept on the C stack to build the path of a failing
+   element. 'index' is the index of an array entry, or -1 for the element
+   named by 'element' or 'key', as used by 'Element.fromPy' and
+   'EventFormatter.fromPy' respectively. */
+typedef struct FromPyFrame {
+    const struct FromPyFrame* parent;
+    const blpapi_Element_t* element;
+    PyObject* key;
+    Py_ssize_t index;
+} FromPyFrame;
+
+/* Returns the path of 'frame' as formatted by 'Element._fromPyHelper':
+   names separated by '/' from the root element, and '[index]' for array
+   entries. */
+static PyObject* elementFramePath(const FromPyFrame* frame) {
+    PyObject* path;
+    if (frame->parent == NULL) {
+        return PyUnicode_FromString(blpapi_Element_nameString(frame->element));
+    }
+    path = elementFramePath(frame->parent);
+    if (path == NULL) {
+        return NULL;
+    }
+    if (appendPathPart(&path,
+                       frame->index >= 0
+                           ? PyUnicode_FromFormat("[%zd]", frame->index)
+                           : PyUnicode_FromFormat(
+                                 "/%s",
+                                 blpapi_Element_nameString(frame->element)))) {
+        return NULL;
+    }
+    return path;
+}
+
+/* Returns the path of 'frame' as the list of the parts of the 'dpath' of
+   'EventFormatter._fromPyHelper': the 'str' keys of the pushed elements, and
+   'key[index]' for array entries. */
+static PyObject* formatterFramePath(const FromPyFrame* frame) {
+    PyObject* path;
+    PyObject* part;
+    if (frame->parent == NULL) {
+        return PyList_New(0);
+    }
+    path = formatterFramePath(frame->parent);
+    if (path == NULL) {
+        return NULL;
+    }
+    part = frame->key ? PyObject_Str(frame->key) : PyUnicode_FromString("");
+    if (part != NULL && frame->index >= 0) {
+        PyObject* entryPart = PyUnicode_FromFormat("%U[%zd]",
+                                                   part,
+                                                   frame->index);
+        Py_DECREF(part);
+        part = entryPart;
+    }
+    if (part == NULL || PyList_Append(path, part)) {
+        Py_XDECREF(part);
+        Py_DECREF(path);
+        return NULL;
+    }
+    Py_DECREF(part);
+    return path;
+}
+
+typedef struct {
+    PyObject* getNamePair;  // 'name.getNamePair'
+    PyObject* setValue;     // sets values of other types
+    PyObject* appendValue;  // appends values of other types
+    PyObject* failure;      // the description of the failure, if any
+} FromPyContext;
+
+/* Records the failure described by the other arguments, 'detail' (stolen)
+   being the error, or the value for 'FROMPY_NOT_SCALAR'. Returns -1, or -2
+   with a pending exception if the failure cannot be described. */
+static int elementFromPyFailure(FromPyContext* context,
+                                int kind,
+                                const FromPyFrame* frame,
+                                const blpapi_Element_t* element,
+                                int isArrayEntry,
+                                PyObject* detail) {
+    PyObject* path = elementFramePath(frame);
+    if (path == NULL) {
+        Py_XDECREF(detail);
+        return -2;
+    }
+    context->failure = Py_BuildValue("(iNNiN)",
+                                     kind,
+                                     handleToPy((void*) element),
+                                     path,
+                                     isArrayEntry,
+                                     detail ? detail : Py_BuildValue(""));
+    return context->failure == NULL ? -2 : -1;
+}
+
+static int formatterFromPyFailure(FromPyContext* context,
+                                  int kind,
+                                  const FromPyFrame* frame,
+                                  PyObject* key,
+                                  PyObject* detail) {
+    PyObject* path = formatterFramePath(frame);
+    if (path == NULL) {
+        Py_XDECREF(detail);
+        return -2;
+    }
+    context->failure = Py_BuildValue("(iNNO)",
+                                     kind,
+                                     path,
+                                     detail ? detail : Py_BuildValue(""),
+                                     key ? key : Py_None);
+    return context->failure == NULL ? -2 : -1;
+}
+
+/* Returns the new reference to the '(nameString, name)' pair of 'key', or
+   NULL with a pending exception. If 'anyKey' is set, a 'key' that is neither
+   a string nor a 'Name' is named by its 'str', as 'Name(str(key))' does. */
+static PyObject* nameOfKey(FromPyContext* context,
+                           PyObject* key,
+                           int anyKey,
+                           const char** nameString,
+                           void** name,
+                           PyObject** holder) {
+    PyObject* pair = PyObject_CallFunctionObjArgs(
+            context->getNamePair, key, NULL);
+    PyObject *nameStringObj, *nameObj;
+    *holder = NULL;
+    if (pair == NULL && anyKey && PyErr_ExceptionMatches(PyExc_TypeError)) {
+        PyObject* keyString;
+        PyErr_Clear();
+        keyString = PyObject_Str(key);
+        if (keyString == NULL) {
+            return NULL;
+        }
+        pair = PyObject_CallFunctionObjArgs(
+                context->getNamePair, keyString, NULL);
+        Py_DECREF(keyString);
+    }
+    if (pair == NULL) {
+        return NULL;
+    }
+    if (!PyArg_ParseTuple(pair, "OO", &nameStringObj, &nameObj)
+            || handleFromPy(nameObj, name)
+            || stringFromPy(nameStringObj, nameString, holder)) {
+        Py_DECREF(pair);
+        return NULL;
+    }
+    return pair;
+}
+
+/* Sets the value at 'index' of 'element' from 'value' as 'Element.setValue'
+   does. Returns 0 on success, the error code of a failed call, -1 with a
+   pending exception, or FROMPY_NOT_HANDLED for other types of 'value'. */
+static int elementSetScalar(blpapi_Element_t* element,
+                            PyObject* value,
+                            size_t index) {
+    if (PyUnicode_Check(value)) {
+        PyObject* holder = PyUnicode_AsUTF8String(value);
+        int retCode;
+        if (holder == NULL) {
+            return -1;
+        }
+        retCode = blpapi_Element_setValueString(
+                element, PyBytes_AsString(holder), index);
+        Py_DECREF(holder);
+        return retCode;
+    }
+    if (PyBytes_Check(value)) {
+        return blpapi_Element_setValueBytes(element,
+                                            PyBytes_AsString(value),
+                                            (size_t) PyBytes_Size(value),
+                                            index);
+    }
+    if (PyBool_Check(value)) {
+        return blpapi_Element_setValueBool(element, value == Py_True, index);
+    }
+    if (PyLong_Check(value)) {
+        int overflow;
+        const long long intValue = PyLong_AsLongLongAndOverflow(value,
+                                                                &overflow);
+        if (overflow) {
+            // out of range, left to the python error
+            return FROMPY_NOT_HANDLED;
+        }
+        if (intValue == -1 && PyErr_Occurred()) {
+            return -1;
+        }
+        if (intValue >= INT32_MIN && intValue <= INT32_MAX) {
+            return blpapi_Element_setValueInt32(
+                    element, (blpapi_Int32_t) intValue, index);
+        }
+        return blpapi_Element_setValueInt64(element, intValue, index);
+    }
+    if (PyFloat_Check(value)) {
+        const double floatValue = PyFloat_AsDouble(value);
+        // python floats are narrowed to 32 bits if the schema says so
+        if (blpapi_Element_datatype(element) == BLPAPI_DATATYPE_FLOAT32) {
+            return blpapi_Element_setValueFloat32(
+                    element, (blpapi_Float32_t) floatValue, index);
+        }
+        return blpapi_Element_setValueFloat64(element, floatValue, index);
+    }
+    return FROMPY_NOT_HANDLED;
+}
+
+/* Sets the value of the scalar or array 'element' at 'index' from 'value',
+   through 'context->setValue' for the types not handled natively. Returns
+   0, or the failure as 'elementFromPyFailure'. */
+static int elementSetValue(FromPyContext* context,
+                           const FromPyFrame* frame,
+                           blpapi_Element_t* element,
+                           PyObject* value,
+                           size_t index,
+                           int isArrayEntry) {
+    int retCode = elementSetScalar(element, value, index);
+    if (retCode == FROMPY_NOT_HANDLED) {
+        PyObject* result = PyObject_CallFunction(context->setValue,
+                                                 "NOn",
+                                                 handleToPy(element),
+                                                 value,
+                                                 (Py_ssize_t) index);
+        retCode = result == NULL ? -1 : 0;
+        Py_XDECREF(result);
+    }
+    if (retCode == 0) {
+        return 0;
+    }
+    {
+        PyObject* detail = retCode == -1 ? exceptionDetail()
+                                         : errorDetail(retCode);
+        if (detail == NULL) {
+            return -2;
+        }
+        return elementFromPyFailure(context, FROMPY_ERROR, frame, element,
+                                    isArrayEntry, detail);
+    }
+}
+
+static int elementFromPy(FromPyContext* context,
+                         const FromPyFrame* frame,
+                         blpapi_Element_t* element,
+                         PyObject* value);
+
+/* Formats the sub-element of the complex 'element' named by 'key'. */
+static int elementItemFromPy(FromPyContext* context,
+                             const FromPyFrame* frame,
+                             blpapi_Element_t* element,
+                             PyObject* key,
+                             PyObject* value) {
+    FromPyFrame subFrame = { frame, NULL, key, -1 };
+    blpapi_Element_t* subElement = NULL;
+    int retCode;
+    if (PyLong_Check(key)) {
+        // as 'Element.getElement', integers are positions
+        size_t position = PyLong_AsSize_t(key);
+        if (position == (size_t) -1 && PyErr_Occurred()) {
+            PyObject* detail = exceptionDetail();
+            return detail == NULL
+                       ? -2
+                       : elementFromPyFailure(context, FROMPY_ERROR, frame,
+                                              element, 0, detail);
+        }
+        retCode = blpapi_Element_getElementAt(element, &subElement, position);
+    }
+    else {
+        const char* nameString;
+        void* name;
+        PyObject* holder;
+        PyObject* pair = nameOfKey(context, key, 0, &nameString, &name,
+                                   &holder);
+        if (pair == NULL) {
+            PyObject* detail = exceptionDetail();
+            return detail == NULL
+                       ? -2
+                       : elementFromPyFailure(context, FROMPY_ERROR, frame,
+                                              element, 0, detail);
+        }
+        retCode = blpapi_Element_getElement(element,
+                                            &subElement,
+                                            nameString,
+                                            (const blpapi_Name_t*) name);
+        Py_XDECREF(holder);
+        Py_DECREF(pair);
+    }
+    if (retCode) {
+        PyObject* detail = errorDetail(retCode);
+        return detail == NULL
+                   ? -2
+                   : elementFromPyFailure(context, FROMPY_ERROR, frame,
+                                          element, 0, detail);
+    }
+    subFrame.element = subElement;
+    return elementFromPy(context, &subFrame, subElement, value);
+}
+
+/* Formats the entry of the array 'element' at 'index' from 'value'. */
+static int elementEntryFromPy(FromPyContext* context,
+                              const FromPyFrame* frame,
+                              blpapi_Element_t* element,
+                              int complexValues,
+                              Py_ssize_t index,
+                              PyObject* value) {
+    const FromPyFrame entryFrame = { frame, NULL, NULL, index };
+    const int kind = classifyValue(value);
+    if (kind < 0) {
+        return -2;
+    }
+    if (kind == VALUE_KIND_MAPPING) {
+        blpapi_Element_t* appended = NULL;
+        int retCode;
+        if (!complexValues) {
+            return elementFromPyFailure(context, FROMPY_MAPPING_ENTRY,
+                                        &entryFrame, element, 1, NULL);
+        }
+        retCode = blpapi_Element_appendElement(element, &appended);
+        if (retCode) {
+            PyObject* detail = errorDetail(retCode);
+            return detail == NULL
+                       ? -2
+                       : elementFromPyFailure(context, FROMPY_RAISE, frame,
+                                              element, 0, detail);
+        }
+        // the appended element is named by its index in the path
+        return elementFromPy(context, &entryFrame, appended, value);
+    }
+    if (kind == VALUE_KIND_SEQUENCE) {
+        return elementFromPyFailure(context, FROMPY_NESTED_SEQUENCE,
+                                    &entryFrame, element, 1, NULL);
+    }
+    if (complexValues) {
+        return elementFromPyFailure(context, FROMPY_SCALAR_ENTRY,
+                                    &entryFrame, element, 1, NULL);
+    }
+    return elementSetValue(context, &entryFrame, element, value,
+                           BLPAPI_ELEMENT_INDEX_END, 1);
+}
+
+/* Formats 'element', reached through 'frame', from 'value' as
+   'Element._fromPyHelper' does. Returns 0 on success, -1 if a failure was
+   recorded in 'context' and -2 with a pending exception. */
+static int elementFromPy(FromPyContext* context,
+                         const FromPyFrame* frame,
+                         blpapi_Element_t* element,
+                         PyObject* value) {
+    int kind;
+    int result = 0;
+    if (blpapi_Element_numElements(element)
+            || blpapi_Element_numValues(element)) {
+        return elementFromPyFailure(context, FROMPY_ALREADY_FORMATTED, frame,
+                                    element, 0, NULL);
+    }
+    kind = classifyValue(value);
+    if (kind < 0) {
+        return -2;
+    }
+
+    if (kind == VALUE_KIND_MAPPING) {
+        if (!blpapi_Element_isComplexType(element)) {
+            return elementFromPyFailure(context, FROMPY_NOT_COMPLEX, frame,
+                                        element, 0, NULL);
+        }
+        if (PyDict_Check(value)) {
+            Py_ssize_t position = 0;
+            PyObject *key, *subValue;
+            while (result == 0
+                    && PyDict_Next(value, &position, &key, &subValue)) {
+                result = elementItemFromPy(context, frame, element, key,
+                                           subValue);
+            }
+        }
+        else {
+            PyObject* iterator = PyObject_GetIter(value);
+            PyObject* key;
+            if (iterator == NULL) {
+                return -2;
+            }
+            while (result == 0 && (key = PyIter_Next(iterator)) != NULL) {
+                PyObject* subValue = PyObject_GetItem(value, key);
+                result = subValue == NULL
+                             ? -2
+                             : elementItemFromPy(context, frame, element,
+                                                 key, subValue);
+                Py_XDECREF(subValue);
+                Py_DECREF(key);
+            }
+            Py_DECREF(iterator);
+            if (result == 0 && PyErr_Occurred()) {
+                result = -2;
+            }
+        }
+        return result;
+    }
+
+    if (kind == VALUE_KIND_SEQUENCE) {
+        const blpapi_SchemaTypeDefinition_t* typeDefinition;
+        PyObject* iterator;
+        PyObject* entry;
+        Py_ssize_t index = 0;
+        int complexValues;
+        if (!blpapi_Element_isArray(element)) {
+            return elementFromPyFailure(context, FROMPY_NOT_ARRAY, frame,
+                                        element, 0, NULL);
+        }
+        typeDefinition = blpapi_SchemaElementDefinition_type(
+                blpapi_Element_definition(element));
+        complexValues = blpapi_SchemaTypeDefinition_isComplexType(
+                typeDefinition);
+        iterator = PyObject_GetIter(value);
+        if (iterator == NULL) {
+            return -2;
+        }
+        while (result == 0 && (entry = PyIter_Next(iterator)) != NULL) {
+            result = elementEntryFromPy(context, frame, element,
+                                        complexValues, index++, entry);
+            Py_DECREF(entry);
+        }
+        Py_DECREF(iterator);
+        if (result == 0 && PyErr_Occurred()) {
+            result = -2;
+        }
+        return result;
+    }
+
+    if (value == Py_None) {
+        return 0;
+    }
+    if (blpapi_Element_isComplexType(element)
+            || blpapi_Element_isArray(element)) {
+        Py_INCREF(value);
+        return elementFromPyFailure(context, FROMPY_NOT_SCALAR, frame,
+                                    element, 0, value);
+    }
+    return elementSetValue(context, frame, element, value, 0, 0);
+}
+
+/* Appends the values of the iterable 'values' to the array 'element' as
+   'Element.appendValue' does for each of them, calling 'setValue(element,
+   value, index)' for the values of the types not set here. Returns the error
+   code of the first failed call, 0 if all the values are appended, or NULL
+   with a pending exception. */
+static PyObject* fast_blpapi_Element_appendValues(PyObject* self,
+                                                  PyObject* args) {
+    PyObject *elementObj, *values, *setValue, *iterator, *value;
+    void* element;
+    int retCode = 0;
+    if (!PyArg_ParseTuple(args, "OOO", &elementObj, &values, &setValue)
+            || handleFromPy(elementObj, &element)) {
+        return NULL;
+    }
+    iterator = PyObject_GetIter(values);
+    if (iterator == NULL) {
+        return NULL;
+    }
+    while (retCode == 0 && (value = PyIter_Next(iterator)) != NULL) {
+        retCode = elementSetScalar((blpapi_Element_t*) element,
+                                   value,
+                                   BLPAPI_ELEMENT_INDEX_END);
+        if (retCode == FROMPY_NOT_HANDLED) {
+            PyObject* result = PyObject_CallFunction(
+                    setValue, "OOn", elementObj, value,
+                    (Py_ssize_t) BLPAPI_ELEMENT_INDEX_END);
+            retCode = result == NULL ? -1 : 0;
+            Py_XDECREF(result);
+        }
+        Py_DECREF(value);
+    }
+    Py_DECREF(iterator);
+    if (retCode == -1 || PyErr_Occurred()) {
+        return NULL;
+    }
+    return PyLong_FromLong(retCode);
+}
+
+/* Formats the element 'handle' from 'value' as 'Element._fromPyHelper'.
+   Values of other types than those handled natively are set by calling
+   'setValue(elementHandle, value, index)'. Returns None on success, and
+   '(kind, elementHandle, path, isArrayEntry, detail)' describing the first
+   failure otherwise, 'detail' being the exception or '(retCode,
+   description)' of the error, or the value for a 'FROMPY_NOT_SCALAR'
+   failure.
+*/
+static PyObject* fast_blpapi_Element_fromPy(PyObject* self, PyObject* args) {
+    PyObject *elementObj, *value;
+    void* element;
+    FromPyContext context = { NULL, NULL, NULL, NULL };
+    FromPyFrame root = { NULL, NULL, NULL, -1 };
+    if (!PyArg_ParseTuple(args, "OOOO", &elementObj, &value,
+                          &context.getNamePair, &context.setValue)
+            || handleFromPy(elementObj, &element)) {
+        return NULL;
+    }
+    root.element = (const blpapi_Element_t*) element;
+    if (elementFromPy(&context, &root, (blpapi_Element_t*) element, value)
+            == -2) {
+        Py_XDECREF(context.failure);
+        return NULL;
+    }
+    if (context.failure == NULL) {
+        Py_RETURN_NONE; // inc ref and return
+    }
+    return context.failure;
+}
+
+/* Sets the element named by 'nameString' or 'name' at the current level of
+   'formatter' as 'EventFormatter.setElement' does, or appends the value if
+   'append' is set. Returns as 'elementSetScalar'. */
+static int formatterSetScalar(blpapi_EventFormatter_t* formatter,
+                              const char* nameString,
+                              const blpapi_Name_t* name,
+                              PyObject* value,
+                              int append) {
+    if (PyUnicode_Check(value)) {
+        PyObject* holder = PyUnicode_AsUTF8String(value);
+        int retCode;
+        if (holder == NULL) {
+            return -1;
+        }
+        retCode = append
+                ? blpapi_EventFormatter_appendValueString(
+                      formatter, PyBytes_AsString(holder))
+                : blpapi_EventFormatter_setValueString(
+                      formatter, nameString, name, PyBytes_AsString(holder));
+        Py_DECREF(holder);
+        return retCode;
+    }
+    if (PyBytes_Check(value)) {
+        // arrays of bytes are not supported, the python error is raised
+        return append ? FROMPY_NOT_HANDLED
+                      : blpapi_EventFormatter_setValueBytes(
+                            formatter, nameString, name,
+                            PyBytes_AsString(value),
+                            (size_t) PyBytes_Size(value));
+    }
+    if (PyBool_Check(value)) {
+        const blpapi_Bool_t boolValue = value == Py_True;
+        return append ? blpapi_EventFormatter_appendValueBool(formatter,
+                                                              boolValue)
+                      : blpapi_EventFormatter_setValueBool(
+                            formatter, nameString, name, boolValue);
+    }
+    if (PyLong_Check(value)) {
+        int overflow;
+        const long long intValue = PyLong_AsLongLongAndOverflow(value,
+                                                                &overflow);
+        if (overflow) {
+            return FROMPY_NOT_HANDLED;
+        }
+        if (intValue == -1 && PyErr_Occurred()) {
+            return -1;
+        }
+        if (intValue >= INT32_MIN && intValue <= INT32_MAX) {
+            return append ? blpapi_EventFormatter_appendValueInt32(
+                                formatter, (blpapi_Int32_t) intValue)
+                          : blpapi_EventFormatter_setValueInt32(
+                                formatter, nameString, name,
+                                (blpapi_Int32_t) intValue);
+        }
+        return append ? blpapi_EventFormatter_appendValueInt64(formatter,
+                                                               intValue)
+                      : blpapi_EventFormatter_setValueInt64(
+                            formatter, nameString, name, intValue);
+    }
+    if (PyFloat_Check(value)) {
+        const double floatValue = PyFloat_AsDouble(value);
+        // python floats are narrowed to 32 bits if the schema says so
+        int retCode = append
+                ? blpapi_EventFormatter_appendValueFloat64(formatter,
+                                                           floatValue)
+                : blpapi_EventFormatter_setValueFloat64(
+                      formatter, nameString, name, floatValue);
+        if (retCode) {
+            retCode = append
+                ? blpapi_EventFormatter_appendValueFloat32(
+                      formatter, (blpapi_Float32_t) floatValue)
+                : blpapi_EventFormatter_setValueFloat32(
+                      formatter, nameString, name,
+                      (blpapi_Float32_t) floatValue);
+        }
+        return retCode;
+    }
+    return FROMPY_NOT_HANDLED;
+}
+
+/* Records the failure of a call returning 'retCode', -1 meaning that a
+   python exception is pending. */
+static int formatterCallFailure(FromPyContext* context,
+                                int kind,
+                                const FromPyFrame* frame,
+                                PyObject* key,
+                                int retCode) {
+    PyObject* detail = retCode == -1 ? exceptionDetail()
+                                     : errorDetail(retCode);
+    if (detail == NULL) {
+        return -2;
+    }
+    return formatterFromPyFailure(context, kind, frame, key, detail);
+}
+
+static int formatterFromPy(FromPyContext* context,
+                           const FromPyFrame* frame,
+                           blpapi_EventFormatter_t* formatter,
+                           PyObject* key,
+                           PyObject* value);
+
+/* Calls 'function(formatter, nameString, name)' with the name of 'key', see
+   'nameOfKey' for 'anyKey'. Returns the result of the call, or -1 with a
+   pending exception. */
+static int formatterNameCall(
+        FromPyContext* context,
+        int (*function)(blpapi_EventFormatter_t*,
+                        const char*,
+                        const blpapi_Name_t*),
+        blpapi_EventFormatter_t* formatter,
+        PyObject* key,
+        int anyKey) {
+    const char* nameString;
+    void* name;
+    PyObject* holder;
+    PyObject* pair = nameOfKey(context, key, anyKey, &nameString, &name,
+                               &holder);
+    int retCode;
+    if (pair == NULL) {
+        return -1;
+    }
+    retCode = function(formatter, nameString, (const blpapi_Name_t*) name);
+    Py_XDECREF(holder);
+    Py_DECREF(pair);
+    return retCode;
+}
+
+/* Formats the item 'key' of a mapping at the current level. */
+static int formatterItemFromPy(FromPyContext* context,
+                               const FromPyFrame* frame,
+                               blpapi_EventFormatter_t* formatter,
+                               PyObject* key,
+                               PyObject* value) {
+    const FromPyFrame subFrame = { frame, NULL, key, -1 };
+    const int kind = classifyValue(value);
+    int retCode;
+    int isEmpty;
+    if (kind < 0) {
+        return -2;
+    }
+    if (kind != VALUE_KIND_MAPPING) {
+        return formatterFromPy(context, frame, formatter, key, value);
+    }
+    isEmpty = !PyObject_IsTrue(value);
+    if (isEmpty && PyErr_Occurred()) {
+        return -2;
+    }
+    if (isEmpty) {
+        retCode = formatterNameCall(context, blpapi_EventFormatter_setValueNull,
+                                    formatter, key, 0);
+        return retCode ? formatterCallFailure(context, FROMPY_ERROR, frame,
+                                              NULL, retCode)
+                       : 0;
+    }
+    retCode = formatterNameCall(context, blpapi_EventFormatter_pushElement,
+                                formatter, key, 0);
+    if (retCode) {
+        return formatterCallFailure(context, FROMPY_ERROR, frame, NULL,
+                                    retCode);
+    }
+    retCode = formatterFromPy(context, &subFrame, formatter, key, value);
+    if (retCode) {
+        return retCode;
+    }
+    retCode = blpapi_EventFormatter_popElement(formatter);
+    return retCode ? formatterCallFailure(context, FROMPY_RAISE, frame,
+                                          NULL, retCode)
+                   : 0;
+}
+
+/* Formats the entry 'index' of the array 'key' at the current level. */
+static int formatterEntryFromPy(FromPyContext* context,
+                                const FromPyFrame* frame,
+                                blpapi_EventFormatter_t* formatter,
+                                PyObject* key,
+                                Py_ssize_t index,
+                                PyObject* value) {
+    const FromPyFrame entryFrame = { frame, NULL, key, index };
+    const int kind = classifyValue(value);
+    int retCode;
+    if (kind < 0) {
+        return -2;
+    }
+    if (kind == VALUE_KIND_MAPPING) {
+        retCode = blpapi_EventFormatter_appendElement(formatter);
+        if (retCode) {
+            return formatterCallFailure(context, FROMPY_MAPPING_ENTRY,
+                                        &entryFrame, NULL, retCode);
+        }
+        retCode = formatterFromPy(context, &entryFrame, formatter, NULL,
+                                  value);
+        if (retCode) {
+            return retCode;
+        }
+        retCode = blpapi_EventFormatter_popElement(formatter);
+        return retCode ? formatterCallFailure(context, FROMPY_RAISE,
+                                              &entryFrame, NULL, retCode)
+                       : 0;
+    }
+    if (kind == VALUE_KIND_SEQUENCE) {
+        return formatterFromPyFailure(context, FROMPY_NESTED_SEQUENCE,
+                                      &entryFrame, NULL, NULL);
+    }
+    retCode = formatterSetScalar(formatter, NULL, NULL, value, 1);
+    if (retCode == FROMPY_NOT_HANDLED) {
+        PyObject* result = PyObject_CallFunctionObjArgs(context->appendValue,
+                                                        value, NULL);
+        retCode = result == NULL ? -1 : 0;
+        Py_XDECREF(result);
+    }
+    return retCode ? formatterCallFailure(context, FROMPY_ERROR,
+                                          &entryFrame, NULL, retCode)
+                   : 0;
+}
+
+/* Formats 'value' at the current level of 'formatter', 'key' naming the
+   element to format unless 'value' is a mapping, as
+   'EventFormatter._fromPyHelper' does. Returns as 'elementFromPy'. */
+static int formatterFromPy(FromPyContext* context,
+                           const FromPyFrame* frame,
+                           blpapi_EventFormatter_t* formatter,
+                           PyObject* key,
+                           PyObject* value) {
+    const int kind = classifyValue(value);
+    int result = 0;
+    if (kind < 0) {
+        return -2;
+    }
+
+    if (kind == VALUE_KIND_MAPPING) {
+        if (PyDict_Check(value)) {
+            Py_ssize_t position = 0;
+            PyObject *subKey, *subValue;
+            while (result == 0
+                    && PyDict_Next(value, &position, &subKey, &subValue)) {
+                result = formatterItemFromPy(context, frame, formatter,
+                                             subKey, subValue);
+            }
+        }
+        else {
+            PyObject* items = PyMapping_Items(value);
+            Py_ssize_t i;
+            if (items == NULL) {
+                return -2;
+            }
+            for (i = 0; result == 0 && i < PyList_Size(items); ++i) {
+                PyObject *subKey, *subValue;
+                if (!PyArg_ParseTuple(PyList_GetItem(items, i), "OO",
+                                      &subKey, &subValue)) {
+                    result = -2;
+                    break;
+                }
+                result = formatterItemFromPy(context, frame, formatter,
+                                             subKey, subValue);
+            }
+            Py_DECREF(items);
+        }
+        return result;
+    }
+
+    if (kind == VALUE_KIND_SEQUENCE) {
+        PyObject* iterator;
+        PyObject* entry;
+        Py_ssize_t index = 0;
+        int retCode = formatterNameCall(context,
+                                        blpapi_EventFormatter_pushElement,
+                                        formatter, key, 1);
+        if (retCode) {
+            return formatterCallFailure(context, FROMPY_ERROR, frame, NULL,
+                                        retCode);
+        }
+        iterator = PyObject_GetIter(value);
+        if (iterator == NULL) {
+            return -2;
+        }
+        while (result == 0 && (entry = PyIter_Next(iterator)) != NULL) {
+            result = formatterEntryFromPy(context, frame, formatter, key,
+                                          index++, entry);
+            Py_DECREF(entry);
+        }
+        Py_DECREF(iterator);
+        if (result == 0 && PyErr_Occurred()) {
+            return -2;
+        }
+        if (result) {
+            return result;
+        }
+        retCode = blpapi_EventFormatter_popElement(formatter);
+        return retCode ? formatterCallFailure(context, FROMPY_RAISE, frame,
+                                              NULL, retCode)
+                       : 0;
+    }
+
+    {
+        // scalar, the key is included in the path of some of the errors
+        int retCode;
+        if (value == Py_None) {
+            retCode = formatterNameCall(context,
+                                        blpapi_EventFormatter_setValueNull,
+                                        formatter, key, 1);
+        }
+        else {
+            const char* nameString;
+            void* name;
+            PyObject* holder;
+            PyObject* pair = nameOfKey(context, key, 1, &nameString, &name,
+                                       &holder);
+            if (pair == NULL) {
+                retCode = -1;
+            }
+            else {
+                retCode = formatterSetScalar(formatter, nameString,
+                                             (const blpapi_Name_t*) name,
+                                             value, 0);
+                Py_XDECREF(holder);
+                Py_DECREF(pair);
+            }
+            if (retCode == FROMPY_NOT_HANDLED) {
+                PyObject* result = PyObject_CallFunctionObjArgs(
+                        context->setValue, key, value, NULL);
+                retCode = result == NULL ? -1 : 0;
+                Py_XDECREF(result);
+            }
+        }
+        return retCode ? formatterCallFailure(context, FROMPY_ERROR, frame,
+                                              key, retCode)
+                       : 0;
+    }
+}
+
+/* Formats the current message of the event formatter 'handle' from the
+   mapping 'value' as 'EventFormatter._fromPyHelper'. Values of other types
+   than those handled natively are set by calling 'setElement(key, value)'
+   and 'appendValue(value)'. Returns None on success, and
+   '(kind, path, detail, key)' describing the first failure otherwise,
+   'detail' being the exception or '(retCode, description)' of the error,
+   and 'key' the name of the scalar element that failed, if any.
+*/
+static PyObject* fast_blpapi_EventFormatter_fromPy(PyObject* self,
+                                                   PyObject* args) {
+    PyObject *formatterObj, *value;
+    void* formatter;
+    FromPyContext context = { NULL, NULL, NULL, NULL };
+    const FromPyFrame root = { NULL, NULL, NULL, -1 };
+    if (!PyArg_ParseTuple(args, "OOOOO", &formatterObj, &value,
+                          &context.getNamePair, &context.setValue,
+                          &context.appendValue)
+            || handleFromPy(formatterObj, &formatter)) {
+        return NULL;
+    }
+    if (formatterFromPy(&context, &root, (blpapi_EventFormatter_t*) formatter,
+                        NULL, value) == -2) {
+        Py_XDECREF(context.failure);
+        return NULL;
+    }
+    if (context.failure == NULL) {
+        Py_RETURN_NONE; // inc ref and return
+    }
+    return context.failure;
+}
+
+/* Appends the values of the iterable 'values' at the current level of
+   'formatter' as 'EventFormatter.appendValue' does for each of them, calling
+   'appendValue(value)' for the values of the types not appended here.
+   Returns as 'blpapi_Element_appendValues'. */
+static PyObject* fast_blpapi_EventFormatter_appendValues(PyObject* self,
+                                                         PyObject* args) {
+    PyObject *formatterObj, *values, *appendValue, *iterator, *value;
+    void* formatter;
+    int retCode = 0;
+    if (!PyArg_ParseTuple(args, "OOO", &formatterObj, &values, &appendValue)
+            || handleFromPy(formatterObj, &formatter)) {
+        return NULL;
+    }
+    iterator = PyObject_GetIter(values);
+    if (iterator == NULL) {
+        return NULL;
+    }
+    while (retCode == 0 && (value = PyIter_Next(iterator)) != NULL) {
+        retCode = formatterSetScalar((blpapi_EventFormatter_t*) formatter,
+                                     NULL, NULL, value, 1);
+        if (retCode == FROMPY_NOT_HANDLED) {
+            PyObject* result = PyObject_CallFunctionObjArgs(appendValue,
+                                                            value, NULL);
+            retCode = result == NULL ? -1 : 0;
+            Py_XDECREF(result);
+        }
+        Py_DECREF(value);
+    }
+    Py_DECREF(iterator);
+    if (retCode == -1 || PyErr_Occurred()) {
+        return NULL;
+    }
+    return PyLong_FromLong(retCode);
+}
+
+/* Appends to 'formatter' the messages 'start' to 'stop' of a batch, each of
+   type 'messageType' and formatted as 'EventFormatter.fromPy' does. If
+   'fields' is 'None', 'values' is the sequence of the mappings of the
+   messages, otherwise 'values' is the sequence of the columns of the
+   'fields', in which 'None' values are not formatted. 'topics' is the
+   sequence of the handles of the topics of the messages. */
+static PyObject* fast_blpapi_EventFormatter_appendMessagesFromPy(
+        PyObject* self,
+        PyObject* args) {
+    PyObject *formatterObj, *nameStringObj, *nameObj, *topics, *values;
+    PyObject *fields, *holder = NULL;
+    PyObject** columns = NULL;
+    Py_ssize_t start, stop, row, numFields = 0, i;
+    void *formatter, *name;
+    const char* nameString;
+    FromPyContext context = { NULL, NULL, NULL, NULL };
+    const FromPyFrame root = { NULL, NULL, NULL, -1 };
+    int result = 0;
+    if (!PyArg_ParseTuple(args, "OOOOOOnnOOO", &formatterObj,
+                          &nameStringObj, &nameObj, &topics, &values,
+                          &fields, &start, &stop, &context.getNamePair,
+                          &context.setValue, &context.appendValue)
+            || handleFromPy(formatterObj, &formatter)
+            || handleFromPy(nameObj, &name)
+            || stringFromPy(nameStringObj, &nameString, &holder)) {
+        return NULL;
+    }
+    if (start < 0 || start > stop || PySequence_Size(topics) < stop) {
+        if (!PyErr_Occurred()) {
+            PyErr_SetString(PyExc_ValueError, "invalid range of messages");
+        }
+        goto error;
+    }
+    if (fields == Py_None) {
+        if (PySequence_Size(values) < stop) {
+            if (!PyErr_Occurred()) {
+                PyErr_SetString(PyExc_ValueError,
+                                "there must be a value per topic");
+            }
+            goto error;
+        }
+    }
+    else {
+        numFields = PySequence_Size(fields);
+        if (numFields < 0 || PySequence_Size(values) != numFields) {
+            if (!PyErr_Occurred()) {
+                PyErr_SetString(PyExc_ValueError,
+                                "there must be a column per field");
+            }
+            goto error;
+        }
+        columns = (PyObject**) PyMem_Calloc(numFields ? numFields : 1,
+                                            sizeof(PyObject*));
+        if (columns == NULL) {
+            PyErr_NoMemory();
+            goto error;
+        }
+        for (i = 0; i < numFields; ++i) {
+            columns[i] = PySequence_GetItem(values, i);
+            if (columns[i] == NULL) {
+                goto error;
+            }
+            if (PySequence_Size(columns[i]) < stop) {
+                if (!PyErr_Occurred()) {
+                    PyErr_SetString(PyExc_ValueError,
+                                    "there must be a value per topic in "
+                                    "each column");
+                }
+                goto error;
+            }
+        }
+    }
+
+    for (row = start; row < stop; ++row) {
+        PyObject* topicObj = PySequence_GetItem(topics, row);
+        void* topic;
+        int retCode;
+        if (topicObj == NULL) {
+            goto error;
+        }
+        retCode = handleFromPy(topicObj, &topic);
+        Py_DECREF(topicObj);
+        if (retCode) {
+            goto error;
+        }
+        retCode = blpapi_EventFormatter_appendMessage(
+                (blpapi_EventFormatter_t*) formatter,
+                nameString,
+                (blpapi_Name_t*) name,
+                (const blpapi_Topic_t*) topic);
+        if (retCode) {
+            result = formatterCallFailure(&context, FROMPY_RAISE, &root,
+                                          NULL, retCode);
+            break;
+        }
+        if (columns == NULL) {
+            PyObject* value = PySequence_GetItem(values, row);
+            if (value == NULL) {
+                goto error;
+            }
+            result = formatterFromPy(&context, &root,
+                                     (blpapi_EventFormatter_t*) formatter,
+                                     NULL, value);
+            Py_DECREF(value);
+        }
+        for (i = 0; i < numFields && result == 0; ++i) {
+            PyObject* key;
+            PyObject* value = PySequence_GetItem(columns[i], row);
+            if (value == NULL) {
+                goto error;
+            }
+            if (value != Py_None) {
+                key = PySequence_GetItem(fields, i);
+                result = key == NULL
+                             ? -2
+                             : formatterItemFromPy(
+                                     &context, &root,
+                                     (blpapi_EventFormatter_t*) formatter,
+                                     key, value);
+                Py_XDECREF(key);
+            }
+            Py_DECREF(value);
+        }
+        if (result) {
+            break;
+        }
+    }
+    if (result == -2) {
+        goto error;
+    }
+
+    for (i = 0; i < numFields; ++i) {
+        Py_DECREF(columns[i]);
+    }
+    PyMem_Free(columns);
+    Py_XDECREF(holder);
+    if (context.failure == NULL) {
+        Py_RETURN_NONE; // inc ref and return
+    }
+    return Py_BuildValue("(nN)", row, context.failure);
+
+error:
+    if (columns != NULL) {
+        for (i = 0; i < numFields; ++i) {
+            Py_XDECREF(columns[i]);
+        }
+        PyMem_Free(columns);
+    }
+    Py_XDECREF(holder);
+    Py_XDECREF(context.failure);
+    return NULL;
+}
+
+/* Adds to 'list' a subscription per topic of the sequence 'topics', 'None'
+   standing for an empty topic, whose subscription string is the topic
+   followed by 'suffix'. If 'correlationIds' is not 'None', it is the sequence
+   of the correlation ids of the subscriptions: 'None' for an unset one, an
+   'int' for an integer one, and any other value 'cid' is added by calling
+   'add(subscriptionString, cid)'. Returns the error code of the first
+   failed addition, 0 if all the subscriptions are added, or NULL with a
+   pending exception. */
+static PyObject* fast_blpapi_SubscriptionList_addMany(PyObject* self,
+                                                      PyObject* args) {
+    PyObject *listObj, *topics, *suffixObj, *correlationIds, *add;
+    PyObject *suffixHolder = NULL;
+    void* list;
+    const char* suffix;
+    char* buffer = NULL;
+    size_t bufferSize = 0, suffixLength;
+    Py_ssize_t numTopics, i;
+    int retCode = 0;
+    if (!PyArg_ParseTuple(args, "OOOOO", &listObj, &topics, &suffixObj,
+                          &correlationIds, &add)
+            || handleFromPy(listObj, &list)
+            || stringFromPy(suffixObj, &suffix, &suffixHolder)) {
+        return NULL;
+    }
+    suffix = suffix ? suffix : "";
+    suffixLength = strlen(suffix);
+    numTopics = PySequence_Size(topics);
+    if (numTopics < 0
+            || (correlationIds != Py_None
+                && PySequence_Size(correlationIds) != numTopics)) {
+        if (!PyErr_Occurred()) {
+            PyErr_SetString(PyExc_ValueError,
+                            "there must be a correlation id per topic");
+        }
+        goto error;
+    }
+
+    for (i = 0; i < numTopics && retCode == 0; ++i) {
+        PyObject *topicObj, *topicHolder, *cidObj = Py_None;
+        const char* topic;
+        size_t topicLength;
+        blpapi_CorrelationId_t correlationId;
+        topicObj = PySequence_GetItem(topics, i);
+        if (topicObj == NULL) {
+            goto error;
+        }
+        if (stringFromPy(topicObj, &topic, &topicHolder)) {
+            Py_DECREF(topicObj);
+            goto error;
+        }
+        topic = topic ? topic : "";
+        topicLength = strlen(topic);
+        if (topicLength + suffixLength + 1 > bufferSize) {
+            char* grown = (char*) PyMem_Realloc(
+                    buffer, topicLength + suffixLength + 1);
+            if (grown == NULL) {
+                Py_XDECREF(topicHolder);
+                Py_DECREF(topicObj);
+                PyErr_NoMemory();
+                goto error;
+            }
+            buffer = grown;
+            bufferSize = topicLength + suffixLength + 1;
+        }
+        memcpy(buffer, topic, topicLength);
+        memcpy(buffer + topicLength, suffix, suffixLength + 1);
+        Py_XDECREF(topicHolder);
+        Py_DECREF(topicObj);
+
+        if (correlationIds == Py_None) {
+            // released below as the items of 'correlationIds' are
+            Py_INCREF(cidObj);
+        }
+        else {
+            cidObj = PySequence_GetItem(correlationIds, i);
+            if (cidObj == NULL) {
+                goto error;
+            }
+        }
+        memset(&correlationId, 0, sizeof(correlationId));
+        correlationId.size = sizeof(correlationId);
+        if (cidObj == Py_None) {
+            correlationId.valueType = BLPAPI_CORRELATION_TYPE_UNSET;
+        }
+        else if (PyLong_Check(cidObj) && !PyBool_Check(cidObj)) {
+            correlationId.valueType = BLPAPI_CORRELATION_TYPE_INT;
+            correlationId.value.intValue = PyLong_AsUnsignedLongLong(cidObj);
+            if (PyErr_Occurred()) {
+                Py_DECREF(cidObj);
+                goto error;
+            }
+        }
+        else {
+            PyObject* result = PyObject_CallFunction(add, "sO", buffer,
+                                                     cidObj);
+            Py_DECREF(cidObj);
+            if (result == NULL) {
+                goto error;
+            }
+            retCode = (int) PyLong_AsLong(result);
+            Py_DECREF(result);
+            if (PyErr_Occurred()) {
+                goto error;
+            }
+            continue;
+        }
+        Py_DECREF(cidObj);
+        retCode = blpapi_SubscriptionList_add(
+                (blpapi_SubscriptionList_t*) list, buffer, &correlationId,
+                NULL, NULL, 0, 0);
+    }
+
+    PyMem_Free(buffer);
+    Py_XDECREF(suffixHolder);
+    return PyLong_FromLong(retCode);
+
+error:
+    PyMem_Free(buffer);
+    Py_XDECREF(suffixHolder);
+    return NULL;
+}
+
+/* Drains of the events of a 'blpapi_Session_t' or a 'blpapi_EventQueue_t'.
+   The first event is waited for without holding the GIL, then the events
+   already queued are collected without blocking again. A timeout event is
+   released and not returned, so the result is an empty list on timeout.
+*/
+typedef int (*TryNextEventFunction)(void* source, blpapi_Event_t** event);
+
+static int sessionTryNextEvent(void* source, blpapi_Event_t** event) {
+    return blpapi_Session_tryNextEvent((blpapi_Session_t*) source, event);
+}
+
+static int eventQueueTryNextEvent(void* source, blpapi_Event_t** event) {
+    return blpapi_EventQueue_tryNextEvent((blpapi_EventQueue_t*) source,
+                                          event);
+}
+
+/* The number of events the array of a drain is first allocated for */
+#define DRAIN_INITIAL_CAPACITY 16
+
+/* Collects into '*events', which has room for '*capacity' events, the
+   non-timeout 'first' event followed by up to 'maxEvents - 1' of the events
+   already queued in 'source', growing '*events' with 'realloc' as needed.
+   If it cannot be grown, the events left are not collected.
+   Returns the number of events collected. Called without the GIL. */
+static int collectEvents(blpapi_Event_t* first,
+                         void* source,
+                         TryNextEventFunction tryNextEvent,
+                         blpapi_Event_t*** events,
+                         int* capacity,
+                         int maxEvents) {
+    int numEvents = 0;
+    if (first == NULL) {
+        return 0;
+    }
+    if (blpapi_Event_eventType(first) == BLPAPI_EVENTTYPE_TIMEOUT) {
+        blpapi_Event_release(first);
+        return 0;
+    }
+    (*events)[numEvents++] = first;
+    while (numEvents < maxEvents) {
+        if (numEvents == *capacity) {
+            const int newCapacity = *capacity > maxEvents / 2
+                                        ? maxEvents
+                                        : 2 * *capacity;
+            blpapi_Event_t** grown = (blpapi_Event_t**) realloc(
+                    *events, (size_t) newCapacity * sizeof(blpapi_Event_t*));
+            if (grown == NULL) {
+                break;
+            }
+            *events = grown;
+            *capacity = newCapacity;
+        }
+        if (tryNextEvent(source, &(*events)[numEvents]) != 0) {
+            break;
+        }
+        ++numEvents;
+    }
+    return numEvents;
+}
+
+/* Returns a new list of handles of the specified 'events', releasing all
+   of them on error since none is owned by an 'Event' yet. */
+static PyObject* eventsToPy(blpapi_Event_t** events, int numEvents) {
+    PyObject *list, *handle;
+    int i;
+    list = PyList_New(numEvents);
+    if (list == NULL) {
+        goto ERROR;
+    }
+    for (i = 0; i < numEvents; ++i) {
+        handle = handleToPy(events[i]);
+        if (handle == NULL || PyList_SetItem(list, i, handle)) { // steals ref
+            goto ERROR;
+        }
+    }
+    return list;
+
+ERROR:
+    for (i = 0; i < numEvents; ++i) {
+        blpapi_Event_release(events[i]);
+    }
+    Py_XDECREF(list);
+    return NULL;
+}
+
+/* Parses the '(source, maxEvents, timeout)' arguments of a drain and
+   allocates '*events' for the first 'DRAIN_INITIAL_CAPACITY' events at
+   most, leaving 'collectEvents' to grow it as events are available. */
+static int parseDrainArgs(PyObject* args,
+                          void** source,
+                          int* maxEvents,
+                          int* timeout,
+                          blpapi_Event_t*** events,
+                          int* capacity) {
+    PyObject* sourceObj;
+    if (!PyArg_ParseTuple(args, "Oii", &sourceObj, maxEvents, timeout)
+            || handleFromPy(sourceObj, source)) {
+        return -1;
+    }
+    if (*maxEvents < 1) {
+        PyErr_SetString(PyExc_ValueError, "maxEvents must be positive");
+        return -1;
+    }
+    *capacity = *maxEvents < DRAIN_INITIAL_CAPACITY ? *maxEvents
+                                                    : DRAIN_INITIAL_CAPACITY;
+    *events = (blpapi_Event_t**) malloc(
+            (size_t) *capacity * sizeof(blpapi_Event_t*));
+    if (*events == NULL) {
+        PyErr_NoMemory();
+        return -1;
+    }
+    return 0;
+}
+
+/* Returns '(retCode, [handle, ...])' like a 'blpapi_Session_nextEvent'
+   followed by up to 'maxEvents - 1' 'blpapi_Session_tryNextEvent's. */
+static PyObject* fast_blpapi_Session_drainEvents(PyObject* self,
+                                                 PyObject* args) {
+    void* session;
+    int maxEvents, timeout, capacity, retCode, numEvents = 0;
+    blpapi_Event_t *first = NULL, **events;
+    PyObject* result;
+    if (parseDrainArgs(
+                args, &session, &maxEvents, &timeout, &events, &capacity)) {
+        return NULL;
+    }
+    Py_BEGIN_ALLOW_THREADS
+    retCode = blpapi_Session_nextEvent(
+            (blpapi_Session_t*) session, &first, (unsigned int) timeout);
+    if (retCode == 0) {
+        numEvents = collectEvents(first,
+                                  session,
+                                  sessionTryNextEvent,
+                                  &events,
+                                  &capacity,
+                                  maxEvents);
+    }
+    Py_END_ALLOW_THREADS
+    result = resultToPy(retCode, eventsToPy(events, numEvents));
+    free(events);
+    return result;
+}
+
+/* Returns '[handle, ...]' like a 'blpapi_EventQueue_nextEvent' followed by
+   up to 'maxEvents - 1' 'blpapi_EventQueue_tryNextEvent's. */
+static PyObject* fast_blpapi_EventQueue_drainEvents(PyObject* self,
+                                                    PyObject* args) {
+    void* eventQueue;
+    int maxEvents, timeout, capacity, numEvents;
+    blpapi_Event_t **events;
+    PyObject* result;
+    if (parseDrainArgs(args,
+                       &eventQueue,
+                       &maxEvents,
+                       &timeout,
+                       &events,
+                       &capacity)) {
+        return NULL;
+    }
+    Py_BEGIN_ALLOW_THREADS
+    numEvents = collectEvents(
+            blpapi_EventQueue_nextEvent(
+                    (blpapi_EventQueue_t*) eventQueue, timeout),
+            eventQueue,
+            eventQueueTryNextEvent,
+            &events,
+            &capacity,
+            maxEvents);
+    Py_END_ALLOW_THREADS
+    result = eventsToPy(events, numEvents);
+    free(events);
+    return result;
+}
+
+/* Tables of the handlers registered by integer correlation id, which
+   'blpapi_Event_route' looks up from the 'blpapi_CorrelationId_t' of each
+   message, without building a 'CorrelationId' or even an 'int' for it.
+   They are open addressing hash tables with linear probing, kept at most
+   half full. */
+typedef struct {
+    unsigned long long key;
+    PyObject* value;    // the handler, NULL for an empty slot
+} CorrelationIdTableSlot;
+
+typedef struct {
+    CorrelationIdTableSlot* slots;
+    size_t capacity;    // 0 or a power of 2
+    size_t size;
+#ifdef Py_GIL_DISABLED
+    PyMutex mutex;      // guards the slots
+#endif
+} CorrelationIdTable;
+
+static const char* const correlationIdTableCapsuleName =
+    "blpapi.ffiutils.CorrelationIdTable";
+
+static size_t correlationIdHash(unsigned long long key) {
+    // finalizer of 'splitmix64', consecutive ids are spread over the slots
+    key ^= key >> 30;
+    key *= 0xbf58476d1ce4e5b9ULL;
+    key ^= key >> 27;
+    key *= 0x94d049bb133111ebULL;
+    key ^= key >> 31;
+    return (size_t) key;
+}
+
+/* Returns the slot of 'key' in 'table', or the empty slot where it would
+   be inserted. 'table' must have a free slot. */
+static CorrelationIdTableSlot* correlationIdTableFind(
+        const CorrelationIdTable* table,
+        unsigned long long key) {
+    size_t mask = table->capacity - 1;
+    size_t index = correlationIdHash(key) & mask;
+    while (table->slots[index].value != NULL
+            && table->slots[index].key != key) {
+        index = (index + 1) & mask;
+    }
+    return &table->slots[index];
+}
+
+/* Returns a new reference to the handler of 'key', or NULL if there is
+   none. Does not set an exception. */
+static PyObject* correlationIdTableGet(CorrelationIdTable* table,
+                                       unsigned long long key) {
+    PyObject* value = NULL;
+    FFIUTILS_LOCK(table->mutex);
+    if (table->size != 0) {
+        value = correlationIdTableFind(table, key)->value;
+        Py_XINCREF(value);
+    }
+    FFIUTILS_UNLOCK(table->mutex);
+    return value;
+}
+
+/* Doubles the capacity of 'table'. Returns 0 on success, -1 if the memory
+   cannot be allocated. Called with the mutex held. */
+static int correlationIdTableGrow(CorrelationIdTable* table) {
+    CorrelationIdTableSlot* slots = table->slots;
+    size_t capacity = table->capacity;
+    size_t i;
+    table->capacity = capacity ? capacity * 2 : 16;
+    table->slots = (CorrelationIdTableSlot*)
+        PyMem_Calloc(table->capacity, sizeof(*slots));
+    if (table->slots == NULL) {
+        table->slots = slots;
+        table->capacity = capacity;
+        return -1;
+    }
+    for (i = 0; i < capacity; ++i) {
+        if (slots[i].value != NULL) {
+            *correlationIdTableFind(table, slots[i].key) = slots[i];
+        }
+    }
+    PyMem_Free(slots);
+    return 0;
+}
+
+/* Removes 'key' from 'table', shifting back the slots that follow it so
+   that no probe sequence is broken. Returns the reference to the handler
+   that was held by the table, or NULL if there was none. Called with the
+   mutex held. */
+static PyObject* correlationIdTableTake(CorrelationIdTable* table,
+                                        unsigned long long key) {
+    CorrelationIdTableSlot* slot;
+    PyObject* value;
+    size_t mask, hole, next, home;
+    if (table->size == 0) {
+        return NULL;
+    }
+    slot = correlationIdTableFind(table, key);
+    value = slot->value;
+    if (value == NULL) {
+        return NULL;
+    }
+    mask = table->capacity - 1;
+    hole = (size_t) (slot - table->slots);
+    next = hole;
+    for (;;) {
+        next = (next + 1) & mask;
+        if (table->slots[next].value == NULL) {
+            break;
+        }
+        home = correlationIdHash(table->slots[next].key) & mask;
+        // the slot stays if its home is cyclically in '(hole, next]'
+        if (hole <= next ? (hole < home && home <= next)
+                         : (hole < home || home <= next)) {
+            continue;
+        }
+        table->slots[hole] = table->slots[next];
+        hole = next;
+    }
+    table->slots[hole].value = NULL;
+    --table->size;
+    return value;
+}
+
+static void destroyCorrelationIdTable(PyObject* capsule) {
+    CorrelationIdTable* table = (CorrelationIdTable*)
+        PyCapsule_GetPointer(capsule, correlationIdTableCapsuleName);
+    size_t i;
+    if (table == NULL) {
+        return;
+    }
+    for (i = 0; i < table->capacity; ++i) {
+        Py_XDECREF(table->slots[i].value);
+    }
+    PyMem_Free(table->slots);
+    PyMem_Free(table);
+}
+
+static CorrelationIdTable* correlationIdTableFromPy(PyObject* capsule) {
+    return (CorrelationIdTable*)
+        PyCapsule_GetPointer(capsule, correlationIdTableCapsuleName);
+}
+
+/* Returns a capsule owning a new, empty 'CorrelationIdTable'. */
+static PyObject* fast_CorrelationIdTable_create(PyObject* self,
+                                                PyObject* args) {
+    PyObject* capsule;
+    CorrelationIdTable* table;
+    if (!PyArg_ParseTuple(args, "")) {
+        return NULL;
+    }
+    table = (CorrelationIdTable*) PyMem_Calloc(1, sizeof(*table));
+    if (table == NULL) {
+        return PyErr_NoMemory();
+    }
+    capsule = PyCapsule_New(
+            table, correlationIdTableCapsuleName, destroyCorrelationIdTable);
+    if (capsule == NULL) {
+        PyMem_Free(table);
+    }
+    return capsule;
+}
+
+/* Returns the handler of the correlation id, or 'None'. */
+static PyObject* fast_CorrelationIdTable_get(PyObject* self,
+                                             PyObject* args) {
+    PyObject* capsule;
+    CorrelationIdTable* table;
+    unsigned long long key;
+    PyObject* value;
+    if (!PyArg_ParseTuple(args, "OK", &capsule, &key)
+            || (table = correlationIdTableFromPy(capsule)) == NULL) {
+        return NULL;
+    }
+    value = correlationIdTableGet(table, key);
+    if (value == NULL) {
+        Py_RETURN_NONE; // inc ref and return
+    }
+    return value;
+}
+
+/* Removes the handler of the correlation id, returns whether there was
+   one. */
+static PyObject* fast_CorrelationIdTable_remove(PyObject* self,
+                                                PyObject* args) {
+    PyObject* capsule;
+    CorrelationIdTable* table;
+    unsigned long long key;
+    PyObject* value;
+    if (!PyArg_ParseTuple(args, "OK", &capsule, &key)
+            || (table = correlationIdTableFromPy(capsule)) == NULL) {
+        return NULL;
+    }
+    FFIUTILS_LOCK(table->mutex);
+    value = correlationIdTableTake(table, key);
+    FFIUTILS_UNLOCK(table->mutex);
+    if (value == NULL) {
+        Py_RETURN_FALSE; // inc ref and return
+    }
+    // released without the mutex, as it may run arbitrary code
+    Py_DECREF(value);
+    Py_RETURN_TRUE; // inc ref and return
+}
+
+/* Sets the handler of the correlation id, replacing any previous one. */
+static PyObject* fast_CorrelationIdTable_set(PyObject* self,
+                                             PyObject* args) {
+    PyObject *capsule, *handler;
+    CorrelationIdTable* table;
+    CorrelationIdTableSlot* slot;
+    unsigned long long key;
+    PyObject* previous = NULL;
+    if (!PyArg_ParseTuple(args, "OKO", &capsule, &key, &handler)
+            || (table = correlationIdTableFromPy(capsule)) == NULL) {
+        return NULL;
+    }
+    FFIUTILS_LOCK(table->mutex);
+    if ((table->size + 1) * 2 > table->capacity
+            && correlationIdTableGrow(table)) {
+        FFIUTILS_UNLOCK(table->mutex);
+        return PyErr_NoMemory();
+    }
+    slot = correlationIdTableFind(table, key);
+    if (slot->value == NULL) {
+        slot->key = key;
+        ++table->size;
+    }
+    previous = slot->value;
+    Py_INCREF(handler);
+    slot->value = handler;
+    FFIUTILS_UNLOCK(table->mutex);
+    Py_XDECREF(previous);
+    Py_RETURN_NONE; // inc ref and return
+}
+
+static PyObject* fast_CorrelationIdTable_size(PyObject* self,
+                                              PyObject* args) {
+    PyObject* capsule;
+    CorrelationIdTable* table;
+    size_t size;
+    if (!PyArg_ParseTuple(args, "O", &capsule)
+            || (table = correlationIdTableFromPy(capsule)) == NULL) {
+        return NULL;
+    }
+    FFIUTILS_LOCK(table->mutex);
+    size = table->size;
+    FFIUTILS_UNLOCK(table->mutex);
+    return PyLong_FromSize_t(size);
+}
+
+/* Calls 'handler(message)' for each message of 'event' and each of its
+   integer correlation ids that has a handler in 'table', and
+   'default(message)' for the messages without any, unless 'default' is
+   'None'. The messages are created as 'messageType(handle, eventObj)', only
+   for those given to a handler. Returns 'None', or NULL with the exception
+   raised by a handler. */
+static PyObject* fast_blpapi_Event_route(PyObject* self, PyObject* args) {
+    PyObject *capsule, *eventHandleObj, *messageType, *eventObj, *defaultObj;
+    PyObject *handler, *messageObj, *handle, *result;
+    CorrelationIdTable* table;
+    void* event;
+    blpapi_MessageIterator_t* iterator;
+    blpapi_Message_t* message;
+    blpapi_CorrelationId_t correlationId;
+    int numCorrelationIds, i, routed;
+    if (!PyArg_ParseTuple(args, "OOOOO", &capsule, &eventHandleObj,
+                          &messageType, &eventObj, &defaultObj)
+            || (table = correlationIdTableFromPy(capsule)) == NULL
+            || handleFromPy(eventHandleObj, &event)) {
+        return NULL;
+    }
+    iterator = blpapi_MessageIterator_create((blpapi_Event_t*) event);
+    if (iterator == NULL) {
+        PyErr_SetString(PyExc_Exception, "Cannot iterate the event");
+        return NULL;
+    }
+    while (blpapi_MessageIterator_next(iterator, &message) == 0) {
+        messageObj = NULL;
+        routed = 0;
+        numCorrelationIds = blpapi_Message_numCorrelationIds(message);
+        for (i = 0; i < numCorrelationIds; ++i) {
+            // the returned struct is a shallow copy, we do not own a
+            // reference
+            correlationId = blpapi_Message_correlationId(message, i);
+            // the generated ids are not routed, their values may be those
+            // of integer ones
+            if (correlationId.valueType != BLPAPI_CORRELATION_TYPE_INT) {
+                continue;
+            }
+            handler = correlationIdTableGet(table,
+                                            correlationId.value.intValue);
+            if (handler == NULL) {
+                continue;
+            }
+            routed = 1;
+            if (messageObj == NULL) {
+                handle = handleToPy(message);
+                messageObj = handle == NULL ? NULL
+                    : PyObject_CallFunctionObjArgs(
+                            messageType, handle, eventObj, NULL);
+                Py_XDECREF(handle);
+            }
+            result = messageObj == NULL ? NULL
+                : PyObject_CallFunctionObjArgs(handler, messageObj, NULL);
+            Py_DECREF(handler);
+            if (result == NULL) {
+                goto ERROR;
+            }
+            Py_DECREF(result);
+        }
+        if (!routed && defaultObj != Py_None) {
+            handle = handleToPy(message);
+            messageObj = handle == NULL ? NULL
+                : PyObject_CallFunctionObjArgs(
+                        messageType, handle, eventObj, NULL);
+            Py_XDECREF(handle);
+            result = messageObj == NULL ? NULL
+                : PyObject_CallFunctionObjArgs(defaultObj, messageObj, NULL);
+            if (result == NULL) {
+                goto ERROR;
+            }
+            Py_DECREF(result);
+        }
+        Py_XDECREF(messageObj);
+    }
+    blpapi_MessageIterator_destroy(iterator);
+    Py_RETURN_NONE; // inc ref and return
+
+ERROR:
+    Py_XDECREF(messageObj);
+    blpapi_MessageIterator_destroy(iterator);
+    return NULL;
+}
+
+/* Returns the values of the correlation ids of 'message', as 'int's for
+   the integer and generated ones, 'None' for the others. */
+static PyObject* fast_blpapi_Message_correlationIdInts(PyObject* self,
+                                                       PyObject* args) {
+    PyObject *messageObj, *pyList, *pyValue;
+    void* message;
+    blpapi_CorrelationId_t correlationId;
+    int numCorrelationIds, i;
+    if (!PyArg_ParseTuple(args, "O", &messageObj)
+            || handleFromPy(messageObj, &message)) {
+        return NULL;
+    }
+    numCorrelationIds = blpapi_Message_numCorrelationIds(
+            (blpapi_Message_t*) message);
+    pyList = PyList_New(numCorrelationIds);
+    if (pyList == NULL) {
+        return NULL;
+    }
+    for (i = 0; i < numCorrelationIds; ++i) {
+        correlationId = blpapi_Message_correlationId(
+                (blpapi_Message_t*) message, i);
+        if (correlationId.valueType == BLPAPI_CORRELATION_TYPE_INT
+                || correlationId.valueType
+                                     == BLPAPI_CORRELATION_TYPE_AUTOGEN) {
+            pyValue = PyLong_FromUnsignedLongLong(
+                    correlationId.value.intValue);
+            if (pyValue == NULL) {
+                Py_DECREF(pyList);
+                return NULL;
+            }
+        }
+        else {
+            Py_INCREF(Py_None);
+            pyValue = Py_None;
+        }
+        // steals ref to value
+        PyList_SetItem(pyList, i, pyValue);
+    }
+    return pyList;
+}
+
+/* Last value caches of subscription data. A 'LastValueCache' holds, per
+   integer correlation id, the last value of each scalar field of the
+   messages of that correlation id, the fields of successive messages being
+   merged. A recap, whose first fragment clears the fields of its
+   correlation id, replaces them. The fields updated since the last poll
+   are flagged, and the entries updated since then are listed in the order
+   of their first update, so that polling only visits them.
+
+   Merging does not call into python: the events of a session created with
+   a cache are merged on its dispatcher threads without taking the GIL,
+   however fast they arrive, and the memory used only grows with the number
+   of correlation ids and fields. The cache is guarded by its own lock,
+   which is never held while waiting for the GIL.
+*/
+typedef struct {
+    DecodedValue value;   // a scalar or DECODED_NULL, 'name' being set; the
+                          // data of strings and bytes is in 'buffer'
+    char* buffer;
+    size_t bufferSize;
+    int changed;          // whether updated since the last poll
+} CachedField;
+
+typedef struct {
+    unsigned long long key;
+    CachedField* fields;
+    size_t numFields;
+    size_t capacity;      // the fields past 'numFields' keep their buffers
+    int present;          // whether updated since created or removed
+    int queued;           // whether in 'changed'
+} CachedEntry;
+
+typedef struct {
+    CachedEntry** entries; // by key, open addressing, NULL for empty slots
+    size_t capacity;       // 0 or a power of 2
+    size_t numEntries;     // allocated entries, never freed before the cache
+    size_t numPresent;
+    CachedEntry** changed; // entries updated since the last poll
+    size_t numChanged;
+    DecodedEvent scratch;  // top-level fields of the message being merged
+    const char* error;     // set if merging failed since the last poll
+    PyThread_type_lock lock;
+} LastValueCache;
+
+static const char* const lastValueCacheCapsuleName =
+    "blpapi.ffiutils.LastValueCache";
+
+/* Returns the slot of 'key' in 'cache->entries', or the empty slot where
+   it would be inserted. There must be a free slot. */
+static CachedEntry** lastValueCacheFind(const LastValueCache* cache,
+                                        unsigned long long key) {
+    size_t mask = cache->capacity - 1;
+    size_t index = correlationIdHash(key) & mask;
+    while (cache->entries[index] != NULL
+            && cache->entries[index]->key != key) {
+        index = (index + 1) & mask;
+    }
+    return &cache->entries[index];
+}
+
+/* Returns the entry of 'key', created if needed, or NULL if it cannot be
+   allocated. Called with the lock held. */
+static CachedEntry* lastValueCacheEntry(LastValueCache* cache,
+                                        unsigned long long key) {
+    CachedEntry** slot;
+    size_t i;
+    if ((cache->numEntries + 1) * 2 > cache->capacity) {
+        CachedEntry** entries = cache->entries;
+        CachedEntry** changed;
+        size_t capacity = cache->capacity;
+        size_t newCapacity = capacity ? capacity * 2 : 16;
+        // 'changed' lists at most every entry
+        changed = (CachedEntry**) realloc(cache->changed,
+                                          newCapacity * sizeof(*changed));
+        if (changed == NULL) {
+            return NULL;
+        }
+        cache->changed = changed;
+        cache->entries = (CachedEntry**)
+            calloc(newCapacity, sizeof(*entries));
+        if (cache->entries == NULL) {
+            cache->entries = entries;
+            return NULL;
+        }
+        cache->capacity = newCapacity;
+        for (i = 0; i < capacity; ++i) {
+            if (entries[i] != NULL) {
+                *lastValueCacheFind(cache, entries[i]->key) = entries[i];
+            }
+        }
+        free(entries);
+    }
+    slot = lastValueCacheFind(cache, key);
+    if (*slot == NULL) {
+        *slot = (CachedEntry*) calloc(1, sizeof(CachedEntry));
+        if (*slot == NULL) {
+            return NULL;
+        }
+        (*slot)->key = key;
+        ++cache->numEntries;
+    }
+    return *slot;
+}
+
+/* Returns the entry of 'key' if it is present, NULL otherwise. Called with
+   the lock held. */
+static CachedEntry* lastValueCacheGet(const LastValueCache* cache,
+                                      unsigned long long key) {
+    CachedEntry* entry;
+    if (cache->capacity == 0) {
+        return NULL;
+    }
+    entry = *lastValueCacheFind(cache, key);
+    return entry != NULL && entry->present ? entry : NULL;
+}
+
+/* Sets the field of 'entry' named as 'value' to 'value'. Returns 0 on
+   success, -1 if it cannot be allocated. Called with the lock held. */
+static int cachedEntrySet(CachedEntry* entry, const DecodedValue* value) {
+    CachedField* field = NULL;
+    size_t i, length;
+    for (i = 0; i < entry->numFields; ++i) {
+        if (entry->fields[i].value.name == value->name) {
+            field = &entry->fields[i];
+            break;
+        }
+    }
+    if (field == NULL) {
+        if (entry->numFields == entry->capacity) {
+            size_t capacity = entry->capacity ? entry->capacity * 2 : 8;
+            CachedField* fields = (CachedField*) realloc(
+                    entry->fields, capacity * sizeof(*fields));
+            if (fields == NULL) {
+                return -1;
+            }
+            memset(fields + entry->capacity,
+                   0,
+                   (capacity - entry->capacity) * sizeof(*fields));
+            entry->fields = fields;
+            entry->capacity = capacity;
+        }
+        field = &entry->fields[entry->numFields++];
+    }
+    if (value->kind == DECODED_STRING || value->kind == DECODED_BYTES) {
+        length = value->value.bytesValue.length;
+        if (length > field->bufferSize || field->buffer == NULL) {
+            char* buffer = (char*) realloc(field->buffer, length + 1);
+            if (buffer == NULL) {
+                return -1;
+            }
+            field->buffer = buffer;
+            field->bufferSize = length;
+        }
+        memcpy(field->buffer, value->value.bytesValue.data, length);
+        field->value = *value;
+        field->value.value.bytesValue.data = field->buffer;
+    }
+    else {
+        field->value = *value;
+    }
+    field->changed = 1;
+    return 0;
+}
+
+/* Decodes the top-level scalar fields of 'message' into 'cache->scratch'
+   and merges them into the entry of each of its integer correlation ids.
+   The fields which are complex or arrays are not cached. Returns 0 on
+   success, -1 with 'cache->error' set otherwise. Called with the lock
+   held, does not need the GIL. */
+static int lastValueCacheMerge(LastValueCache* cache,
+                               blpapi_Message_t* message) {
+    DecodedEvent* scratch = &cache->scratch;
+    blpapi_Element_t* elements = blpapi_Message_elements(message);
+    blpapi_Element_t* element;
+    blpapi_CorrelationId_t correlationId;
+    CachedEntry* entry;
+    const int isRecap = blpapi_Message_recapType(message)
+                                         != BLPAPI_MESSAGE_RECAPTYPE_NONE;
+    const int fragmentType = blpapi_Message_fragmentType(message);
+    const int numCorrelationIds = blpapi_Message_numCorrelationIds(message);
+    size_t numElements, i, j;
+    int c;
+
+    scratch->numValues = 0;
+    scratch->error = NULL;
+    numElements = elements ? blpapi_Element_numElements(elements) : 0;
+    for (i = 0; i < numElements; ++i) {
+        if (0 != blpapi_Element_getElementAt(elements, &element, i)) {
+            scratch->error = "Internal error merging a Message";
+            break;
+        }
+        if (blpapi_Element_isComplexType(element)
+                || blpapi_Element_isArray(element)) {
+            continue;
+        }
+        if (blpapi_Element_isNull(element)) {
+            if (appendDecodedValue(scratch,
+                                   DECODED_NULL,
+                                   blpapi_Element_name(element))
+                    == (size_t) -1) {
+                break;
+            }
+        }
+        else if (decodeScalar(scratch,
+                              element,
+                              0,
+                              blpapi_Element_name(element))) {
+            break;
+        }
+    }
+    if (scratch->error != NULL) {
+        cache->error = scratch->error;
+        return -1;
+    }
+
+    for (c = 0; c < numCorrelationIds; ++c) {
+        // the returned struct is a shallow copy, we do not own a reference
+        correlationId = blpapi_Message_correlationId(message, c);
+        // as when routing, the generated ids are not cached
+        if (correlationId.valueType != BLPAPI_CORRELATION_TYPE_INT) {
+            continue;
+        }
+        entry = lastValueCacheEntry(cache, correlationId.value.intValue);
+        if (entry == NULL) {
+            cache->error = "Out of memory merging a Message";
+            return -1;
+        }
+        if (isRecap && (fragmentType == BLPAPI_MESSAGE_FRAGMENT_NONE
+                        || fragmentType == BLPAPI_MESSAGE_FRAGMENT_START)) {
+            entry->numFields = 0;
+        }
+        for (j = 0; j < scratch->numValues; ++j) {
+            if (cachedEntrySet(entry, &scratch->values[j])) {
+                cache->error = "Out of memory merging a Message";
+                return -1;
+            }
+        }
+        if (!entry->present) {
+            entry->present = 1;
+            ++cache->numPresent;
+        }
+        if (!entry->queued) {
+            entry->queued = 1;
+            cache->changed[cache->numChanged++] = entry;
+        }
+    }
+    return 0;
+}
+
+/* Merges the messages of 'event'. Does not call into python, and must be
+   called without holding the GIL, or with it released around the call. */
+static void lastValueCacheUpdate(LastValueCache* cache,
+                                 blpapi_Event_t* event) {
+    blpapi_MessageIterator_t* iterator;
+    blpapi_Message_t* message = NULL;
+    iterator = blpapi_MessageIterator_create(event);
+    PyThread_acquire_lock(cache->lock, WAIT_LOCK);
+    if (iterator == NULL) {
+        cache->error = "Internal error in blpapi_MessageIterator_create";
+    }
+    else {
+        while (0 == blpapi_MessageIterator_next(iterator, &message)) {
+            if (lastValueCacheMerge(cache, message)) {
+                break;
+            }
+        }
+        blpapi_MessageIterator_destroy(iterator);
+    }
+    PyThread_release_lock(cache->lock);
+}
+
+/* Acquires the lock of 'cache', releasing the GIL while waiting for it. */
+static void lastValueCacheLock(LastValueCache* cache) {
+    if (!PyThread_acquire_lock(cache->lock, NOWAIT_LOCK)) {
+        Py_BEGIN_ALLOW_THREADS
+        PyThread_acquire_lock(cache->lock, WAIT_LOCK);
+        Py_END_ALLOW_THREADS
+    }
+}
+
+/* Returns a new dict of the fields of 'entry', only of those updated since
+   the last poll if 'changedOnly', or NULL with an error set. Called with
+   the lock and the GIL held. */
+static PyObject* cachedEntryToPy(const CachedEntry* entry,
+                                 int changedOnly,
+                                 int flags) {
+    PyObject *pyDict = PyDict_New(), *key, *pyValue;
+    size_t i;
+    if (pyDict == NULL) {
+        return NULL;
+    }
+    for (i = 0; i < entry->numFields; ++i) {
+        const CachedField* field = &entry->fields[i];
+        if (changedOnly && !field->changed) {
+            continue;
+        }
+        // borrowed reference owned by the cache
+        key = nameToPyKey(field->value.name);
+        pyValue = key ? decodedValueToPy(&field->value, flags) : NULL;
+        // does not steal refs to key and value
+        if (pyValue == NULL || PyDict_SetItem(pyDict, key, pyValue)) {
+            Py_XDECREF(pyValue);
+            Py_DECREF(pyDict);
+            return NULL;
+        }
+        Py_DECREF(pyValue);
+    }
+    return pyDict;
+}
+
+static void destroyLastValueCache(PyObject* capsule) {
+    LastValueCache* cache = (LastValueCache*)
+        PyCapsule_GetPointer(capsule, lastValueCacheCapsuleName);
+    size_t i, j;
+    if (cache == NULL) {
+        return;
+    }
+    for (i = 0; i < cache->capacity; ++i) {
+        CachedEntry* entry = cache->entries[i];
+        if (entry == NULL) {
+            continue;
+        }
+        for (j = 0; j < entry->capacity; ++j) {
+            free(entry->fields[j].buffer);
+        }
+        free(entry->fields);
+        free(entry);
+    }
+    free(cache->entries);
+    free(cache->changed);
+    free(cache->scratch.values);
+    PyThread_free_lock(cache->lock);
+    PyMem_Free(cache);
+}
+
+static LastValueCache* lastValueCacheFromPy(PyObject* capsule) {
+    return (LastValueCache*)
+        PyCapsule_GetPointer(capsule, lastValueCacheCapsuleName);
+}
+
+/* Returns a capsule owning a new, empty 'LastValueCache'. */
+static PyObject* fast_LastValueCache_create(PyObject* self, PyObject* args) {
+    PyObject* capsule;
+    LastValueCache* cache;
+    if (!PyArg_ParseTuple(args, "")) {
+        return NULL;
+    }
+    cache = (LastValueCache*) PyMem_Calloc(1, sizeof(*cache));
+    if (cache == NULL) {
+        return PyErr_NoMemory();
+    }
+    cache->lock = PyThread_allocate_lock();
+    if (cache->lock == NULL) {
+        PyMem_Free(cache);
+        return PyErr_NoMemory();
+    }
+    capsule = PyCapsule_New(
+            cache, lastValueCacheCapsuleName, destroyLastValueCache);
+    if (capsule == NULL) {
+        PyThread_free_lock(cache->lock);
+        PyMem_Free(cache);
+    }
+    return capsule;
+}
+
+/* Returns the dict of the fields of the correlation id, or 'None' if it is
+   not in the cache. */
+static PyObject* fast_LastValueCache_get(PyObject* self, PyObject* args) {
+    PyObject* capsule;
+    PyObject* result;
+    LastValueCache* cache;
+    CachedEntry* entry;
+    unsigned long long key;
+    int flags;
+    if (!PyArg_ParseTuple(args, "OKi", &capsule, &key, &flags)
+            || (cache = lastValueCacheFromPy(capsule)) == NULL) {
+        return NULL;
+    }
+    lastValueCacheLock(cache);
+    entry = lastValueCacheGet(cache, key);
+    if (entry == NULL) {
+        result = Py_None;
+        Py_INCREF(result);
+    }
+    else {
+        result = cachedEntryToPy(entry, 0, flags);
+    }
+    PyThread_release_lock(cache->lock);
+    return result;
+}
+
+/* Returns the list of the correlation ids in the cache. */
+static PyObject* fast_LastValueCache_keys(PyObject* self, PyObject* args) {
+    PyObject *capsule, *pyList, *pyValue;
+    LastValueCache* cache;
+    size_t i;
+    if (!PyArg_ParseTuple(args, "O", &capsule)
+            || (cache = lastValueCacheFromPy(capsule)) == NULL) {
+        return NULL;
+    }
+    pyList = PyList_New(0);
+    if (pyList == NULL) {
+        return NULL;
+    }
+    lastValueCacheLock(cache);
+    for (i = 0; i < cache->capacity; ++i) {
+        const CachedEntry* entry = cache->entries[i];
+        if (entry == NULL || !entry->present) {
+            continue;
+        }
+        pyValue = PyLong_FromUnsignedLongLong(entry->key);
+        if (pyValue == NULL || PyList_Append(pyList, pyValue)) {
+            Py_XDECREF(pyValue);
+            Py_CLEAR(pyList);
+            break;
+        }
+        Py_DECREF(pyValue);
+    }
+    PyThread_release_lock(cache->lock);
+    return pyList;
+}
+
+/* Returns a dict of the fields of each correlation id updated since the
+   last poll, only of the fields updated since then if 'changedOnly', in
+   the order of their first update, and clears the updates. Raises, keeping
+   the updates, if merging failed since the last poll. */
+static PyObject* fast_LastValueCache_poll(PyObject* self, PyObject* args) {
+    PyObject *capsule, *pyDict, *key, *pyValue;
+    LastValueCache* cache;
+    int changedOnly, flags;
+    const char* error;
+    size_t i, j;
+    if (!PyArg_ParseTuple(args, "Opi", &capsule, &changedOnly, &flags)
+            || (cache = lastValueCacheFromPy(capsule)) == NULL) {
+        return NULL;
+    }
+    pyDict = PyDict_New();
+    if (pyDict == NULL) {
+        return NULL;
+    }
+    lastValueCacheLock(cache);
+    error = cache->error;
+    cache->error = NULL;
+    if (error != NULL) {
+        PyThread_release_lock(cache->lock);
+        Py_DECREF(pyDict);
+        PyErr_SetString(PyExc_Exception, error);
+        return NULL;
+    }
+    for (i = 0; i < cache->numChanged; ++i) {
+        const CachedEntry* entry = cache->changed[i];
+        if (!entry->present) {
+            continue;
+        }
+        key = PyLong_FromUnsignedLongLong(entry->key);
+        pyValue = key ? cachedEntryToPy(entry, changedOnly, flags) : NULL;
+        // does not steal refs to key and value
+        if (pyValue == NULL || PyDict_SetItem(pyDict, key, pyValue)) {
+            Py_XDECREF(key);
+            Py_XDECREF(pyValue);
+            Py_CLEAR(pyDict);
+            break;
+        }
+        Py_DECREF(key);
+        Py_DECREF(pyValue);
+    }
+    if (pyDict != NULL) {
+        // the updates are only cleared once they are all returned
+        for (i = 0; i < cache->numChanged; ++i) {
+            CachedEntry* entry = cache->changed[i];
+            entry->queued = 0;
+            for (j = 0; j < entry->numFields; ++j) {
+                entry->fields[j].changed = 0;
+            }
+        }
+        cache->numChanged = 0;
+    }
+    PyThread_release_lock(cache->lock);
+    return pyDict;
+}
+
+/* Removes the correlation id from the cache, returns whether it was
+   there. */
+static PyObject* fast_LastValueCache_remove(PyObject* self, PyObject* args) {
+    PyObject* capsule;
+    LastValueCache* cache;
+    CachedEntry* entry;
+    unsigned long long key;
+    if (!PyArg_ParseTuple(args, "OK", &capsule, &key)
+            || (cache = lastValueCacheFromPy(capsule)) == NULL) {
+        return NULL;
+    }
+    lastValueCacheLock(cache);
+    entry = lastValueCacheGet(cache, key);
+    if (entry != NULL) {
+        // the entry is kept, with its buffers, for the next updates
+        entry->present = 0;
+        entry->numFields = 0;
+        --cache->numPresent;
+    }
+    PyThread_release_lock(cache->lock);
+    return PyBool_FromLong(entry != NULL);
+}
+
+static PyObject* fast_LastValueCache_size(PyObject* self, PyObject* args) {
+    PyObject* capsule;
+    LastValueCache* cache;
+    size_t size;
+    if (!PyArg_ParseTuple(args, "O", &capsule)
+            || (cache = lastValueCacheFromPy(capsule)) == NULL) {
+        return NULL;
+    }
+    lastValueCacheLock(cache);
+    size = cache->numPresent;
+    PyThread_release_lock(cache->lock);
+    return PyLong_FromSize_t(size);
+}
+
+/* Merges the messages of the event into the cache, without the GIL. */
+static PyObject* fast_LastValueCache_update(PyObject* self, PyObject* args) {
+    PyObject *capsule, *eventObj;
+    LastValueCache* cache;
+    void* event;
+    if (!PyArg_ParseTuple(args, "OO", &capsule, &eventObj)
+            || (cache = lastValueCacheFromPy(capsule)) == NULL
+            || handleFromPy(eventObj, &event)) {
+        return NULL;
+    }
+    Py_BEGIN_ALLOW_THREADS
+    lastValueCacheUpdate(cache, (blpapi_Event_t*) event);
+    Py_END_ALLOW_THREADS
+    Py_RETURN_NONE; // inc ref and return
+}
+
+/* Latency histograms of the dispatch of events. A 'LatencyMonitor' holds a
+   histogram of durations in nanoseconds per stage of the dispatch, and
+   gauges of the events dispatched. The histograms are log-linear, as HDR
+   histograms: the durations below 'LATENCY_SUB_BUCKETS' nanoseconds have a
+   bucket each, and each following power of two is split into
+   'LATENCY_SUB_BUCKETS' buckets, so that a bucket is less than 1% of the
+   durations it holds wide. The durations of 'LATENCY_MAX_VALUE' or more,
+   about 36 minutes, are all held by the last bucket.
+
+   Every counter is updated with relaxed atomic operations, so that the
+   dispatcher threads of a session record their durations without any lock
+   and whether or not they hold the GIL. A snapshot is not an atomic copy
+   of the counters, which may be updated while it is taken.
+*/
+#define LATENCY_RECEIVE_TO_DEQUEUE 0
+#define LATENCY_DEQUEUE_TO_HANDLER 1
+#define LATENCY_HANDLER 2
+#define LATENCY_CONVERSION 3
+#define LATENCY_NUM_STAGES 4
+
+#define LATENCY_SUB_BUCKET_BITS 7
+#define LATENCY_SUB_BUCKETS (1 << LATENCY_SUB_BUCKET_BITS)
+#define LATENCY_MAX_SHIFT 33
+#define LATENCY_NUM_BUCKETS ((LATENCY_MAX_SHIFT + 2) * LATENCY_SUB_BUCKETS)
+#define LATENCY_MAX_VALUE \
+    ((2LL * LATENCY_SUB_BUCKETS << LATENCY_MAX_SHIFT) - 1)
+#define LATENCY_NO_MIN 0x7fffffffffffffffLL
+
+#if defined(_MSC_VER) && defined(_WIN64)
+#include <intrin.h>
+#define FFIUTILS_ATOMIC_ADD(target, value) \
+    _InterlockedExchangeAdd64((target), (value))
+#define FFIUTILS_ATOMIC_EXCHANGE(target, value) \
+    _InterlockedExchange64((target), (value))
+#define FFIUTILS_ATOMIC_LOAD(target) _InterlockedOr64((target), 0)
+#define FFIUTILS_ATOMIC_LOAD_ACQUIRE(target) _InterlockedOr64((target), 0)
+#define FFIUTILS_ATOMIC_STORE_RELEASE(target, value) \
+    _InterlockedExchange64((target), (value))
+#elif defined(_MSC_VER)
+/* On 32 bit x86, only the compare exchange of 64 bit values is an
+   intrinsic, the other operations are built from it. */
+#include <intrin.h>
+static __inline long long atomicAdd32(long long* target, long long value) {
+    long long previous = *target, current;
+    while ((current = _InterlockedCompareExchange64(
+                    target, previous + value, previous)) != previous) {
+        previous = current;
+    }
+    return previous;
+}
+static __inline long long atomicExchange32(long long* target,
+                                           long long value) {
+    long long previous = *target, current;
+    while ((current = _InterlockedCompareExchange64(
+                    target, value, previous)) != previous) {
+        previous = current;
+    }
+    return previous;
+}
+#define FFIUTILS_ATOMIC_ADD(target, value) atomicAdd32((target), (value))
+#define FFIUTILS_ATOMIC_EXCHANGE(target, value) \
+    atomicExchange32((target), (value))
+#define FFIUTILS_ATOMIC_LOAD(target) \
+    _InterlockedCompareExchange64((target), 0, 0)
+#define FFIUTILS_ATOMIC_LOAD_ACQUIRE(target) \
+    _InterlockedCompareExchange64((target), 0, 0)
+#define FFIUTILS_ATOMIC_STORE_RELEASE(target, value) \
+    atomicExchange32((target), (value))
+#else
+#define FFIUTILS_ATOMIC_ADD(target, value) \
+    __atomic_fetch_add((target), (value), __ATOMIC_RELAXED)
+#define FFIUTILS_ATOMIC_EXCHANGE(target, value) \
+    __atomic_exchange_n((target), (value), __ATOMIC_RELAXED)
+#define FFIUTILS_ATOMIC_LOAD(target) \
+    __atomic_load_n((target), __ATOMIC_RELAXED)
+#define FFIUTILS_ATOMIC_LOAD_ACQUIRE(target) \
+    __atomic_load_n((target), __ATOMIC_ACQUIRE)
+#define FFIUTILS_ATOMIC_STORE_RELEASE(target, value) \
+    __atomic_store_n((target), (value), __ATOMIC_RELEASE)
+#endif
+
+/* Sets '*target' to 'desired' and returns non-zero if it is '*expected',
+   loads it into '*expected' and returns 0 otherwise. */
+static int atomicCompareExchange(long long* target,
+                                 long long* expected,
+                                 long long desired) {
+#if defined(_MSC_VER)
+    const long long previous =
+        _InterlockedCompareExchange64(target, desired, *expected);
+    if (previous == *expected) {
+        return 1;
+    }
+    *expected = previous;
+    return 0;
+#else
+    return __atomic_compare_exchange_n(
+            target, expected, desired, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+#endif
+}
+
+static void atomicMax(long long* target, long long value) {
+    long long current = FFIUTILS_ATOMIC_LOAD(target);
+    while (value > current
+               && !atomicCompareExchange(target, &current, value)) {
+    }
+}
+
+static void atomicMin(long long* target, long long value) {
+    long long current = FFIUTILS_ATOMIC_LOAD(target);
+    while (value < current
+               && !atomicCompareExchange(target, &current, value)) {
+    }
+}
+
+typedef struct {
+    long long count;
+    long long sum;
+    long long min; // 'LATENCY_NO_MIN' if 'count' is 0
+    long long max;
+    long long buckets[LATENCY_NUM_BUCKETS];
+} LatencyHistogram;
+
+typedef struct {
+    LatencyHistogram stages[LATENCY_NUM_STAGES];
+    long long events;        // dispatched
+    long long queueDepth;    // dispatched, and not handled yet
+    long long maxQueueDepth; // since the last reset
+} LatencyMonitor;
+
+static const char* const latencyMonitorCapsuleName =
+    "blpapi.ffiutils.LatencyMonitor";
+
+static size_t latencyBucketIndex(long long value) {
+    int shift = 0;
+    if (value < LATENCY_SUB_BUCKETS) {
+        return (size_t) value;
+    }
+    while ((value >> shift) >= 2 * LATENCY_SUB_BUCKETS) {
+        ++shift;
+    }
+    return (size_t) shift * LATENCY_SUB_BUCKETS + (size_t) (value >> shift);
+}
+
+static void latencyRecord(LatencyMonitor* monitor,
+                          int stage,
+                          long long value) {
+    LatencyHistogram* histogram = &monitor->stages[stage];
+    if (value < 0) {
+        // clocks of distinct hosts, as for the receive times
+        value = 0;
+    }
+    else if (value > LATENCY_MAX_VALUE) {
+        value = LATENCY_MAX_VALUE;
+    }
+    FFIUTILS_ATOMIC_ADD(&histogram->buckets[latencyBucketIndex(value)], 1);
+    FFIUTILS_ATOMIC_ADD(&histogram->count, 1);
+    FFIUTILS_ATOMIC_ADD(&histogram->sum, value);
+    atomicMin(&histogram->min, value);
+    atomicMax(&histogram->max, value);
+}
+
+/* Records the dispatch of 'event' at '*dequeued', which is loaded with the
+   current time, and the durations from the receive times of its messages,
+   if any. Does not need the GIL. */
+static void latencyDequeued(LatencyMonitor* monitor,
+                            blpapi_Event_t* event,
+                            blpapi_TimePoint_t* dequeued) {
+    blpapi_MessageIterator_t* iterator;
+    blpapi_Message_t* message;
+    blpapi_TimePoint_t received;
+    blpapi_HighResolutionClock_now(dequeued);
+    FFIUTILS_ATOMIC_ADD(&monitor->events, 1);
+    atomicMax(&monitor->maxQueueDepth,
+              FFIUTILS_ATOMIC_ADD(&monitor->queueDepth, 1) + 1);
+    iterator = blpapi_MessageIterator_create(event);
+    if (iterator == NULL) {
+        return;
+    }
+    while (0 == blpapi_MessageIterator_next(iterator, &message)) {
+        if (0 == blpapi_Message_timeReceived(message, &received)) {
+            latencyRecord(monitor,
+                          LATENCY_RECEIVE_TO_DEQUEUE,
+                          blpapi_TimePointUtil_nanosecondsBetween(
+                              &received, dequeued));
+        }
+    }
+    blpapi_MessageIterator_destroy(iterator);
+}
+
+/* Records the duration from '*start' to now in 'stage', and loads the
+   current time into '*start'. */
+static void latencyLap(LatencyMonitor* monitor,
+                       int stage,
+                       blpapi_TimePoint_t* start) {
+    blpapi_TimePoint_t now;
+    blpapi_HighResolutionClock_now(&now);
+    latencyRecord(
+            monitor, stage, blpapi_TimePointUtil_nanosecondsBetween(start, &now));
+    *start = now;
+}
+
+static void latencyHandled(LatencyMonitor* monitor) {
+    FFIUTILS_ATOMIC_ADD(&monitor->queueDepth, -1);
+}
+
+/* Returns the '(count, sum, min, max, buckets)' tuple of 'histogram', the
+   'buckets' being a dict of the non-zero counts by bucket index, and
+   clears it if 'reset' is set. */
+static PyObject* latencyHistogramToPy(LatencyHistogram* histogram,
+                                      int reset) {
+    PyObject *pyBuckets = PyDict_New(), *pyKey, *pyValue;
+    long long count, sum, min, max, bucket;
+    size_t i;
+    if (pyBuckets == NULL) {
+        return NULL;
+    }
+    for (i = 0; i < LATENCY_NUM_BUCKETS; ++i) {
+        bucket = reset
+            ? FFIUTILS_ATOMIC_EXCHANGE(&histogram->buckets[i], 0)
+            : FFIUTILS_ATOMIC_LOAD(&histogram->buckets[i]);
+        if (bucket == 0) {
+            continue;
+        }
+        pyKey = PyLong_FromSize_t(i);
+        pyValue = PyLong_FromLongLong(bucket);
+        // does not steal refs to key and value
+        if (pyKey == NULL || pyValue == NULL
+                || PyDict_SetItem(pyBuckets, pyKey, pyValue)) {
+            Py_XDECREF(pyKey);
+            Py_XDECREF(pyValue);
+            Py_DECREF(pyBuckets);
+            return NULL;
+        }
+        Py_DECREF(pyKey);
+        Py_DECREF(pyValue);
+    }
+    if (reset) {
+        count = FFIUTILS_ATOMIC_EXCHANGE(&histogram->count, 0);
+        sum = FFIUTILS_ATOMIC_EXCHANGE(&histogram->sum, 0);
+        min = FFIUTILS_ATOMIC_EXCHANGE(&histogram->min, LATENCY_NO_MIN);
+        max = FFIUTILS_ATOMIC_EXCHANGE(&histogram->max, 0);
+    }
+    else {
+        count = FFIUTILS_ATOMIC_LOAD(&histogram->count);
+        sum = FFIUTILS_ATOMIC_LOAD(&histogram->sum);
+        min = FFIUTILS_ATOMIC_LOAD(&histogram->min);
+        max = FFIUTILS_ATOMIC_LOAD(&histogram->max);
+    }
+    // steals ref to buckets
+    return Py_BuildValue(
+            "LLLLN", count, sum, count ? min : 0LL, max, pyBuckets);
+}
+
+static void destroyLatencyMonitor(PyObject* capsule) {
+    LatencyMonitor* monitor = (LatencyMonitor*)
+        PyCapsule_GetPointer(capsule, latencyMonitorCapsuleName);
+    free(monitor);
+}
+
+static LatencyMonitor* latencyMonitorFromPy(PyObject* capsule) {
+    return (LatencyMonitor*)
+        PyCapsule_GetPointer(capsule, latencyMonitorCapsuleName);
+}
+
+static PyObject* fast_LatencyMonitor_create(PyObject* self, PyObject* args) {
+    PyObject* capsule;
+    int i;
+    LatencyMonitor* monitor =
+        (LatencyMonitor*) calloc(1, sizeof(LatencyMonitor));
+    if (monitor == NULL) {
+        return PyErr_NoMemory();
+    }
+    for (i = 0; i < LATENCY_NUM_STAGES; ++i) {
+        monitor->stages[i].min = LATENCY_NO_MIN;
+    }
+    capsule = PyCapsule_New(
+            monitor, latencyMonitorCapsuleName, destroyLatencyMonitor);
+    if (capsule == NULL) {
+        free(monitor);
+    }
+    return capsule;
+}
+
+static PyObject* fast_LatencyMonitor_record(PyObject* self, PyObject* args) {
+    PyObject* capsule;
+    LatencyMonitor* monitor;
+    int stage;
+    long long value;
+    if (!PyArg_ParseTuple(args, "OiL", &capsule, &stage, &value)
+            || (monitor = latencyMonitorFromPy(capsule)) == NULL) {
+        return NULL;
+    }
+    if (stage < 0 || stage >= LATENCY_NUM_STAGES) {
+        PyErr_SetString(PyExc_ValueError, "Invalid latency stage");
+        return NULL;
+    }
+    latencyRecord(monitor, stage, value);
+    Py_RETURN_NONE; // inc ref and return
+}
+
+/* Returns the '(events, queueDepth, maxQueueDepth, stages)' tuple of the
+   monitor, 'stages' being the list of the tuples of its histograms, and
+   clears the histograms and the maximum depth if 'reset' is set. */
+static PyObject* fast_LatencyMonitor_snapshot(PyObject* self,
+                                              PyObject* args) {
+    PyObject *capsule, *pyStages, *pyStage;
+    LatencyMonitor* monitor;
+    long long queueDepth, maxQueueDepth;
+    int reset, i;
+    if (!PyArg_ParseTuple(args, "Op", &capsule, &reset)
+            || (monitor = latencyMonitorFromPy(capsule)) == NULL) {
+        return NULL;
+    }
+    pyStages = PyList_New(LATENCY_NUM_STAGES);
+    for (i = 0; pyStages != NULL && i < LATENCY_NUM_STAGES; ++i) {
+        pyStage = latencyHistogramToPy(&monitor->stages[i], reset);
+        if (pyStage == NULL) {
+            Py_CLEAR(pyStages);
+            break;
+        }
+        // steals ref to stage
+        PyList_SetItem(pyStages, i, pyStage);
+    }
+    if (pyStages == NULL) {
+        return NULL;
+    }
+    queueDepth = FFIUTILS_ATOMIC_LOAD(&monitor->queueDepth);
+    maxQueueDepth = reset
+        ? FFIUTILS_ATOMIC_EXCHANGE(&monitor->maxQueueDepth, queueDepth)
+        : FFIUTILS_ATOMIC_LOAD(&monitor->maxQueueDepth);
+    // steals ref to stages
+    return Py_BuildValue("LLLN",
+                         FFIUTILS_ATOMIC_LOAD(&monitor->events),
+                         queueDepth,
+                         maxQueueDepth,
+                         pyStages);
+}
+
+/* Buffered logging. The logging callback registered by
+   'LogBuffer_register' copies the records of the SDK into a bounded ring
+   without taking the GIL, so that the threads of the SDK are not stalled
+   by python when verbose logging is enabled, and the records are converted
+   by 'LogBuffer_drain', in batches. The ring is a bounded multi-producer
+   queue: a producer claims a slot by advancing 'enqueuePosition', and
+   publishes the record by setting the sequence of the slot, which tells
+   the consumer that the record can be read and, once it is read, tells
+   the producers that the slot is free again. Records are dropped, and
+   counted, when the ring is full, and their text is truncated to
+   'LOG_BUFFER_TEXT_SIZE' bytes.
+
+   The SDK has one logging callback per process, so there is one ring,
+   created by the first registration and never destroyed, since the
+   threads of the SDK may be logging into it at any time. It is drained
+   with the GIL held, or 'logBufferMutex' locked on free-threaded builds.
+*/
+#define LOG_BUFFER_TEXT_SIZE 2048
+
+typedef struct {
+    long long sequence;
+    blpapi_UInt64_t threadId;
+    int severity;
+    blpapi_Datetime_t timestamp;
+    size_t categoryLength;
+    size_t messageLength; // the message follows the category in 'text'
+    char text[LOG_BUFFER_TEXT_SIZE];
+} LogRecord;
+
+typedef struct {
+    long long enqueuePosition;
+    long long dequeuePosition;
+    long long dropped;
+    long long mask; // the capacity, a power of 2, minus 1
+    LogRecord records[1];
+} LogBuffer;
+
+static LogBuffer* logBuffer = NULL;
+#ifdef Py_GIL_DISABLED
+static PyMutex logBufferMutex = { 0 };
+#endif
+
+/* Copies at most 'size' bytes of the null-terminated 'text' into 'out'
+   and returns the number of bytes copied. */
+static size_t logBufferCopy(char* out, const char* text, size_t size) {
+    size_t length = 0;
+    if (text == NULL) {
+        return 0;
+    }
+    while (length < size && text[length] != '\0') {
+        out[length] = text[length];
+        ++length;
+    }
+    return length;
+}
+
+static void logBufferCallback(blpapi_UInt64_t threadId,
+                              int severity,
+                              blpapi_Datetime_t timestamp,
+                              const char* category,
+                              const char* message) {
+    LogBuffer* buffer = logBuffer;
+    LogRecord* record;
+    long long position = FFIUTILS_ATOMIC_LOAD(&buffer->enqueuePosition);
+    for (;;) {
+        long long sequence;
+        record = &buffer->records[position & buffer->mask];
+        sequence = FFIUTILS_ATOMIC_LOAD_ACQUIRE(&record->sequence);
+        if (sequence == position) {
+            // the slot is free, claim it unless another thread did
+            if (atomicCompareExchange(
+                        &buffer->enqueuePosition, &position, position + 1)) {
+                break;
+            }
+        }
+        else if (sequence < position) {
+            // the slot still holds the record of the previous lap
+            FFIUTILS_ATOMIC_ADD(&buffer->dropped, 1);
+            return;
+        }
+        else {
+            position = FFIUTILS_ATOMIC_LOAD(&buffer->enqueuePosition);
+        }
+    }
+    record->threadId = threadId;
+    record->severity = severity;
+    record->timestamp = timestamp;
+    record->categoryLength =
+        logBufferCopy(record->text, category, LOG_BUFFER_TEXT_SIZE / 8);
+    record->messageLength =
+        logBufferCopy(record->text + record->categoryLength,
+                      message,
+                      LOG_BUFFER_TEXT_SIZE - record->categoryLength);
+    FFIUTILS_ATOMIC_STORE_RELEASE(&record->sequence, position + 1);
+}
+
+/* Returns the '(threadId, severity, timestamp, category, message)' tuple
+   of 'record', as passed to the python logging callbacks. */
+static PyObject* logRecordToPy(const LogRecord* record) {
+    blpapi_HighPrecisionDatetime_t timestamp;
+    PyObject *pyTimestamp, *pyCategory, *pyMessage;
+    timestamp.datetime = record->timestamp;
+    timestamp.picoseconds = 0;
+    pyTimestamp = datetimeToPy(&timestamp, 0);
+    pyCategory = PyUnicode_DecodeUTF8(
+            record->text, (Py_ssize_t) record->categoryLength, "replace");
+    pyMessage = PyUnicode_DecodeUTF8(record->text + record->categoryLength,
+                                     (Py_ssize_t) record->messageLength,
+                                     "replace");
+    if (pyTimestamp == NULL || pyCategory == NULL || pyMessage == NULL) {
+        Py_XDECREF(pyTimestamp);
+        Py_XDECREF(pyCategory);
+        Py_XDECREF(pyMessage);
+        return NULL;
+    }
+    // steals refs to timestamp, category and message
+    return Py_BuildValue("KiNNN",
+                         (unsigned long long) record->threadId,
+                         record->severity,
+                         pyTimestamp,
+                         pyCategory,
+                         pyMessage);
+}
+
+/* Registers the callback of the ring, creating it with at least
+   'capacity' records if it does not exist yet, and returns the return
+   code of 'blpapi_Logging_registerCallback'. */
+static PyObject* fast_LogBuffer_register(PyObject* self, PyObject* args) {
+    Py_ssize_t capacity;
+    int thresholdSeverity, rc;
+    if (!PyArg_ParseTuple(args, "ni", &capacity, &thresholdSeverity)) {
+        return NULL;
+    }
+    if (capacity <= 0) {
+        PyErr_SetString(PyExc_ValueError,
+                        "The capacity of the log buffer must be positive");
+        return NULL;
+    }
+    FFIUTILS_LOCK(logBufferMutex);
+    if (logBuffer == NULL) {
+        long long size = 1, i;
+        while (size < capacity) {
+            size *= 2;
+        }
+        logBuffer = (LogBuffer*) calloc(
+                1, sizeof(LogBuffer) + (size - 1) * sizeof(LogRecord));
+        if (logBuffer != NULL) {
+            logBuffer->mask = size - 1;
+            for (i = 0; i < size; ++i) {
+                logBuffer->records[i].sequence = i;
+            }
+        }
+    }
+    FFIUTILS_UNLOCK(logBufferMutex);
+    if (logBuffer == NULL) {
+        return PyErr_NoMemory();
+    }
+    Py_BEGIN_ALLOW_THREADS
+    rc = blpapi_Logging_registerCallback(logBufferCallback,
+                                         thresholdSeverity);
+    Py_END_ALLOW_THREADS
+    return PyLong_FromLong(rc);
+}
+
+/* Returns the list of the tuples of at most 'maxRecords' records taken
+   from the ring, of all of them if 'maxRecords' is negative, in the order
+   in which they were logged. */
+static PyObject* fast_LogBuffer_drain(PyObject* self, PyObject* args) {
+    Py_ssize_t maxRecords, numRecords = 0;
+    PyObject *pyRecords, *pyRecord;
+    if (!PyArg_ParseTuple(args, "n", &maxRecords)) {
+        return NULL;
+    }
+    pyRecords = PyList_New(0);
+    if (pyRecords == NULL || logBuffer == NULL) {
+        return pyRecords;
+    }
+    FFIUTILS_LOCK(logBufferMutex);
+    while (maxRecords < 0 || numRecords < maxRecords) {
+        const long long position = logBuffer->dequeuePosition;
+        LogRecord* record = &logBuffer->records[position & logBuffer->mask];
+        if (FFIUTILS_ATOMIC_LOAD_ACQUIRE(&record->sequence)
+                != position + 1) {
+            // empty, or the next record is still being written
+            break;
+        }
+        pyRecord = logRecordToPy(record);
+        // does not steal ref to record
+        if (pyRecord == NULL || PyList_Append(pyRecords, pyRecord)) {
+            Py_XDECREF(pyRecord);
+            Py_CLEAR(pyRecords);
+            break;
+        }
+        Py_DECREF(pyRecord);
+        // frees the slot for the next lap
+        FFIUTILS_ATOMIC_STORE_RELEASE(&record->sequence,
+                                      position + logBuffer->mask + 1);
+        logBuffer->dequeuePosition = position + 1;
+        ++numRecords;
+    }
+    FFIUTILS_UNLOCK(logBufferMutex);
+    return pyRecords;
+}
+
+/* Returns the number of records dropped because the ring was full. */
+static PyObject* fast_LogBuffer_dropped(PyObject* self, PyObject* args) {
+    return PyLong_FromLongLong(
+            logBuffer == NULL ? 0 : FFIUTILS_ATOMIC_LOAD(&logBuffer->dropped));
+}
+
+/* Pipes of events to an event loop. The event handler of a session created
+   with an 'EventPipe' as handler appends the events to the pipe on the
+   dispatcher threads, without taking the GIL, and sends a byte to the
+   write end of a socket pair when the pipe becomes non-empty, so that the
+   loop, waiting for the read end to be readable, takes all the pending
+   events at once. At most one byte is outstanding between two drains. */
+typedef struct {
+    blpapi_Event_t** events;
+    size_t numEvents;
+    size_t capacity;
+    unsigned long long socket; // write end, not written once closed
+    int signalled;             // whether a byte was sent since the drain
+    int closed;
+    PyThread_type_lock lock;
+} EventPipe;
+
+static const char* const eventPipeCapsuleName = "blpapi.ffiutils.EventPipe";
+
+static EventPipe* eventPipeFromPy(PyObject* capsule) {
+    return (EventPipe*) PyCapsule_GetPointer(capsule, eventPipeCapsuleName);
+}
+
+/* Appends 'event' to 'pipe', which takes ownership of it, and signals the
+   loop if needed. The event is released if the pipe is closed or cannot
+   grow. Does not need the GIL. */
+static void eventPipePush(EventPipe* pipe, blpapi_Event_t* event) {
+    blpapi_Event_t** events;
+    size_t capacity;
+    PyThread_acquire_lock(pipe->lock, WAIT_LOCK);
+    if (!pipe->closed && pipe->numEvents == pipe->capacity) {
+        capacity = pipe->capacity ? 2 * pipe->capacity : 64;
+        events = (blpapi_Event_t**)
+            realloc(pipe->events, capacity * sizeof(blpapi_Event_t*));
+        if (events != NULL) {
+            pipe->events = events;
+            pipe->capacity = capacity;
+        }
+    }
+    if (pipe->closed || pipe->numEvents == pipe->capacity) {
+        PyThread_release_lock(pipe->lock);
+        blpapi_Event_release(event);
+        return;
+    }
+    pipe->events[pipe->numEvents++] = event;
+    if (!pipe->signalled) {
+        pipe->signalled = 1;
+        // sent with the lock held, as closing the pipe stops the sends
+        // before the socket is closed
+        send((FFIUTILS_SOCKET) pipe->socket, "", 1, 0);
+    }
+    PyThread_release_lock(pipe->lock);
+}
+
+static void destroyEventPipe(PyObject* capsule) {
+    EventPipe* pipe = eventPipeFromPy(capsule);
+    size_t i;
+    if (pipe == NULL) {
+        return;
+    }
+    for (i = 0; i < pipe->numEvents; ++i) {
+        blpapi_Event_release(pipe->events[i]);
+    }
+    free(pipe->events);
+    PyThread_free_lock(pipe->lock);
+    free(pipe);
+}
+
+/* Returns a capsule owning an empty 'EventPipe' signalling the specified
+   socket. */
+static PyObject* fast_EventPipe_create(PyObject* self, PyObject* args) {
+    PyObject* capsule;
+    unsigned long long socket;
+    EventPipe* pipe;
+    if (!PyArg_ParseTuple(args, "K", &socket)) {
+        return NULL;
+    }
+    pipe = (EventPipe*) calloc(1, sizeof(EventPipe));
+    if (pipe == NULL) {
+        return PyErr_NoMemory();
+    }
+    pipe->socket = socket;
+    pipe->lock = PyThread_allocate_lock();
+    if (pipe->lock == NULL) {
+        free(pipe);
+        return PyErr_NoMemory();
+    }
+    capsule = PyCapsule_New(pipe, eventPipeCapsuleName, destroyEventPipe);
+    if (capsule == NULL) {
+        PyThread_free_lock(pipe->lock);
+        free(pipe);
+    }
+    return capsule;
+}
+
+/* Stops the signals of the pipe, whose socket can then be closed, and
+   releases the events pushed from then on. */
+static PyObject* fast_EventPipe_close(PyObject* self, PyObject* args) {
+    PyObject* capsule;
+    EventPipe* pipe;
+    if (!PyArg_ParseTuple(args, "O", &capsule)
+            || (pipe = eventPipeFromPy(capsule)) == NULL) {
+        return NULL;
+    }
+    Py_BEGIN_ALLOW_THREADS
+    PyThread_acquire_lock(pipe->lock, WAIT_LOCK);
+    pipe->closed = 1;
+    PyThread_release_lock(pipe->lock);
+    Py_END_ALLOW_THREADS
+    Py_RETURN_NONE; // inc ref and return
+}
+
+/* Returns '[handle, ...]' of the events pushed since the previous drain, in
+   order, after which the next push signals the loop again. */
+static PyObject* fast_EventPipe_drain(PyObject* self, PyObject* args) {
+    PyObject* capsule;
+    EventPipe* pipe;
+    blpapi_Event_t** events;
+    size_t numEvents;
+    if (!PyArg_ParseTuple(args, "O", &capsule)
+            || (pipe = eventPipeFromPy(capsule)) == NULL) {
+        return NULL;
+    }
+    Py_BEGIN_ALLOW_THREADS
+    PyThread_acquire_lock(pipe->lock, WAIT_LOCK);
+    events = pipe->events;
+    numEvents = pipe->numEvents;
+    pipe->events = NULL;
+    pipe->numEvents = pipe->capacity = 0;
+    pipe->signalled = 0;
+    PyThread_release_lock(pipe->lock);
+    Py_END_ALLOW_THREADS
+    // 'eventsToPy' releases the events on failure
+    capsule = eventsToPy(events, (int) numEvents);
+    free(events);
+    return capsule;
+}
+
+/* Native event handler of the sessions created with an 'eventHandler'.
+   'dispatchEvent' matches 'blpapi_EventHandler_t' and
+   'blpapi_ProviderEventHandler_t' and is given as 'userData' an
+   'EventHandlerContext', created by 'EventHandler_create' and owned by the
+   capsule it returns. It acquires the GIL once, builds the 'Event' and calls
+   the handler with it, or with a list of 'Event's in batch mode.
+
+   In batch mode, the events which arrive on other dispatcher threads while
+   the handler is running are queued in 'pending' and given to the handler
+   as the next batch by the thread running it, in the order they arrived.
+
+   If the context has a 'LastValueCache', the subscription data events are
+   merged into it without acquiring the GIL, and not given to the handler.
+*/
+typedef struct EventHandlerContext {
+    PyObject* eventType;  // 'Event'
+    PyObject* handler;    // 'handler(event, session)', or the capsule of
+                          // 'pipe'
+    PyObject* sessionRef; // weak reference to the session
+    PyObject* onError;    // 'onError(excType, excValue, excTraceback)'
+    PyObject* pending;    // events waiting for the handler in batch mode,
+                          // NULL otherwise
+    int dispatching;      // whether a thread is delivering 'pending'
+    PyObject* cacheObj;   // capsule owning 'cache', NULL if none
+    LastValueCache* cache;
+    PyObject* monitorObj; // capsule owning 'monitor', NULL if none
+    LatencyMonitor* monitor;
+    EventPipe* pipe;      // NULL if 'handler' is not an 'EventPipe'
+#ifdef Py_GIL_DISABLED
+    PyMutex mutex;        // guards 'pending' and 'dispatching'
+#endif
+} EventHandlerContext;
+
+static const char* const eventHandlerCapsuleName =
+    "blpapi.ffiutils.EventHandler";
+
+static void destroyEventHandlerContext(PyObject* capsule) {
+    EventHandlerContext* context = (EventHandlerContext*)
+        PyCapsule_GetPointer(capsule, eventHandlerCapsuleName);
+    if (context == NULL) {
+        return;
+    }
+    Py_XDECREF(context->eventType);
+    Py_XDECREF(context->handler);
+    Py_XDECREF(context->sessionRef);
+    Py_XDECREF(context->onError);
+    Py_XDECREF(context->pending);
+    Py_XDECREF(context->cacheObj);
+    Py_XDECREF(context->monitorObj);
+    PyMem_Free(context);
+}
+
+/* Returns a capsule owning the 'EventHandlerContext' of the specified
+   event type, handler, session weak reference, error handler, batch mode,
+   and optional 'LastValueCache' and 'LatencyMonitor' capsules. The handler
+   can be the capsule of an 'EventPipe', into which the events are pushed
+   instead. */
+static PyObject* fast_EventHandler_create(PyObject* self, PyObject* args) {
+    PyObject *eventType, *handler, *sessionRef, *onError, *capsule;
+    PyObject* cacheObj = Py_None;
+    PyObject* monitorObj = Py_None;
+    LastValueCache* cache = NULL;
+    LatencyMonitor* monitor = NULL;
+    int batch;
+    EventHandlerContext* context;
+    if (!PyArg_ParseTuple(args, "OOOOp|OO", &eventType, &handler,
+                          &sessionRef, &onError, &batch, &cacheObj,
+                          &monitorObj)
+            || (cacheObj != Py_None
+                && (cache = lastValueCacheFromPy(cacheObj)) == NULL)
+            || (monitorObj != Py_None
+                && (monitor = latencyMonitorFromPy(monitorObj)) == NULL)) {
+        return NULL;
+    }
+    context = (EventHandlerContext*) PyMem_Calloc(1, sizeof(*context));
+    if (context == NULL) {
+        return PyErr_NoMemory();
+    }
+    if (cache != NULL) {
+        Py_INCREF(cacheObj);
+        context->cacheObj = cacheObj;
+        context->cache = cache;
+    }
+    if (monitor != NULL) {
+        Py_INCREF(monitorObj);
+        context->monitorObj = monitorObj;
+        context->monitor = monitor;
+    }
+    if (batch) {
+        context->pending = PyList_New(0);
+        if (context->pending == NULL) {
+            PyMem_Free(context);
+            return NULL;
+        }
+    }
+    Py_INCREF(eventType);
+    context->eventType = eventType;
+    Py_INCREF(handler);
+    context->handler = handler;
+    if (PyCapsule_IsValid(handler, eventPipeCapsuleName)) {
+        context->pipe = eventPipeFromPy(handler);
+    }
+    Py_INCREF(sessionRef);
+    context->sessionRef = sessionRef;
+    Py_INCREF(onError);
+    context->onError = onError;
+    capsule = PyCapsule_New(
+            context, eventHandlerCapsuleName, destroyEventHandlerContext);
+    if (capsule == NULL) {
+        Py_XDECREF(context->pending);
+        Py_XDECREF(context->cacheObj);
+        Py_XDECREF(context->monitorObj);
+        Py_DECREF(eventType);
+        Py_DECREF(handler);
+        Py_DECREF(sessionRef);
+        Py_DECREF(onError);
+        PyMem_Free(context);
+    }
+    return capsule;
+}
+
+/* Returns the address of the 'EventHandlerContext' of the capsule, to be
+   given as 'userData' with 'dispatchEvent' to 'blpapi_*Session_create'. */
+static PyObject* fast_EventHandler_userData(PyObject* self, PyObject* args) {
+    PyObject* capsule;
+    void* context;
+    if (!PyArg_ParseTuple(args, "O", &capsule)) {
+        return NULL;
+    }
+    context = PyCapsule_GetPointer(capsule, eventHandlerCapsuleName);
+    if (context == NULL) {
+        return NULL;
+    }
+    return PyLong_FromVoidPtr(context);
+}
+
+/* Appends 'event' to the pending events and, unless another thread is
+   already doing it, gives them to the handler until none is left, the
+   duration of each call being recorded by the monitor of 'context', if
+   any. Returns 0 on success, -1 with an exception set otherwise. */
+static int dispatchBatches(EventHandlerContext* context,
+                           PyObject* event,
+                           PyObject* session) {
+    PyObject *batch, *result;
+    blpapi_TimePoint_t start;
+    int rc = 0;
+    FFIUTILS_LOCK(context->mutex);
+    if (PyList_Append(context->pending, event) || context->dispatching) {
+        FFIUTILS_UNLOCK(context->mutex);
+        return PyErr_Occurred() ? -1 : 0;
+    }
+    context->dispatching = 1;
+    while (PyList_Size(context->pending) > 0) {
+        batch = context->pending;
+        context->pending = PyList_New(0);
+        if (context->pending == NULL) {
+            context->pending = batch;
+            rc = -1;
+            break;
+        }
+        FFIUTILS_UNLOCK(context->mutex);
+        if (context->monitor != NULL) {
+            blpapi_HighResolutionClock_now(&start);
+        }
+        result = PyObject_CallFunctionObjArgs(
+                context->handler, batch, session, NULL);
+        if (context->monitor != NULL) {
+            latencyLap(context->monitor, LATENCY_HANDLER, &start);
+        }
+        Py_DECREF(batch);
+        Py_XDECREF(result);
+        FFIUTILS_LOCK(context->mutex);
+        if (result == NULL) {
+            rc = -1;
+            break;
+        }
+    }
+    context->dispatching = 0;
+    FFIUTILS_UNLOCK(context->mutex);
+    return rc;
+}
+
+/* Reports the current exception to 'onError', which is not expected to
+   return. */
+static void reportEventHandlerError(EventHandlerContext* context) {
+    PyObject *excType, *excValue, *excTraceback, *result;
+    PyErr_Fetch(&excType, &excValue, &excTraceback);
+    PyErr_NormalizeException(&excType, &excValue, &excTraceback);
+    result = PyObject_CallFunctionObjArgs(context->onError,
+                                          excType,
+                                          excValue ? excValue : Py_None,
+                                          excTraceback ? excTraceback
+                                                       : Py_None,
+                                          NULL);
+    Py_XDECREF(result);
+    Py_XDECREF(excType);
+    Py_XDECREF(excValue);
+    Py_XDECREF(excTraceback);
+    PyErr_Clear();
+}
+
+static PyObject* sessionSetName = NULL; // "_sessionSet"
+
+PEXPRT void dispatchEvent(blpapi_Event_t *event,
+                          blpapi_Session_t *session,
+                          void *userData);
+void dispatchEvent(blpapi_Event_t *event,
+                   blpapi_Session_t *session,
+                   void *userData)
+{
+    EventHandlerContext* context = (EventHandlerContext*) userData;
+    LatencyMonitor* const monitor = context->monitor;
+    PyObject *sessionObj, *handle = NULL, *sessions = NULL, *eventObj = NULL;
+    PyObject *result, *sessionSetAttr;
+    int failed = 1;
+    PyGILState_STATE state;
+    blpapi_TimePoint_t lap;
+
+    if (monitor != NULL) {
+        latencyDequeued(monitor, event, &lap);
+    }
+    if (context->pipe != NULL) {
+        eventPipePush(context->pipe, event);
+        if (monitor != NULL) {
+            latencyHandled(monitor);
+        }
+        return;
+    }
+    if (context->cache != NULL && blpapi_Event_eventType(event)
+                                      == BLPAPI_EVENTTYPE_SUBSCRIPTION_DATA) {
+        lastValueCacheUpdate(context->cache, event);
+        blpapi_Event_release(event);
+        if (monitor != NULL) {
+            latencyHandled(monitor);
+        }
+        return;
+    }
+
+    state = PyGILState_Ensure();
+
+    sessionObj = PyObject_CallObject(context->sessionRef, NULL);
+    if (sessionObj == NULL) {
+        blpapi_Event_release(event);
+        goto DONE;
+    }
+    if (sessionObj == Py_None) {
+        // The session is being destroyed, nobody will handle the event.
+        blpapi_Event_release(event);
+        failed = 0;
+        goto DONE;
+    }
+
+    handle = handleToPy(event);
+    // the events of a session share its immutable set of sessions
+    sessionSetAttr = constantKey(&sessionSetName, "_sessionSet");
+    sessions = sessionSetAttr == NULL
+        ? NULL
+        : PyObject_CallMethodObjArgs(sessionObj, sessionSetAttr, NULL);
+    if (handle == NULL || sessions == NULL) {
+        blpapi_Event_release(event);
+        goto DONE;
+    }
+    // 'eventObj' releases 'event' from now on
+    eventObj = PyObject_CallFunctionObjArgs(
+            context->eventType, handle, sessions, NULL);
+    if (eventObj == NULL) {
+        blpapi_Event_release(event);
+        goto DONE;
+    }
+
+    if (monitor != NULL) {
+        latencyLap(monitor, LATENCY_DEQUEUE_TO_HANDLER, &lap);
+    }
+    if (context->pending == NULL) {
+        result = PyObject_CallFunctionObjArgs(
+                context->handler, eventObj, sessionObj, NULL);
+        if (monitor != NULL) {
+            latencyLap(monitor, LATENCY_HANDLER, &lap);
+        }
+        failed = result == NULL;
+        Py_XDECREF(result);
+    }
+    else {
+        failed = dispatchBatches(context, eventObj, sessionObj) != 0;
+    }
+
+DONE:
+    if (failed) {
+        reportEventHandlerError(context);
+    }
+    Py_XDECREF(eventObj);
+    Py_XDECREF(sessions);
+    Py_XDECREF(handle);
+    Py_XDECREF(sessionObj);
+    PyGILState_Release(state);
+    if (monitor != NULL) {
+        latencyHandled(monitor);
+    }
+}
+
+/* Module functions of the two phase conversion of events, the decoded
+   events being returned in capsules owning them. */
+static const char* const decodedEventCapsuleName =
+    "blpapi.ffiutils.DecodedEvent";
+
+static void destroyDecodedEventCapsule(PyObject* capsule) {
+    DecodedEvent* decoded = (DecodedEvent*)
+        PyCapsule_GetPointer(capsule, decodedEventCapsuleName);
+    if (decoded != NULL) {
+        destroyDecodedEvent(decoded);
+    }
+}
+
+static DecodedEvent* decodedEventFromPy(PyObject* capsule) {
+    return (DecodedEvent*)
+        PyCapsule_GetPointer(capsule, decodedEventCapsuleName);
+}
+
+/* Returns a capsule owning the 'DecodedEvent' of the event, decoded
+   without holding the GIL. */
+static PyObject* fast_blpapi_Event_decode(PyObject* self, PyObject* args) {
+    PyObject *eventObj, *fieldsObj, *capsule;
+    void *event, *fields;
+    int flags;
+    Py_ssize_t numFields;
+    DecodedEvent* decoded;
+    if (!PyArg_ParseTuple(args, "OiOn", &eventObj, &flags, &fieldsObj,
+                          &numFields)
+            || handleFromPy(eventObj, &event)
+            || handleFromPy(fieldsObj, &fields)) {
+        return NULL;
+    }
+    Py_BEGIN_ALLOW_THREADS
+    decoded = decodeEvent((blpapi_Event_t*) event,
+                          flags,
+                          (const blpapi_Name_t* const*) fields,
+                          (size_t) numFields);
+    Py_END_ALLOW_THREADS
+    if (decoded == NULL) {
+        return PyErr_NoMemory();
+    }
+    if (decoded->error != NULL) {
+        PyErr_SetString(PyExc_Exception, decoded->error);
+        destroyDecodedEvent(decoded);
+        return NULL;
+    }
+    capsule = PyCapsule_New(
+            decoded, decodedEventCapsuleName, destroyDecodedEventCapsule);
+    if (capsule == NULL) {
+        destroyDecodedEvent(decoded);
+    }
+    return capsule;
+}
+
+static PyObject* fast_blpapi_DecodedEvent_numMessages(PyObject* self,
+                                                      PyObject* args) {
+    PyObject* capsule;
+    DecodedEvent* decoded;
+    if (!PyArg_ParseTuple(args, "O", &capsule)
+            || (decoded = decodedEventFromPy(capsule)) == NULL) {
+        return NULL;
+    }
+    return PyLong_FromSize_t(decoded->numMessages);
+}
+
+static PyObject* fast_blpapi_DecodedEvent_toPy(PyObject* self,
+                                               PyObject* args) {
+    PyObject* capsule;
+    DecodedEvent* decoded;
+    if (!PyArg_ParseTuple(args, "O", &capsule)
+            || (decoded = decodedEventFromPy(capsule)) == NULL) {
+        return NULL;
+    }
+    return decodedEventToPy(decoded);
+}
+
+static PyObject* fast_blpapi_DecodedEvent_toColumns(PyObject* self,
+                                                    PyObject* args) {
+    PyObject *capsule, *fieldsObj, *columns;
+    DecodedEvent* decoded;
+    void* fields;
+    Py_ssize_t numFields, numRows;
+    if (!PyArg_ParseTuple(args, "OOnOn", &capsule, &fieldsObj, &numFields,
+                          &columns, &numRows)
+            || (decoded = decodedEventFromPy(capsule)) == NULL
+            || handleFromPy(fieldsObj, &fields)) {
+        return NULL;
+    }
+    return decodedEventToColumns(decoded,
+                                 (const blpapi_Name_t* const*) fields,
+                                 (size_t) numFields,
+                                 columns,
+                                 (size_t) numRows);
+}
+
+/* Capture records of events. A record is the binary encoding of an event,
+   appended by 'EventRecorder' to a capture file and decoded back by
+   'EventReplayer'. All the integers are little-endian, and a string is its
+   'uint32' length followed by its UTF-8 bytes:
+
+       uint32 size             of the record, this field excluded
+       int64  recordedAt       nanoseconds since the epoch
+       int32  eventType
+       uint32 numMessages
+       per message:
+           string messageType, topicName, service
+           int32  recapType, fragmentType
+           int64  timeReceived         nanoseconds since the epoch, or
+                                       'CAPTURE_NO_TIME'
+           uint32 numCorrelationIds
+           per correlation id:
+               uint8  valueType
+               uint64 value            0 unless an integer or generated id
+           value of the elements of the message
+
+   A value is its 'uint8' 'DECODED_*' kind and its string name, empty in
+   arrays and for the elements of a message, followed by: nothing for a
+   null, an 'uint8' for a bool, an 'int64', a 'float64', a string for a
+   string or bytes, the fields of 'blpapi_HighPrecisionDatetime_t' in
+   order for a datetime, and the 'uint32' number of values followed by the
+   values for a complex or an array.
+
+   Encoding does not call into python, and must be done without holding
+   the GIL.
+*/
+#define CAPTURE_NO_TIME (-0x7fffffffffffffffLL - 1)
+#define CAPTURE_MAX_DEPTH 256
+
+typedef struct {
+    unsigned char* data;
+    size_t size;
+    size_t capacity;
+    int failed; // set if the buffer could not grow
+} CaptureBuffer;
+
+static unsigned char* captureReserve(CaptureBuffer* buffer, size_t size) {
+    unsigned char* result;
+    if (buffer->failed) {
+        return NULL;
+    }
+    if (buffer->size + size > buffer->capacity) {
+        size_t newCapacity = buffer->capacity ? 2 * buffer->capacity : 4096;
+        unsigned char* newData;
+        while (newCapacity < buffer->size + size) {
+            newCapacity *= 2;
+        }
+        newData = (unsigned char*) realloc(buffer->data, newCapacity);
+        if (newData == NULL) {
+            buffer->failed = 1;
+            return NULL;
+        }
+        buffer->data = newData;
+        buffer->capacity = newCapacity;
+    }
+    result = buffer->data + buffer->size;
+    buffer->size += size;
+    return result;
+}
+
+static void capturePutInt(CaptureBuffer* buffer,
+                          unsigned long long value,
+                          size_t size) {
+    unsigned char* out = captureReserve(buffer, size);
+    size_t i;
+    if (out == NULL) {
+        return;
+    }
+    for (i = 0; i < size; ++i) {
+        out[i] = (unsigned char) (value >> (8 * i));
+    }
+}
+
+static void capturePutFloat(CaptureBuffer* buffer, double value) {
+    unsigned long long bits;
+    memcpy(&bits, &value, sizeof(bits));
+    capturePutInt(buffer, bits, 8);
+}
+
+static void capturePutString(CaptureBuffer* buffer,
+                             const char* data,
+                             size_t length) {
+    unsigned char* out;
+    capturePutInt(buffer, length, 4);
+    out = captureReserve(buffer, length);
+    if (out != NULL && length) {
+        memcpy(out, data, length);
+    }
+}
+
+static void capturePutName(CaptureBuffer* buffer, const blpapi_Name_t* name) {
+    if (name == NULL) {
+        capturePutInt(buffer, 0, 4);
+    }
+    else {
+        capturePutString(buffer,
+                         blpapi_Name_string(name),
+                         blpapi_Name_length(name));
+    }
+}
+
+static void captureEncodeValue(CaptureBuffer* buffer,
+                               const DecodedValue* value) {
+    const DecodedValue* child;
+    const DecodedValue* const end = value + value->size;
+    capturePutInt(buffer, (unsigned long long) value->kind, 1);
+    capturePutName(buffer, value->name);
+    switch (value->kind) {
+        case DECODED_BOOL: {
+            capturePutInt(buffer, value->value.boolValue ? 1 : 0, 1);
+        } break;
+        case DECODED_INT64: {
+            capturePutInt(buffer,
+                          (unsigned long long) value->value.intValue,
+                          8);
+        } break;
+        case DECODED_FLOAT64: {
+            capturePutFloat(buffer, value->value.floatValue);
+        } break;
+        case DECODED_STRING:
+        case DECODED_BYTES: {
+            capturePutString(buffer,
+                             value->value.bytesValue.data,
+                             value->value.bytesValue.length);
+        } break;
+        case DECODED_DATETIME: {
+            const blpapi_HighPrecisionDatetime_t* dt =
+                &value->value.datetimeValue;
+            capturePutInt(buffer, dt->datetime.parts, 1);
+            capturePutInt(buffer, dt->datetime.hours, 1);
+            capturePutInt(buffer, dt->datetime.minutes, 1);
+            capturePutInt(buffer, dt->datetime.seconds, 1);
+            capturePutInt(buffer, dt->datetime.milliSeconds, 2);
+            capturePutInt(buffer, dt->datetime.month, 1);
+            capturePutInt(buffer, dt->datetime.day, 1);
+            capturePutInt(buffer, dt->datetime.year, 2);
+            capturePutInt(buffer,
+                          (unsigned long long) dt->datetime.offset,
+                          2);
+            capturePutInt(buffer, dt->picoseconds, 4);
+        } break;
+        case DECODED_COMPLEX:
+        case DECODED_ARRAY: {
+            capturePutInt(buffer, value->value.numValues, 4);
+            for (child = value + 1; child < end; child += child->size) {
+                captureEncodeValue(buffer, child);
+            }
+        } break;
+    }
+}
+
+static void captureEncodeMessage(CaptureBuffer* buffer,
+                                 const DecodedValue* value) {
+    blpapi_Message_t* message = value->value.message;
+    blpapi_Service_t* service = blpapi_Message_service(message);
+    const char* str;
+    blpapi_TimePoint_t timePoint;
+    blpapi_HighPrecisionDatetime_t timeReceived;
+    long long nanos = CAPTURE_NO_TIME;
+    int numCorrelationIds, i;
+
+    capturePutName(buffer, blpapi_Message_messageType(message));
+    str = blpapi_Message_topicName(message);
+    capturePutString(buffer, str ? str : "", str ? strlen(str) : 0);
+    str = service ? blpapi_Service_name(service) : NULL;
+    capturePutString(buffer, str ? str : "", str ? strlen(str) : 0);
+    capturePutInt(buffer,
+                  (unsigned long long) blpapi_Message_recapType(message),
+                  4);
+    capturePutInt(buffer,
+                  (unsigned long long) blpapi_Message_fragmentType(message),
+                  4);
+    if (0 != blpapi_Message_timeReceived(message, &timePoint)
+            || 0 != blpapi_HighPrecisionDatetime_fromTimePoint(
+                    &timeReceived, &timePoint, 0)
+            || 0 != datetimeToNanos(&timeReceived, &nanos)) {
+        nanos = CAPTURE_NO_TIME;
+    }
+    capturePutInt(buffer, (unsigned long long) nanos, 8);
+
+    numCorrelationIds = blpapi_Message_numCorrelationIds(message);
+    capturePutInt(buffer, (unsigned long long) numCorrelationIds, 4);
+    for (i = 0; i < numCorrelationIds; ++i) {
+        const blpapi_CorrelationId_t correlationId =
+            blpapi_Message_correlationId(message, i);
+        const int isInt =
+            correlationId.valueType == BLPAPI_CORRELATION_TYPE_INT
+            || correlationId.valueType == BLPAPI_CORRELATION_TYPE_AUTOGEN;
+        capturePutInt(buffer, correlationId.valueType, 1);
+        capturePutInt(buffer, isInt ? correlationId.value.intValue : 0, 8);
+    }
+    captureEncodeValue(buffer, value + 1);
+}
+
+/* Loads into the empty 'buffer' the record of 'event', whose 'decoded'
+   messages are encoded, or sets 'buffer->failed'. */
+static void captureEncodeEvent(CaptureBuffer* buffer,
+                               blpapi_Event_t* event,
+                               const DecodedEvent* decoded,
+                               long long recordedAt) {
+    const DecodedValue* value = decoded->values;
+    const DecodedValue* const end = decoded->values + decoded->numValues;
+    size_t size, i;
+    capturePutInt(buffer, 0, 4); // size, set below
+    capturePutInt(buffer, (unsigned long long) recordedAt, 8);
+    capturePutInt(buffer,
+                  (unsigned long long) blpapi_Event_eventType(event),
+                  4);
+    capturePutInt(buffer, decoded->numMessages, 4);
+    for (; value < end; value += value->size) {
+        captureEncodeMessage(buffer, value);
+    }
+    if (!buffer->failed) {
+        size = buffer->size - 4;
+        for (i = 0; i < 4; ++i) {
+            buffer->data[i] = (unsigned char) (size >> (8 * i));
+        }
+    }
+}
+
+/* Decoding of a record, from a python 'bytes' object holding it without
+   its size. A malformed record sets 'reader->failed' instead of reading
+   past its end. */
+typedef struct {
+    const unsigned char* data;
+    const unsigned char* end;
+    int failed;
+} CaptureReader;
+
+static const unsigned char* captureRead(CaptureReader* reader, size_t size) {
+    const unsigned char* result = reader->data;
+    if (reader->failed || (size_t) (reader->end - reader->data) < size) {
+        reader->failed = 1;
+        return NULL;
+    }
+    reader->data += size;
+    return result;
+}
+
+static unsigned long long captureGetInt(CaptureReader* reader, size_t size) {
+    const unsigned char* in = captureRead(reader, size);
+    unsigned long long value = 0;
+    size_t i;
+    if (in == NULL) {
+        return 0;
+    }
+    for (i = 0; i < size; ++i) {
+        value |= (unsigned long long) in[i] << (8 * i);
+    }
+    return value;
+}
+
+static const char* captureGetString(CaptureReader* reader, size_t* length) {
+    *length = (size_t) captureGetInt(reader, 4);
+    return (const char*) captureRead(reader, *length);
+}
+
+/* Returns a new reference to the string read, interned if 'intern' is
+   set, or NULL with an error set. */
+static PyObject* captureStringToPy(CaptureReader* reader, int intern) {
+    size_t length;
+    const char* data = captureGetString(reader, &length);
+    PyObject* result;
+    if (data == NULL) {
+        return NULL;
+    }
+    result = PyUnicode_FromStringAndSize(data, (Py_ssize_t) length);
+    if (result != NULL && intern) {
+        PyUnicode_InternInPlace(&result);
+    }
+    return result;
+}
+
+static PyObject* captureValueToPy(CaptureReader* reader,
+                                  PyObject** name,
+                                  const int flags,
+                                  const int depth) {
+    const int kind = (int) captureGetInt(reader, 1);
+    PyObject* pyResult = NULL;
+    PyObject* pyKey = NULL;
+    PyObject* pyValue = NULL;
+    size_t numValues, i, length;
+    const char* data;
+    *name = captureStringToPy(reader, 1);
+    if (*name == NULL || depth > CAPTURE_MAX_DEPTH) {
+        goto ERROR;
+    }
+    switch (kind) {
+        case DECODED_NULL: {
+            Py_RETURN_NONE; // inc ref and return
+        }
+        case DECODED_BOOL: {
+            pyResult = PyBool_FromLong((long) captureGetInt(reader, 1));
+        } break;
+        case DECODED_INT64: {
+            pyResult = PyLong_FromLongLong(
+                    (long long) captureGetInt(reader, 8));
+        } break;
+        case DECODED_FLOAT64: {
+            const unsigned long long bits = captureGetInt(reader, 8);
+            double value;
+            memcpy(&value, &bits, sizeof(value));
+            pyResult = PyFloat_FromDouble(value);
+        } break;
+        case DECODED_STRING:
+        case DECODED_BYTES: {
+            data = captureGetString(reader, &length);
+            if (data == NULL) {
+                goto ERROR;
+            }
+            pyResult = kind == DECODED_STRING
+                ? PyUnicode_FromStringAndSize(data, (Py_ssize_t) length)
+                : PyBytes_FromStringAndSize(data, (Py_ssize_t) length);
+        } break;
+        case DECODED_DATETIME: {
+            blpapi_HighPrecisionDatetime_t dt;
+            dt.datetime.parts = (blpapi_UChar_t) captureGetInt(reader, 1);
+            dt.datetime.hours = (blpapi_UChar_t) captureGetInt(reader, 1);
+            dt.datetime.minutes = (blpapi_UChar_t) captureGetInt(reader, 1);
+            dt.datetime.seconds = (blpapi_UChar_t) captureGetInt(reader, 1);
+            dt.datetime.milliSeconds =
+                (blpapi_UInt16_t) captureGetInt(reader, 2);
+            dt.datetime.month = (blpapi_UChar_t) captureGetInt(reader, 1);
+            dt.datetime.day = (blpapi_UChar_t) captureGetInt(reader, 1);
+            dt.datetime.year = (blpapi_UInt16_t) captureGetInt(reader, 2);
+            dt.datetime.offset = (blpapi_Int16_t) captureGetInt(reader, 2);
+            dt.picoseconds = (blpapi_UInt32_t) captureGetInt(reader, 4);
+            if (reader->failed) {
+                goto ERROR;
+            }
+            pyResult = datetimeToPy(&dt, flags);
+        } break;
+        case DECODED_COMPLEX: {
+            numValues = (size_t) captureGetInt(reader, 4);
+            pyResult = reader->failed ? NULL : PyDict_New();
+            for (i = 0; pyResult != NULL && i < numValues; ++i) {
+                pyValue = captureValueToPy(reader, &pyKey, flags, depth + 1);
+                // does not steal refs to key and value
+                if (pyValue == NULL
+                        || PyDict_SetItem(pyResult, pyKey, pyValue)) {
+                    goto ERROR;
+                }
+                Py_CLEAR(pyKey);
+                Py_CLEAR(pyValue);
+            }
+        } break;
+        case DECODED_ARRAY: {
+            numValues = (size_t) captureGetInt(reader, 4);
+            pyResult = reader->failed ? NULL : PyList_New(0);
+            for (i = 0; pyResult != NULL && i < numValues; ++i) {
+                pyValue = captureValueToPy(reader, &pyKey, flags, depth + 1);
+                // does not steal ref to value
+                if (pyValue == NULL || PyList_Append(pyResult, pyValue)) {
+                    goto ERROR;
+                }
+                Py_CLEAR(pyKey);
+                Py_CLEAR(pyValue);
+            }
+        } break;
+        default: {
+            reader->failed = 1;
+        }
+    }
+    if (pyResult != NULL && !reader->failed) {
+        return pyResult;
+    }
+ERROR:
+    Py_XDECREF(pyResult);
+    Py_XDECREF(pyKey);
+    Py_XDECREF(pyValue);
+    Py_CLEAR(*name);
+    if (!PyErr_Occurred()) {
+        PyErr_SetString(PyExc_ValueError, "Malformed capture record");
+    }
+    return NULL;
+}
+
+/* Keys of the dicts of decoded records, besides those of the dicts of
+   converted messages */
+static PyObject* recordedAtKey = NULL;
+static PyObject* eventTypeKey = NULL;
+static PyObject* messagesKey = NULL;
+static PyObject* serviceKey = NULL;
+static PyObject* recapTypeKey = NULL;
+static PyObject* fragmentTypeKey = NULL;
+static PyObject* timeReceivedKey = NULL;
+
+/* Sets 'key' of 'dict' to 'value', stealing the reference to 'value'.
+   Returns 0, or non-zero with an error set. */
+static int captureSetItem(PyObject* dict,
+                          PyObject** cachedKey,
+                          const char* key,
+                          PyObject* value) {
+    PyObject* pyKey = constantKey(cachedKey, key);
+    int rc = value == NULL || pyKey == NULL
+        || PyDict_SetItem(dict, pyKey, value);
+    Py_XDECREF(value);
+    return rc;
+}
+
+static PyObject* captureMessageToPy(CaptureReader* reader, const int flags) {
+    PyObject* pyDict = PyDict_New();
+    PyObject* pyCorrelationIds = NULL;
+    PyObject* pyValue = NULL;
+    PyObject* pyName = NULL;
+    size_t numCorrelationIds, i;
+    long long nanos;
+    if (pyDict == NULL
+            || captureSetItem(pyDict, &messageTypeKey, "messageType",
+                              captureStringToPy(reader, 1))
+            || captureSetItem(pyDict, &topicNameKey, "topicName",
+                              captureStringToPy(reader, 0))
+            || captureSetItem(pyDict, &serviceKey, "service",
+                              captureStringToPy(reader, 1))
+            || captureSetItem(pyDict, &recapTypeKey, "recapType",
+                              PyLong_FromLong((int) captureGetInt(reader, 4)))
+            || captureSetItem(pyDict, &fragmentTypeKey, "fragmentType",
+                              PyLong_FromLong(
+                                      (int) captureGetInt(reader, 4)))) {
+        goto ERROR;
+    }
+    nanos = (long long) captureGetInt(reader, 8);
+    if (nanos == CAPTURE_NO_TIME) {
+        Py_INCREF(Py_None);
+        pyValue = Py_None;
+    }
+    else {
+        pyValue = PyLong_FromLongLong(nanos);
+    }
+    if (captureSetItem(pyDict, &timeReceivedKey, "timeReceived", pyValue)) {
+        pyValue = NULL;
+        goto ERROR;
+    }
+
+    numCorrelationIds = (size_t) captureGetInt(reader, 4);
+    pyCorrelationIds = reader->failed ? NULL : PyList_New(0);
+    for (i = 0; pyCorrelationIds != NULL && i < numCorrelationIds; ++i) {
+        const int valueType = (int) captureGetInt(reader, 1);
+        const unsigned long long value = captureGetInt(reader, 8);
+        if (valueType == BLPAPI_CORRELATION_TYPE_INT
+                || valueType == BLPAPI_CORRELATION_TYPE_AUTOGEN) {
+            pyValue = PyLong_FromUnsignedLongLong(value);
+        }
+        else {
+            Py_INCREF(Py_None);
+            pyValue = Py_None;
+        }
+        // does not steal ref to value
+        if (pyValue == NULL || PyList_Append(pyCorrelationIds, pyValue)) {
+            goto ERROR;
+        }
+        Py_CLEAR(pyValue);
+    }
+    if (reader->failed
+            || captureSetItem(pyDict, &correlationIdsKey, "correlationIds",
+                              pyCorrelationIds)) {
+        pyCorrelationIds = NULL;
+        goto ERROR;
+    }
+    pyCorrelationIds = NULL;
+
+    pyValue = captureValueToPy(reader, &pyName, flags, 0);
+    Py_XDECREF(pyName);
+    if (captureSetItem(pyDict, &elementsKey, "elements", pyValue)) {
+        pyValue = NULL;
+        goto ERROR;
+    }
+    return pyDict;
+
+ERROR:
+    Py_XDECREF(pyDict);
+    Py_XDECREF(pyValue);
+    Py_XDECREF(pyCorrelationIds);
+    if (!PyErr_Occurred()) {
+        PyErr_SetString(PyExc_ValueError, "Malformed capture record");
+    }
+    return NULL;
+}
+
+/* Returns the record of the event, encoded without holding the GIL. */
+static PyObject* fast_blpapi_Event_encode(PyObject* self, PyObject* args) {
+    PyObject *eventObj, *result = NULL;
+    void* event;
+    long long recordedAt;
+    DecodedEvent* decoded;
+    CaptureBuffer buffer = { NULL, 0, 0, 0 };
+    if (!PyArg_ParseTuple(args, "OL", &eventObj, &recordedAt)
+            || handleFromPy(eventObj, &event)) {
+        return NULL;
+    }
+    Py_BEGIN_ALLOW_THREADS
+    decoded = decodeEvent((blpapi_Event_t*) event, 0, NULL, 0);
+    if (decoded != NULL && decoded->error == NULL) {
+        captureEncodeEvent(
+                &buffer, (blpapi_Event_t*) event, decoded, recordedAt);
+    }
+    Py_END_ALLOW_THREADS
+    if (decoded == NULL || buffer.failed) {
+        PyErr_NoMemory();
+    }
+    else if (decoded->error != NULL) {
+        PyErr_SetString(PyExc_Exception, decoded->error);
+    }
+    else {
+        result = PyBytes_FromStringAndSize(
+                (const char*) buffer.data, (Py_ssize_t) buffer.size);
+    }
+    if (decoded != NULL) {
+        destroyDecodedEvent(decoded);
+    }
+    free(buffer.data);
+    return result;
+}
+
+/* Returns the dict of the record held by the 'bytes' argument, without its
+   size, the datetimes being converted with 'flags'. */
+static PyObject* fast_CaptureRecord_toPy(PyObject* self, PyObject* args) {
+    PyObject *recordObj, *pyDict, *pyMessages;
+    char* data;
+    Py_ssize_t size;
+    int flags;
+    size_t numMessages, i;
+    CaptureReader reader;
+    if (!PyArg_ParseTuple(args, "Oi", &recordObj, &flags)
+            || PyBytes_AsStringAndSize(recordObj, &data, &size)) {
+        return NULL;
+    }
+    reader.data = (const unsigned char*) data;
+    reader.end = reader.data + size;
+    reader.failed = 0;
+    pyDict = PyDict_New();
+    if (pyDict == NULL
+            || captureSetItem(pyDict, &recordedAtKey, "recordedAt",
+                              PyLong_FromLongLong(
+                                      (long long) captureGetInt(&reader, 8)))
+            || captureSetItem(pyDict, &eventTypeKey, "eventType",
+                              PyLong_FromLong(
+                                      (int) captureGetInt(&reader, 4)))) {
+        goto ERROR;
+    }
+    numMessages = (size_t) captureGetInt(&reader, 4);
+    pyMessages = reader.failed ? NULL : PyList_New(0);
+    if (captureSetItem(pyDict, &messagesKey, "messages", pyMessages)) {
+        goto ERROR;
+    }
+    // 'pyDict' holds a reference to 'pyMessages'
+    for (i = 0; i < numMessages; ++i) {
+        PyObject* pyValue = captureMessageToPy(&reader, flags);
+        // does not steal ref to value
+        if (pyValue == NULL || PyList_Append(pyMessages, pyValue)) {
+            Py_XDECREF(pyValue);
+            goto ERROR;
+        }
+        Py_DECREF(pyValue);
+    }
+    if (reader.failed || reader.data != reader.end) {
+        goto ERROR;
+    }
+    return pyDict;
+
+ERROR:
+    Py_XDECREF(pyDict);
+    if (!PyErr_Occurred()) {
+        PyErr_SetString(PyExc_ValueError, "Malformed capture record");
+    }
+    return NULL;
+}
+
+/* Schema plans. A plan is the definition of an element and the definitions
+   of the elements of its type, recursively, walked once in a single call,
+   where walking them from python costs about ten calls per element. The
+   types are numbered in the order in which they are first reached and each
+   one is walked once, however many elements have it, which also ends the
+   walk of recursive types. */
+
+static PyObject* schemaPlanElement(
+        const blpapi_SchemaElementDefinition_t* definition,
+        PyObject* types,
+        PyObject* indexes);
+
+/* Returns a new reference to the interned name of 'name', 'None' if it is
+   NULL. */
+static PyObject* schemaPlanName(const blpapi_Name_t* name) {
+    PyObject* key;
+    if (name == NULL) {
+        Py_RETURN_NONE; // inc ref and return
+    }
+    key = nameToPyKey(name);
+    Py_XINCREF(key);
+    return key;
+}
+
+/* Returns the tuple of the names of the constants of the enumeration
+   'type', or 'None' if 'type' is not an enumeration. */
+static PyObject* schemaPlanEnumeration(
+        const blpapi_SchemaTypeDefinition_t* type) {
+    const blpapi_ConstantList_t* constants;
+    PyObject* names;
+    int numConstants, i;
+    if (!blpapi_SchemaTypeDefinition_isEnumerationType(type)
+            || (constants = blpapi_SchemaTypeDefinition_enumeration(type))
+                    == NULL) {
+        Py_RETURN_NONE; // inc ref and return
+    }
+    numConstants = blpapi_ConstantList_numConstants(constants);
+    names = PyTuple_New(numConstants < 0 ? 0 : numConstants);
+    for (i = 0; names != NULL && i < numConstants; ++i) {
+        PyObject* name = schemaPlanName(blpapi_Constant_name(
+                blpapi_ConstantList_getConstantAt(constants, (size_t) i)));
+        // steals ref to name, even on failure
+        if (name == NULL || PyTuple_SetItem(names, i, name)) {
+            Py_CLEAR(names);
+        }
+    }
+    return names;
+}
+
+/* Returns the index in 'types' of the '(name, datatype, fields,
+   enumeration)' entry of 'type', walked and appended if 'type' is not a key
+   of 'indexes' yet, or -1 on error. */
+static Py_ssize_t schemaPlanType(const blpapi_SchemaTypeDefinition_t* type,
+                                 PyObject* types,
+                                 PyObject* indexes) {
+    PyObject *key, *indexObj, *fields = NULL, *entry;
+    Py_ssize_t index;
+    size_t numFields, i;
+    key = PyLong_FromVoidPtr((void*) type);
+    if (key == NULL) {
+        return -1;
+    }
+    indexObj = PyDict_GetItem(indexes, key); // borrowed
+    if (indexObj != NULL) {
+        Py_DECREF(key);
+        return PyLong_AsSsize_t(indexObj);
+    }
+    // numbered before its fields are walked, for the recursive types
+    index = PyList_Size(types);
+    indexObj = PyLong_FromSsize_t(index);
+    if (indexObj == NULL || PyDict_SetItem(indexes, key, indexObj)
+            || PyList_Append(types, Py_None)) {
+        goto ERROR;
+    }
+    Py_CLEAR(indexObj);
+    numFields = blpapi_SchemaTypeDefinition_isComplexType(type)
+                      ? blpapi_SchemaTypeDefinition_numElementDefinitions(type)
+                      : 0;
+    fields = PyTuple_New((Py_ssize_t) numFields);
+    for (i = 0; fields != NULL && i < numFields; ++i) {
+        PyObject* field = schemaPlanElement(
+                blpapi_SchemaTypeDefinition_getElementDefinitionAt(type, i),
+                types,
+                indexes);
+        // steals ref to field, even on failure
+        if (field == NULL
+                || PyTuple_SetItem(fields, (Py_ssize_t) i, field)) {
+            goto ERROR;
+        }
+    }
+    if (fields == NULL) {
+        goto ERROR;
+    }
+    entry = Py_BuildValue("(NiNN)",
+                          schemaPlanName(
+                                  blpapi_SchemaTypeDefinition_name(type)),
+                          blpapi_SchemaTypeDefinition_datatype(type),
+                          fields,
+                          schemaPlanEnumeration(type));
+    // 'entry' stole the reference to 'fields', even on failure
+    fields = NULL;
+    // steals ref to entry, even on failure
+    if (entry == NULL || PyList_SetItem(types, index, entry)) {
+        goto ERROR;
+    }
+    Py_DECREF(key);
+    return index;
+
+ERROR:
+    Py_XDECREF(indexObj);
+    Py_XDECREF(fields);
+    Py_DECREF(key);
+    return -1;
+}
+
+/* Returns the '(name, typeIndex, minValues, maxValues)' tuple of
+   'definition', the type of 'definition' being walked into 'types', or NULL
+   on error. 'maxValues' is -1 for unbounded arrays. */
+static PyObject* schemaPlanElement(
+        const blpapi_SchemaElementDefinition_t* definition,
+        PyObject* types,
+        PyObject* indexes) {
+    Py_ssize_t typeIndex;
+    size_t maxValues;
+    if (definition == NULL) {
+        PyErr_SetString(PyExc_Exception,
+                        "Internal error getting SchemaElementDefinition");
+        return NULL;
+    }
+    typeIndex = schemaPlanType(
+            blpapi_SchemaElementDefinition_type(definition), types, indexes);
+    if (typeIndex < 0) {
+        return NULL;
+    }
+    maxValues = blpapi_SchemaElementDefinition_maxValues(definition);
+    return Py_BuildValue(
+            "(NnnL)",
+            schemaPlanName(blpapi_SchemaElementDefinition_name(definition)),
+            typeIndex,
+            (Py_ssize_t) blpapi_SchemaElementDefinition_minValues(definition),
+            maxValues == (size_t) BLPAPI_ELEMENTDEFINITION_UNBOUNDED
+                    ? -1LL
+                    : (long long) maxValues);
+}
+
+/* Returns '(element, types)', the plan of the element definition, see
+   'schemaPlanElement' and 'schemaPlanType'. */
+static PyObject* fast_SchemaPlan_compile(PyObject* self, PyObject* args) {
+    PyObject *definitionObj, *types, *indexes, *element, *result = NULL;
+    void* definition;
+    if (!PyArg_ParseTuple(args, "O", &definitionObj)
+            || handleFromPy(definitionObj, &definition)) {
+        return NULL;
+    }
+    types = PyList_New(0);
+    indexes = PyDict_New();
+    if (types != NULL && indexes != NULL) {
+        element = schemaPlanElement(
+                (const blpapi_SchemaElementDefinition_t*) definition,
+                types,
+                indexes);
+        if (element != NULL) {
+            result = Py_BuildValue("(NO)", element, types);
+        }
+    }
+    Py_XDECREF(types);
+    Py_XDECREF(indexes);
+    return result;
+}
+
+#define FAST_METHOD(FUNC) { #FUNC, fast_##FUNC, METH_VARARGS, NULL }
+
+static PyMethodDef ffiutilsMethods[] = {
+    FAST_METHOD(CaptureRecord_toPy),
+    FAST_METHOD(CorrelationIdTable_create),
+    FAST_METHOD(CorrelationIdTable_get),
+    FAST_METHOD(CorrelationIdTable_remove),
+    FAST_METHOD(CorrelationIdTable_set),
+    FAST_METHOD(CorrelationIdTable_size),
+    FAST_METHOD(EventHandler_create),
+    FAST_METHOD(EventHandler_userData),
+    FAST_METHOD(EventPipe_close),
+    FAST_METHOD(EventPipe_create),
+    FAST_METHOD(EventPipe_drain),
+    FAST_METHOD(LastValueCache_create),
+    FAST_METHOD(LastValueCache_get),
+    FAST_METHOD(LastValueCache_keys),
+    FAST_METHOD(LastValueCache_poll),
+    FAST_METHOD(LastValueCache_remove),
+    FAST_METHOD(LastValueCache_size),
+    FAST_METHOD(LastValueCache_update),
+    FAST_METHOD(LatencyMonitor_create),
+    FAST_METHOD(LatencyMonitor_record),
+    FAST_METHOD(LatencyMonitor_snapshot),
+    FAST_METHOD(LogBuffer_drain),
+    FAST_METHOD(LogBuffer_dropped),
+    FAST_METHOD(LogBuffer_register),
+    FAST_METHOD(SchemaPlan_compile),
+    FAST_METHOD(blpapi_DecodedEvent_numMessages),
+    FAST_METHOD(blpapi_DecodedEvent_toColumns),
+    FAST_METHOD(blpapi_DecodedEvent_toPy),
+    FAST_METHOD(blpapi_Element_appendValues),
+    FAST_METHOD(blpapi_Element_datatype),
+    FAST_METHOD(blpapi_Element_fromPy),
+    FAST_METHOD(blpapi_Element_getElement),
+    FAST_METHOD(blpapi_Element_getElementAt),
+    FAST_METHOD(blpapi_Element_getItem),
+    FAST_METHOD(blpapi_Element_getValueAsBool),
+    FAST_METHOD(blpapi_Element_getValueAsFloat64),
+    FAST_METHOD(blpapi_Element_getValueAsInt64),
+    FAST_METHOD(blpapi_Element_getValueAsString),
+    FAST_METHOD(blpapi_Element_hasElementEx),
+    FAST_METHOD(blpapi_Element_isArray),
+    FAST_METHOD(blpapi_Element_isComplexType),
+    FAST_METHOD(blpapi_Element_isNull),
+    FAST_METHOD(blpapi_Element_numElements),
+    FAST_METHOD(blpapi_Element_numValues),
+    FAST_METHOD(blpapi_EventFormatter_appendMessagesFromPy),
+    FAST_METHOD(blpapi_EventFormatter_appendValues),
+    FAST_METHOD(blpapi_EventFormatter_fromPy),
+    FAST_METHOD(blpapi_EventQueue_drainEvents),
+    FAST_METHOD(blpapi_Event_decode),
+    FAST_METHOD(blpapi_Event_encode),
+    FAST_METHOD(blpapi_Event_route),
+    FAST_METHOD(blpapi_MessageIterator_next),
+    FAST_METHOD(blpapi_Message_correlationIdInts),
+    FAST_METHOD(blpapi_Session_drainEvents),
+    FAST_METHOD(blpapi_SubscriptionList_addMany),
+    { NULL, NULL, 0, NULL }
+};
+
+static struct PyModuleDef ffiutilsModule = {
+    PyModuleDef_HEAD_INIT,
+    "blpapi.ffiutils",
+    "Compiled helpers of the blpapi package. For internal use.",
+    -1,
+    ffiutilsMethods,
+    NULL, NULL, NULL, NULL
+};
+
+/* The library is also loaded by 'internals.py' with 'ctypes.PyDLL' to use
+   the exported 'blpapi_*_toPy' functions and the managed pointer helpers.
+*/
+PyMODINIT_FUNC PyInit_ffiutils(void) {
+    PyObject* ctypesModule;
+    PyObject* module;
+    if (voidPtrType == NULL) {
+        ctypesModule = PyImport_ImportModule("ctypes");
+        if (ctypesModule == NULL) {
+            return NULL;
+        }
+        voidPtrType = PyObject_GetAttrString(ctypesModule, "c_void_p");
+        Py_DECREF(ctypesModule);
+        if (voidPtrType == NULL) {
+            return NULL;
+        }
+        valueAttr = PyUnicode_InternFromString("value");
+        if (valueAttr == NULL) {
+            Py_CLEAR(voidPtrType);
+            return NULL;
+        }
+    }
+    module = PyModule_Create(&ffiutilsModule);
+#ifdef Py_GIL_DISABLED
+    if (module != NULL) {
+        PyUnstable_Module_SetGIL(module, Py_MOD_GIL_NOT_USED);
+    }
+#endif
+    return module;
 }
@@ -0,0 +1,117 @@
+# fieldselector.py
+
+"""Provide a precompiled selection of fields for partial conversions.
+
+This file defines a 'FieldSelector' which holds a list of field 'Name's
+resolved once, so that 'Element.toPy', 'Message.toPy' and 'Event.toPy' can
+convert only the selected sub-elements instead of the whole element tree.
+
+Usage
+-----
+The following snippet converts only the 'BID' and 'ASK' fields of the
+messages of a subscription data event.
+
+    selector = FieldSelector(["BID", "ASK"])
+    for msg in event:
+        quote = msg.toPy(fields=selector)
+"""
+
+from __future__ import annotations
+from ctypes import c_void_p
+from typing import Iterable, List, Union
+from .name import Name
+
+
+class FieldSelector:
+    """An immutable list of field :class:`Name`\\ s used to convert only a
+    subset of the sub-elements of a complex :class:`Element`.
+
+    A :class:`FieldSelector` resolves each field name once, when it is
+    created, so it should be created once and reused for every conversion.
+
+    Converting with a :class:`FieldSelector` produces a :py:class:`dict`
+    whose keys are the selected fields present in the converted element, in
+    the order in which they were given. Fields that are not part of the
+    element are skipped.
+    """
+
+    def __init__(self, fields: Iterable[Union[Name, str]]) -> None:
+        """
+        Args:
+            fields: Names of the top-level fields to select
+
+        Raises:
+            TypeError: If any of ``fields`` is neither a :class:`Name` nor a
+                string
+        """
+        names: List[Name] = []
+        for field in fields:
+            if isinstance(field, Name):
+                names.append(field)
+            elif isinstance(field, str):
+                names.append(Name(field))
+            else:
+                raise TypeError(
+                    f"Field must be a Name or a string, got {field!r}"
+                )
+        # The 'Name' objects are kept alive for as long as their handles
+        # are referenced by the array.
+        self.__names = tuple(names)
+        # pylint: disable=protected-access
+        self.__handles = (c_void_p * len(names))(
+            *(name._handle() for name in names)
+        )
+
+    def names(self) -> List[Name]:
+        """
+        Returns:
+            The selected field :class:`Name`\\ s.
+        """
+        return list(self.__names)
+
+    def __len__(self) -> int:
+        return len(self.__names)
+
+    def _handles(self) -> c_void_p:
+        """Return the array of 'blpapi_Name_t*' of the selected fields.
+
+        For internal use."""
+        return self.__handles  # type: ignore
+
+    def __repr__(self) -> str:
+        return (
+            "FieldSelector(["
+            + ", ".join(repr(str(name)) for name in self.__names)
+            + "])"
+        )
+
+
+def toFieldSelector(
+    fields: Union[FieldSelector, Iterable[Union[Name, str]]]
+) -> FieldSelector:
+    """Return 'fields' as a 'FieldSelector'. For internal use."""
+    if isinstance(fields, FieldSelector):
+        return fields
+    return FieldSelector(fields)
+
+
+__copyright__ = """
+Copyright 2024. Bloomberg Finance L.P.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to
+deal in the Software without restriction, including without limitation the
+rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+sell copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:  The above
+copyright notice and this permission notice shall be included in all copies
+or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+IN THE SOFTWARE.
+"""
@@ -19,9 +19,9 @@ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
 IN THE SOFTWARE.
 """
 
-import platform
-import glob
+import functools
 import os
+import sys
 from typing import Optional, List, Callable, Any
 
 # Note: all functions here assume we are given an opaque handle,
@@ -68,18 +68,92 @@ from .ctypesutils import (
     getStructFromOutput,
     getSizedStrFromBuffer,
     getSizedBytesFromOutput,
+    getMemoryViewFromOutput,
     voidFromPyObject,
     voidFromPyFunction,
 )
 
 
 # ============= Library loading
+class _LazyFunction:
+    """A function of the shared library, looked up on its first call.
+
+    The 'argtypes' and 'restype' set before the first call are given to the
+    function looked up, which then replaces this object as 'l_<name>' in this
+    module, so that the calls through 'l_<name>' pay no indirection once the
+    function is looked up. Most processes call only a few of the functions
+    bound below, and short-lived ones may call none of them."""
+
+    __slots__ = ("_library", "_name", "_function", "_argtypes", "_restype")
+
+    def __init__(self, library: CDLL, name: str) -> None:
+        self._library = library
+        self._name = name
+        self._function: Any = None
+        self._argtypes: Any = None
+        self._restype: Any = c_int
+
+    def _resolve(self) -> Any:
+        if self._function is None:
+            function = self._library[self._name]
+            if self._argtypes is not None:
+                function.argtypes = self._argtypes
+            function.restype = self._restype
+            self._function = function
+            if globals().get("l_" + self._name) is self:
+                globals()["l_" + self._name] = function
+        return self._function
+
+    @property
+    def argtypes(self) -> Any:
+        if self._function is not None:
+            return self._function.argtypes
+        return self._argtypes
+
+    @argtypes.setter
+    def argtypes(self, argtypes: Any) -> None:
+        if self._function is not None:
+            self._function.argtypes = argtypes
+        self._argtypes = argtypes
+
+    @property
+    def restype(self) -> Any:
+        if self._function is not None:
+            return self._function.restype
+        return self._restype
+
+    @restype.setter
+    def restype(self, restype: Any) -> None:
+        if self._function is not None:
+            self._function.restype = restype
+        self._restype = restype
+
+    def __call__(self, *args: Any) -> Any:
+        return self._resolve()(*args)
+
+
+class _LazyLibrary(CDLL):
+    """The blpapi shared library, whose functions accessed as attributes are
+    looked up on their first call, see '_LazyFunction'. Indexing looks the
+    functions up immediately, as for 'CDLL'."""
+
+    def __getattr__(self, name: str) -> Any:
+        if name.startswith("__") and name.endswith("__"):
+            raise AttributeError(name)
+        function = _LazyFunction(self, name)
+        setattr(self, name, function)
+        return function
+
+
 def _loadLibrary() -> Any:
     """Load blpapi  shared library/dll"""
-    bitness = "64" if platform.architecture()[0].startswith("64") else "32"
-    prefix = "" if platform.system().lower() == "windows" else "lib"
-    libsuffix = ".dll" if platform.system().lower() == "windows" else ".so"
-    topysuffix = ".pyd" if platform.system().lower() == "windows" else ".so"
+    # 'os' and 'sys' rather than 'platform' and 'glob', which cost more to
+    # import than loading the library
+    windows = os.name == "nt"
+    bitness = "64" if sys.maxsize > 2**32 else "32"
+    prefix = "" if windows else "lib"
+    libsuffix = ".dll" if windows else ".so"
+    topysuffix = ".pyd" if windows else ".so"
     libname = f"{prefix}blpapi3_{bitness}{libsuffix}"
 
     # it is either next to this file (we are in wheel)
@@ -88,23 +162,67 @@ def _loadLibrary() -> Any:
         libpath = os.path.join(
             os.path.abspath(os.path.dirname(__file__)), libname
         )
-        lib = CDLL(libpath)
+        lib = _LazyLibrary(libpath)
     except OSError:
-        lib = CDLL(libname)
+        lib = _LazyLibrary(libname)
 
-    for filename in glob.glob(
-        os.path.join(
-            os.path.abspath(os.path.dirname(__file__)),
-            "ffiutils.*" + topysuffix,
-        )
-    ):
-        toPy = PyDLL(filename)
-        break
+    libdir = os.path.abspath(os.path.dirname(__file__))
+    for filename in os.listdir(libdir):
+        if filename.startswith("ffiutils.") and filename.endswith(topysuffix):
+            toPy = PyDLL(os.path.join(libdir, filename))
+            break
     return lib, toPy
 
 
 libblpapict, libffastcalls = _loadLibrary()
+libffastcalls.blpapi_Element_keysToPy.argtypes = [c_void_p]
+libffastcalls.blpapi_Element_keysToPy.restype = py_object
+libffastcalls.blpapi_Element_toJson.argtypes = [
+    c_void_p,
+    c_int,
+    c_void_p,
+    c_size_t,
+]
+libffastcalls.blpapi_Element_toJson.restype = py_object
 libffastcalls.blpapi_Element_toPy.restype = py_object
+libffastcalls.blpapi_Element_toPyFields.argtypes = [
+    c_void_p,
+    c_void_p,
+    c_size_t,
+    c_int,
+]
+libffastcalls.blpapi_Element_toPyFields.restype = py_object
+libffastcalls.blpapi_Element_valueToPy.argtypes = [
+    c_void_p,
+    c_size_t,
+    c_int,
+]
+libffastcalls.blpapi_Element_valueToPy.restype = py_object
+libffastcalls.blpapi_Event_toPy.argtypes = [
+    c_void_p,
+    c_int,
+    c_void_p,
+    c_size_t,
+]
+libffastcalls.blpapi_Event_toPy.restype = py_object
+libffastcalls.blpapi_Event_toColumns.argtypes = [
+    c_void_p,
+    c_void_p,
+    c_size_t,
+    py_object,
+    c_size_t,
+]
+libffastcalls.blpapi_Event_toColumns.restype = py_object
+libffastcalls.blpapi_Event_toRows.argtypes = [
+    c_void_p,
+    c_void_p,
+    c_size_t,
+    c_void_p,
+    c_size_t,
+    py_object,
+    c_size_t,
+]
+libffastcalls.blpapi_Event_toRows.restype = py_object
 
 libffastcalls.incref.argtypes = [py_object]
 incref = libffastcalls.incref
@@ -120,6 +238,8 @@ from .pycbhelpers import (
     any_printer,
     anySessionEventHandlerWrapper,
     anySessionSubErrorHandlerWrapper,
+    dispatchEventToHandler,
+    handleEventHandlerError,
     StreamWrapper,
 )
 
@@ -297,6 +417,28 @@ DATETIME_TIME_PART = (
 DATETIME_TIMEMILLI_PART = DATETIME_TIME_PART | DATETIME_MILLISECONDS_PART
 DATETIME_TIMEFRACSECONDS_PART = DATETIME_TIME_PART | DATETIME_FRACSECONDS_PART
 
+TOPY_DATETIME_AS_EPOCH_NANOS = 0x1  # must match ffi_utils.c
+
+COLUMNKIND_INT64 = 0  # must match ffi_utils.c
+COLUMNKIND_FLOAT64 = 1
+COLUMNKIND_BOOL = 2
+COLUMNKIND_TIMESTAMP = 3
+COLUMNKIND_OBJECT = 4
+
+ITEMKIND_VALUE = 0  # must match ffi_utils.c
+ITEMKIND_ELEMENT = 1
+ITEMKIND_NAME = 2
+
+FROMPY_ERROR = 0  # must match ffi_utils.c
+FROMPY_RAISE = 1
+FROMPY_ALREADY_FORMATTED = 2
+FROMPY_NOT_COMPLEX = 3
+FROMPY_NOT_ARRAY = 4
+FROMPY_MAPPING_ENTRY = 5
+FROMPY_NESTED_SEQUENCE = 6
+FROMPY_SCALAR_ENTRY = 7
+FROMPY_NOT_SCALAR = 8
+
 ELEMENTDEFINITION_UNBOUNDED = -1
 ELEMENT_INDEX_END = 0xFFFFFFFF
 
@@ -1550,6 +1692,11 @@ l_blpapi_TestUtil_serializeService = (
     libblpapict.blpapi_TestUtil_serializeService
 )  # int
 
+l_blpapi_TimePointUtil_nanosecondsBetween = (
+    libblpapict.blpapi_TimePointUtil_nanosecondsBetween
+)
+l_blpapi_TimePointUtil_nanosecondsBetween.restype = c_int64
+
 l_blpapi_TlsOptions_createFromBlobs = (
     libblpapict.blpapi_TlsOptions_createFromBlobs
 )
@@ -2082,6 +2229,18 @@ def _blpapi_Element_getValueAsBytes(element, index):
     return retCode, getSizedBytesFromOutput(outp, szoutp, retCode)
 
 
+# signature: int blpapi_Element_getValueAsBytes(const blpapi_Element_t *element, const char **buffer, size_t *length, size_t index);
+def _blpapi_Element_getValueAsBytesView(element, index, owner):
+    out = c_char_p()
+    outp = pointer(out)
+    szout = c_size_t()
+    szoutp = pointer(szout)
+    retCode = l_blpapi_Element_getValueAsBytes(
+        element, outp, szoutp, c_size_t(index)
+    )
+    return retCode, getMemoryViewFromOutput(outp, szoutp, retCode, owner)
+
+
 # signature: int blpapi_Element_getValueAsChar(const blpapi_Element_t *element, blpapi_Char_t *buffer, size_t index);
 def _blpapi_Element_getValueAsChar(element, index):
     out = c_char()
@@ -2195,6 +2354,11 @@ def _blpapi_Element_isReadOnly(element):
     return l_blpapi_Element_isReadOnly(element)
 
 
+# signature:
+def _blpapi_Element_keysToPy(element):
+    return libffastcalls.blpapi_Element_keysToPy(element)
+
+
 # signature:  blpapi_Name_t *blpapi_Element_name(const blpapi_Element_t *element);
 def _blpapi_Element_name(element):
     return getHandleFromPtr(l_blpapi_Element_name(element))
@@ -2379,8 +2543,27 @@ def _blpapi_Element_setValueString(element, value, index):
 
 
 # signature:
-def _blpapi_Element_toPy(element):
-    return libffastcalls.blpapi_Element_toPy(element)
+def _blpapi_Element_toJson(element, flags, fields, numFields):
+    return libffastcalls.blpapi_Element_toJson(
+        element, flags, fields, numFields
+    )
+
+
+# signature:
+def _blpapi_Element_toPy(element, flags):
+    return libffastcalls.blpapi_Element_toPy(element, flags)
+
+
+# signature:
+def _blpapi_Element_toPyFields(element, fields, numFields, flags):
+    return libffastcalls.blpapi_Element_toPyFields(
+        element, fields, numFields, flags
+    )
+
+
+# signature:
+def _blpapi_Element_valueToPy(element, index, flags):
+    return libffastcalls.blpapi_Element_valueToPy(element, index, flags)
 
 
 # signature: blpapi_EventDispatcher_t *blpapi_EventDispatcher_create(size_t numDispatcherThreads);
@@ -2717,6 +2900,27 @@ def _blpapi_Event_release(event):
     return l_blpapi_Event_release(event)
 
 
+# signature:
+def _blpapi_Event_toColumns(event, fields, numFields, columns, numRows):
+    return libffastcalls.blpapi_Event_toColumns(
+        event, fields, numFields, columns, numRows
+    )
+
+
+# signature:
+def _blpapi_Event_toRows(
+    event, path, pathLength, fields, numFields, columns, numRows
+):
+    return libffastcalls.blpapi_Event_toRows(
+        event, path, pathLength, fields, numFields, columns, numRows
+    )
+
+
+# signature:
+def _blpapi_Event_toPy(event, flags, fields, numFields):
+    return libffastcalls.blpapi_Event_toPy(event, flags, fields, numFields)
+
+
 # signature: int blpapi_HighPrecisionDatetime_compare(const blpapi_HighPrecisionDatetime_t *lhs,const blpapi_HighPrecisionDatetime_t *rhs);
 def _blpapi_HighPrecisionDatetime_compare(lhs, rhs):
     raise NotImplementedError("not called")
@@ -3158,6 +3362,37 @@ def _blpapi_Message_correlationId(message, index):
     return cid
 
 
+# Return the values of the correlation ids of 'message', as 'int's for the
+# integer and generated ones, 'None' for the others.
+def _blpapi_Message_correlationIdInts(message):
+    res = []
+    for i in range(l_blpapi_Message_numCorrelationIds(message)):
+        cid = l_blpapi_Message_correlationId(message, c_size_t(i))
+        if cid.flags.valueType in (
+            CORRELATION_TYPE_INT,
+            CORRELATION_TYPE_AUTOGEN,
+        ):
+            res.append(cid.rawvalue.intValue)
+        else:
+            res.append(None)
+    return res
+
+
+# Return the values of the correlation ids of 'message' of type
+# 'CORRELATION_TYPE_INT', 'None' for the others, including the generated
+# ones. Used to route the messages when the extension module is not
+# available.
+def _blpapi_Message_intCorrelationIds(message):
+    res = []
+    for i in range(l_blpapi_Message_numCorrelationIds(message)):
+        cid = l_blpapi_Message_correlationId(message, c_size_t(i))
+        if cid.flags.valueType == CORRELATION_TYPE_INT:
+            res.append(cid.rawvalue.intValue)
+        else:
+            res.append(None)
+    return res
+
+
 # signature: blpapi_Element_t *blpapi_Message_elements(const blpapi_Message_t *message);
 def _blpapi_Message_elements(message):
     return getHandleFromPtr(l_blpapi_Message_elements(message))
@@ -4873,7 +5108,7 @@ def _blpapi_TestUtil_serializeServiceHelper(service):
 
 # signature: long long blpapi_TimePointUtil_nanosecondsBetween(const blpapi_TimePoint_t *start, const blpapi_TimePoint_t *end);
 def _blpapi_TimePointUtil_nanosecondsBetween(start, end):
-    raise NotImplementedError("not called")
+    return l_blpapi_TimePointUtil_nanosecondsBetween(byref(start), byref(end))
 
 
 # signature: blpapi_TlsOptions_t *blpapi_TlsOptions_createFromBlobs(const char *clientCredentialsRawData,int clientCredentialsRawDataLength,const char *clientCredentialsPassword,const char *trustedCertificatesRawData,int trustedCertificatesRawDataLength);
@@ -5090,6 +5325,20 @@ def _blpapi_getVersionInfo():
     )
 
 
+def _eventHandlerParams(eventHandlerFunc):
+    # eventHandlerFunc is the result of 'createEventHandler'
+    # returns the handler and user data given to 'blpapi_*Session_create'
+    if callable(eventHandlerFunc):
+        return (
+            anySessionEventHandlerWrapper.get(),
+            voidFromPyFunction(eventHandlerFunc),
+        )
+    return (
+        cast(libffastcalls.dispatchEvent, c_void_p),
+        c_void_p(_ffiutils.EventHandler_userData(eventHandlerFunc)),
+    )
+
+
 def _ProviderSession_createHelper(parameters, eventHandlerFunc, dispatcher):
     # parameters is a handle to SessionOptions
     # eventHandlerFunc is python callback
@@ -5097,8 +5346,7 @@ def _ProviderSession_createHelper(parameters, eventHandlerFunc, dispatcher):
     # returns handle to Session
     hasHandler = eventHandlerFunc is not None
     if hasHandler:
-        handlerparam = anySessionEventHandlerWrapper.get()
-        userdata = voidFromPyFunction(eventHandlerFunc)
+        handlerparam, userdata = _eventHandlerParams(eventHandlerFunc)
     else:
         handlerparam = c_void_p(0)
         userdata = c_void_p(0)
@@ -5122,8 +5370,7 @@ def _Session_createHelper(parameters, eventHandlerFunc, dispatcher):
     # returns handle to Session
     hasHandler = eventHandlerFunc is not None
     if hasHandler:
-        handlerparam = anySessionEventHandlerWrapper.get()
-        userdata = voidFromPyFunction(eventHandlerFunc)
+        handlerparam, userdata = _eventHandlerParams(eventHandlerFunc)
     else:
         handlerparam = c_void_p(0)
         userdata = c_void_p(0)
@@ -5222,6 +5469,7 @@ blpapi_Element_getElement = _blpapi_Element_getElement
 blpapi_Element_getElementAt = _blpapi_Element_getElementAt
 blpapi_Element_getValueAsBool = _blpapi_Element_getValueAsBool
 blpapi_Element_getValueAsBytes = _blpapi_Element_getValueAsBytes
+blpapi_Element_getValueAsBytesView = _blpapi_Element_getValueAsBytesView
 blpapi_Element_getValueAsChar = _blpapi_Element_getValueAsChar
 blpapi_Element_getValueAsDatetime = _blpapi_Element_getValueAsDatetime
 blpapi_Element_getValueAsElement = _blpapi_Element_getValueAsElement
@@ -5239,6 +5487,7 @@ blpapi_Element_isComplexType = _blpapi_Element_isComplexType
 blpapi_Element_isNull = _blpapi_Element_isNull
 blpapi_Element_isNullValue = _blpapi_Element_isNullValue
 blpapi_Element_isReadOnly = _blpapi_Element_isReadOnly
+blpapi_Element_keysToPy = _blpapi_Element_keysToPy
 blpapi_Element_name = _blpapi_Element_name
 blpapi_Element_nameString = _blpapi_Element_nameString
 blpapi_Element_numElements = _blpapi_Element_numElements
@@ -5265,7 +5514,10 @@ blpapi_Element_setValueHighPrecisionDatetime = (
 blpapi_Element_setValueInt32 = _blpapi_Element_setValueInt32
 blpapi_Element_setValueInt64 = _blpapi_Element_setValueInt64
 blpapi_Element_setValueString = _blpapi_Element_setValueString
+blpapi_Element_toJson = _blpapi_Element_toJson
 blpapi_Element_toPy = _blpapi_Element_toPy
+blpapi_Element_toPyFields = _blpapi_Element_toPyFields
+blpapi_Element_valueToPy = _blpapi_Element_valueToPy
 blpapi_EventDispatcher_create = _blpapi_EventDispatcher_create
 blpapi_EventDispatcher_destroy = _blpapi_EventDispatcher_destroy
 blpapi_EventDispatcher_start = _blpapi_EventDispatcher_start
@@ -5333,6 +5585,9 @@ blpapi_EventQueue_purge = _blpapi_EventQueue_purge
 blpapi_EventQueue_tryNextEvent = _blpapi_EventQueue_tryNextEvent
 blpapi_Event_eventType = _blpapi_Event_eventType
 blpapi_Event_release = _blpapi_Event_release
+blpapi_Event_toColumns = _blpapi_Event_toColumns
+blpapi_Event_toPy = _blpapi_Event_toPy
+blpapi_Event_toRows = _blpapi_Event_toRows
 blpapi_HighPrecisionDatetime_compare = _blpapi_HighPrecisionDatetime_compare
 blpapi_HighPrecisionDatetime_fromTimePoint = (
     _blpapi_HighPrecisionDatetime_fromTimePoint
@@ -5438,6 +5693,8 @@ blpapi_MessageProperties_setTimeReceived = (
 )
 blpapi_Message_addRef = _blpapi_Message_addRef
 blpapi_Message_correlationId = _blpapi_Message_correlationId
+blpapi_Message_correlationIdInts = _blpapi_Message_correlationIdInts
+blpapi_Message_intCorrelationIds = _blpapi_Message_intCorrelationIds
 blpapi_Message_elements = _blpapi_Message_elements
 blpapi_Message_fragmentType = _blpapi_Message_fragmentType
 blpapi_Message_getRequestId = _blpapi_Message_getRequestId
@@ -5894,6 +6151,207 @@ ProviderSession_destroyHelper = _ProviderSession_destroyHelper
 Session_createHelper = _Session_createHelper
 Session_destroyHelper = _Session_destroyHelper
 
+def _collectEvents(first, tryNextEvent, source, maxEvents):
+    if first is None:
+        return []
+    if _blpapi_Event_eventType(first) == EVENTTYPE_TIMEOUT:
+        _blpapi_Event_release(first)
+        return []
+    events = [first]
+    while len(events) < maxEvents:
+        retCode, event = tryNextEvent(source)
+        if retCode:
+            break
+        events.append(event)
+    return events
+
+
+# Drain the first event of 'session', waiting up to 'timeoutInMilliseconds'
+# for it, and up to 'maxEvents - 1' more already queued events. Return
+# '(retCode, handles)', 'handles' being empty on timeout.
+def _blpapi_Session_drainEvents(session, maxEvents, timeoutInMilliseconds):
+    if maxEvents < 1:
+        raise ValueError("maxEvents must be positive")
+    retCode, first = _blpapi_Session_nextEvent(session, timeoutInMilliseconds)
+    if retCode:
+        return retCode, []
+    return 0, _collectEvents(
+        first, _blpapi_Session_tryNextEvent, session, maxEvents
+    )
+
+
+# Same as '_blpapi_Session_drainEvents' for 'eventQueue', returning the
+# handles only.
+def _blpapi_EventQueue_drainEvents(eventQueue, maxEvents, timeout):
+    if maxEvents < 1:
+        raise ValueError("maxEvents must be positive")
+    first = _blpapi_EventQueue_nextEvent(eventQueue, timeout)
+    return _collectEvents(
+        first, _blpapi_EventQueue_tryNextEvent, eventQueue, maxEvents
+    )
+
+
+blpapi_EventQueue_drainEvents = _blpapi_EventQueue_drainEvents
+blpapi_Session_drainEvents = _blpapi_Session_drainEvents
+
+# The hottest accessors are also compiled into the 'ffiutils' extension
+# module, which avoids the ctypes marshalling done by the wrappers above.
+# They take and return the same values as those wrappers, which remain in
+# use if the extension module cannot be imported.
+try:
+    from . import ffiutils as _ffiutils
+except Exception:  # pylint: disable=broad-except
+    _ffiutils = None
+
+# Only available from the extension module, 'None' otherwise.
+CaptureRecord_toPy = None
+CorrelationIdTable_create = None
+CorrelationIdTable_get = None
+CorrelationIdTable_remove = None
+CorrelationIdTable_set = None
+CorrelationIdTable_size = None
+EventPipe_close = None
+EventPipe_create = None
+EventPipe_drain = None
+LastValueCache_create = None
+LastValueCache_get = None
+LastValueCache_keys = None
+LastValueCache_poll = None
+LastValueCache_remove = None
+LastValueCache_size = None
+LastValueCache_update = None
+LatencyMonitor_create = None
+LatencyMonitor_record = None
+LatencyMonitor_snapshot = None
+LogBuffer_drain = None
+LogBuffer_dropped = None
+LogBuffer_register = None
+SchemaPlan_compile = None
+blpapi_DecodedEvent_numMessages = None
+blpapi_DecodedEvent_toColumns = None
+blpapi_DecodedEvent_toPy = None
+blpapi_Element_appendValues = None
+blpapi_Element_fromPy = None
+blpapi_Element_getItem = None
+blpapi_EventFormatter_appendMessagesFromPy = None
+blpapi_EventFormatter_appendValues = None
+blpapi_EventFormatter_fromPy = None
+blpapi_Event_decode = None
+blpapi_Event_encode = None
+blpapi_Event_route = None
+blpapi_SubscriptionList_addMany = None
+
+
+# Return the 'eventHandlerFunc' given to '*Session_createHelper' to dispatch
+# each event to 'handler(eventType(eventHandle, session._sessionSet()),
+# session)', or to 'handler([event, ...], session)' in 'batch' mode,
+# 'session' being the referent of the weak reference 'sessionRef'. The subscription data events
+# are merged into 'lastValueTable' instead, if it is not 'None': the table of
+# a 'LastValueCache', created by 'LastValueCache_create' or, without the
+# extension module, an object with an 'update(event)' method. The 'handler'
+# can be an 'EventPipe' created by 'EventPipe_create', into which the events
+# are pushed instead. The dispatch
+# of each event is recorded into 'latencyTable', if it is not 'None': the
+# table of a 'LatencyMonitor', created by 'LatencyMonitor_create' or, without
+# the extension module, a '_LatencyTable'.
+def createEventHandler(
+    eventType,
+    handler,
+    sessionRef,
+    batch,
+    lastValueTable=None,
+    latencyTable=None,
+):
+    if _ffiutils is None:
+        return functools.partial(
+            dispatchEventToHandler,
+            eventType,
+            handler,
+            sessionRef,
+            batch,
+            lastValueTable,
+            latencyTable,
+        )
+    return _ffiutils.EventHandler_create(
+        eventType,
+        handler,
+        sessionRef,
+        handleEventHandlerError,
+        batch,
+        lastValueTable,
+        latencyTable,
+    )
+
+
+if _ffiutils is not None:
+    CaptureRecord_toPy = _ffiutils.CaptureRecord_toPy
+    CorrelationIdTable_create = _ffiutils.CorrelationIdTable_create
+    CorrelationIdTable_get = _ffiutils.CorrelationIdTable_get
+    CorrelationIdTable_remove = _ffiutils.CorrelationIdTable_remove
+    CorrelationIdTable_set = _ffiutils.CorrelationIdTable_set
+    CorrelationIdTable_size = _ffiutils.CorrelationIdTable_size
+    EventPipe_close = _ffiutils.EventPipe_close
+    EventPipe_create = _ffiutils.EventPipe_create
+    EventPipe_drain = _ffiutils.EventPipe_drain
+    LastValueCache_create = _ffiutils.LastValueCache_create
+    LastValueCache_get = _ffiutils.LastValueCache_get
+    LastValueCache_keys = _ffiutils.LastValueCache_keys
+    LastValueCache_poll = _ffiutils.LastValueCache_poll
+    LastValueCache_remove = _ffiutils.LastValueCache_remove
+    LastValueCache_size = _ffiutils.LastValueCache_size
+    LastValueCache_update = _ffiutils.LastValueCache_update
+    LatencyMonitor_create = _ffiutils.LatencyMonitor_create
+    LatencyMonitor_record = _ffiutils.LatencyMonitor_record
+    LatencyMonitor_snapshot = _ffiutils.LatencyMonitor_snapshot
+    LogBuffer_drain = _ffiutils.LogBuffer_drain
+    LogBuffer_dropped = _ffiutils.LogBuffer_dropped
+    LogBuffer_register = _ffiutils.LogBuffer_register
+    SchemaPlan_compile = _ffiutils.SchemaPlan_compile
+    blpapi_DecodedEvent_numMessages = (
+        _ffiutils.blpapi_DecodedEvent_numMessages
+    )
+    blpapi_DecodedEvent_toColumns = _ffiutils.blpapi_DecodedEvent_toColumns
+    blpapi_DecodedEvent_toPy = _ffiutils.blpapi_DecodedEvent_toPy
+    blpapi_Element_appendValues = _ffiutils.blpapi_Element_appendValues
+    blpapi_Element_datatype = _ffiutils.blpapi_Element_datatype
+    blpapi_Element_fromPy = _ffiutils.blpapi_Element_fromPy
+    blpapi_Element_getElement = _ffiutils.blpapi_Element_getElement
+    blpapi_Element_getElementAt = _ffiutils.blpapi_Element_getElementAt
+    blpapi_Element_getItem = _ffiutils.blpapi_Element_getItem
+    blpapi_Element_getValueAsBool = _ffiutils.blpapi_Element_getValueAsBool
+    blpapi_Element_getValueAsFloat64 = (
+        _ffiutils.blpapi_Element_getValueAsFloat64
+    )
+    blpapi_Element_getValueAsInt64 = _ffiutils.blpapi_Element_getValueAsInt64
+    blpapi_Element_getValueAsString = (
+        _ffiutils.blpapi_Element_getValueAsString
+    )
+    blpapi_Element_hasElementEx = _ffiutils.blpapi_Element_hasElementEx
+    blpapi_Element_isArray = _ffiutils.blpapi_Element_isArray
+    blpapi_Element_isComplexType = _ffiutils.blpapi_Element_isComplexType
+    blpapi_Element_isNull = _ffiutils.blpapi_Element_isNull
+    blpapi_Element_numElements = _ffiutils.blpapi_Element_numElements
+    blpapi_Element_numValues = _ffiutils.blpapi_Element_numValues
+    blpapi_EventFormatter_appendMessagesFromPy = (
+        _ffiutils.blpapi_EventFormatter_appendMessagesFromPy
+    )
+    blpapi_EventFormatter_appendValues = (
+        _ffiutils.blpapi_EventFormatter_appendValues
+    )
+    blpapi_EventFormatter_fromPy = _ffiutils.blpapi_EventFormatter_fromPy
+    blpapi_EventQueue_drainEvents = _ffiutils.blpapi_EventQueue_drainEvents
+    blpapi_Event_decode = _ffiutils.blpapi_Event_decode
+    blpapi_Event_encode = _ffiutils.blpapi_Event_encode
+    blpapi_Event_route = _ffiutils.blpapi_Event_route
+    blpapi_MessageIterator_next = _ffiutils.blpapi_MessageIterator_next
+    blpapi_Message_correlationIdInts = (
+        _ffiutils.blpapi_Message_correlationIdInts
+    )
+    blpapi_Session_drainEvents = _ffiutils.blpapi_Session_drainEvents
+    blpapi_SubscriptionList_addMany = (
+        _ffiutils.blpapi_SubscriptionList_addMany
+    )
+
 
 def _test_function_signatures():
     _C_TO_PY = {
@@ -5902,6 +6360,7 @@ def _test_function_signatures():
         "float": c_float,
         "int": c_int,
         "int*": POINTER(c_int),
+        "long long": c_int64,
         "size_t": c_size_t,
         "unsigned int": c_uint,
         "blpapi_CorrelationId_t": CidStruct,
@@ -0,0 +1,281 @@
+# lastvaluecache.py
+
+"""Conflate subscription data into the last value of each field.
+
+This component defines a class, 'LastValueCache', which holds, for each
+integer correlation id, the last value of each field of the subscription
+data messages of that correlation id. The fields of successive messages are
+merged, and a recap replaces the fields of its correlation id. The
+application polls the correlation ids updated since its last poll at its own
+rate, however fast the updates arrive, and looks up the last values of any
+correlation id without touching the messages.
+
+A 'Session' created with a 'LastValueCache' merges its subscription data
+events into it, instead of giving them to its event handler. When the
+extension module is available, the events are merged natively on the threads
+of the dispatcher of the session, without acquiring the GIL.
+
+Usage
+-----
+The following polls the changes of a universe ten times per second.
+
+    cache = LastValueCache()
+    session = Session(sessionOptions, processEvent, lastValueCache=cache)
+    ...
+    while running:
+        for correlationId, fields in cache.poll().items():
+            ...
+        time.sleep(0.1)
+"""
+
+import threading
+from typing import Any, Dict, List, Optional, Union
+from .correlationid import CorrelationId
+from .correlationidrouter import _intOfCorrelationId
+from .event import Event
+from .message import Message
+from .utils import get_handle
+from . import internals
+
+
+class _LastValueTable:
+    """The table of a :class:`LastValueCache` when the extension module is
+    not available, with the same behavior as the native one."""
+
+    def __init__(self, datetimeAsEpochNanos: bool) -> None:
+        self.__datetimeAsEpochNanos = datetimeAsEpochNanos
+        self.__lock = threading.Lock()
+        self.__entries: Dict[int, Dict[str, Any]] = {}
+        # the names of the fields updated since the last poll, by
+        # correlation id, in the order of their first update
+        self.__changed: Dict[int, set] = {}
+
+    def update(self, event: Event) -> None:
+        with self.__lock:
+            for message in event:
+                self.__merge(message)
+
+    def __merge(self, message: Message) -> None:
+        fields = {}
+        for element in message.asElement().elements():
+            if element.isComplexType() or element.isArray():
+                continue
+            fields[str(element.name())] = (
+                None
+                if element.isNull()
+                else element.toPy(self.__datetimeAsEpochNanos)
+            )
+        clear = (
+            message.recapType() != Message.RECAPTYPE_NONE
+            and message.fragmentType()
+            in (Message.FRAGMENT_NONE, Message.FRAGMENT_START)
+        )
+        for value in internals.blpapi_Message_intCorrelationIds(
+            get_handle(message)
+        ):
+            if value is None:
+                continue
+            entry = self.__entries.setdefault(value, {})
+            changed = self.__changed.setdefault(value, set())
+            if clear:
+                entry.clear()
+                changed.clear()
+            entry.update(fields)
+            changed.update(fields)
+
+    def poll(self, changedFieldsOnly: bool) -> Dict[int, Dict[str, Any]]:
+        with self.__lock:
+            result = {}
+            for value, changed in self.__changed.items():
+                entry = self.__entries.get(value)
+                if entry is None:
+                    continue
+                result[value] = (
+                    {name: entry[name] for name in entry if name in changed}
+                    if changedFieldsOnly
+                    else dict(entry)
+                )
+            self.__changed = {}
+            return result
+
+    def get(self, value: int) -> Optional[Dict[str, Any]]:
+        with self.__lock:
+            entry = self.__entries.get(value)
+            return None if entry is None else dict(entry)
+
+    def keys(self) -> List[int]:
+        with self.__lock:
+            return list(self.__entries)
+
+    def remove(self, value: int) -> bool:
+        with self.__lock:
+            self.__changed.pop(value, None)
+            return self.__entries.pop(value, None) is not None
+
+    def size(self) -> int:
+        with self.__lock:
+            return len(self.__entries)
+
+
+class LastValueCache:
+    r"""The last value of each field of the subscription data, by integer
+    correlation id.
+
+    The messages are merged by :meth:`update`, for each of their correlation
+    ids of type :attr:`CorrelationId.INT_TYPE`, the correlation ids of the
+    other types being ignored, including those of type
+    :attr:`CorrelationId.AUTOGEN_TYPE`, whose values may be those of integer
+    correlation ids. Only the top-level fields of the messages which are
+    neither complex nor arrays are cached; a null field is cached as
+    ``None``. The fields of a correlation id are cleared by the first
+    fragment of a recap, as given by :meth:`Message.recapType` and
+    :meth:`Message.fragmentType`, so that they are replaced by the fields of
+    the recap.
+
+    The memory used by a :class:`LastValueCache` is bounded by the number of
+    correlation ids and fields, whatever the number of messages merged
+    between two :meth:`poll`\s.
+
+    A :class:`LastValueCache` can be updated and polled from any thread.
+    """
+
+    def __init__(self, datetimeAsEpochNanos: bool = False) -> None:
+        """Create an empty cache.
+
+        Args:
+            datetimeAsEpochNanos: Whether the values of the datetime fields
+                are returned as ``int`` nanoseconds since the epoch, as by
+                :meth:`Element.toPy`
+        """
+        self.__flags = (
+            internals.TOPY_DATETIME_AS_EPOCH_NANOS
+            if datetimeAsEpochNanos
+            else 0
+        )
+        self.__table: Any
+        if internals.LastValueCache_create is not None:
+            self.__table = internals.LastValueCache_create()
+        else:
+            self.__table = _LastValueTable(datetimeAsEpochNanos)
+
+    def update(self, event: Event) -> None:
+        """Merge the messages of ``event`` into this cache.
+
+        Args:
+            event: The subscription data event to merge
+
+        Note:
+            The subscription data events of a :class:`Session` created with
+            this cache are merged without calling this method.
+        """
+        if internals.LastValueCache_update is not None:
+            internals.LastValueCache_update(self.__table, get_handle(event))
+        else:
+            self.__table.update(event)
+
+    def poll(
+        self, changedFieldsOnly: bool = False
+    ) -> Dict[int, Dict[str, Any]]:
+        r"""Return the fields of the correlation ids updated since the last
+        poll, and start tracking the updates again.
+
+        Args:
+            changedFieldsOnly: Whether only the fields updated since the
+                last poll are returned, instead of all the fields of the
+                updated correlation ids
+
+        Returns:
+            A ``dict`` of the fields of each correlation id updated since
+            the last poll, keyed by the value of the correlation id, in the
+            order of their first update since the last poll. The fields are
+            ``dict``\s of the values keyed by the names of the fields.
+
+        Raises:
+            Exception: If a message could not be merged since the last poll.
+                The updates are then kept for the next poll.
+        """
+        if internals.LastValueCache_poll is not None:
+            return internals.LastValueCache_poll(
+                self.__table, changedFieldsOnly, self.__flags
+            )
+        return self.__table.poll(changedFieldsOnly)
+
+    def get(
+        self, correlationId: Union[int, CorrelationId]
+    ) -> Optional[Dict[str, Any]]:
+        """
+        Args:
+            correlationId: An integer correlation id, or its value
+
+        Returns:
+            The fields of ``correlationId``, or ``None`` if this cache has
+            no fields for it. Does not affect :meth:`poll`.
+        """
+        value = _intOfCorrelationId(correlationId)
+        if internals.LastValueCache_get is not None:
+            return internals.LastValueCache_get(
+                self.__table, value, self.__flags
+            )
+        return self.__table.get(value)
+
+    def correlationIds(self) -> List[int]:
+        """
+        Returns:
+            The values of the correlation ids of this cache, in no
+            particular order.
+        """
+        if internals.LastValueCache_keys is not None:
+            return internals.LastValueCache_keys(self.__table)
+        return self.__table.keys()
+
+    def remove(self, correlationId: Union[int, CorrelationId]) -> bool:
+        """Remove the fields of ``correlationId``, for instance once its
+        subscription is cancelled.
+
+        Args:
+            correlationId: An integer correlation id, or its value
+
+        Returns:
+            ``True`` if this cache had fields for ``correlationId``,
+            ``False`` otherwise.
+        """
+        value = _intOfCorrelationId(correlationId)
+        if internals.LastValueCache_remove is not None:
+            return internals.LastValueCache_remove(self.__table, value)
+        return self.__table.remove(value)
+
+    def __len__(self) -> int:
+        """
+        Returns:
+            The number of correlation ids of this cache.
+        """
+        if internals.LastValueCache_size is not None:
+            return internals.LastValueCache_size(self.__table)
+        return self.__table.size()
+
+    def _table(self) -> Any:
+        """The table given to the event handler of a :class:`Session`. For
+        internal use."""
+        return self.__table
+
+
+__copyright__ = """
+Copyright 2024. Bloomberg Finance L.P.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to
+deal in the Software without restriction, including without limitation the
+rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+sell copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:  The above
+copyright notice and this permission notice shall be included in all copies
+or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+IN THE SOFTWARE.
+"""
@@ -0,0 +1,563 @@
+# latencymonitor.py
+
+"""Measure the latencies of the dispatch of the events of a session.
+
+This component defines a class, 'LatencyMonitor', which records, for each
+event dispatched to the event handler of a 'Session', the latencies of the
+following stages into HDR-style histograms:
+
+- from the time each message was received by the SDK to the time the event
+  was dequeued by the dispatcher, for the messages whose receive time was
+  recorded, see 'SessionOptions.setRecordSubscriptionDataReceiveTimes',
+- from the time the event was dequeued to the time the event handler was
+  called,
+- the duration of the event handler,
+- optionally, the duration of the conversions of events and messages to
+  Python objects, by 'Event.toPy', 'Message.toPy' and 'DecodedEvent.toPy',
+  on any thread.
+
+It also counts the events dispatched and the events being dispatched. A
+'LatencyMonitor' is cheap to snapshot, and its snapshots can be exported in
+the OpenMetrics text format, as scraped by Prometheus.
+
+When the extension module is available, the histograms are updated natively
+with atomic operations, without locks, on the threads of the dispatcher of
+the session, the dispatch stages being timed with the high resolution clock
+of the SDK. The conversions are only timed while a 'LatencyMonitor'
+recording them is alive, by wrapping the conversion methods in the
+meantime, so that they cost nothing more otherwise.
+
+Usage
+-----
+The following logs the median and the tail latencies every minute.
+
+    monitor = LatencyMonitor()
+    session = Session(sessionOptions, processEvent, latencyMonitor=monitor)
+    ...
+    while running:
+        time.sleep(60)
+        snapshot = monitor.snapshot(reset=True)
+        logger.info(
+            "%d events/s, handler p50 %d ns, p99 %d ns",
+            snapshot.eventsPerSecond,
+            snapshot.handler.percentile(50),
+            snapshot.handler.percentile(99),
+        )
+"""
+
+import functools
+import threading
+import time
+import weakref
+from typing import Any, Callable, Dict, Iterable, List, Sequence, Tuple
+from .utils import get_handle
+from . import internals
+
+# the stages of the histograms, as numbered by the extension module
+_RECEIVE_TO_DEQUEUE = 0
+_DEQUEUE_TO_HANDLER = 1
+_HANDLER = 2
+_CONVERSION = 3
+_NUM_STAGES = 4
+
+# each power of two range of values is split into '_SUB_BUCKETS' buckets,
+# so that the upper bound of a bucket exceeds its values by less than 1%
+_SUB_BUCKET_BITS = 7
+_SUB_BUCKETS = 1 << _SUB_BUCKET_BITS
+_MAX_VALUE = (2 * _SUB_BUCKETS << 33) - 1  # about 36 minutes
+
+# the upper bounds of the buckets of 'LatencySnapshot.toOpenMetrics', in
+# seconds
+_DEFAULT_BOUNDS = (
+    1e-6,
+    2.5e-6,
+    5e-6,
+    1e-5,
+    2.5e-5,
+    5e-5,
+    1e-4,
+    2.5e-4,
+    5e-4,
+    1e-3,
+    2.5e-3,
+    5e-3,
+    1e-2,
+    2.5e-2,
+    5e-2,
+    0.1,
+    0.25,
+    0.5,
+    1.0,
+)
+
+
+def _bucketIndex(value: int) -> int:
+    if value < _SUB_BUCKETS:
+        return value
+    shift = value.bit_length() - _SUB_BUCKET_BITS - 1
+    return shift * _SUB_BUCKETS + (value >> shift)
+
+
+def _bucketUpperBound(index: int) -> int:
+    if index < _SUB_BUCKETS:
+        return index
+    shift = index // _SUB_BUCKETS - 1
+    return ((index - shift * _SUB_BUCKETS + 1) << shift) - 1
+
+
+class _Histogram:
+    def __init__(self) -> None:
+        self.count = 0
+        self.sum = 0
+        self.min = 0
+        self.max = 0
+        self.buckets: Dict[int, int] = {}
+
+    def record(self, value: int) -> None:
+        value = min(max(value, 0), _MAX_VALUE)
+        index = _bucketIndex(value)
+        self.buckets[index] = self.buckets.get(index, 0) + 1
+        self.min = value if self.count == 0 else min(self.min, value)
+        self.max = max(self.max, value)
+        self.count += 1
+        self.sum += value
+
+    def toTuple(self) -> Tuple[int, int, int, int, Dict[int, int]]:
+        return (self.count, self.sum, self.min, self.max, dict(self.buckets))
+
+
+class _LatencyTable:
+    """The table of a :class:`LatencyMonitor` when the extension module is
+    not available, with the same behavior as the native one, except that
+    only the receive times are taken from the clock of the SDK."""
+
+    def __init__(self) -> None:
+        self.__lock = threading.Lock()
+        self.__stages = [_Histogram() for _ in range(_NUM_STAGES)]
+        self.__events = 0
+        self.__queueDepth = 0
+        self.__maxQueueDepth = 0
+
+    def record(self, stage: int, value: int) -> None:
+        with self.__lock:
+            self.__stages[stage].record(value)
+
+    def dequeued(self, event: Any) -> int:
+        start = time.perf_counter_ns()
+        _, now = internals.blpapi_HighResolutionClock_now()
+        received = []
+        for message in event:
+            rc, timePoint = internals.blpapi_Message_timeReceived(
+                get_handle(message)
+            )
+            if rc == 0:
+                received.append(
+                    internals.blpapi_TimePointUtil_nanosecondsBetween(
+                        timePoint, now
+                    )
+                )
+        with self.__lock:
+            self.__events += 1
+            self.__queueDepth += 1
+            self.__maxQueueDepth = max(
+                self.__maxQueueDepth, self.__queueDepth
+            )
+            for value in received:
+                self.__stages[_RECEIVE_TO_DEQUEUE].record(value)
+        return start
+
+    def handlerEntered(self, start: int) -> int:
+        now = time.perf_counter_ns()
+        self.record(_DEQUEUE_TO_HANDLER, now - start)
+        return now
+
+    def handlerExited(self, start: int) -> None:
+        self.record(_HANDLER, time.perf_counter_ns() - start)
+
+    def handled(self) -> None:
+        with self.__lock:
+            self.__queueDepth -= 1
+
+    def snapshot(self, reset: bool) -> Tuple[int, int, int, List[Tuple]]:
+        with self.__lock:
+            result = (
+                self.__events,
+                self.__queueDepth,
+                self.__maxQueueDepth,
+                [stage.toTuple() for stage in self.__stages],
+            )
+            if reset:
+                self.__stages = [_Histogram() for _ in range(_NUM_STAGES)]
+                self.__maxQueueDepth = self.__queueDepth
+            return result
+
+
+# the monitors recording the conversions, the conversion methods replaced
+# by timed ones while there are any, and whether a conversion is being timed
+# on each thread, so that the conversions they make are not timed again
+_conversionMonitors: "weakref.WeakSet[LatencyMonitor]" = weakref.WeakSet()
+_untimedConversions: Dict[type, Callable] = {}
+_conversionLock = threading.Lock()
+_timing = threading.local()
+
+
+class LatencyHistogram:
+    """A snapshot of the histogram of the latencies of a stage, in
+    nanoseconds.
+
+    The latencies are counted in buckets whose upper bounds exceed the
+    latencies they count by less than 1%, the latencies above about 36
+    minutes being counted as 36 minutes, and the negative ones, across hosts
+    whose clocks are not synchronized, as 0.
+    """
+
+    def __init__(
+        self, count: int, total: int, low: int, high: int, buckets: Dict
+    ) -> None:
+        """For internal use."""
+        self.__count = count
+        self.__sum = total
+        self.__min = low
+        self.__max = high
+        self.__buckets = sorted(buckets.items())
+
+    def count(self) -> int:
+        """
+        Returns:
+            The number of latencies recorded.
+        """
+        return self.__count
+
+    def sum(self) -> int:
+        """
+        Returns:
+            The sum of the latencies recorded, in nanoseconds.
+        """
+        return self.__sum
+
+    def min(self) -> int:
+        """
+        Returns:
+            The lowest latency recorded, in nanoseconds, 0 if none was.
+        """
+        return self.__min
+
+    def max(self) -> int:
+        """
+        Returns:
+            The highest latency recorded, in nanoseconds, 0 if none was.
+        """
+        return self.__max
+
+    def mean(self) -> float:
+        """
+        Returns:
+            The mean of the latencies recorded, in nanoseconds, 0 if none
+            was.
+        """
+        return self.__sum / self.__count if self.__count else 0.0
+
+    def percentile(self, percentile: float) -> int:
+        """
+        Args:
+            percentile: The percentile, between 0 and 100
+
+        Returns:
+            The latency, in nanoseconds, under which ``percentile`` percent
+            of the latencies recorded are, to within 1%, 0 if none was.
+
+        Raises:
+            ValueError: If ``percentile`` is not between 0 and 100
+        """
+        if not 0 <= percentile <= 100:
+            raise ValueError(
+                f"`percentile` must be between 0 and 100, got {percentile}"
+            )
+        if self.__count == 0:
+            return 0
+        rank = max(1, percentile * self.__count / 100)
+        cumulated = 0
+        for index, count in self.__buckets:
+            cumulated += count
+            if cumulated >= rank:
+                bound = _bucketUpperBound(index)
+                return max(self.__min, min(bound, self.__max))
+        return self.__max
+
+    def buckets(self) -> List[Tuple[int, int]]:
+        """
+        Returns:
+            The ``(upperBound, count)`` tuples of the non-empty buckets, in
+            increasing order of upper bound, ``count`` latencies recorded
+            being at most ``upperBound`` nanoseconds, and above the upper
+            bound of the previous bucket.
+        """
+        return [
+            (_bucketUpperBound(index), count)
+            for index, count in self.__buckets
+        ]
+
+    def __repr__(self) -> str:
+        return (
+            f"LatencyHistogram(count={self.__count}, min={self.__min},"
+            f" mean={self.mean():.0f}, p99={self.percentile(99)},"
+            f" max={self.__max})"
+        )
+
+
+class LatencySnapshot:
+    """A snapshot of a :class:`LatencyMonitor`, as returned by
+    :meth:`LatencyMonitor.snapshot`."""
+
+    def __init__(
+        self,
+        events: int,
+        queueDepth: int,
+        maxQueueDepth: int,
+        stages: Sequence[Tuple],
+        eventsPerSecond: float,
+    ) -> None:
+        """For internal use."""
+        self.events = events
+        """The number of events dispatched since the monitor was created."""
+        self.eventsPerSecond = eventsPerSecond
+        """The number of events dispatched per second since the previous
+        snapshot, or since the monitor was created."""
+        self.queueDepth = queueDepth
+        """The number of events dispatched to the event handler and not
+        handled yet, on all the threads of the dispatcher."""
+        self.maxQueueDepth = maxQueueDepth
+        """The highest :attr:`queueDepth` since the previous snapshot reset,
+        or since the monitor was created."""
+        self.receiveToDequeue = LatencyHistogram(
+            *stages[_RECEIVE_TO_DEQUEUE]
+        )
+        """The latencies from the receive times of the messages to the
+        dispatch of their events."""
+        self.dequeueToHandler = LatencyHistogram(
+            *stages[_DEQUEUE_TO_HANDLER]
+        )
+        """The latencies from the dispatch of the events to the calls of
+        the event handler."""
+        self.handler = LatencyHistogram(*stages[_HANDLER])
+        """The durations of the calls of the event handler."""
+        self.conversion = LatencyHistogram(*stages[_CONVERSION])
+        """The durations of the conversions to Python objects."""
+
+    def histograms(self) -> Dict[str, LatencyHistogram]:
+        """
+        Returns:
+            The histograms of this snapshot, keyed by the names of the
+            attributes holding them.
+        """
+        return {
+            "receiveToDequeue": self.receiveToDequeue,
+            "dequeueToHandler": self.dequeueToHandler,
+            "handler": self.handler,
+            "conversion": self.conversion,
+        }
+
+    def toOpenMetrics(
+        self,
+        prefix: str = "blpapi",
+        bounds: Iterable[float] = _DEFAULT_BOUNDS,
+    ) -> str:
+        """
+        Args:
+            prefix: The prefix of the names of the metrics
+            bounds: The upper bounds of the buckets of the histograms, in
+                seconds
+
+        Returns:
+            This snapshot in the OpenMetrics text format, terminated by
+            ``# EOF``.
+
+        The histograms are exported in seconds, as ``<prefix>_<stage>_seconds``
+        metrics, a latency being counted in a bucket only if the upper bound
+        of the bucket of the monitor counting it is at most the bound of the
+        bucket exported. Since the metrics of a histogram are expected to
+        only increase, the snapshots exported should be taken without
+        resetting the monitor.
+        """
+        bounds = sorted(bounds)
+        lines = []
+        for name, histogram in (
+            ("receive_to_dequeue", self.receiveToDequeue),
+            ("dequeue_to_handler", self.dequeueToHandler),
+            ("handler", self.handler),
+            ("conversion", self.conversion),
+        ):
+            metric = f"{prefix}_{name}_seconds"
+            lines.append(f"# TYPE {metric} histogram")
+            lines.append(f"# UNIT {metric} seconds")
+            buckets = histogram.buckets()
+            position = 0
+            cumulated = 0
+            for bound in bounds:
+                limit = bound * 1e9
+                while (
+                    position < len(buckets) and buckets[position][0] <= limit
+                ):
+                    cumulated += buckets[position][1]
+                    position += 1
+                lines.append(f'{metric}_bucket{{le="{bound!r}"}} {cumulated}')
+            lines.append(f'{metric}_bucket{{le="+Inf"}} {histogram.count()}')
+            lines.append(f"{metric}_count {histogram.count()}")
+            lines.append(f"{metric}_sum {histogram.sum() / 1e9!r}")
+        lines.append(f"# TYPE {prefix}_events counter")
+        lines.append(f"{prefix}_events_total {self.events}")
+        for name, value in (
+            ("events_per_second", self.eventsPerSecond),
+            ("queue_depth", self.queueDepth),
+            ("max_queue_depth", self.maxQueueDepth),
+        ):
+            lines.append(f"# TYPE {prefix}_{name} gauge")
+            lines.append(f"{prefix}_{name} {value!r}")
+        lines.append("# EOF")
+        return "\n".join(lines) + "\n"
+
+
+class LatencyMonitor:
+    """The histograms of the latencies of the dispatch of the events of a
+    :class:`Session`, and optionally of the conversions to Python objects.
+
+    A :class:`LatencyMonitor` given to a :class:`Session` records the
+    dispatch of each event delivered to the event handler of the session,
+    on the threads of its dispatcher, whether the events are dispatched one
+    by one or in batches. In batch mode, the dequeue to handler latency of
+    an event ends when it is queued for the next batch, and the duration of
+    the handler is the duration of each call with a batch. The subscription
+    data events merged into a :class:`LastValueCache` are counted, but do
+    not have a handler latency.
+
+    A :class:`LatencyMonitor` can be given to several sessions, and
+    snapshotted from any thread.
+    """
+
+    def __init__(self, recordConversions: bool = False) -> None:
+        """Create a monitor without any latency recorded.
+
+        Args:
+            recordConversions: Whether the durations of the conversions to
+                Python objects, on any thread and for any session, are
+                recorded while this monitor is alive
+        """
+        self.__table: Any
+        if internals.LatencyMonitor_create is not None:
+            self.__table = internals.LatencyMonitor_create()
+        else:
+            self.__table = _LatencyTable()
+        self.__lock = threading.Lock()
+        self.__lastTime = time.monotonic()
+        self.__lastEvents = 0
+        if recordConversions:
+            _startTimingConversions(self)
+
+    def snapshot(self, reset: bool = False) -> LatencySnapshot:
+        """
+        Args:
+            reset: Whether the histograms and the maximum queue depth are
+                cleared, so that the next snapshot only covers the
+                latencies recorded from now on
+
+        Returns:
+            A snapshot of the latencies recorded, since the previous reset
+            or since this monitor was created.
+        """
+        if internals.LatencyMonitor_snapshot is not None:
+            values = internals.LatencyMonitor_snapshot(self.__table, reset)
+        else:
+            values = self.__table.snapshot(reset)
+        events = values[0]
+        with self.__lock:
+            now = time.monotonic()
+            elapsed = now - self.__lastTime
+            eventsPerSecond = (
+                (events - self.__lastEvents) / elapsed if elapsed > 0 else 0.0
+            )
+            self.__lastTime = now
+            self.__lastEvents = events
+        return LatencySnapshot(*values, eventsPerSecond=eventsPerSecond)
+
+    def _record(self, stage: int, value: int) -> None:
+        if internals.LatencyMonitor_record is not None:
+            internals.LatencyMonitor_record(self.__table, stage, value)
+        else:
+            self.__table.record(stage, value)
+
+    def _table(self) -> Any:
+        """The table given to the event handler of a :class:`Session`. For
+        internal use."""
+        return self.__table
+
+
+def _timedConversion(conversion: Callable) -> Callable:
+    """Return the method timing the conversion method 'conversion' into
+    the monitors recording the conversions."""
+
+    @functools.wraps(conversion)
+    def timed(*args: Any, **kwargs: Any) -> Any:
+        if getattr(_timing, "active", False):
+            return conversion(*args, **kwargs)
+        _timing.active = True
+        start = time.perf_counter_ns()
+        try:
+            return conversion(*args, **kwargs)
+        finally:
+            value = time.perf_counter_ns() - start
+            _timing.active = False
+            for monitor in list(_conversionMonitors):
+                # pylint: disable=protected-access
+                monitor._record(_CONVERSION, value)
+
+    return timed
+
+
+def _startTimingConversions(monitor: LatencyMonitor) -> None:
+    """Record the conversions into 'monitor' while it is alive, replacing
+    the conversion methods by timed ones if they are not yet."""
+    # pylint: disable=import-outside-toplevel
+    from .event import DecodedEvent, Event
+    from .message import Message
+
+    with _conversionLock:
+        if not _untimedConversions:
+            for cls in (Event, DecodedEvent, Message):
+                conversion = cls.__dict__["toPy"]
+                _untimedConversions[cls] = conversion
+                setattr(cls, "toPy", _timedConversion(conversion))
+        _conversionMonitors.add(monitor)
+    weakref.finalize(monitor, _stopTimingConversions)
+
+
+def _stopTimingConversions() -> None:
+    """Restore the conversion methods if no monitor records them anymore."""
+    with _conversionLock:
+        # iterating skips the monitors being finalized
+        if any(True for _ in _conversionMonitors):
+            return
+        for cls, conversion in _untimedConversions.items():
+            setattr(cls, "toPy", conversion)
+        _untimedConversions.clear()
+
+
+__copyright__ = """
+Copyright 2024. Bloomberg Finance L.P.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to
+deal in the Software without restriction, including without limitation the
+rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+sell copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:  The above
+copyright notice and this permission notice shall be included in all copies
+or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+IN THE SOFTWARE.
+"""
@@ -5,13 +5,14 @@
 @DESCRIPTION: This component provides a function that is used to
  register a callback for logging"""
 
-from typing import Callable, List, Optional, Tuple
+from collections import deque
+from typing import Any, Callable, Deque, List, Optional, Tuple
 from blpapi import internals
 from datetime import datetime
+import threading
 from . import utils
 from .datetime import _DatetimeUtil
 from .typehints import AnyPythonDatetime
-from inspect import signature
 
 
 class Logger(metaclass=utils.MetaClassForClassesWithEnums):
@@ -30,12 +31,25 @@ class Logger(metaclass=utils.MetaClassForClassesWithEnums):
     # needed for temp. ref. holding
     loggerCallbacksLocal: List[Tuple[Callable, Callable]] = []
 
+    # state of the buffered callback, see 'registerCallback'
+    _bufferedCallback: Optional[Callable] = None
+    _drainLock = threading.RLock()
+    _drainStopped: Optional[threading.Event] = None
+    _drainThread: Optional[threading.Thread] = None
+    # records and drop count of the buffer when the extension module is not
+    # available
+    _bufferedRecords: Deque[Tuple[int, int, Any, bytes, bytes]] = deque()
+    _bufferSize = 0
+    _droppedRecords = 0
+
     @staticmethod
     def registerCallback(
         callback: Optional[
             Callable[[int, int, AnyPythonDatetime, str, str], None]
         ],
         thresholdSeverity: int = SEVERITY_INFO,
+        bufferSize: int = 0,
+        drainInterval: Optional[float] = None,
     ) -> None:
         """Register the specified 'callback' that will be called for all log
         messages with severity greater than or equal to the specified
@@ -43,15 +57,50 @@ class Logger(metaclass=utils.MetaClassForClassesWithEnums):
         start of all sessions.  If this function is called multiple times, only
         the last registered callback will take effect. An exception of type
         'RuntimeError' will be thrown if 'callback' cannot be registered.
-        If callback is None, any existing callback shall be removed."""
+        If callback is None, any existing callback shall be removed.
+
+        If the specified 'bufferSize' is positive, 'callback' is not called
+        by the threads of the SDK that log the messages. The messages are
+        instead copied into a buffer of 'bufferSize' messages, without
+        taking the GIL, and 'callback' is called by 'drain()' for each of
+        the buffered messages, in the order in which they were logged. If
+        'drainInterval' is not None, a daemon thread calls 'drain()' every
+        'drainInterval' seconds, until another callback is registered;
+        otherwise the application calls 'drain()' itself. Messages logged
+        while the buffer is full are dropped, and counted by
+        'droppedRecords()'. This keeps verbose logging from delaying the
+        processing of events, at the cost of delivering the messages
+        later. A message longer than about 1800 bytes is truncated. The
+        size of the buffer is that of the first buffered registration."""
 
+        Logger._stopDrainThread()
         callbackRef = None
         if callback is not None:
+            # imported here, as 'inspect' is only needed by the few
+            # applications registering a callback
+            from inspect import signature
+
             sign = signature(callback)
             # we expect 5 named parameters
             if len(sign.parameters) < 5:
                 raise TypeError("Wrong type of callback for logging")
 
+        if callback is not None and bufferSize > 0:
+            Logger._bufferedCallback = callback
+            if internals.LogBuffer_register is not None:
+                if internals.LogBuffer_register(bufferSize, thresholdSeverity):
+                    raise RuntimeError("unable to register callback")
+            else:
+                Logger._registerBufferingCallback(
+                    bufferSize, thresholdSeverity
+                )
+            if drainInterval is not None:
+                Logger._startDrainThread(drainInterval)
+            return
+        Logger._bufferedCallback = None
+
+        if callback is not None:
+
             def callbackWrapper(
                 threadId: int,
                 severity: int,
@@ -84,6 +133,121 @@ class Logger(metaclass=utils.MetaClassForClassesWithEnums):
             # we have a new cb now, let the previous one go
             Logger.loggerCallbacksLocal.pop(0)
 
+    @staticmethod
+    def drain(maxRecords: Optional[int] = None) -> int:
+        """Call the callback registered with a positive 'bufferSize' for the
+        buffered messages, or for at most the specified 'maxRecords' of
+        them, and return the number of messages taken from the buffer.
+        Messages buffered while no buffered callback is registered are
+        discarded. An exception raised by the callback is propagated, the
+        messages that follow the one being delivered remaining buffered."""
+
+        with Logger._drainLock:
+            callback = Logger._bufferedCallback
+            if internals.LogBuffer_drain is not None:
+                records: List[Tuple] = internals.LogBuffer_drain(
+                    -1 if maxRecords is None else maxRecords
+                )
+            else:
+                buffered = Logger._bufferedRecords
+                count = len(buffered)
+                if maxRecords is not None:
+                    count = min(count, maxRecords)
+                records = []
+                for _ in range(count):
+                    threadId, severity, ts, category, message = (
+                        buffered.popleft()
+                    )
+                    records.append(
+                        (
+                            threadId,
+                            severity,
+                            _DatetimeUtil.convertToNativeNotHighPrecision(ts),
+                            category.decode(errors="replace"),
+                            message.decode(errors="replace"),
+                        )
+                    )
+            if callback is not None:
+                for record in records:
+                    callback(*record)
+            return len(records)
+
+    @staticmethod
+    def droppedRecords() -> int:
+        """Return the number of messages dropped because the buffer of the
+        callback registered with a positive 'bufferSize' was full."""
+        if internals.LogBuffer_dropped is not None:
+            return internals.LogBuffer_dropped()
+        return Logger._droppedRecords
+
+    @staticmethod
+    def _registerBufferingCallback(
+        bufferSize: int, thresholdSeverity: int
+    ) -> None:
+        # without the extension module, the messages are buffered by a
+        # python callback, which still takes the GIL but defers the work of
+        # the application callback
+        if not Logger._bufferSize:
+            Logger._bufferSize = bufferSize
+        buffered = Logger._bufferedRecords
+
+        def bufferingCallback(
+            threadId: int,
+            severity: int,
+            ts: datetime,
+            category: bytes,
+            message: bytes,
+        ) -> None:
+            if len(buffered) >= Logger._bufferSize:
+                Logger._droppedRecords += 1
+                return
+            buffered.append(
+                (threadId, severity, ts, category[:256], message[:1800])
+            )
+
+        err_code, proxy = internals.blpapi_Logging_registerCallback(
+            bufferingCallback, thresholdSeverity
+        )
+        if err_code != 0:
+            raise RuntimeError("unable to register callback")
+        Logger.loggerCallbacksLocal.append((bufferingCallback, proxy))
+        if len(Logger.loggerCallbacksLocal) > 1:
+            Logger.loggerCallbacksLocal.pop(0)
+
+    @staticmethod
+    def _startDrainThread(drainInterval: float) -> None:
+        stopped = threading.Event()
+
+        def drainPeriodically() -> None:
+            while True:
+                done = stopped.wait(drainInterval)
+                try:
+                    Logger.drain()
+                except Exception:  # pylint: disable=broad-except
+                    # reported as for the callbacks called by the SDK
+                    import traceback
+
+                    traceback.print_exc()
+                if done:
+                    return
+
+        Logger._drainStopped = stopped
+        Logger._drainThread = threading.Thread(
+            target=drainPeriodically, name="blpapi-log-drain", daemon=True
+        )
+        Logger._drainThread.start()
+
+    @staticmethod
+    def _stopDrainThread() -> None:
+        # the thread drains the buffer a last time before it stops
+        thread, stopped = Logger._drainThread, Logger._drainStopped
+        Logger._drainThread = Logger._drainStopped = None
+        if thread is None or stopped is None:
+            return
+        stopped.set()
+        if thread is not threading.current_thread():
+            thread.join()
+
     @staticmethod
     def logTestMessage(severity: int) -> None:
         """Log a test message at the specified 'severity'.
@@ -12,14 +12,15 @@ from __future__ import absolute_import
 import sys
 import weakref
 import datetime
-from typing import Set, Optional, Any, List
+from typing import Set, Optional, Any, Iterable, List, Union
 from blpapi.datetime import _DatetimeUtil, UTC
 from . import typehints  # pylint: disable=unused-import
 from .typehints import BlpapiNameOrIndex
 from .typehints import BlpapiMessageHandle, AnyPythonDatetime
 from .typehints import SupportedElementTypes
 from typing import Iterator as IteratorType
-from .element import Element
+from .element import Element, ElementView
+from .fieldselector import FieldSelector
 from .exception import _ExceptionUtil
 from .name import Name
 from . import internals
@@ -77,6 +78,8 @@ class Message(CHandle, metaclass=MetaClassForClassesWithEnums):
     RECAPTYPE_UNSOLICITED = internals.MESSAGE_RECAPTYPE_UNSOLICITED
     """Generated by the service"""
 
+    __slots__ = ("__handle", "__sessions", "__element")
+
     def __init__(
         self,
         handle: BlpapiMessageHandle,
@@ -96,12 +99,14 @@ class Message(CHandle, metaclass=MetaClassForClassesWithEnums):
         internals.blpapi_Message_addRef(handle)
         super(Message, self).__init__(handle, internals.blpapi_Message_release)
         self.__handle = handle
-        self.__sessions: Set["typehints.AbstractSession"] = set()
-        if event is None:
-            if sessions is not None:
-                self.__sessions = sessions
-        else:
+        # the messages of an event share the set of sessions of the event
+        self.__sessions: Set["typehints.AbstractSession"]
+        if event is not None:
             self.__sessions = event._sessions()
+        elif sessions is not None:
+            self.__sessions = sessions
+        else:
+            self.__sessions = set()
 
         self.__element: Optional[weakref.ReferenceType] = None
 
@@ -257,6 +262,22 @@ class Message(CHandle, metaclass=MetaClassForClassesWithEnums):
             )
         return res
 
+    def correlationIdInts(self) -> List[Optional[int]]:
+        """
+        Returns:
+            The values of the correlation ids associated with this message,
+            in the order of :meth:`correlationIds`: an :class:`int` for each
+            correlation id of type :attr:`CorrelationId.INT_TYPE` or
+            :attr:`CorrelationId.AUTOGEN_TYPE`, ``None`` for the others.
+
+        Note:
+            No :class:`CorrelationId` is created, which makes this the
+            cheaper way to route messages by integer correlation ids. The
+            value of a generated correlation id may be that of an integer
+            one, which :class:`CorrelationIdRouter` tells apart.
+        """
+        return internals.blpapi_Message_correlationIdInts(self.__handle)
+
     def hasElement(
         self, name: Name, excludeNullElements: bool = False
     ) -> bool:
@@ -318,6 +339,15 @@ class Message(CHandle, metaclass=MetaClassForClassesWithEnums):
         """
         return self.asElement().getElementAsBytes(name)
 
+    def getElementAsBytesView(self, name: Name) -> memoryview:
+        """Equivalent to :meth:`asElement().getElementAsBytesView(name)
+        <Element.getElementAsBytesView()>`.
+
+        The returned view keeps this :class:`Message` alive until it is
+        released.
+        """
+        return self.asElement().getElementAsBytesView(name)
+
     def getElementAsInteger(self, name: Name) -> int:
         """Equivalent to :meth:`asElement().getElementAsInteger(name)
         <Element.getElementAsInteger()>`.
@@ -404,9 +434,40 @@ class Message(CHandle, metaclass=MetaClassForClassesWithEnums):
             self.__handle, level, spacesPerLevel
         )
 
-    def toPy(self) -> dict:
+    def toPy(
+        self,
+        datetimeAsEpochNanos: bool = False,
+        fields: Optional[
+            Union[FieldSelector, Iterable[Union[Name, str]]]
+        ] = None,
+    ) -> dict:
         """Equivalent to :meth:`asElement().toPy()<Element.toPy()>`."""
-        return self.asElement().toPy()  # type: ignore
+        return self.asElement().toPy(  # type: ignore
+            datetimeAsEpochNanos, fields
+        )
+
+    def toJson(
+        self,
+        datetimeAsEpochNanos: bool = False,
+        fields: Optional[
+            Union[FieldSelector, Iterable[Union[Name, str]]]
+        ] = None,
+    ) -> bytes:
+        """Equivalent to :meth:`asElement().toJson()<Element.toJson()>`."""
+        return self.asElement().toJson(  # type: ignore
+            datetimeAsEpochNanos, fields
+        )
+
+    def asMapping(
+        self, datetimeAsEpochNanos: bool = False
+    ) -> ElementView:
+        """Equivalent to :meth:`asElement().view()<Element.view()>`.
+
+        The returned :class:`ElementView` converts the elements of this
+        :class:`Message` only when they are accessed, and keeps this
+        :class:`Message` alive.
+        """
+        return self.asElement().view(datetimeAsEpochNanos)  # type: ignore
 
     def timeReceived(self, tzinfo: datetime.tzinfo = UTC) -> AnyPythonDatetime:
         """Get the time when the message was received by the SDK.
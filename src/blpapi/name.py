@@ -7,7 +7,7 @@ form for efficient string comparison.
 
 """
 from __future__ import annotations
-from typing import Any, Optional, Tuple, Union
+from typing import Any, Dict, Optional, Tuple, Union
 from . import internals
 from .utils import conv2str, get_handle, isstr
 from .chandle import CHandle
@@ -136,6 +136,16 @@ class Name(CHandle):
         return int(self.__handle.value)  # type: ignore
 
 
+# Handles of the existing 'blpapi_Name_t's of the strings passed to
+# 'getNamePair', so that lookups by string are done by 'Name' without
+# searching the global name table again on every call. Entries are never
+# removed from that table, so the handles stay valid; the cache itself is
+# cleared when full, since the strings are chosen by the application.
+# Concurrent updates are safe, each of them being a single 'dict' operation.
+_nameHandles: Dict[Union[str, bytes], BlpapiNameHandle] = {}
+_NAME_HANDLES_MAX_SIZE = 4096
+
+
 def getNamePair(
     name: Union[Name, str],
 ) -> Union[Tuple[None, BlpapiNameHandle], Tuple[str, None]]:
@@ -145,24 +155,40 @@ def getNamePair(
         name: A :class:`Name` or a string instance
 
     Returns:
-        ``(None, name._handle())`` if ``name`` is a :class:`Name` instance, or
-        ``(name, None)`` if ``name`` is a string. In other cases raise
-        TypeError exception.
+        ``(None, name._handle())`` if ``name`` is a :class:`Name` instance.
+        If ``name`` is a string, ``(None, handle)`` with the handle of the
+        existing :class:`Name` for that string, or ``(name, None)`` if there
+        is no such :class:`Name`. In other cases raise TypeError exception.
 
     Raises:
         TypeError: If ``name`` is neither a :class:`Name` nor a string
 
     For internal use only.
 
-    Note:
-        :class:`Name` **objects should be initialized
-        once and then reused** in order to minimize lookup cost.
+    The handles found for strings are cached, so that code using string
+    literals as keys costs a dictionary lookup more than code using
+    :class:`Name` objects instead of a search of the name table. No
+    :class:`Name` is created for a string that has none, and such misses
+    are not cached: each of them costs a search of the name table before
+    the lookup by string of the caller. As no element or definition can
+    have a name missing from the table, callers testing whether one exists
+    return ``False`` for a ``None`` handle without such a lookup.
     """
 
     if isinstance(name, Name):
         return (None, get_handle(name))
     if isstr(name):
-        return (conv2str(name), None)
+        handle = _nameHandles.get(name)
+        if handle is not None:
+            return (None, handle)
+        nameString = conv2str(name)
+        handle = internals.blpapi_Name_findName(nameString)
+        if handle is None:
+            return (nameString, None)
+        if len(_nameHandles) >= _NAME_HANDLES_MAX_SIZE:
+            _nameHandles.clear()
+        _nameHandles[name] = handle
+        return (None, handle)
     raise TypeError("name should be an instance of a string or blpapi.Name")
 
 
@@ -0,0 +1,200 @@
+# preparedrequest.py
+
+"""
+This component provides a class, PreparedRequest, that builds the many
+requests of an operation that only differ by a few of their elements.
+
+The content shared by the requests is given once, as the value given to
+'Request.fromPy', together with the names of its "slots": the top-level
+elements, such as 'securities', 'overrides' or 'startDate', whose values are
+given for each request. The names of the slots are checked against the schema
+of the operation, and the shared content is checked by formatting a first
+request, once when the 'PreparedRequest' is created, its keys being resolved
+to 'Name's at the same time.
+
+A 'PreparedRequest' is a convenience: as the C library cannot copy a
+request, each request is still formatted in full, by a single
+'Request.fromPy' call of the shared content merged with the values of the
+slots. It only saves the checks of the slot names and the lookups of the
+names of the shared content.
+
+Usage
+-----
+The following sends a 'HistoricalDataRequest' per security of 'securities'.
+
+    prepared = service.prepareRequest(
+        "HistoricalDataRequest",
+        {
+            "fields": ["PX_LAST", "VOLUME"],
+            "periodicitySelection": "DAILY",
+            "startDate": "20240101",
+            "endDate": "20241231",
+        },
+        slots=["securities"],
+    )
+    for security in securities:
+        prepared.send(session, {"securities": [security]})
+"""
+
+from collections.abc import Mapping
+from typing import Any, Dict, FrozenSet, Optional, Sequence, Union
+from typing import Mapping as MappingType
+from .correlationid import CorrelationId
+from .name import Name
+from .request import Request
+from . import typehints  # pylint: disable=unused-import
+
+
+def _resolveNames(value: Any) -> Any:
+    """Return a copy of 'value' where the 'str' keys of the mappings,
+    including those nested in mappings and sequences, are 'Name's."""
+    if isinstance(value, Mapping):
+        return {
+            Name(key) if isinstance(key, str) else key: _resolveNames(item)
+            for key, item in value.items()
+        }
+    if isinstance(value, (list, tuple)):
+        return [_resolveNames(item) for item in value]
+    return value
+
+
+class PreparedRequest:
+    """The shared content of the requests of an operation, and the names of
+    the elements set for each request.
+
+    :class:`PreparedRequest` objects are created using
+    :meth:`Service.prepareRequest()`. The requests created from a
+    :class:`PreparedRequest` are independent :class:`Request` objects, which
+    can be further formatted before being sent.
+    """
+
+    def __init__(
+        self,
+        service: "typehints.Service",
+        operation: Union[Name, str],
+        value: MappingType,
+        slots: Sequence[Union[Name, str]] = (),
+    ) -> None:
+        """Use :meth:`Service.prepareRequest()` to create a
+        :class:`PreparedRequest`."""
+        if not isinstance(value, Mapping):
+            raise Exception("`value` must be a `Mapping` instance")
+        typeDefinition = (
+            service.getOperation(operation)
+            .requestDefinition()
+            .typeDefinition()
+        )
+        slotNames = {str(slot): Name(str(slot)) for slot in slots}
+        for slot in slotNames.values():
+            if not typeDefinition.hasElementDefinition(slot):
+                raise Exception(
+                    f"`{slot}` is not an element of the requests of"
+                    f" `{operation}`"
+                )
+
+        self.__service = service
+        self.__operation = str(operation)
+        self.__slots: Dict[str, Name] = slotNames
+        self.__value: Dict[Any, Any] = {
+            key: item
+            for key, item in value.items()
+            if str(key) not in slotNames
+        }
+
+        # format a first request, so that errors in the shared content are
+        # reported here rather than when sending, before resolving its keys
+        # to the 'Name's that its elements now have
+        self.createRequest()
+        self.__value = _resolveNames(self.__value)
+
+    def slots(self) -> FrozenSet[Name]:
+        """
+        Returns:
+            The names of the elements set for each request.
+        """
+        return frozenset(self.__slots.values())
+
+    def createRequest(self, values: Optional[MappingType] = None) -> Request:
+        """Create a request formatted from the shared content and the
+        ``values`` of the slots, as :meth:`Request.fromPy` formats it from
+        their merged values.
+
+        Args:
+            values: The values of the slots of this request, keyed by the
+                names of the slots. Slots without a value are not set.
+
+        Returns:
+            A new request of the operation of this :class:`PreparedRequest`.
+
+        Raises:
+            KeyError: If a key of ``values`` is not a slot.
+            Exception: If a value cannot format its element, as
+                :meth:`Request.fromPy`.
+        """
+        request = self.__service.createRequest(self.__operation)
+        if not values:
+            request.fromPy(self.__value)
+            return request
+
+        content = dict(self.__value)
+        for key, item in values.items():
+            name = self.__slots.get(key if isinstance(key, str) else str(key))
+            if name is None:
+                raise KeyError(f"`{key}` is not a slot of this request")
+            content[name] = item
+        request.fromPy(content)
+        return request
+
+    def send(
+        self,
+        session: "typehints.Session",
+        values: Optional[MappingType] = None,
+        identity: Optional["typehints.Identity"] = None,
+        correlationId: Optional[CorrelationId] = None,
+        eventQueue: Optional["typehints.EventQueue"] = None,
+        requestLabel: Optional[str] = None,
+    ) -> CorrelationId:
+        """Send, through ``session``, the request created by
+        :meth:`createRequest()` for ``values``.
+
+        Args:
+            session: Session to send the request with
+            values: The values of the slots of the request
+            identity: As :meth:`Session.sendRequest()`
+            correlationId: As :meth:`Session.sendRequest()`
+            eventQueue: As :meth:`Session.sendRequest()`
+            requestLabel: As :meth:`Session.sendRequest()`
+
+        Returns:
+            CorrelationId: The actual correlation id associated with the
+            request
+        """
+        return session.sendRequest(
+            self.createRequest(values),
+            identity=identity,
+            correlationId=correlationId,
+            eventQueue=eventQueue,
+            requestLabel=requestLabel,
+        )
+
+
+__copyright__ = """
+Copyright 2024. Bloomberg Finance L.P.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to
+deal in the Software without restriction, including without limitation the
+rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+sell copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:  The above
+copyright notice and this permission notice shall be included in all copies
+or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+IN THE SOFTWARE.
+"""
@@ -59,25 +59,24 @@ publishers that do not maintain per-topic state.
 
 from __future__ import annotations
 from weakref import ref, ReferenceType  # pylint: disable=unused-import
-from typing import Optional, Callable, Sequence, Any
-import sys
-import traceback
-import os
-import functools
+from typing import Optional, Callable, Sequence, Any, List, Tuple, Union
+from typing import Mapping as MappingType
 import atexit
+from collections.abc import Mapping
 from .abstractsession import AbstractSession
 from .event import Event
+from .eventformatter import EventFormatter, _columnsFromPy
 from . import exception
 from .exception import _ExceptionUtil
 from . import internals
 from .correlationid import CorrelationId
+from .name import Name
 from .sessionoptions import SessionOptions
 from .topic import Topic
 from . import utils
 from .utils import get_handle
 from .chandle import CHandle
 from . import typehints  # pylint: disable=unused-import
-from .typehints import BlpapiEventHandle
 
 
 # pylint: disable=line-too-long,too-many-lines
@@ -303,29 +302,17 @@ class ProviderSession(
     __handle = None  # pylint: disable=unused-private-member
     __handlerProxy = None  # pylint: disable=unused-private-member
 
-    @staticmethod
-    def __dispatchEvent(
-        sessionRef: "ReferenceType[ProviderSession]",
-        eventHandle: BlpapiEventHandle,
-    ) -> None:  # pragma: no cover
-        """Use sessions ref to dispatch an event"""
-        try:
-            session = sessionRef()
-            if session is not None:
-                event = Event(eventHandle, {session})
-                session.__handler(event, session)
-        except:
-            print("Exception in event handler:", file=sys.stderr)
-            traceback.print_exc(file=sys.stderr)
-            os._exit(1)
-
     def __init__(
         self,
         options: Optional[SessionOptions] = None,
         eventHandler: Optional[
-            Callable[[Event, ProviderSession], None]
+            Union[
+                Callable[[Event, ProviderSession], None],
+                Callable[[List[Event], ProviderSession], None],
+            ]
         ] = None,
         eventDispatcher: Optional["typehints.EventDispatcher"] = None,
+        dispatchInBatches: bool = False,
     ) -> None:
         """Constructor.
 
@@ -333,6 +320,8 @@ class ProviderSession(
             options: Options used to construct the sessions
             eventHandler: Handler for the events generated by this session
             eventDispatcher: Dispatcher for the events generated by this session
+            dispatchInBatches: Whether ``eventHandler`` takes a list of
+                received events instead of a single event
         Raises:
             InvalidArgumentException: If ``eventHandler`` is ``None`` and the
                 ``eventDispatcher`` is not ``None``
@@ -367,6 +356,9 @@ class ProviderSession(
         and takes a long time to process them does not delay a session that
         receives small messages and processes each one very quickly then give
         each one a separate :class:`EventDispatcher`.
+
+        If ``dispatchInBatches`` is ``True``, ``eventHandler`` is called with
+        a non-empty list of events instead, see :class:`Session` for details.
         """
         if (eventHandler is None) and (eventDispatcher is not None):
             raise exception.InvalidArgumentException(
@@ -375,10 +367,8 @@ class ProviderSession(
         if options is None:
             options = SessionOptions()
         if eventHandler is not None:
-            # pylint: disable=unused-private-member
-            self.__handler = eventHandler
-            self.__handlerProxy = functools.partial(
-                ProviderSession.__dispatchEvent, ref(self)
+            self.__handlerProxy = internals.createEventHandler(
+                Event, eventHandler, ref(self), dispatchInBatches
             )
 
         self.__handle = internals.ProviderSession_createHelper(
@@ -529,7 +519,7 @@ class ProviderSession(
 
         _ExceptionUtil.raiseOnError(retCode)
 
-        return Event(event, {self})
+        return Event(event, self._sessionSet())
 
     def tryNextEvent(self) -> Optional[Event]:
         r"""
@@ -545,7 +535,7 @@ class ProviderSession(
         )
         if retCode:
             return None
-        return Event(event, {self})
+        return Event(event, self._sessionSet())
 
     def registerService(
         self,
@@ -763,7 +753,7 @@ class ProviderSession(
             self.__handle, get_handle(message)
         )
         _ExceptionUtil.raiseOnError(errorCode)
-        return Topic(topicHandle, {self})
+        return Topic(topicHandle, self._sessionSet())
 
     def createServiceStatusTopic(self, service: "typehints.Service") -> Topic:
         """Create a :class:`Service` Status :class:`Topic` which is to be used
@@ -785,7 +775,7 @@ class ProviderSession(
             self.__handle, get_handle(service)
         )
         _ExceptionUtil.raiseOnError(errorCode)
-        return Topic(topicHandle, {self})
+        return Topic(topicHandle, self._sessionSet())
 
     def publish(self, event: Event) -> None:
         """Publish the specified ``event``.
@@ -799,6 +789,127 @@ class ProviderSession(
             )
         )
 
+    def publishMessages(
+        self,
+        service: "typehints.Service",
+        messageType: Union[Name, str],
+        messages: Sequence[Tuple[Topic, MappingType]],
+        maxMessagesPerEvent: int = 0,
+    ) -> int:
+        """Publish a message of type ``messageType`` per ``(topic, value)``
+        pair of ``messages``, formatted from ``value`` as
+        :meth:`EventFormatter.fromPy` does.
+
+        Args:
+            service: Service of the topics
+            messageType: Type of the messages
+            messages: The topics and values of the messages
+            maxMessagesPerEvent: The maximum number of messages published in
+                one :class:`Event`, ``0`` for no maximum
+
+        Returns:
+            The number of events published
+
+        The messages are encoded into events created with
+        :meth:`Service.createPublishEvent`, in the ``blpapi`` extension module
+        when it is available. If a message cannot be formatted, the
+        exception raised is the one :meth:`EventFormatter.fromPy` raises: the
+        events before the one of that message have been published, that
+        event and the following ones are not.
+        """
+        topics = []
+        values = []
+        for topic, value in messages:
+            if not isinstance(value, Mapping):
+                raise Exception("`value` must be a `Mapping` instance")
+            topics.append(get_handle(topic))
+            values.append(value)
+        return self.__publishBatch(
+            service, messageType, topics, values, None, maxMessagesPerEvent
+        )
+
+    def publishColumns(
+        self,
+        service: "typehints.Service",
+        messageType: Union[Name, str],
+        topics: Sequence[Topic],
+        columns: MappingType[Union[Name, str], Sequence[Any]],
+        maxMessagesPerEvent: int = 0,
+    ) -> int:
+        """Publish a message of type ``messageType`` per topic of ``topics``,
+        formatted from the row of the topic in ``columns`` as
+        :meth:`EventFormatter.appendColumns` does.
+
+        Args:
+            service: Service of the topics
+            messageType: Type of the messages
+            topics: The topic of each message
+            columns: The columns of the values of the elements, each with a
+                value per topic
+            maxMessagesPerEvent: The maximum number of messages published in
+                one :class:`Event`, ``0`` for no maximum
+
+        Returns:
+            The number of events published
+
+        Failures are handled as by :meth:`publishMessages`.
+
+        Example:
+            The following publishes a refresh of a whole universe held in a
+            pandas ``DataFrame`` indexed by topic, a thousand messages per
+            event::
+
+                session.publishColumns(
+                    service,
+                    "MarketData",
+                    list(frame.index),
+                    {column: frame[column].to_numpy() for column in frame},
+                    maxMessagesPerEvent=1000,
+                )
+        """
+        topicHandles = [get_handle(topic) for topic in topics]
+        fields, values = _columnsFromPy(columns, len(topicHandles))
+        return self.__publishBatch(
+            service,
+            messageType,
+            topicHandles,
+            values,
+            fields,
+            maxMessagesPerEvent,
+        )
+
+    def __publishBatch(
+        self,
+        service: "typehints.Service",
+        messageType: Union[Name, str],
+        topics: List[Any],
+        values: Sequence[Any],
+        fields: Optional[List[Union[Name, str]]],
+        maxMessagesPerEvent: int,
+    ) -> int:
+        """Publish the messages of the topic handles ``topics``, in events of
+        at most ``maxMessagesPerEvent`` messages."""
+        if maxMessagesPerEvent < 0:
+            raise ValueError("maxMessagesPerEvent must not be negative")
+        numMessages = len(topics)
+        step = maxMessagesPerEvent or max(numMessages, 1)
+        numEvents = 0
+        for start in range(0, numMessages, step):
+            event = service.createPublishEvent()
+            formatter = EventFormatter(event)
+            # pylint: disable=protected-access
+            formatter._appendMessagesFromPy(
+                messageType,
+                topics,
+                values,
+                fields,
+                start,
+                min(start + step, numMessages),
+            )
+            self.publish(event)
+            numEvents += 1
+        return numEvents
+
     def sendResponse(
         self, event: Event, isPartialResponse: bool = False
     ) -> None:
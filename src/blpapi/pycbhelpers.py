@@ -7,6 +7,9 @@ from ctypes import (
 
 from typing import Any, Callable
 from io import StringIO
+import os
+import sys
+import traceback
 
 from .ctypesutils import pyObjectFromVoid, voidFromPyObject
 
@@ -68,6 +71,56 @@ class EventHandleWrapper:
 anySessionEventHandlerWrapper = EventHandleWrapper()
 
 
+def handleEventHandlerError(
+    excType: Any, excValue: Any, excTraceback: Any
+) -> None:
+    print("Exception in event handler:", file=sys.stderr)
+    traceback.print_exception(
+        excType, excValue, excTraceback, file=sys.stderr
+    )
+    os._exit(1)
+
+
+def dispatchEventToHandler(
+    eventType: Any,
+    handler: Callable,
+    sessionRef: Any,
+    batch: bool,
+    lastValueTable: Any,
+    latencyTable: Any,
+    eventHandle: c_void_p,
+) -> None:  # pragma: no cover
+    # A 'functools.partial' of this function is the 'pycb' given to
+    # '_dispatchEventProxy' when the native event handler of the 'ffiutils'
+    # module is not available. In batch mode, each batch holds one event.
+    # The dispatch is recorded into 'latencyTable', if it is not 'None'.
+    try:
+        session = sessionRef()
+        if session is None:
+            return
+        event = eventType(eventHandle, session._sessionSet())
+        start = 0
+        if latencyTable is not None:
+            start = latencyTable.dequeued(event)
+        try:
+            if (
+                lastValueTable is not None
+                and event.eventType() == eventType.SUBSCRIPTION_DATA
+            ):
+                lastValueTable.update(event)
+                return
+            if latencyTable is not None:
+                start = latencyTable.handlerEntered(start)
+            handler([event] if batch else event, session)
+            if latencyTable is not None:
+                latencyTable.handlerExited(start)
+        finally:
+            if latencyTable is not None:
+                latencyTable.handled()
+    except:  # pylint: disable=bare-except
+        handleEventHandlerError(*sys.exc_info())
+
+
 def _subscriptionPreprocessProxy(
     cid: int, subString: bytes, errorCode: int, errorDesc: bytes, pycb: int
 ) -> None:
@@ -0,0 +1,353 @@
+# responsecollector.py
+
+"""Collect the responses of requests into typed columns as they arrive.
+
+This component defines a class, 'ResponseCollector', which sends requests
+on a 'Session' with its own 'EventQueue' and appends the rows of each
+'PARTIAL_RESPONSE' and 'RESPONSE' event to the columns of the request it
+belongs to as soon as it is received, using a 'ColumnarExtractor'. The
+events, and the messages they hold, are released as they are converted, so
+that a large response is never held in memory as a whole, and the columns
+of a request are returned as a single 'ColumnarBatch' once its final
+'RESPONSE' is received.
+
+A 'ResponseCollector' can bound the number of its requests in flight, in
+which case sending a request first waits for enough of the others to
+complete.
+
+Usage
+-----
+The following collects the history of a universe, 16 requests at a time.
+
+    extractor = ColumnarExtractor(
+        [
+            ("security", ColumnarExtractor.OBJECT),
+            ("date", ColumnarExtractor.TIMESTAMP),
+            ("PX_LAST", ColumnarExtractor.FLOAT64),
+        ],
+        rows=["securityData", "fieldData"],
+    )
+    collector = ResponseCollector(session, extractor, maxInFlight=16)
+    for security in universe:
+        request = service.createRequest("HistoricalDataRequest")
+        ...
+        collector.sendRequest(request)
+    for correlationId, batch in collector.results():
+        frame = batch.toArrow().to_pandas()
+"""
+
+import time
+from collections import deque
+from typing import Any, Deque, Dict, Iterator, Optional, Tuple, Union
+from .columnar import ColumnarBatch, ColumnarExtractor
+from .correlationid import CorrelationId
+from .event import Event, EventQueue
+from .exception import Exception as BlpapiException
+from .exception import InvalidArgumentException
+from .message import Message
+from .name import Name
+from .names import Names
+from .session import Session
+from . import typehints  # pylint: disable=unused-import
+
+_DESCRIPTION = Name("description")
+_ERROR_CODE = Name("errorCode")
+_REASON = Name("reason")
+
+# the 'RequestFailure' of a request, or the error converting a response
+_Failure = Union[Message, Exception]
+
+
+class ResponseCollector:
+    """Columns of the responses of requests, filled as they arrive.
+
+    The requests sent with :meth:`sendRequest` are delivered to an
+    :class:`EventQueue` owned by the collector. Each
+    :attr:`~Event.PARTIAL_RESPONSE` and :attr:`~Event.RESPONSE` event read
+    from it is appended to the columns of its request with the
+    ``extractor`` of the collector, and a request is complete once its
+    :attr:`~Event.RESPONSE` has been appended, or once it failed with a
+    ``RequestFailure`` :attr:`~Event.REQUEST_STATUS` or because one of its
+    responses could not be converted by the extractor, whose later
+    responses are then ignored. The events are only
+    read from the queue while :meth:`sendRequest`, :meth:`result` or
+    :meth:`results` wait for them.
+
+    The messages of a response event must all belong to the same request,
+    as they do for the requests of the Bloomberg services.
+
+    Note:
+        The methods of a :class:`ResponseCollector` must not be called from
+        several threads at the same time.
+    """
+
+    def __init__(
+        self,
+        session: Session,
+        extractor: ColumnarExtractor,
+        maxInFlight: Optional[int] = None,
+    ) -> None:
+        """Create a collector sending its requests on ``session`` and
+        converting their responses with ``extractor``, with at most
+        ``maxInFlight`` requests in flight if it is not ``None``.
+
+        Args:
+            session: The session the requests are sent on
+            extractor: The extractor of the rows of the responses, usually
+                created with ``rows``
+            maxInFlight: The maximum number of requests sent and not yet
+                complete
+
+        Raises:
+            ValueError: If ``maxInFlight`` is not positive
+        """
+        if maxInFlight is not None and maxInFlight < 1:
+            raise ValueError("maxInFlight must be positive")
+        self.__session = session
+        self.__extractor = extractor
+        self.__maxInFlight = maxInFlight
+        self.__queue = EventQueue()
+        # the columns and number of rows of the requests in flight
+        self.__pending: Dict[CorrelationId, Tuple[Any, int]] = {}
+        # the batch or the failure of the requests complete and not yet
+        # returned, and the order in which they completed
+        self.__complete: Dict[
+            CorrelationId, Tuple[Optional[ColumnarBatch], Optional[_Failure]]
+        ] = {}
+        self.__completionOrder: Deque[CorrelationId] = deque()
+
+    def sendRequest(
+        self,
+        request: "typehints.Request",
+        identity: Optional["typehints.Identity"] = None,
+        correlationId: Optional[CorrelationId] = None,
+        requestLabel: Optional[str] = None,
+    ) -> CorrelationId:
+        """Send ``request`` as :meth:`Session.sendRequest` does, its
+        responses being collected by this collector.
+
+        Args:
+            request: Request to send
+            identity: Identity used for authorization
+            correlationId: Correlation id to associate with the request
+            requestLabel: String which will be recorded along with any
+                diagnostics for this operation
+
+        Returns:
+            The correlation id associated with the request.
+
+        Raises:
+            InvalidArgumentException: If ``correlationId`` is the
+                correlation id of another request of this collector that is
+                in flight or whose result was not returned yet
+
+        If ``maxInFlight`` requests of this collector are in flight, wait
+        for one of them to complete before sending ``request``.
+        """
+        if correlationId is not None and (
+            correlationId in self.__pending
+            or correlationId in self.__complete
+        ):
+            raise InvalidArgumentException(
+                f"Correlation id {correlationId} is already used by this"
+                " collector",
+                0,
+            )
+        if self.__maxInFlight is not None:
+            while len(self.__pending) >= self.__maxInFlight:
+                self.__processEvent(self.__queue.nextEvent())
+        # pylint: disable=protected-access
+        columns = self.__extractor._newColumns()
+        correlationId = self.__session.sendRequest(
+            request, identity, correlationId, self.__queue, requestLabel
+        )
+        self.__pending[correlationId] = (columns, 0)
+        return correlationId
+
+    def pending(self) -> int:
+        """
+        Returns:
+            The number of requests of this collector in flight.
+        """
+        return len(self.__pending)
+
+    def result(
+        self, correlationId: CorrelationId, timeout: int = 0
+    ) -> Optional[ColumnarBatch]:
+        """Wait for the request of ``correlationId`` to complete and return
+        its rows.
+
+        Args:
+            correlationId: The correlation id returned by
+                :meth:`sendRequest`
+            timeout: Timeout threshold in milliseconds
+
+        Returns:
+            The batch of the rows of all the responses of the request, or
+            ``None`` if the request did not complete within ``timeout``.
+
+        Raises:
+            InvalidArgumentException: If ``correlationId`` is not the
+                correlation id of a request of this collector whose result
+                was not returned yet
+            Exception: If the request failed, with the description and
+                error code of its ``RequestFailure``, or the exception
+                raised converting one of its responses
+
+        If ``timeout`` is zero this method waits until the request
+        completes. Once returned, the result of a request is released by
+        the collector.
+        """
+        if (
+            correlationId not in self.__pending
+            and correlationId not in self.__complete
+        ):
+            raise InvalidArgumentException(
+                f"No request of this collector has correlation id"
+                f" {correlationId}",
+                0,
+            )
+        deadline = time.monotonic() + timeout / 1000 if timeout else None
+        while correlationId in self.__pending:
+            if not self.__waitForEvent(deadline):
+                return None
+        if correlationId in self.__completionOrder:
+            self.__completionOrder.remove(correlationId)
+        batch, failure = self.__complete.pop(correlationId)
+        if isinstance(failure, Exception):
+            raise failure
+        if failure is not None:
+            reason = failure.getElement(_REASON)
+            raise BlpapiException(
+                reason.getElementAsString(_DESCRIPTION),
+                reason.getElementAsInteger(_ERROR_CODE),
+            )
+        return batch
+
+    def results(
+        self, timeout: int = 0
+    ) -> Iterator[Tuple[CorrelationId, Optional[ColumnarBatch]]]:
+        """Yield the requests of this collector as they complete.
+
+        Args:
+            timeout: Timeout threshold in milliseconds
+
+        Yields:
+            The correlation id of each request and the batch of the rows of
+            all its responses, or ``None`` if it failed, in which case
+            :meth:`failure` returns its failure.
+
+        Stop once all the requests of this collector are complete and have
+        been yielded, or once no request completes within ``timeout`` if it
+        is not zero. The results of the requests yielded are released by
+        the collector.
+        """
+        deadline = time.monotonic() + timeout / 1000 if timeout else None
+        while self.__pending or self.__completionOrder:
+            while self.__completionOrder:
+                correlationId = self.__completionOrder.popleft()
+                entry = self.__complete.get(correlationId)
+                if entry is None:
+                    # returned by 'result' or 'failure' in the meantime
+                    continue
+                batch, failure = entry
+                if failure is None:
+                    del self.__complete[correlationId]
+                yield correlationId, batch
+            if self.__pending and not self.__waitForEvent(deadline):
+                return
+            if timeout:
+                deadline = time.monotonic() + timeout / 1000
+
+    def failure(
+        self, correlationId: CorrelationId
+    ) -> Optional[_Failure]:
+        """
+        Args:
+            correlationId: The correlation id of a complete request
+
+        Returns:
+            The ``RequestFailure`` message of the request, or the exception
+            raised converting one of its responses, if it failed, releasing
+            it, otherwise ``None``.
+        """
+        entry = self.__complete.get(correlationId)
+        if entry is None or entry[1] is None:
+            return None
+        del self.__complete[correlationId]
+        return entry[1]
+
+    def __waitForEvent(self, deadline: Optional[float]) -> bool:
+        """Process the next event of the queue, waiting until 'deadline' if
+        it is not 'None', and return 'False' if none was received before."""
+        timeout = 0
+        if deadline is not None:
+            # a zero timeout would wait forever
+            timeout = max(int((deadline - time.monotonic()) * 1000), 1)
+        event = self.__queue.nextEvent(timeout)
+        if event.eventType() == Event.TIMEOUT:
+            return False
+        self.__processEvent(event)
+        return True
+
+    def __processEvent(self, event: Event) -> None:
+        """Append the rows of the response 'event' to the columns of its
+        request, or record the failure of the requests of 'event'."""
+        eventType = event.eventType()
+        if eventType in (Event.PARTIAL_RESPONSE, Event.RESPONSE):
+            for message in event:
+                correlationId = message.correlationId()
+                break
+            else:
+                return
+            entry = self.__pending.get(correlationId)
+            if entry is None:
+                return
+            columns, numRows = entry
+            try:
+                # pylint: disable=protected-access
+                numRows = self.__extractor._append(columns, event, numRows)
+            except Exception as exception:  # pylint: disable=broad-except
+                # the rows of the request would be missing those of 'event'
+                del self.__pending[correlationId]
+                self.__complete[correlationId] = (None, exception)
+                self.__completionOrder.append(correlationId)
+                return
+            if eventType == Event.PARTIAL_RESPONSE:
+                self.__pending[correlationId] = (columns, numRows)
+                return
+            del self.__pending[correlationId]
+            batch = self.__extractor._finish(columns, numRows)
+            self.__complete[correlationId] = (batch, None)
+            self.__completionOrder.append(correlationId)
+        elif eventType == Event.REQUEST_STATUS:
+            for message in event:
+                if message.messageType() != Names.REQUEST_FAILURE:
+                    continue
+                for correlationId in message.correlationIds():
+                    if self.__pending.pop(correlationId, None) is None:
+                        continue
+                    self.__complete[correlationId] = (None, message)
+                    self.__completionOrder.append(correlationId)
+
+
+__copyright__ = """
+Copyright 2024. Bloomberg Finance L.P.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to
+deal in the Software without restriction, including without limitation the
+rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+sell copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:  The above
+copyright notice and this permission notice shall be included in all copies
+or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+IN THE SOFTWARE.
+"""
@@ -364,6 +364,9 @@ class SchemaTypeDefinition:
         """
 
         namepair = getNamePair(name)
+        if namepair[1] is None:
+            # no definition has a name missing from the name table
+            return False
         return bool(
             internals.blpapi_SchemaTypeDefinition_hasElementDefinition(
                 self.__handle, namepair[0], namepair[1]
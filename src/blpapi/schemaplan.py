@@ -0,0 +1,724 @@
+# schemaplan.py
+
+"""Compile the schema of an event or a request into a reusable plan.
+
+This component defines two classes: 'SchemaPlan', the compiled definition of
+a complex type of a schema, and 'FieldPlan', the compiled definition of one of
+its elements. Walking the 'SchemaElementDefinition's and
+'SchemaTypeDefinition's of a schema costs a call into the C library per
+attribute per element definition, and handlers looking up the datatypes,
+arrays and optional elements they receive repeat that walk. A 'SchemaPlan'
+walks the definition tree once, in a single call when the extension module is
+available, and keeps the name, datatype, type, bounds and enumeration of
+every element, so that these are then plain attribute lookups.
+
+A 'SchemaPlan' derives from its element definitions the 'FieldSelector' and
+the 'ColumnarExtractor' of its fields, the kind of each column following the
+datatype of its field, and validates the values given to 'Request.fromPy' or
+'EventFormatter.fromPy' against the schema, without formatting them.
+
+A 'SchemaPlan' only holds python values, and can be saved to a file and
+loaded again. 'Service.schemaPlan' compiles the plans of a service once per
+'Service' object and, given a cache directory, loads them from the files
+saved for the same schema by previous runs.
+
+Usage
+-----
+The following extracts the numeric, boolean and time fields of the
+subscription data events of a service into typed columns.
+
+    plan = service.schemaPlan("MarketDataEvents", cacheDirectory=cacheDir)
+    extractor = plan.columnarExtractor(["BID", "ASK", "LAST_UPDATE_BID_RT"])
+    for event in events:
+        batch = extractor.extract(event)
+
+The following validates a request before formatting it.
+
+    plan = service.schemaPlan("ReferenceDataRequest")
+    plan.validate(value)
+    request.fromPy(value)
+"""
+
+from __future__ import annotations
+import datetime
+import os
+from collections.abc import Mapping
+from ctypes import c_size_t
+from typing import Any, Dict, Iterator, List, Optional, Sequence, Tuple, Union
+from .columnar import ColumnarExtractor
+from .exception import InvalidArgumentException, NotFoundException
+from .fieldselector import FieldSelector
+from .name import Name
+from .schema import SchemaElementDefinition
+from .utils import isNonScalarSequence
+from . import internals
+
+_FORMAT_VERSION = 1
+_SIZE_T_UNBOUNDED = c_size_t(-1).value
+
+_COLUMN_KINDS = {
+    internals.DATATYPE_BOOL: ColumnarExtractor.BOOL,
+    internals.DATATYPE_BYTE: ColumnarExtractor.INT64,
+    internals.DATATYPE_INT32: ColumnarExtractor.INT64,
+    internals.DATATYPE_INT64: ColumnarExtractor.INT64,
+    internals.DATATYPE_FLOAT32: ColumnarExtractor.FLOAT64,
+    internals.DATATYPE_FLOAT64: ColumnarExtractor.FLOAT64,
+    internals.DATATYPE_DATE: ColumnarExtractor.TIMESTAMP,
+    internals.DATATYPE_TIME: ColumnarExtractor.TIMESTAMP,
+    internals.DATATYPE_DATETIME: ColumnarExtractor.TIMESTAMP,
+}
+
+_NUMERIC_DATATYPES = frozenset(
+    (
+        internals.DATATYPE_BOOL,
+        internals.DATATYPE_BYTE,
+        internals.DATATYPE_INT32,
+        internals.DATATYPE_INT64,
+        internals.DATATYPE_FLOAT32,
+        internals.DATATYPE_FLOAT64,
+        internals.DATATYPE_DECIMAL,
+    )
+)
+
+_TEMPORAL_DATATYPES = frozenset(
+    (
+        internals.DATATYPE_DATE,
+        internals.DATATYPE_TIME,
+        internals.DATATYPE_DATETIME,
+    )
+)
+
+# The compiled form of a definition, as returned by
+# 'internals.SchemaPlan_compile': the '(name, typeIndex, minValues,
+# maxValues)' of the element, and the '(name, datatype, fields,
+# enumeration)' of each type, 'fields' being tuples of elements.
+_Element = Tuple[Optional[str], int, int, int]
+_Type = Tuple[
+    Optional[str], int, Tuple[_Element, ...], Optional[Tuple[str, ...]]
+]
+
+
+def _compileDefinition(handle: Any) -> Tuple[_Element, List[_Type]]:
+    """Same as 'internals.SchemaPlan_compile' when the extension module is
+    not available."""
+    types: List[Any] = []
+    indexes: Dict[Any, int] = {}
+
+    def compileType(typeHandle: Any) -> int:
+        index = indexes.get(typeHandle.value)
+        if index is not None:
+            return index
+        # numbered before its fields are walked, for the recursive types
+        index = len(types)
+        indexes[typeHandle.value] = index
+        types.append(None)
+        fields: Tuple[_Element, ...] = ()
+        if internals.blpapi_SchemaTypeDefinition_isComplexType(typeHandle):
+            fields = tuple(
+                compileElement(
+                    internals.blpapi_SchemaTypeDefinition_getElementDefinitionAt(
+                        typeHandle, i
+                    )
+                )
+                for i in range(
+                    internals.blpapi_SchemaTypeDefinition_numElementDefinitions(
+                        typeHandle
+                    )
+                )
+            )
+        enumeration = None
+        if internals.blpapi_SchemaTypeDefinition_isEnumerationType(
+            typeHandle
+        ):
+            constants = internals.blpapi_SchemaTypeDefinition_enumeration(
+                typeHandle
+            )
+            enumeration = tuple(
+                internals.blpapi_Name_string(
+                    internals.blpapi_Constant_name(
+                        internals.blpapi_ConstantList_getConstantAt(
+                            constants, i
+                        )
+                    )
+                )
+                for i in range(
+                    internals.blpapi_ConstantList_numConstants(constants)
+                )
+            )
+        types[index] = (
+            internals.blpapi_Name_string(
+                internals.blpapi_SchemaTypeDefinition_name(typeHandle)
+            ),
+            internals.blpapi_SchemaTypeDefinition_datatype(typeHandle),
+            fields,
+            enumeration,
+        )
+        return index
+
+    def compileElement(elementHandle: Any) -> _Element:
+        typeIndex = compileType(
+            internals.blpapi_SchemaElementDefinition_type(elementHandle)
+        )
+        maxValues = internals.blpapi_SchemaElementDefinition_maxValues(
+            elementHandle
+        )
+        return (
+            internals.blpapi_Name_string(
+                internals.blpapi_SchemaElementDefinition_name(elementHandle)
+            ),
+            typeIndex,
+            internals.blpapi_SchemaElementDefinition_minValues(elementHandle),
+            -1 if maxValues == _SIZE_T_UNBOUNDED else maxValues,
+        )
+
+    return compileElement(handle), types
+
+
+class FieldPlan:
+    """The compiled definition of an element of a :class:`SchemaPlan`.
+
+    :class:`FieldPlan` objects are obtained from a :class:`SchemaPlan`, and
+    are read-only.
+    """
+
+    __slots__ = (
+        "_FieldPlan__name",
+        "_FieldPlan__datatype",
+        "_FieldPlan__typeName",
+        "_FieldPlan__minValues",
+        "_FieldPlan__maxValues",
+        "_FieldPlan__enumeration",
+        "_FieldPlan__plan",
+    )
+
+    def __init__(
+        self,
+        name: str,
+        datatype: int,
+        typeName: Optional[str],
+        minValues: int,
+        maxValues: int,
+        enumeration: Optional[Tuple[str, ...]],
+        plan: Optional[SchemaPlan],
+    ) -> None:
+        self.__name = name
+        self.__datatype = datatype
+        self.__typeName = typeName
+        self.__minValues = minValues
+        self.__maxValues = maxValues
+        self.__enumeration = enumeration
+        self.__plan = plan
+
+    def name(self) -> str:
+        """
+        Returns:
+            The name of this element.
+        """
+        return self.__name
+
+    def datatype(self) -> int:
+        """
+        Returns:
+            The datatype of the values of this element, see
+            :class:`DataType`.
+        """
+        return self.__datatype
+
+    def typeName(self) -> Optional[str]:
+        """
+        Returns:
+            The name of the type of this element.
+        """
+        return self.__typeName
+
+    def minValues(self) -> int:
+        """
+        Returns:
+            The minimum number of occurrences of this element, as
+            :meth:`SchemaElementDefinition.minValues`.
+        """
+        return self.__minValues
+
+    def maxValues(self) -> int:
+        """
+        Returns:
+            The maximum number of occurrences of this element, or
+            :attr:`SchemaElementDefinition.UNBOUNDED` for unbounded arrays.
+        """
+        return self.__maxValues
+
+    def isArray(self) -> bool:
+        """
+        Returns:
+            ``True`` if this element is an array, i.e. may occur more than
+            once.
+        """
+        return self.__maxValues != 1
+
+    def isOptional(self) -> bool:
+        """
+        Returns:
+            ``True`` if this element may be absent, i.e. may occur zero
+            times.
+        """
+        return self.__minValues == 0
+
+    def isComplexType(self) -> bool:
+        """
+        Returns:
+            ``True`` if the values of this element are sequences or choices
+            of elements, described by :meth:`plan`.
+        """
+        return self.__plan is not None
+
+    def enumeration(self) -> Optional[Tuple[str, ...]]:
+        """
+        Returns:
+            The names of the constants of the enumeration of this element,
+            or ``None`` if this element is not an enumeration.
+        """
+        return self.__enumeration
+
+    def plan(self) -> Optional[SchemaPlan]:
+        """
+        Returns:
+            The plan of the complex type of this element, or ``None`` if
+            this element is not of a complex type.
+        """
+        return self.__plan
+
+    def columnKind(self) -> int:
+        """
+        Returns:
+            The kind of the :class:`ColumnarExtractor` column storing this
+            element: :attr:`ColumnarExtractor.INT64`,
+            :attr:`~ColumnarExtractor.FLOAT64`,
+            :attr:`~ColumnarExtractor.BOOL` or
+            :attr:`~ColumnarExtractor.TIMESTAMP` for the elements of these
+            datatypes which are neither arrays nor of a complex type,
+            :attr:`~ColumnarExtractor.OBJECT` otherwise.
+        """
+        if self.isArray():
+            return ColumnarExtractor.OBJECT
+        return _COLUMN_KINDS.get(self.__datatype, ColumnarExtractor.OBJECT)
+
+    def __repr__(self) -> str:
+        return f"FieldPlan({self.__name!r}, {self.__typeName!r})"
+
+
+class SchemaPlan:
+    """The compiled definition of a complex type of a schema: the
+    :class:`FieldPlan` of each of its elements, in schema order.
+
+    A :class:`SchemaPlan` is compiled once from a
+    :class:`SchemaElementDefinition`, such as the definition of an event of a
+    :class:`Service` or the request definition of an :class:`Operation`,
+    usually through :meth:`Service.schemaPlan`. It holds no handle to the
+    schema, and remains valid after the :class:`Session` of the schema is
+    stopped.
+
+    A :class:`SchemaPlan` is read-only and can be used from any thread.
+    """
+
+    def __init__(self, element: _Element, types: Sequence[_Type]) -> None:
+        """Use :meth:`compile`, :meth:`load` or :meth:`Service.schemaPlan`
+        to create a :class:`SchemaPlan`."""
+        name, typeIndex, _, _ = element
+        if types[typeIndex][1] not in (
+            internals.DATATYPE_SEQUENCE,
+            internals.DATATYPE_CHOICE,
+        ):
+            raise InvalidArgumentException(
+                f"Element '{name}' is not of a complex type", 0
+            )
+        self.__init(
+            tuple(element),  # type: ignore
+            [tuple(entry) for entry in types],
+            typeIndex,
+            {},
+        )
+
+    def __init(
+        self,
+        element: _Element,
+        types: List[_Type],
+        typeIndex: int,
+        plans: Dict[int, SchemaPlan],
+    ) -> None:
+        # the types are shared by the plans of the complex types reached
+        # from 'element', each type having a single plan
+        plans[typeIndex] = self
+        self.__element = element
+        self.__types = types
+        self.__selector: Optional[FieldSelector] = None
+        self.__extractor: Optional[ColumnarExtractor] = None
+        self.__name, self.__datatype, fields, _ = types[typeIndex]
+        self.__fields: List[FieldPlan] = []
+        for fieldName, fieldTypeIndex, minValues, maxValues in fields:
+            typeName, datatype, _, enumeration = types[fieldTypeIndex]
+            plan = None
+            if datatype in (
+                internals.DATATYPE_SEQUENCE,
+                internals.DATATYPE_CHOICE,
+            ):
+                plan = plans.get(fieldTypeIndex)
+                if plan is None:
+                    plan = SchemaPlan.__new__(SchemaPlan)
+                    plan.__init(
+                        (fieldName, fieldTypeIndex, 1, 1),
+                        types,
+                        fieldTypeIndex,
+                        plans,
+                    )
+            self.__fields.append(
+                FieldPlan(
+                    fieldName,
+                    datatype,
+                    typeName,
+                    minValues,
+                    maxValues,
+                    enumeration,
+                    plan,
+                )
+            )
+        self.__fieldsByName = {field.name(): field for field in self.__fields}
+
+    @staticmethod
+    def compile(definition: SchemaElementDefinition) -> SchemaPlan:
+        """
+        Args:
+            definition: The definition of an element of a complex type
+
+        Returns:
+            The plan of the type of ``definition``.
+
+        Raises:
+            InvalidArgumentException: If ``definition`` is not of a complex
+                type
+        """
+        # pylint: disable=protected-access
+        if internals.SchemaPlan_compile is not None:
+            element, types = internals.SchemaPlan_compile(
+                definition._handle()
+            )
+        else:
+            element, types = _compileDefinition(definition._handle())
+        return SchemaPlan(element, types)
+
+    def name(self) -> Optional[str]:
+        """
+        Returns:
+            The name of the type of this plan.
+        """
+        return self.__name
+
+    def isChoice(self) -> bool:
+        """
+        Returns:
+            ``True`` if the values of this type hold exactly one of its
+            elements, ``False`` if they hold any of them.
+        """
+        return self.__datatype == internals.DATATYPE_CHOICE
+
+    def fields(self) -> List[FieldPlan]:
+        """
+        Returns:
+            The plans of the elements of this type, in schema order.
+        """
+        return list(self.__fields)
+
+    def hasField(self, name: Union[Name, str]) -> bool:
+        """
+        Args:
+            name: The name of an element
+
+        Returns:
+            ``True`` if this type has an element named ``name``.
+        """
+        return str(name) in self.__fieldsByName
+
+    def getField(self, name: Union[Name, str]) -> FieldPlan:
+        """
+        Args:
+            name: The name of an element
+
+        Returns:
+            The plan of the element of this type named ``name``.
+
+        Raises:
+            NotFoundException: If this type has no element named ``name``
+        """
+        field = self.__fieldsByName.get(str(name))
+        if field is None:
+            raise NotFoundException(
+                f"'{self.__name}' has no element named '{name}'", 0
+            )
+        return field
+
+    def __len__(self) -> int:
+        return len(self.__fields)
+
+    def __iter__(self) -> Iterator[FieldPlan]:
+        return iter(self.__fields)
+
+    def __contains__(self, name: Union[Name, str]) -> bool:
+        return self.hasField(name)
+
+    def fieldSelector(
+        self, fields: Optional[Sequence[Union[Name, str]]] = None
+    ) -> FieldSelector:
+        """
+        Args:
+            fields: The names of elements of this type, all of them by
+                default
+
+        Returns:
+            The selector of ``fields``, to convert only them with
+            :meth:`Message.toPy` and :meth:`Event.toPy`. The selector of all
+            the elements is created once.
+
+        Raises:
+            NotFoundException: If this type has no element named as one of
+                ``fields``
+        """
+        if fields is None:
+            if self.__selector is None:
+                self.__selector = FieldSelector(
+                    field.name() for field in self.__fields
+                )
+            return self.__selector
+        return FieldSelector(self.getField(name).name() for name in fields)
+
+    def columnarExtractor(
+        self, fields: Optional[Sequence[Union[Name, str]]] = None
+    ) -> ColumnarExtractor:
+        """
+        Args:
+            fields: The names of elements of this type, all of them by
+                default
+
+        Returns:
+            The extractor of ``fields`` into columns of the kinds given by
+            :meth:`FieldPlan.columnKind`. The extractor of all the elements
+            is created once.
+
+        Raises:
+            NotFoundException: If this type has no element named as one of
+                ``fields``
+        """
+        if fields is None:
+            if self.__extractor is None:
+                self.__extractor = ColumnarExtractor(
+                    [(field.name(), field.columnKind()) for field in self]
+                )
+            return self.__extractor
+        plans = [self.getField(name) for name in fields]
+        return ColumnarExtractor(
+            [(field.name(), field.columnKind()) for field in plans]
+        )
+
+    def validate(self, value: Mapping) -> None:
+        """Check ``value``, as given to :meth:`Request.fromPy` or
+        :meth:`EventFormatter.fromPy`, against this plan, without
+        formatting it.
+
+        Args:
+            value: The value of an element of this type
+
+        Raises:
+            InvalidArgumentException: If ``value`` names an element that
+                this type does not have, holds a :class:`Mapping` or a
+                sequence where the schema does not allow one, has more
+                values than an array allows, sets more than one element of
+                a choice, or holds a value that is not a constant of its
+                enumeration. The message gives the path of the first
+                offending value.
+
+        The values of the elements are only checked against their
+        datatypes where they obviously cannot be converted, e.g. a date for
+        a numeric element: a value accepted by :meth:`validate` may still be
+        rejected by the C library when it is formatted. Elements missing
+        from ``value`` are not reported.
+        """
+        self._validate(value, "")
+
+    def _validate(self, value: Any, path: str) -> None:
+        """Same as :meth:`validate` for the value at ``path``. For internal
+        use."""
+        if not isinstance(value, Mapping):
+            raise _invalid(path, "expected a `Mapping`")
+        if self.isChoice() and len(value) > 1:
+            raise _invalid(path, "more than one element of a choice")
+        for key, item in value.items():
+            field = self.__fieldsByName.get(str(key))
+            itemPath = f"{path}/{key}" if path else str(key)
+            if field is None:
+                raise _invalid(
+                    itemPath, f"'{self.__name}' has no such element"
+                )
+            if not field.isArray():
+                _validateValue(field, item, itemPath)
+                continue
+            if item is None:
+                continue
+            if not isNonScalarSequence(item):
+                raise _invalid(itemPath, "expected a `Sequence`")
+            if field.maxValues() != -1 and len(item) > field.maxValues():
+                raise _invalid(
+                    itemPath, f"more than {field.maxValues()} values"
+                )
+            for index, entry in enumerate(item):
+                _validateValue(field, entry, f"{itemPath}[{index}]")
+
+    def toDict(self) -> Dict[str, Any]:
+        """
+        Returns:
+            The ``dict`` of this plan, holding only ``dict``\\ s, ``list``\\ s,
+            strings and integers, from which :meth:`fromDict` creates an
+            equal plan.
+        """
+        return {
+            "version": _FORMAT_VERSION,
+            "element": list(self.__element),
+            "types": [
+                [
+                    name,
+                    datatype,
+                    [list(field) for field in fields],
+                    None if enumeration is None else list(enumeration),
+                ]
+                for name, datatype, fields, enumeration in self.__types
+            ],
+        }
+
+    @staticmethod
+    def fromDict(value: Mapping) -> SchemaPlan:
+        """
+        Args:
+            value: A ``dict`` returned by :meth:`toDict`
+
+        Returns:
+            The plan of ``value``.
+
+        Raises:
+            InvalidArgumentException: If ``value`` was not returned by
+                :meth:`toDict` of this version of the package
+        """
+        try:
+            if value["version"] != _FORMAT_VERSION:
+                raise ValueError(value["version"])
+            element = tuple(value["element"])
+            types = [
+                (
+                    name,
+                    datatype,
+                    tuple(tuple(field) for field in fields),
+                    None if enumeration is None else tuple(enumeration),
+                )
+                for name, datatype, fields, enumeration in value["types"]
+            ]
+            return SchemaPlan(element, types)  # type: ignore
+        except (KeyError, TypeError, ValueError, IndexError) as error:
+            raise InvalidArgumentException(
+                f"Invalid schema plan: {error!r}", 0
+            ) from error
+
+    def save(self, path: str) -> None:
+        """Save this plan to the file ``path``, replaced atomically if it
+        exists.
+
+        Args:
+            path: The path of the file
+        """
+        # 'json' is only imported by the applications persisting plans
+        import json  # pylint: disable=import-outside-toplevel
+
+        temporary = f"{path}.{os.getpid()}.tmp"
+        with open(temporary, "w", encoding="utf-8") as file:
+            json.dump(self.toDict(), file, separators=(",", ":"))
+        os.replace(temporary, path)
+
+    @staticmethod
+    def load(path: str) -> SchemaPlan:
+        """
+        Args:
+            path: The path of a file written by :meth:`save`
+
+        Returns:
+            The plan saved in ``path``.
+
+        Raises:
+            OSError: If ``path`` cannot be read
+            InvalidArgumentException: If ``path`` does not hold a plan saved
+                by this version of the package
+        """
+        import json  # pylint: disable=import-outside-toplevel
+
+        with open(path, "r", encoding="utf-8") as file:
+            try:
+                value = json.load(file)
+            except ValueError as error:
+                raise InvalidArgumentException(
+                    f"Invalid schema plan: {error!r}", 0
+                ) from error
+        return SchemaPlan.fromDict(value)
+
+    def __repr__(self) -> str:
+        return f"SchemaPlan({self.__name!r}, {len(self.__fields)} fields)"
+
+
+def _invalid(path: str, reason: str) -> InvalidArgumentException:
+    where = f"'{path}'" if path else "the value"
+    return InvalidArgumentException(f"While validating {where}: {reason}", 0)
+
+
+def _validateValue(field: FieldPlan, value: Any, path: str) -> None:
+    """Check that ``value`` is a value, not an array, of ``field``."""
+    plan = field.plan()
+    if plan is not None:
+        plan._validate(value, path)  # pylint: disable=protected-access
+        return
+    if value is None:
+        return
+    if isinstance(value, Mapping):
+        raise _invalid(path, "encountered a `Mapping` for a scalar element")
+    if isNonScalarSequence(value):
+        raise _invalid(path, "encountered a `Sequence` for a scalar value")
+    enumeration = field.enumeration()
+    if enumeration is not None:
+        if isinstance(value, (str, Name)) and str(value) not in enumeration:
+            raise _invalid(
+                path, f"'{value}' is not a constant of the enumeration"
+            )
+        return
+    datatype = field.datatype()
+    if datatype in _NUMERIC_DATATYPES and isinstance(
+        value, (datetime.date, datetime.time)
+    ):
+        raise _invalid(path, "encountered a date or time for a number")
+    if datatype in _TEMPORAL_DATATYPES and isinstance(
+        value, (bool, int, float)
+    ):
+        raise _invalid(path, "encountered a number for a date or time")
+
+
+__copyright__ = """
+Copyright 2024. Bloomberg Finance L.P.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to
+deal in the Software without restriction, including without limitation the
+rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+sell copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:  The above
+copyright notice and this permission notice shall be included in all copies
+or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+IN THE SOFTWARE.
+"""
@@ -7,17 +7,22 @@ from a Session and contains zero or more 'Operations'. A service can be a
 provider service (can generate API data) or a consumer service.
 
 """
+import os
 import warnings
-from typing import Optional, Set
+from typing import Dict, Optional, Sequence, Set, Union
+from typing import Mapping as MappingType
 from typing import Iterator as IteratorType
 from . import typehints  # pylint: disable=unused-import
 from .typehints import BlpapiNameOrIndex
 from .typehints import BlpapiServiceHandle, BlpapiOperationHandle
 from .event import Event
-from .name import getNamePair
+from .name import Name, getNamePair
+from .preparedrequest import PreparedRequest
 from .request import Request
 from .schema import SchemaElementDefinition
-from .exception import _ExceptionUtil
+from .schemaplan import SchemaPlan
+from .exception import _ExceptionUtil, InvalidArgumentException
+from .exception import NotFoundException
 from . import utils
 from . import internals
 from .chandle import CHandle
@@ -146,6 +151,8 @@ class Service(CHandle):
         super(Service, self).__init__(handle, internals.blpapi_Service_release)
         self.__handle = handle
         self.__sessions = sessions
+        self.__schemaPlans: Dict[str, SchemaPlan] = {}
+        self.__schemaDigest: Optional[str] = None
         if isRealService:  # as opposed to deserialized
             # see blpapi-cpp/src/blpapi_testutil.cpp#L270
             internals.blpapi_Service_addRef(self.__handle)
@@ -431,6 +438,117 @@ class Service(CHandle):
         _ExceptionUtil.raiseOnError(errCode)
         return Request(request, self.__sessions)
 
+    def prepareRequest(
+        self,
+        operation: Union[Name, str],
+        value: MappingType,
+        slots: Sequence[Union[Name, str]] = (),
+    ) -> PreparedRequest:
+        """Prepare the requests of the specified ``operation`` that share the
+        content ``value`` and differ by the elements named by ``slots``.
+
+        Args:
+            operation: A valid operation on this service
+            value: The content shared by the requests, as given to
+                :meth:`Request.fromPy()`. The values of the ``slots``, if
+                any, are ignored.
+            slots: The names of the top-level elements set for each request
+
+        Returns:
+            The prepared requests of the ``operation``.
+
+        Raises:
+            Exception: If ``operation`` does not identify a valid operation in
+                the :class:`Service`, if a slot is not an element of its
+                requests, or if ``value`` cannot format a request.
+
+        See :class:`PreparedRequest` for how to create and send the requests.
+        """
+
+        return PreparedRequest(self, operation, value, slots)
+
+    def schemaPlan(
+        self, name: Union[Name, str], cacheDirectory: Optional[str] = None
+    ) -> SchemaPlan:
+        """Get the compiled schema of the event, the request or the
+        response named ``name``.
+
+        Args:
+            name: The name of an event definition of this service, of an
+                operation, whose request definition is compiled, or of a
+                response definition of an operation
+            cacheDirectory: The directory where the plans are saved, to be
+                loaded by later runs instead of being compiled, if any
+
+        Returns:
+            The plan of the definition named ``name``, compiled once per
+            :class:`Service` object.
+
+        Raises:
+            NotFoundException: If this service has no definition named
+                ``name``
+            InvalidArgumentException: If the definition is not of a complex
+                type
+
+        The file of a plan in ``cacheDirectory`` is named after this
+        service, ``name`` and a digest of the whole schema of this service,
+        so that a plan is only loaded for the schema it was compiled from.
+        Computing the digest prints the schema once per :class:`Service`
+        object, which costs a single call into the C library. A file that
+        cannot be read is compiled again, and a plan that cannot be saved
+        is not.
+        """
+        key = str(name)
+        plan = self.__schemaPlans.get(key)
+        if plan is not None:
+            return plan
+        path = None
+        if cacheDirectory is not None:
+            path = self.__schemaPlanPath(cacheDirectory, key)
+            try:
+                plan = SchemaPlan.load(path)
+            except (OSError, InvalidArgumentException):
+                plan = None
+        if plan is None:
+            plan = SchemaPlan.compile(self.__schemaDefinition(key))
+            if path is not None:
+                try:
+                    plan.save(path)
+                except OSError:
+                    pass
+        self.__schemaPlans[key] = plan
+        return plan
+
+    def __schemaDefinition(self, name: str) -> SchemaElementDefinition:
+        if self.hasEventDefinition(name):
+            return self.getEventDefinition(name)
+        if self.hasOperation(name):
+            definition = self.getOperation(name).requestDefinition()
+            if definition is not None:
+                return definition
+        for operation in self.operations():
+            for definition in operation.responseDefinitions():
+                if str(definition.name()) == name:
+                    return definition
+        raise NotFoundException(
+            f"'{self.name()}' has no event, operation or response"
+            f" named '{name}'",
+            0,
+        )
+
+    def __schemaPlanPath(self, cacheDirectory: str, name: str) -> str:
+        if self.__schemaDigest is None:
+            import hashlib  # pylint: disable=import-outside-toplevel
+
+            self.__schemaDigest = hashlib.sha256(
+                self.toString().encode("utf-8")
+            ).hexdigest()[:32]
+        serviceName = self.name().strip("/").replace("/", "_")
+        return os.path.join(
+            cacheDirectory,
+            f"{serviceName}-{name}-{self.__schemaDigest}.json",
+        )
+
     def createAuthorizationRequest(
         self, authorizationOperation: Optional[str] = None
     ) -> Request:
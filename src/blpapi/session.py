@@ -7,15 +7,13 @@ This component implements a consumer session for getting services.
 
 from __future__ import annotations
 from weakref import ref, ReferenceType  # pylint: disable=unused-import
-from typing import Optional, Callable, Any, List
-import sys
-import traceback
-import os
-import functools
+from typing import Optional, Callable, Any, List, Union
 import atexit
 from enum import Enum
 from .abstractsession import AbstractSession
 from .event import Event
+from .lastvaluecache import LastValueCache
+from .latencymonitor import LatencyMonitor
 from . import exception
 from .exception import _ExceptionUtil
 from . import internals
@@ -24,7 +22,6 @@ from .sessionoptions import SessionOptions
 from .requesttemplate import RequestTemplate
 from .utils import get_handle, MetaClassForClassesWithEnums
 from . import typehints  # pylint: disable=unused-import
-from .typehints import BlpapiEventHandle
 
 
 # pylint: disable=too-many-arguments,protected-access,bare-except
@@ -114,28 +111,21 @@ class Session(AbstractSession, metaclass=MetaClassForClassesWithEnums):
     PENDING_CANCELLATION = internals.SUBSCRIPTIONSTATUS_PENDING_CANCELLATION
     """No longer active, terminated by Application."""
 
-    @staticmethod
-    def __dispatchEvent(
-        sessionRef: "ReferenceType[Session]", eventHandle: BlpapiEventHandle
-    ) -> None:  # pragma: no cover
-        """event dispatcher"""
-        try:
-            session = sessionRef()
-            if session is not None:
-                event = Event(eventHandle, {session})
-                session.__handler(event, session)
-        except:
-            print("Exception in event handler:", file=sys.stderr)
-            traceback.print_exc(file=sys.stderr)
-            os._exit(1)
-
     def __init__(
         self,
         options: Optional[SessionOptions] = None,
-        eventHandler: Optional[Callable[[Event, Session], None]] = None,
+        eventHandler: Optional[
+            Union[
+                Callable[[Event, Session], None],
+                Callable[[List[Event], Session], None],
+            ]
+        ] = None,
         eventDispatcher: Optional["typehints.EventDispatcher"] = None,
+        dispatchInBatches: bool = False,
+        lastValueCache: Optional[LastValueCache] = None,
+        latencyMonitor: Optional[LatencyMonitor] = None,
     ) -> None:
-        """Create a consumer :class:`Session`.
+        r"""Create a consumer :class:`Session`.
 
         Args:
             options: Options to construct the session with
@@ -143,10 +133,18 @@ class Session(AbstractSession, metaclass=MetaClassForClassesWithEnums):
                 generated by the session. Takes two arguments - received event
                 and related session
             eventDispatcher: An optional dispatcher for events.
+            dispatchInBatches: Whether ``eventHandler`` takes a list of
+                received events instead of a single event
+            lastValueCache: An optional cache into which the subscription
+                data events are merged, instead of being given to
+                ``eventHandler``
+            latencyMonitor: An optional monitor into which the latencies of
+                the dispatch of the events are recorded
 
         Raises:
             InvalidArgumentException: If ``eventHandler`` is ``None`` and and
-                the ``eventDispatcher`` is not ``None``
+                the ``eventDispatcher``, the ``lastValueCache`` or the
+                ``latencyMonitor`` is not ``None``
 
         If ``eventHandler`` is not ``None`` then this :class:`Session` will
         operate in asynchronous mode, otherwise the :class:`Session` will
@@ -170,6 +168,28 @@ class Session(AbstractSession, metaclass=MetaClassForClassesWithEnums):
         receives small messages and processes each one very quickly then give
         each one a separate ``eventDispatcher``.
 
+        If ``dispatchInBatches`` is ``True``, ``eventHandler`` is called with
+        a non-empty list of :class:`Event`\s instead. While ``eventHandler``
+        runs on one of the threads of ``eventDispatcher``, the events
+        dispatched on its other threads are queued, and then passed in order
+        as the next list by the thread running ``eventHandler``. This lowers
+        the per event overhead of an ``eventDispatcher`` using several
+        threads, at the cost of running ``eventHandler`` on one thread at a
+        time.
+
+        If ``lastValueCache`` is not ``None``, the
+        :attr:`Event.SUBSCRIPTION_DATA` events are merged into it, as by
+        :meth:`LastValueCache.update`, on the threads of ``eventDispatcher``,
+        and the other events are given to ``eventHandler``. The application
+        then polls ``lastValueCache`` at its own rate: when the subscription
+        data arrives faster than it is processed, the updates of each
+        correlation id are conflated instead of being queued.
+
+        If ``latencyMonitor`` is not ``None``, the dispatch of each event to
+        ``eventHandler``, or to ``lastValueCache``, is recorded into it, on
+        the threads of ``eventDispatcher``, as described in
+        :class:`LatencyMonitor`.
+
         Note:
             In case of unhandled exception in ``eventHandler``, the exception
             traceback will be printed to ``sys.stderr`` and application will be
@@ -179,14 +199,26 @@ class Session(AbstractSession, metaclass=MetaClassForClassesWithEnums):
             raise exception.InvalidArgumentException(
                 "eventDispatcher is specified but eventHandler is None", 0
             )
+        if (eventHandler is None) and (lastValueCache is not None):
+            raise exception.InvalidArgumentException(
+                "lastValueCache is specified but eventHandler is None", 0
+            )
+        if (eventHandler is None) and (latencyMonitor is not None):
+            raise exception.InvalidArgumentException(
+                "latencyMonitor is specified but eventHandler is None", 0
+            )
         if options is None:
             options = SessionOptions()
         self.__handlerProxy = None
         if eventHandler is not None:
-            # pylint: disable=unused-private-member
-            self.__handler = eventHandler
-            self.__handlerProxy = functools.partial(
-                Session.__dispatchEvent, ref(self)
+            # pylint: disable=protected-access
+            self.__handlerProxy = internals.createEventHandler(
+                Event,
+                eventHandler,
+                ref(self),
+                dispatchInBatches,
+                None if lastValueCache is None else lastValueCache._table(),
+                None if latencyMonitor is None else latencyMonitor._table(),
             )
 
         # Note __handle in Session is not the __handle
@@ -309,7 +341,7 @@ class Session(AbstractSession, metaclass=MetaClassForClassesWithEnums):
 
         _ExceptionUtil.raiseOnError(retCode)
 
-        return Event(event, {self})
+        return Event(event, self._sessionSet())
 
     def tryNextEvent(self) -> Optional[Event]:
         r"""
@@ -323,7 +355,41 @@ class Session(AbstractSession, metaclass=MetaClassForClassesWithEnums):
         retCode, event = internals.blpapi_Session_tryNextEvent(self.__handle)
         if retCode:
             return None
-        return Event(event, {self})
+        return Event(event, self._sessionSet())
+
+    def drainEvents(self, maxEvents: int, timeout: int = 0) -> List[Event]:
+        r"""
+        Args:
+            maxEvents: Maximum number of events to return
+            timeout: Timeout threshold in milliseconds
+
+        Returns:
+            List of up to ``maxEvents`` next available events for this
+            session
+
+        Raises:
+            InvalidStateException: If invoked on a session created in
+                asynchronous mode
+            ValueError: If ``maxEvents`` is not positive
+
+        Wait for the next :class:`Event` as :meth:`nextEvent()` does, then
+        add the :class:`Event`\s already available for this session without
+        blocking again, in a single call. This is equivalent to, but cheaper
+        than, a :meth:`nextEvent()` followed by up to ``maxEvents - 1``
+        :meth:`tryNextEvent()` calls, which makes it well suited to catching
+        up with a backed up event queue.
+
+        If no :class:`Event` arrives within ``timeout`` milliseconds, return
+        an empty list instead of an event of type :attr:`~Event.TIMEOUT`.
+        """
+        retCode, events = internals.blpapi_Session_drainEvents(
+            self.__handle, maxEvents, timeout
+        )
+
+        _ExceptionUtil.raiseOnError(retCode)
+
+        sessions = self._sessionSet()
+        return [Event(event, sessions) for event in events]
 
     @staticmethod
     def _createErrorAppender(
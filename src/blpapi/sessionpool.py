@@ -0,0 +1,283 @@
+# sessionpool.py
+
+"""Provide a pool of sessions sharing the subscriptions of a large universe.
+
+This component defines a class, 'SessionPool', which shards the subscriptions
+it is given across several 'Session's, each with its own 'EventDispatcher',
+so that the conversion of the events of a large universe is spread across
+dispatcher threads and connections. The events of all the sessions are
+delivered to a single handler.
+
+When a session of the pool terminates, its subscriptions are subscribed again
+on the sessions still running.
+
+Usage
+-----
+The following subscribes a universe across four sessions.
+
+    def processEvent(event, session):
+        ...
+
+    pool = SessionPool(4, processEvent, sessionOptions)
+    pool.start()
+    pool.subscribe(
+        universe,
+        fields=["BID", "ASK"],
+        correlationIds=range(len(universe)),
+    )
+"""
+
+import threading
+from typing import Any, Callable, List, Mapping, Optional, Sequence, Union
+from .event import Event
+from .eventdispatcher import EventDispatcher
+from .names import Names
+from .session import Session
+from .sessionoptions import SessionOptions
+from .subscriptionlist import SubscriptionList, _subscriptionSuffix
+
+
+class SessionPool:
+    r"""A pool of :class:`Session`\s sharing subscriptions.
+
+    Each session of the pool has its own :class:`EventDispatcher` and calls
+    the same ``eventHandler``, with the event and the session that received
+    it. The subscriptions given to :meth:`subscribe` are spread evenly across
+    the sessions running. When a session terminates, or fails to start, its
+    subscriptions are moved to the sessions still running, the
+    ``SessionTerminated`` event being delivered to ``eventHandler`` as usual.
+
+    Note:
+        The subscriptions moved to another session keep their correlation
+        ids if they were given one, otherwise the new session generates
+        another.
+    """
+
+    def __init__(
+        self,
+        numSessions: int,
+        eventHandler: Callable[[Event, Session], None],
+        options: Optional[SessionOptions] = None,
+        numDispatcherThreads: int = 1,
+    ) -> None:
+        """Create a pool of ``numSessions`` sessions created with
+        ``options``, dispatching their events to ``eventHandler`` with
+        ``numDispatcherThreads`` threads each.
+
+        Args:
+            numSessions: The number of sessions of the pool
+            eventHandler: Handler of the events of all the sessions, called
+                with the event and the session
+            options: Options of the sessions
+            numDispatcherThreads: Number of threads of the dispatcher of each
+                session
+
+        Raises:
+            ValueError: If ``numSessions`` is not positive
+        """
+        if numSessions < 1:
+            raise ValueError("numSessions must be positive")
+        self.__eventHandler = eventHandler
+        self.__lock = threading.Lock()
+        self.__dispatchers = [
+            EventDispatcher(numDispatcherThreads) for _ in range(numSessions)
+        ]
+        self.__sessions = [
+            Session(options, self.__handleEvent, dispatcher)
+            for dispatcher in self.__dispatchers
+        ]
+        self.__running = [False] * numSessions
+        # the subscription strings and correlation ids of each session
+        self.__shards: List[List[Any]] = [[] for _ in range(numSessions)]
+        self.__nextShard = 0
+
+    def sessions(self) -> List[Session]:
+        """
+        Returns:
+            The sessions of this pool.
+        """
+        return list(self.__sessions)
+
+    def numSubscriptions(self) -> List[int]:
+        """
+        Returns:
+            The number of subscriptions of each session of this pool, in the
+            order of :meth:`sessions`.
+        """
+        with self.__lock:
+            return [len(shard) for shard in self.__shards]
+
+    def start(self) -> bool:
+        """Start the dispatchers and the sessions of this pool.
+
+        Returns:
+            ``True`` if all the sessions are started, ``False`` if some of
+            them failed to start, in which case their subscriptions are
+            shared among the others.
+        """
+        for dispatcher in self.__dispatchers:
+            dispatcher.start()
+        started = True
+        for index, session in enumerate(self.__sessions):
+            with self.__lock:
+                self.__running[index] = True
+            if not session.start():
+                started = False
+                self.__retire(session)
+        return started
+
+    def stop(self) -> None:
+        """Stop the sessions and the dispatchers of this pool."""
+        with self.__lock:
+            self.__running = [False] * len(self.__sessions)
+        for session in self.__sessions:
+            session.stop()
+        for dispatcher in self.__dispatchers:
+            dispatcher.stop()
+
+    def subscribe(
+        self,
+        topics: Sequence[Optional[str]],
+        fields: Union[str, Sequence[str], None] = None,
+        options: Union[str, Sequence[str], Mapping, None] = None,
+        correlationIds: Optional[Sequence[Any]] = None,
+    ) -> None:
+        """Subscribe to each of the ``topics``, with the same ``fields`` and
+        ``options``, spreading the subscriptions across the running sessions.
+
+        Args:
+            topics: The topics to subscribe to
+            fields: List of fields to subscribe to, for every topic
+            options: List of options, for every topic
+            correlationIds: The correlation ids of the subscriptions, one per
+                topic
+
+        Raises:
+            Exception: If no session of this pool is running
+            Exception: The first error of the sessions subscribing, whose
+                subscriptions are not kept by the pool
+
+        The arguments are those of :meth:`SubscriptionList.addMany`.
+        """
+        suffix = _subscriptionSuffix(fields, options)
+        entries = [
+            (
+                ("" if topic is None else topic) + suffix,
+                None if correlationIds is None else correlationIds[index],
+            )
+            for index, topic in enumerate(topics)
+        ]
+        if not self.__distribute(entries):
+            raise Exception("no session of the pool is running")
+
+    def __distribute(
+        self, entries: List[Any], raiseErrors: bool = True
+    ) -> bool:
+        """Subscribe to ``entries`` on the running sessions, round robin,
+        and return ``False`` if no session is running. The subscriptions
+        are made without the lock held.
+
+        If a session fails to subscribe after it was retired, its shard is
+        moved by ``__retire`` as usual. Otherwise, if ``raiseErrors`` is
+        set, the failure is an error of the subscriptions, which are dropped
+        from the shard of the session, and the first such error is raised
+        once the other shards are subscribed. If it is not set, as when
+        moving the subscriptions of a terminated session from its
+        dispatcher thread, the session may be going down without its
+        termination being delivered yet, and the subscriptions are left in
+        its shard, to be moved with it on termination."""
+        with self.__lock:
+            running = [
+                index
+                for index, isRunning in enumerate(self.__running)
+                if isRunning
+            ]
+            if not running:
+                return False
+            assigned: List[List[Any]] = [[] for _ in running]
+            for offset, entry in enumerate(entries):
+                assigned[(self.__nextShard + offset) % len(running)].append(
+                    entry
+                )
+            self.__nextShard = (self.__nextShard + len(entries)) % len(
+                running
+            )
+            # recorded before subscribing, so that a session retired in the
+            # meantime hands them over with the rest of its shard
+            for index, shard in zip(running, assigned):
+                self.__shards[index].extend(shard)
+
+        error: Optional[Exception] = None
+        for index, shard in zip(running, assigned):
+            if not shard:
+                continue
+            subscriptions = SubscriptionList()
+            subscriptions.addMany(
+                [entry[0] for entry in shard],
+                correlationIds=[entry[1] for entry in shard],
+            )
+            try:
+                self.__sessions[index].subscribe(subscriptions)
+            except Exception as exception:  # pylint: disable=broad-except
+                if not raiseErrors:
+                    continue
+                with self.__lock:
+                    if not self.__running[index]:
+                        # moved by '__retire' with the rest of the shard
+                        continue
+                    failed = {id(entry) for entry in shard}
+                    self.__shards[index] = [
+                        entry
+                        for entry in self.__shards[index]
+                        if id(entry) not in failed
+                    ]
+                if error is None:
+                    error = exception
+        if error is not None:
+            raise error
+        return True
+
+    def __retire(self, session: Session) -> None:
+        """Move the subscriptions of the stopped ``session`` to the running
+        sessions, if any."""
+        with self.__lock:
+            index = self.__sessions.index(session)
+            if not self.__running[index]:
+                return
+            self.__running[index] = False
+            entries = self.__shards[index]
+            self.__shards[index] = []
+        if entries:
+            self.__distribute(entries, raiseErrors=False)
+
+    def __handleEvent(self, event: Event, session: Session) -> None:
+        if event.eventType() == Event.SESSION_STATUS:
+            for message in event:
+                if message.messageType() in (
+                    Names.SESSION_TERMINATED,
+                    Names.SESSION_STARTUP_FAILURE,
+                ):
+                    self.__retire(session)
+        self.__eventHandler(event, session)
+
+
+__copyright__ = """
+Copyright 2024. Bloomberg Finance L.P.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to
+deal in the Software without restriction, including without limitation the
+rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+sell copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:  The above
+copyright notice and this permission notice shall be included in all copies
+or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+IN THE SOFTWARE.
+"""
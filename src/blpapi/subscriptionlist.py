@@ -82,7 +82,8 @@ The rules for qualifying the subscription string are:
 """
 
 from __future__ import absolute_import
-from typing import Mapping, Optional, Sequence, Union
+from collections.abc import Sequence as SequenceABC
+from typing import Any, Iterable, Mapping, Optional, Sequence, Union
 
 from .exception import _ExceptionUtil
 from . import internals
@@ -174,35 +175,78 @@ class SubscriptionList(CHandle):
         if topic is None:
             topic = ""
 
-        if fields:
-            if isstr(fields):
-                fields = conv2str(fields)  # type: ignore # the isstr() check means fields must be string by this point
-            else:
-                fields = ",".join(fields)
-            if fields:
-                topic += "?fields=" + fields
-
-        if options:
-            if isstr(options):
-                options_str = conv2str(options)  # type: ignore # the isstr() check means options must be string by this point
-            elif isinstance(options, (list, tuple)):
-                options_str = "&".join(options)
-            elif isinstance(options, dict):
-                options_str = "&".join(
-                    [
-                        key if val is None else f"{key}={val}"
-                        for key, val in options.items()
-                    ]
-                )
-            else:
-                options_str = ""
-
-            if options_str:
-                opts_prefix = "&" if fields else "?"
-                topic += opts_prefix + options_str
+        return internals.blpapi_SubscriptionList_addHelper(
+            self.__handle,
+            topic + _subscriptionSuffix(fields, options),
+            correlationId,
+        )
+
+    def addMany(
+        self,
+        topics: Iterable[Optional[str]],
+        fields: Union[str, Sequence[str], None] = None,
+        options: Union[str, Sequence[str], Mapping, None] = None,
+        correlationIds: Optional[Iterable[Any]] = None,
+    ) -> int:
+        """Add each of the specified ``topics`` to this
+        :class:`SubscriptionList`, with the same ``fields`` and ``options``.
+
+        Args:
+            topics: The topics to subscribe to
+            fields: List of fields to subscribe to, for every topic
+            options: List of options, for every topic
+            correlationIds: The correlation ids to associate with the
+                subscriptions, one per topic
 
+        Returns:
+            ``0`` if all the topics are added, otherwise the error code of the
+            first addition that failed, the following topics not being added.
+
+        This is equivalent to calling :meth:`add` for each topic, the
+        ``fields`` and ``options`` being represented as for :meth:`add`.
+        Each of the ``correlationIds`` is either a :class:`CorrelationId`, an
+        :py:class:`int`, which stands for ``CorrelationId(value)``, or
+        ``None``, which stands for an unset :class:`CorrelationId`.
+        If ``correlationIds`` is ``None``, all the correlation ids are unset.
+
+        The subscriptions with :py:class:`int` or unset correlation ids are
+        added in a single call into the ``blpapi`` extension module when it is
+        available, without creating a :class:`CorrelationId` per topic.
+        """
+        suffix = _subscriptionSuffix(fields, options)
+        if not isinstance(topics, SequenceABC):
+            topics = list(topics)
+        if correlationIds is not None and not isinstance(
+            correlationIds, SequenceABC
+        ):
+            correlationIds = list(correlationIds)
+        if internals.blpapi_SubscriptionList_addMany is not None:
+            return internals.blpapi_SubscriptionList_addMany(
+                self.__handle, topics, suffix, correlationIds, self.__addString
+            )
+
+        for index, topic in enumerate(topics):
+            correlationId = (
+                None if correlationIds is None else correlationIds[index]
+            )
+            retCode = self.__addString(
+                ("" if topic is None else topic) + suffix, correlationId
+            )
+            if retCode:
+                return retCode
+        return 0
+
+    def __addString(
+        self, subscriptionString: str, correlationId: Any
+    ) -> int:
+        """Add ``subscriptionString`` for the correlation id
+        ``correlationId`` as given to :meth:`addMany`."""
+        if correlationId is None:
+            correlationId = CorrelationId()
+        elif not isinstance(correlationId, CorrelationId):
+            correlationId = CorrelationId(correlationId)
         return internals.blpapi_SubscriptionList_addHelper(
-            self.__handle, topic, correlationId
+            self.__handle, subscriptionString, correlationId
         )
 
     def append(self, other: "typehints.SubscriptionList") -> int:
@@ -310,6 +354,44 @@ class SubscriptionList(CHandle):
         return res
 
 
+def _subscriptionSuffix(
+    fields: Union[str, Sequence[str], None],
+    options: Union[str, Sequence[str], Mapping, None],
+) -> str:
+    """Return the part of the subscription strings of
+    :meth:`SubscriptionList.add` that follows the topic, for ``fields`` and
+    ``options``."""
+    suffix = ""
+    if fields:
+        if isstr(fields):
+            fields = conv2str(fields)  # type: ignore # the isstr() check means fields must be string by this point
+        else:
+            fields = ",".join(fields)
+        if fields:
+            suffix += "?fields=" + fields
+
+    if options:
+        if isstr(options):
+            options_str = conv2str(options)  # type: ignore # the isstr() check means options must be string by this point
+        elif isinstance(options, (list, tuple)):
+            options_str = "&".join(options)
+        elif isinstance(options, dict):
+            options_str = "&".join(
+                [
+                    key if val is None else f"{key}={val}"
+                    for key, val in options.items()
+                ]
+            )
+        else:
+            options_str = ""
+
+        if options_str:
+            opts_prefix = "&" if fields else "?"
+            suffix += opts_prefix + options_str
+
+    return suffix
+
+
 __copyright__ = """
 Copyright 2012. Bloomberg Finance L.P.
 